@@ -14,10 +14,14 @@
 
 #include <epan/epan.h>
 #include <epan/column-info.h>
+#include <epan/conversation_table.h>
 #include <epan/dfilter/dfilter.h>
+#include <epan/dfilter/dfilter-cache.h>
+#include <epan/dfilter/dfilter-index.h>
 #include <epan/frame_data.h>
 #include <epan/frame_data_sequence.h>
 #include <wiretap/wtap.h>
+#include <wsutil/regex.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -91,6 +95,9 @@ typedef struct _capture_file {
   dfilter_t                  *rfcode;               /* Compiled read filter program */
   dfilter_t                  *dfcode;               /* Compiled display filter program */
   gchar                      *dfilter;              /* Display filter string */
+  dfilter_cache_t            *filter_cache;         /* Results of the display filters applied to this file */
+  dfilter_index_t            *field_index;          /* Values of the indexed fields, if any */
+  ct_first_pass_t            *conv_tables;          /* Conversation tables filled while reading, if any */
   gboolean                    redissecting;         /* TRUE if currently redissecting (cf_redissect_packets) */
   gboolean                    read_lock;            /* TRUE if currently processing a file (cf_read) */
   rescan_type                 redissection_queued;  /* Queued redissection type. */
@@ -104,7 +111,7 @@ typedef struct _capture_file {
   guint32                     search_pos;           /* Byte position of last byte found in a hex search */
   guint32                     search_len;           /* Length of bytes matching the search */
   gboolean                    case_type;            /* TRUE if case-insensitive text search */
-  GRegex                     *regex;                /* Set if regular expression search */
+  ws_regex_t                 *regex;                /* Set if regular expression search */
   search_charset_t            scs_type;             /* Character set for text search */
   search_direction            dir;                  /* Direction in which to do searches */
   gboolean                    search_in_progress;   /* TRUE if user just clicked OK in the Find dialog or hit <control>N/B */
@@ -55,8 +55,9 @@ main(int argc, char **argv)
 		cfile_close_failure_message
 	};
 	char		*text;
-	dfilter_t	*df;
+	dfilter_t	*df, *df_unopt;
 	gchar		*err_msg;
+	gint64		start, elapsed_unopt, elapsed_opt;
 
 	cmdarg_err_init(dftest_cmdarg_err, dftest_cmdarg_err_cont);
 
@@ -123,22 +124,46 @@ main(int argc, char **argv)
 
 	printf("Filter: %s\n", text);
 
-	/* Compile it */
+	/* Compile it, without and with the optimizer */
+	dfilter_set_optimize(FALSE);
+	start = g_get_monotonic_time();
+	if (!dfilter_compile(text, &df_unopt, &err_msg)) {
+		fprintf(stderr, "dftest: %s\n", err_msg);
+		g_free(err_msg);
+		epan_cleanup();
+		g_free(text);
+		exit(2);
+	}
+	elapsed_unopt = g_get_monotonic_time() - start;
+
+	dfilter_set_optimize(TRUE);
+	start = g_get_monotonic_time();
 	if (!dfilter_compile(text, &df, &err_msg)) {
 		fprintf(stderr, "dftest: %s\n", err_msg);
 		g_free(err_msg);
+		dfilter_free(df_unopt);
 		epan_cleanup();
 		g_free(text);
 		exit(2);
 	}
+	elapsed_opt = g_get_monotonic_time() - start;
 
 	printf("\n");
 
-	if (df == NULL)
+	if (df == NULL) {
 		printf("Filter is empty\n");
-	else
+	}
+	else {
+		printf("Unoptimized:\n");
+		dfilter_dump(df_unopt);
+		printf("\nOptimized:\n");
 		dfilter_dump(df);
+	}
+
+	printf("\nCompile time: %.3f ms unoptimized, %.3f ms optimized\n",
+		elapsed_unopt / 1000.0, elapsed_opt / 1000.0);
 
+	dfilter_free(df_unopt);
 	dfilter_free(df);
 	epan_cleanup();
 	g_free(text);
@@ -54,6 +54,13 @@ static gboolean filters_enabled = TRUE;
  */
 static gboolean tmp_colors_set = FALSE;
 
+/* The enabled filters of color_filter_list compiled into a single
+ * program, which reads each field only once per packet, and the filter
+ * for each rule of the program. Rebuilt when the list changes. */
+static dfilter_t *color_filter_program = NULL;
+static GPtrArray *color_filter_rules = NULL;
+static gboolean   color_filter_program_dirty = TRUE;
+
 /* Create a new filter */
 color_filter_t *
 color_filter_new(const gchar *name,          /* The name of the filter to create */
@@ -190,6 +197,7 @@ color_filters_set_tmp(guint8 filt_nr, const gchar *filter, gboolean disabled, gc
                 colorf->filter_text = g_strdup(tmpfilter);
                 colorf->c_colorfilter = compiled_filter;
                 colorf->disabled = ((i!=filt_nr) ? TRUE : disabled);
+                color_filter_program_dirty = TRUE;
                 /* Remember that there are now temporary coloring filters set */
                 if( filter )
                     tmp_colors_set = TRUE;
@@ -303,6 +311,8 @@ color_filters_get(gchar** err_msg, color_filter_add_cb_func add_cb)
     FILE     *f;
     int       ret;
 
+    color_filter_program_dirty = TRUE;
+
     /* start the list with the temporary colorizing rules */
     color_filters_add_tmp(&color_filter_list);
 
@@ -372,6 +382,14 @@ color_filters_cleanup(void)
 {
     /* delete the previously deleted filters */
     color_filter_list_delete(&color_filter_deleted_list);
+
+    dfilter_free(color_filter_program);
+    color_filter_program = NULL;
+    if (color_filter_rules) {
+        g_ptr_array_free(color_filter_rules, TRUE);
+        color_filter_rules = NULL;
+    }
+    color_filter_program_dirty = TRUE;
 }
 
 typedef struct _color_clone
@@ -452,6 +470,8 @@ color_filters_apply(GSList *tmp_cfl, GSList *edit_cfl, gchar** err_msg)
 
     *err_msg = NULL;
 
+    color_filter_program_dirty = TRUE;
+
     /* "move" old entries to the deleted list
      * we must keep them until the dissection no longer needs them */
     color_filter_deleted_list = g_slist_concat(color_filter_deleted_list, color_filter_list);
@@ -493,6 +513,56 @@ tmp_color_filters_used(void)
     return tmp_colors_set;
 }
 
+/* (Re)compile the enabled filters into color_filter_program */
+static void
+color_filters_build_program(void)
+{
+    GSList         *curr;
+    color_filter_t *colorf;
+    const gchar   **texts;
+    gchar          *err_msg = NULL;
+    guint           i;
+
+    color_filter_program_dirty = FALSE;
+
+    dfilter_free(color_filter_program);
+    color_filter_program = NULL;
+    if (color_filter_rules == NULL)
+        color_filter_rules = g_ptr_array_new();
+    g_ptr_array_set_size(color_filter_rules, 0);
+
+    for (curr = color_filter_list; curr != NULL; curr = g_slist_next(curr)) {
+        colorf = (color_filter_t *)curr->data;
+        if (!colorf->disabled && colorf->c_colorfilter != NULL)
+            g_ptr_array_add(color_filter_rules, colorf);
+    }
+    if (color_filter_rules->len == 0)
+        return;
+
+    texts = g_new(const gchar *, color_filter_rules->len);
+    for (i = 0; i < color_filter_rules->len; i++) {
+        colorf = (color_filter_t *)g_ptr_array_index(color_filter_rules, i);
+        texts[i] = colorf->filter_text;
+    }
+
+    /* Each filter compiles on its own, so this should never fail; if it
+     * does, color_filters_colorize_packet() applies them one by one. */
+    if (!dfilter_compile_rules(texts, color_filter_rules->len, &color_filter_program, &err_msg)) {
+        ws_warning("Could not combine the color filters: %s", err_msg);
+        g_free(err_msg);
+        color_filter_program = NULL;
+    }
+    g_free(texts);
+}
+
+static dfilter_t *
+color_filters_get_program(void)
+{
+    if (color_filter_program_dirty)
+        color_filters_build_program();
+    return color_filter_program;
+}
+
 /* prepare the epan_dissect_t for the filter */
 static void
 prime_edt(gpointer data, gpointer user_data)
@@ -509,8 +579,15 @@ prime_edt(gpointer data, gpointer user_data)
 void
 color_filters_prime_edt(epan_dissect_t *edt)
 {
-    if (color_filters_used())
-        g_slist_foreach(color_filter_list, prime_edt, edt);
+    dfilter_t *program;
+
+    if (color_filters_used()) {
+        program = color_filters_get_program();
+        if (program != NULL)
+            epan_dissect_prime_with_dfilter(edt, program);
+        else
+            g_slist_foreach(color_filter_list, prime_edt, edt);
+    }
 }
 
 /* * Return the color_t for later use */
@@ -519,9 +596,19 @@ color_filters_colorize_packet(epan_dissect_t *edt)
 {
     GSList         *curr;
     color_filter_t *colorf;
+    dfilter_t      *program;
+    int             rule;
 
     /* If we have color filters, "search" for the matching one. */
     if ((edt->tree != NULL) && (color_filters_used())) {
+        program = color_filters_get_program();
+        if (program != NULL) {
+            rule = dfilter_apply_rules(program, edt->tree);
+            if (rule < 0)
+                return NULL;
+            return (const color_filter_t *)g_ptr_array_index(color_filter_rules, rule);
+        }
+
         curr = color_filter_list;
 
         while(curr != NULL) {
@@ -538,6 +625,26 @@ color_filters_colorize_packet(epan_dissect_t *edt)
     return NULL;
 }
 
+/* Hash of everything that decides the color of a packet */
+guint
+color_filters_get_hash(void)
+{
+    GSList         *curr;
+    color_filter_t *colorf;
+    guint           hash = filters_enabled ? 1 : 0;
+
+    for (curr = color_filter_list; curr != NULL; curr = g_slist_next(curr)) {
+        colorf = (color_filter_t *)curr->data;
+        hash = hash * 31 + g_str_hash(colorf->filter_name ? colorf->filter_name : "");
+        hash = hash * 31 + g_str_hash(colorf->filter_text ? colorf->filter_text : "");
+        hash = hash * 31 + (colorf->disabled ? 1 : 0);
+        hash = hash * 31 + ((guint)colorf->bg_color.red << 16 ^ colorf->bg_color.green << 8 ^ colorf->bg_color.blue);
+        hash = hash * 31 + ((guint)colorf->fg_color.red << 16 ^ colorf->fg_color.green << 8 ^ colorf->fg_color.blue);
+    }
+
+    return hash;
+}
+
 /* read filters from the given file */
 /* XXX - Would it make more sense to use GStrings here instead of reallocing
    our buffers? */
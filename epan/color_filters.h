@@ -117,6 +117,14 @@ WS_DLL_PUBLIC void color_filters_prime_edt(struct epan_dissect *edt);
 WS_DLL_PUBLIC const color_filter_t *
 color_filters_colorize_packet(struct epan_dissect *edt);
 
+/** Get a hash of the active filter list.
+ *
+ * The hash covers the names, texts, colors, order and state of the
+ * filters, so callers can tell whether packets must be colorized again.
+ * @return the hash
+ */
+WS_DLL_PUBLIC guint color_filters_get_hash(void);
+
 /** Clone the currently active filter list.
  *
  * @param user_data will be returned by each call to to color_filter_add_cb()
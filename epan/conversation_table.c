@@ -186,62 +186,99 @@ guint conversation_table_get_num(void)
     return wmem_tree_count(registered_ct_tables);
 }
 
+/* Initial number of slots of the index of a table */
+#define CT_INDEX_MIN_SIZE 1024
+
+/* Hash of the item at a position of conv_array, to rebuild the index */
+typedef guint (*ct_item_hash_func)(const conv_hash_t *ch, guint idx);
+
+/* Mix the bits of a hash value, the index uses the lowest ones. */
+static inline guint
+ct_hash_finalize(guint hash_val)
+{
+    hash_val ^= hash_val >> 16;
+    hash_val *= 0x85ebca6bU;
+    hash_val ^= hash_val >> 13;
+    hash_val *= 0xc2b2ae35U;
+    hash_val ^= hash_val >> 16;
+    return hash_val;
+}
+
 /** Compute the hash value for two given address/port pairs.
- * (Parameter type is gconstpointer for GHashTable compatibility.)
+ * Both directions of a conversation have the same hash value, so that a
+ * single lookup finds it.
  *
- * @param v Conversation Key. MUST point to a conv_key_t struct.
  * @return Computed key hash.
  */
 static guint
-conversation_hash(gconstpointer v)
+conversation_hash(const address *addr1, guint32 port1, const address *addr2, guint32 port2, conv_id_t conv_id)
 {
-    const conv_key_t *key = (const conv_key_t *)v;
-    guint hash_val;
+    guint hash_val1 = add_address_to_hash(port1, addr1);
+    guint hash_val2 = add_address_to_hash(port2, addr2);
 
-    hash_val = 0;
-    hash_val = add_address_to_hash(hash_val, &key->addr1);
-    hash_val += key->port1;
-    hash_val = add_address_to_hash(hash_val, &key->addr2);
-    hash_val += key->port2;
-    hash_val ^= key->conv_id;
+    return ct_hash_finalize((hash_val1 + hash_val2) ^ conv_id);
+}
 
-    return hash_val;
+static guint
+conversation_item_hash(const conv_hash_t *ch, guint idx)
+{
+    const conv_item_t *conv_item = &g_array_index(ch->conv_array, conv_item_t, idx);
+
+    return conversation_hash(&conv_item->src_address, conv_item->src_port,
+                             &conv_item->dst_address, conv_item->dst_port, conv_item->conv_id);
 }
 
-/** Compare two conversation keys for an exact match.
- * (Parameter types are gconstpointer for GHashTable compatibility.)
- *
- * @param key1 First conversation. MUST point to a conv_key_t struct.
- * @param key2 Second conversation. MUST point to a conv_key_t struct.
- * @return TRUE if conversations are equal, FALSE otherwise.
+/*
+ * Compute the hash value for a given address/port pair.
  */
-static gboolean
-conversation_equal(gconstpointer key1, gconstpointer key2)
-{
-    const conv_key_t *ck1 = (const conv_key_t *)key1;
-    const conv_key_t *ck2 = (const conv_key_t *)key2;
-
-    if (ck1->conv_id == ck2->conv_id)
-    {
-        if (ck1->port1 == ck2->port1 &&
-            ck1->port2 == ck2->port2 &&
-            addresses_equal(&ck1->addr1, &ck2->addr1) &&
-            addresses_equal(&ck1->addr2, &ck2->addr2)) {
-            return TRUE;
-        }
+static guint
+host_hash(const address *addr, guint32 port)
+{
+    return ct_hash_finalize(add_address_to_hash(port, addr));
+}
 
-        if (ck1->port2 == ck2->port1 &&
-            ck1->port1 == ck2->port2 &&
-            addresses_equal(&ck1->addr2, &ck2->addr1) &&
-            addresses_equal(&ck1->addr1, &ck2->addr2)) {
-            return TRUE;
-        }
+static guint
+host_item_hash(const conv_hash_t *ch, guint idx)
+{
+    const hostlist_talker_t *host = &g_array_index(ch->conv_array, hostlist_talker_t, idx);
+
+    return host_hash(&host->myaddress, host->port);
+}
+
+static void
+ct_index_insert(guint32 *index, guint32 index_size, guint hash_val, guint idx)
+{
+    guint32 mask = index_size - 1;
+    guint32 slot = hash_val & mask;
+
+    while (index[slot] != 0) {
+        slot = (slot + 1) & mask;
     }
+    index[slot] = idx + 1;
+}
 
-    /*
-     * The addresses, ports, or conversation IDs don't match.
-     */
-    return FALSE;
+/*
+ * Add the last item of conv_array to the index. The index is kept at
+ * most half full so that lookups only probe a few slots.
+ */
+static void
+ct_index_add(conv_hash_t *ch, guint hash_val, ct_item_hash_func item_hash)
+{
+    guint idx = ch->conv_array->len - 1;
+
+    if (ch->conv_array->len * 2 > ch->index_size) {
+        guint32 new_size = ch->index_size ? ch->index_size * 2 : CT_INDEX_MIN_SIZE;
+        guint32 *new_index = g_new0(guint32, new_size);
+        guint i;
+
+        for (i = 0; i < idx; i++) {
+            ct_index_insert(new_index, new_size, item_hash(ch, i), i);
+        }
+        g_free(ch->index);
+        ch->index = new_index;
+        ch->index_size = new_size;
+    }
+    ct_index_insert(ch->index, ch->index_size, hash_val, idx);
 }
 
 void
@@ -262,12 +299,11 @@ reset_conversation_table_data(conv_hash_t *ch)
         g_array_free(ch->conv_array, TRUE);
     }
 
-    if (ch->hashtable != NULL) {
-        g_hash_table_destroy(ch->hashtable);
-    }
+    g_free(ch->index);
 
     ch->conv_array=NULL;
-    ch->hashtable=NULL;
+    ch->index=NULL;
+    ch->index_size=0;
 }
 
 void reset_hostlist_table_data(conv_hash_t *ch)
@@ -286,12 +322,11 @@ void reset_hostlist_table_data(conv_hash_t *ch)
         g_array_free(ch->conv_array, TRUE);
     }
 
-    if (ch->hashtable != NULL) {
-        g_hash_table_destroy(ch->hashtable);
-    }
+    g_free(ch->index);
 
     ch->conv_array=NULL;
-    ch->hashtable=NULL;
+    ch->index=NULL;
+    ch->index_size=0;
 }
 
 char *get_conversation_address(wmem_allocator_t *allocator, address *addr, gboolean resolve_names)
@@ -582,48 +617,43 @@ add_conversation_table_data_with_conv_id(
 {
     conv_item_t *conv_item = NULL;
     gboolean is_fwd_direction = FALSE; /* direction of any conversation found */
+    guint hash_val = conversation_hash(src, src_port, dst, dst_port, conv_id);
 
     /* if we don't have any entries at all yet */
     if (ch->conv_array == NULL) {
         ch->conv_array = g_array_sized_new(FALSE, FALSE, sizeof(conv_item_t), 10000);
+    } else { /* try to find it among the existing known conversations, in either direction */
+        guint32 mask = ch->index_size - 1;
+        guint32 slot;
 
-        ch->hashtable = g_hash_table_new_full(conversation_hash,
-                                              conversation_equal, /* key_equal_func */
-                                              g_free,             /* key_destroy_func */
-                                              NULL);              /* value_destroy_func */
-
-    } else { /* try to find it among the existing known conversations */
-        /* first, check in the fwd conversations */
-        conv_key_t existing_key;
-        gpointer conversation_idx_hash_val;
-
-        existing_key.addr1 = *src;
-        existing_key.addr2 = *dst;
-        existing_key.port1 = src_port;
-        existing_key.port2 = dst_port;
-        existing_key.conv_id = conv_id;
-        if (g_hash_table_lookup_extended(ch->hashtable, &existing_key, NULL, &conversation_idx_hash_val)) {
-            conv_item = &g_array_index(ch->conv_array, conv_item_t, GPOINTER_TO_UINT(conversation_idx_hash_val));
-        }
-        if (conv_item == NULL) {
-            /* then, check in the rev conversations if not found in 'fwd' */
-            existing_key.addr1 = *dst;
-            existing_key.addr2 = *src;
-            existing_key.port1 = dst_port;
-            existing_key.port2 = src_port;
-            if (g_hash_table_lookup_extended(ch->hashtable, &existing_key, NULL, &conversation_idx_hash_val)) {
-                conv_item = &g_array_index(ch->conv_array, conv_item_t, GPOINTER_TO_UINT(conversation_idx_hash_val));
+        for (slot = hash_val & mask; ch->index[slot] != 0; slot = (slot + 1) & mask) {
+            conv_item_t *existing_item = &g_array_index(ch->conv_array, conv_item_t, ch->index[slot] - 1);
+
+            if (existing_item->conv_id != conv_id) {
+                continue;
+            }
+            if (existing_item->src_port == src_port &&
+                existing_item->dst_port == dst_port &&
+                addresses_equal(&existing_item->src_address, src) &&
+                addresses_equal(&existing_item->dst_address, dst)) {
+                /* a conversation was found in this same fwd direction */
+                conv_item = existing_item;
+                is_fwd_direction = TRUE;
+                break;
+            }
+            if (existing_item->src_port == dst_port &&
+                existing_item->dst_port == src_port &&
+                addresses_equal(&existing_item->src_address, dst) &&
+                addresses_equal(&existing_item->dst_address, src)) {
+                conv_item = existing_item;
+                break;
             }
-        } else {
-            /* a conversation was found in this same fwd direction */
-            is_fwd_direction = TRUE;
         }
     }
 
     /* if we still don't know what conversation this is it has to be a new one
        and we have to allocate it and append it to the end of the list */
     if (conv_item == NULL) {
-        conv_key_t *new_key;
         conv_item_t new_conv_item;
         unsigned int conversation_idx;
 
@@ -651,15 +681,7 @@ add_conversation_table_data_with_conv_id(
         g_array_append_val(ch->conv_array, new_conv_item);
         conversation_idx = ch->conv_array->len - 1;
         conv_item = &g_array_index(ch->conv_array, conv_item_t, conversation_idx);
-
-        /* ct->conversations address is not a constant but src/dst_address.data are */
-        new_key = g_new(conv_key_t, 1);
-        set_address(&new_key->addr1, conv_item->src_address.type, conv_item->src_address.len, conv_item->src_address.data);
-        set_address(&new_key->addr2, conv_item->dst_address.type, conv_item->dst_address.len, conv_item->dst_address.data);
-        new_key->port1 = src_port;
-        new_key->port2 = dst_port;
-        new_key->conv_id = conv_id;
-        g_hash_table_insert(ch->hashtable, new_key, GUINT_TO_POINTER(conversation_idx));
+        ct_index_add(ch, hash_val, conversation_item_hash);
 
         /* update the conversation struct */
         conv_item->tx_frames += num_frames;
@@ -688,73 +710,35 @@ add_conversation_table_data_with_conv_id(
     }
 }
 
-/*
- * Compute the hash value for a given address/port pairs if the match
- * is to be exact.
- */
-static guint
-host_hash(gconstpointer v)
-{
-    const host_key_t *key = (const host_key_t *)v;
-    guint hash_val;
-
-    hash_val = 0;
-    hash_val = add_address_to_hash(hash_val, &key->myaddress);
-    hash_val += key->port;
-    return hash_val;
-}
-
-/*
- * Compare two host keys for an exact match.
- */
-static gint
-host_match(gconstpointer v, gconstpointer w)
-{
-    const host_key_t *v1 = (const host_key_t *)v;
-    const host_key_t *v2 = (const host_key_t *)w;
-
-    if (v1->port == v2->port &&
-        addresses_equal(&v1->myaddress, &v2->myaddress)) {
-        return 1;
-    }
-    /*
-     * The addresses or the ports don't match.
-     */
-    return 0;
-}
-
 void
 add_hostlist_table_data(conv_hash_t *ch, const address *addr, guint32 port, gboolean sender, int num_frames, int num_bytes, hostlist_dissector_info_t *host_info, endpoint_type etype)
 {
     hostlist_talker_t *talker=NULL;
+    guint hash_val = host_hash(addr, port);
 
-    /* XXX should be optimized to allocate n extra entries at a time
-       instead of just one */
     /* if we don't have any entries at all yet */
     if(ch->conv_array==NULL){
         ch->conv_array=g_array_sized_new(FALSE, FALSE, sizeof(hostlist_talker_t), 10000);
-        ch->hashtable = g_hash_table_new_full(host_hash,
-                                              host_match, /* key_equal_func */
-                                              g_free,     /* key_destroy_func */
-                                              NULL);      /* value_destroy_func */
     }
     else {
         /* try to find it among the existing known conversations */
-        host_key_t existing_key;
-        gpointer talker_idx_hash_val;
+        guint32 mask = ch->index_size - 1;
+        guint32 slot;
 
-        copy_address_shallow(&existing_key.myaddress, addr);
-        existing_key.port = port;
+        for (slot = hash_val & mask; ch->index[slot] != 0; slot = (slot + 1) & mask) {
+            hostlist_talker_t *existing_talker = &g_array_index(ch->conv_array, hostlist_talker_t, ch->index[slot] - 1);
 
-        if (g_hash_table_lookup_extended(ch->hashtable, &existing_key, NULL, &talker_idx_hash_val)) {
-            talker = &g_array_index(ch->conv_array, hostlist_talker_t, GPOINTER_TO_UINT(talker_idx_hash_val));
+            if (existing_talker->port == port &&
+                addresses_equal(&existing_talker->myaddress, addr)) {
+                talker = existing_talker;
+                break;
+            }
         }
     }
 
     /* if we still don't know what talker this is it has to be a new one
        and we have to allocate it and append it to the end of the list */
     if(talker==NULL){
-        host_key_t *new_key;
         hostlist_talker_t host;
         int talker_idx;
 
@@ -771,12 +755,7 @@ add_hostlist_table_data(conv_hash_t *ch, const address *addr, guint32 port, gboo
         g_array_append_val(ch->conv_array, host);
         talker_idx= ch->conv_array->len - 1;
         talker=&g_array_index(ch->conv_array, hostlist_talker_t, talker_idx);
-
-        /* hl->hosts address is not a constant but address.data is */
-        new_key = g_new(host_key_t,1);
-        set_address(&new_key->myaddress, talker->myaddress.type, talker->myaddress.len, talker->myaddress.data);
-        new_key->port = port;
-        g_hash_table_insert(ch->hashtable, new_key, GUINT_TO_POINTER(talker_idx));
+        ct_index_add(ch, hash_val, host_item_hash);
     }
 
     /* if this is a new talker we need to initialize the struct */
@@ -792,6 +771,175 @@ add_hostlist_table_data(conv_hash_t *ch, const address *addr, guint32 port, gboo
     }
 }
 
+/* A conversation or endpoint table filled while a capture file is read */
+typedef struct {
+    ct_first_pass_t *first_pass;
+    register_ct_t *table;
+    gboolean hostlist;
+    conv_hash_t hash;
+} ct_first_pass_table_t;
+
+struct _ct_first_pass_t {
+    gboolean active;
+    GPtrArray *tables;
+};
+
+static tap_packet_status
+first_pass_table_packet(void *tapdata, packet_info *pinfo, epan_dissect_t *edt, const void *data)
+{
+    ct_first_pass_table_t *fp_table = (ct_first_pass_table_t *)tapdata;
+    tap_packet_cb packet_func;
+
+    if (!fp_table->first_pass->active) {
+        return TAP_PACKET_DONT_REDRAW;
+    }
+
+    packet_func = fp_table->hostlist ? fp_table->table->host_func : fp_table->table->conv_func;
+    return packet_func(&fp_table->hash, pinfo, edt, data);
+}
+
+static void
+first_pass_table_free(gpointer data)
+{
+    ct_first_pass_table_t *fp_table = (ct_first_pass_table_t *)data;
+
+    remove_tap_listener(fp_table);
+    if (fp_table->hostlist) {
+        reset_hostlist_table_data(&fp_table->hash);
+    } else {
+        reset_conversation_table_data(&fp_table->hash);
+    }
+    g_free(fp_table);
+}
+
+ct_first_pass_t *
+conversation_table_first_pass_new(const char *table_names)
+{
+    ct_first_pass_t *first_pass;
+    gchar **names;
+    int i;
+
+    if (table_names == NULL || table_names[0] == '\0') {
+        return NULL;
+    }
+
+    first_pass = g_new0(ct_first_pass_t, 1);
+    first_pass->tables = g_ptr_array_new_with_free_func(first_pass_table_free);
+
+    names = g_strsplit(table_names, ",", -1);
+    for (i = 0; names[i] != NULL; i++) {
+        register_ct_t *table = get_conversation_by_proto_id(proto_get_id_by_short_name(g_strstrip(names[i])));
+        int hostlist;
+
+        if (table == NULL || conversation_table_first_pass_lookup(first_pass, table, FALSE) != NULL) {
+            continue;
+        }
+
+        for (hostlist = 0; hostlist <= 1; hostlist++) {
+            ct_first_pass_table_t *fp_table;
+            GString *error_string;
+
+            if ((hostlist ? table->host_func : table->conv_func) == NULL) {
+                continue;
+            }
+
+            fp_table = g_new0(ct_first_pass_table_t, 1);
+            fp_table->first_pass = first_pass;
+            fp_table->table = table;
+            fp_table->hostlist = hostlist;
+
+            /* Only the first pass needs the frames; rescans don't. */
+            error_string = register_tap_listener(proto_get_protocol_filter_name(table->proto_id), fp_table, NULL,
+                                                 TL_IS_DISSECTOR_HELPER, NULL, first_pass_table_packet, NULL, NULL);
+            if (error_string) {
+                g_string_free(error_string, TRUE);
+                g_free(fp_table);
+                continue;
+            }
+            g_ptr_array_add(first_pass->tables, fp_table);
+        }
+    }
+    g_strfreev(names);
+
+    if (first_pass->tables->len == 0) {
+        conversation_table_first_pass_free(first_pass);
+        return NULL;
+    }
+    return first_pass;
+}
+
+void
+conversation_table_first_pass_free(ct_first_pass_t *first_pass)
+{
+    if (!first_pass) {
+        return;
+    }
+
+    g_ptr_array_free(first_pass->tables, TRUE);
+    g_free(first_pass);
+}
+
+void
+conversation_table_first_pass_set_active(ct_first_pass_t *first_pass, gboolean active)
+{
+    first_pass->active = active;
+}
+
+const conv_hash_t *
+conversation_table_first_pass_lookup(ct_first_pass_t *first_pass, register_ct_t *table, gboolean hostlist)
+{
+    guint i;
+
+    if (!first_pass) {
+        return NULL;
+    }
+
+    for (i = 0; i < first_pass->tables->len; i++) {
+        ct_first_pass_table_t *fp_table = (ct_first_pass_table_t *)g_ptr_array_index(first_pass->tables, i);
+
+        if (fp_table->table == table && fp_table->hostlist == hostlist) {
+            return &fp_table->hash;
+        }
+    }
+    return NULL;
+}
+
+gboolean
+conversation_table_first_pass_copy(ct_first_pass_t *first_pass, register_ct_t *table, gboolean hostlist, conv_hash_t *ch)
+{
+    const conv_hash_t *src = conversation_table_first_pass_lookup(first_pass, table, hostlist);
+    guint i;
+
+    if (!src || ch->conv_array != NULL) {
+        return FALSE;
+    }
+
+    if (src->conv_array == NULL) {
+        /* Nothing was counted yet. */
+        return TRUE;
+    }
+
+    ch->conv_array = g_array_sized_new(FALSE, FALSE, g_array_get_element_size(src->conv_array), MAX(src->conv_array->len, 10000));
+    g_array_append_vals(ch->conv_array, src->conv_array->data, src->conv_array->len);
+    for (i = 0; i < ch->conv_array->len; i++) {
+        if (hostlist) {
+            hostlist_talker_t *host = &g_array_index(ch->conv_array, hostlist_talker_t, i);
+
+            copy_address(&host->myaddress, &g_array_index(src->conv_array, hostlist_talker_t, i).myaddress);
+        } else {
+            conv_item_t *conv_item = &g_array_index(ch->conv_array, conv_item_t, i);
+
+            copy_address(&conv_item->src_address, &g_array_index(src->conv_array, conv_item_t, i).src_address);
+            copy_address(&conv_item->dst_address, &g_array_index(src->conv_array, conv_item_t, i).dst_address);
+        }
+    }
+
+    ch->index = g_new(guint32, src->index_size);
+    memcpy(ch->index, src->index, src->index_size * sizeof(guint32));
+    ch->index_size = src->index_size;
+    return TRUE;
+}
+
 /*
  * Editor modelines
  *
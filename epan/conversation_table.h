@@ -48,28 +48,17 @@ typedef enum {
 } conv_direction_e;
 
 /** Conversation hash + value storage
- * Hash table keys are conv_key_t. Hash table values are indexes into conv_array.
+ * The index is an open addressing hash table of positions in conv_array
+ * (plus one, 0 being an empty slot), so that it only takes a few bytes per
+ * conversation. Lookups compare the keys with the items of conv_array.
  */
 typedef struct _conversation_hash_t {
-    GHashTable  *hashtable;       /**< conversations hash table */
+    guint32     *index;           /**< positions in conv_array + 1, by hash */
+    guint32      index_size;      /**< number of slots of index, a power of two */
     GArray      *conv_array;      /**< array of conversation values */
     void        *user_data;       /**< "GUI" specifics (if necessary) */
 } conv_hash_t;
 
-/** Key for hash lookups */
-typedef struct _conversation_key_t {
-    address     addr1;
-    address     addr2;
-    guint32     port1;
-    guint32     port2;
-    conv_id_t   conv_id;
-} conv_key_t;
-
-typedef struct {
-    address  myaddress;
-    guint32  port;
-} host_key_t;
-
 struct _conversation_item_t;
 typedef const char* (*conv_get_filter_type)(struct _conversation_item_t* item, conv_filter_type_e filter);
 
@@ -319,6 +308,55 @@ add_conversation_table_data_with_conv_id(conv_hash_t *ch, const address *src, co
 WS_DLL_PUBLIC void add_hostlist_table_data(conv_hash_t *ch, const address *addr,
     guint32 port, gboolean sender, int num_frames, int num_bytes, hostlist_dissector_info_t *host_info, endpoint_type etype);
 
+/** Conversation and endpoint tables filled while a capture file is read */
+typedef struct _ct_first_pass_t ct_first_pass_t;
+
+/** Register the tap listeners that fill the conversation and endpoint
+ * tables of the given conversation table names with the frames read from
+ * a capture file, so that the tables don't need another pass over the file.
+ * The listeners only count the frames while the first pass is active, see
+ * conversation_table_first_pass_set_active().
+ *
+ * @param table_names Comma-separated list of conversation table names, e.g. "IPv4,TCP"
+ * @return The tables, or NULL if no valid table name was given.
+ */
+WS_DLL_PUBLIC ct_first_pass_t *conversation_table_first_pass_new(const char *table_names);
+
+/** Remove the tap listeners and free the tables.
+ *
+ * @param first_pass the tables to free, can be NULL
+ */
+WS_DLL_PUBLIC void conversation_table_first_pass_free(ct_first_pass_t *first_pass);
+
+/** Count the frames that are tapped, or stop doing so. Readers activate
+ * the tables only while they dissect a frame for the first time, so that
+ * retaps for other listeners don't count it again.
+ *
+ * @param first_pass the tables
+ * @param active TRUE to count the frames
+ */
+WS_DLL_PUBLIC void conversation_table_first_pass_set_active(ct_first_pass_t *first_pass, gboolean active);
+
+/** Get a table filled while the capture file was read.
+ *
+ * @param first_pass the tables, can be NULL
+ * @param table the conversation table
+ * @param hostlist TRUE for the endpoints, FALSE for the conversations
+ * @return The table, or NULL if it isn't filled while reading.
+ */
+WS_DLL_PUBLIC const conv_hash_t *conversation_table_first_pass_lookup(ct_first_pass_t *first_pass, register_ct_t *table, gboolean hostlist);
+
+/** Copy a table filled while the capture file was read into an empty table,
+ * which can then be updated by its own tap listener.
+ *
+ * @param first_pass the tables, can be NULL
+ * @param table the conversation table
+ * @param hostlist TRUE for the endpoints, FALSE for the conversations
+ * @param ch the empty table to fill
+ * @return TRUE if the table is filled while reading and was copied.
+ */
+WS_DLL_PUBLIC gboolean conversation_table_first_pass_copy(ct_first_pass_t *first_pass, register_ct_t *table, gboolean hostlist, conv_hash_t *ch);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
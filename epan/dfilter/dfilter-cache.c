@@ -0,0 +1,493 @@
+/*
+ * Cache of display filter results for the frames of a capture file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include "dfilter-cache.h"
+
+#include <string.h>
+
+#include "dfilter-int.h"
+#include "sttype-test.h"
+#include <wsutil/wmem/wmem.h>
+
+/*
+ * A bitmap as stored in the cache. Filter results are usually long runs
+ * of matching and non-matching frames, so bitmaps are stored as a
+ * sequence of (byte, run length) pairs, with the run length as a
+ * base-128 varint, unless that takes more room than the bitmap itself.
+ */
+typedef struct {
+	guint8		*data;
+	gsize		len;
+	gboolean	rle;
+} packed_bitmap_t;
+
+typedef struct {
+	char		*key;
+	guint32		num_frames;
+	packed_bitmap_t	passed;
+	packed_bitmap_t	dependents;	/* data is NULL if unknown */
+	GList		*lru_link;
+} cache_entry_t;
+
+struct epan_dfilter_cache {
+	guint		max_entries;
+	GHashTable	*entries;	/* key -> cache_entry_t */
+	GQueue		lru;		/* most recently used first */
+};
+
+/*
+ * The key of a subexpression is the debug representation of its syntax
+ * tree, which names the fields, operators and constants (with their
+ * types) after the semantic check has resolved them.
+ *
+ * The optimizer orders the operands of "&&" and "||" by what earlier
+ * filters learned about them (see optimize.c), so the same filter can
+ * be compiled in different orders.  The keys of the operands of a chain
+ * are sorted to give the same key in any order.
+ */
+static void expr_key(wmem_strbuf_t *buf, stnode_t *node);
+
+static void
+chain_keys(GPtrArray *keys, stnode_t *node, test_op_t chain_op)
+{
+	test_op_t	op;
+	stnode_t	*left, *right;
+	wmem_strbuf_t	*buf;
+
+	if (stnode_type_id(node) == STTYPE_TEST) {
+		sttype_test_get(node, &op, &left, &right);
+		if (op == chain_op) {
+			chain_keys(keys, left, chain_op);
+			chain_keys(keys, right, chain_op);
+			return;
+		}
+	}
+
+	buf = wmem_strbuf_new(NULL, NULL);
+	expr_key(buf, node);
+	g_ptr_array_add(keys, wmem_strbuf_finalize(buf));
+}
+
+static gint
+compare_keys(gconstpointer a, gconstpointer b)
+{
+	return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+static void
+expr_key(wmem_strbuf_t *buf, stnode_t *node)
+{
+	test_op_t	op;
+	stnode_t	*left, *right;
+	GPtrArray	*keys;
+	guint		i;
+
+	if (stnode_type_id(node) != STTYPE_TEST) {
+		wmem_strbuf_append(buf, stnode_todebug(node));
+		return;
+	}
+
+	sttype_test_get(node, &op, &left, &right);
+	wmem_strbuf_append_printf(buf, "%s(", stnode_todebug(node));
+	if (op == TEST_OP_AND || op == TEST_OP_OR) {
+		keys = g_ptr_array_new();
+		chain_keys(keys, node, op);
+		g_ptr_array_sort(keys, compare_keys);
+		for (i = 0; i < keys->len; i++) {
+			if (i > 0)
+				wmem_strbuf_append_c(buf, ',');
+			wmem_strbuf_append(buf, (const char *)g_ptr_array_index(keys, i));
+			wmem_free(NULL, g_ptr_array_index(keys, i));
+		}
+		g_ptr_array_free(keys, TRUE);
+		wmem_strbuf_append_c(buf, ')');
+		return;
+	}
+	if (left)
+		expr_key(buf, left);
+	if (right) {
+		wmem_strbuf_append_c(buf, ',');
+		expr_key(buf, right);
+	}
+	wmem_strbuf_append_c(buf, ')');
+}
+
+char *
+dfilter_node_key(stnode_t *node)
+{
+	wmem_strbuf_t	*buf;
+
+	buf = wmem_strbuf_new(NULL, NULL);
+	expr_key(buf, node);
+	return wmem_strbuf_finalize(buf);
+}
+
+/*
+ * If a test compares a field with constants, or tests whether it exists,
+ * remember the field and the constants so that the test can be answered
+ * from a dfilter_index_t.
+ */
+static void
+expr_leaf(dfilter_expr_t *expr, stnode_t *left, stnode_t *right)
+{
+	stnode_t	*field, *constant;
+	GSList		*l;
+
+	if (expr->op == TEST_OP_EXISTS) {
+		if (stnode_type_id(left) == STTYPE_FIELD)
+			expr->hfinfo = (header_field_info *)stnode_data(left);
+		return;
+	}
+
+	switch (expr->op) {
+		case TEST_OP_ANY_EQ:
+		case TEST_OP_ALL_NE:
+		case TEST_OP_ANY_NE:
+		case TEST_OP_GT:
+		case TEST_OP_GE:
+		case TEST_OP_LT:
+		case TEST_OP_LE:
+		case TEST_OP_BITWISE_AND:
+		case TEST_OP_CONTAINS:
+		case TEST_OP_MATCHES:
+		case TEST_OP_IN:
+			break;
+		default:
+			return;
+	}
+
+	if (stnode_type_id(left) == STTYPE_FIELD) {
+		field = left;
+		constant = right;
+	}
+	else {
+		field = right;
+		constant = left;
+		expr->swapped = TRUE;
+	}
+	if (stnode_type_id(field) != STTYPE_FIELD)
+		return;
+
+	switch (stnode_type_id(constant)) {
+		case STTYPE_FVALUE:
+			expr->value = (fvalue_t *)stnode_data(constant);
+			break;
+		case STTYPE_PCRE:
+			expr->regex = (ws_regex_t *)stnode_data(constant);
+			break;
+		case STTYPE_SET:
+			expr->set = g_ptr_array_new();
+			for (l = (GSList *)stnode_data(constant); l; l = l->next) {
+				if (l->data == NULL) {
+					/* No upper bound */
+					g_ptr_array_add(expr->set, NULL);
+					continue;
+				}
+				if (stnode_type_id((stnode_t *)l->data) != STTYPE_FVALUE) {
+					g_ptr_array_free(expr->set, TRUE);
+					expr->set = NULL;
+					return;
+				}
+				g_ptr_array_add(expr->set, stnode_data((stnode_t *)l->data));
+			}
+			break;
+		default:
+			return;
+	}
+	expr->hfinfo = (header_field_info *)stnode_data(field);
+}
+
+dfilter_expr_t *
+dfilter_expr_new(stnode_t *root)
+{
+	dfilter_expr_t	*expr;
+	stnode_t	*left, *right;
+
+	ws_assert(stnode_type_id(root) == STTYPE_TEST);
+
+	expr = g_new0(dfilter_expr_t, 1);
+	expr->key = dfilter_node_key(root);
+
+	sttype_test_get(root, &expr->op, &left, &right);
+	switch (expr->op) {
+		case TEST_OP_AND:
+		case TEST_OP_OR:
+			expr->left = dfilter_expr_new(left);
+			expr->right = dfilter_expr_new(right);
+			break;
+		case TEST_OP_NOT:
+			expr->left = dfilter_expr_new(left);
+			break;
+		default:
+			expr_leaf(expr, left, right);
+			break;
+	}
+	return expr;
+}
+
+void
+dfilter_expr_free(dfilter_expr_t *expr)
+{
+	if (expr == NULL)
+		return;
+	dfilter_expr_free(expr->left);
+	dfilter_expr_free(expr->right);
+	if (expr->set)
+		g_ptr_array_free(expr->set, TRUE);
+	wmem_free(NULL, expr->key);
+	g_free(expr);
+}
+
+static void
+bitmap_pack(packed_bitmap_t *packed, const guint8 *bitmap, gsize size)
+{
+	GByteArray	*rle = g_byte_array_new();
+	gsize		i, run, len;
+	guint8		byte;
+
+	for (i = 0; i < size && rle->len < size; i += run) {
+		for (run = 1; i + run < size && bitmap[i + run] == bitmap[i]; run++)
+			;
+		g_byte_array_append(rle, &bitmap[i], 1);
+		for (len = run; len >= 0x80; len >>= 7) {
+			byte = (len & 0x7f) | 0x80;
+			g_byte_array_append(rle, &byte, 1);
+		}
+		byte = (guint8)len;
+		g_byte_array_append(rle, &byte, 1);
+	}
+
+	if (rle->len < size) {
+		packed->len = rle->len;
+		packed->data = g_byte_array_free(rle, FALSE);
+		packed->rle = TRUE;
+	}
+	else {
+		g_byte_array_free(rle, TRUE);
+		packed->len = size;
+		packed->data = (guint8 *)g_memdup2(bitmap, size);
+		packed->rle = FALSE;
+	}
+}
+
+static guint8 *
+bitmap_unpack(const packed_bitmap_t *packed, gsize size)
+{
+	guint8	*bitmap;
+	gsize	i, pos, run;
+	guint	shift;
+	guint8	value;
+
+	if (!packed->rle)
+		return (guint8 *)g_memdup2(packed->data, size);
+
+	bitmap = g_new(guint8, size);
+	for (i = 0, pos = 0; i < packed->len; ) {
+		value = packed->data[i++];
+		run = 0;
+		shift = 0;
+		do {
+			run |= (gsize)(packed->data[i] & 0x7f) << shift;
+			shift += 7;
+		} while (packed->data[i++] & 0x80);
+		ws_assert(pos + run <= size);
+		memset(&bitmap[pos], value, run);
+		pos += run;
+	}
+	ws_assert(pos == size);
+	return bitmap;
+}
+
+static void
+cache_entry_free(gpointer data)
+{
+	cache_entry_t *entry = (cache_entry_t *)data;
+
+	g_free(entry->key);
+	g_free(entry->passed.data);
+	g_free(entry->dependents.data);
+	g_free(entry);
+}
+
+dfilter_cache_t *
+dfilter_cache_new(guint max_entries)
+{
+	dfilter_cache_t *cache;
+
+	ws_assert(max_entries > 0);
+
+	cache = g_new0(dfilter_cache_t, 1);
+	cache->max_entries = max_entries;
+	cache->entries = g_hash_table_new_full(g_str_hash, g_str_equal,
+						NULL, cache_entry_free);
+	g_queue_init(&cache->lru);
+	return cache;
+}
+
+void
+dfilter_cache_free(dfilter_cache_t *cache)
+{
+	if (cache == NULL)
+		return;
+	dfilter_cache_clear(cache);
+	g_hash_table_destroy(cache->entries);
+	g_free(cache);
+}
+
+void
+dfilter_cache_clear(dfilter_cache_t *cache)
+{
+	if (cache == NULL)
+		return;
+	g_queue_clear(&cache->lru);
+	g_hash_table_remove_all(cache->entries);
+}
+
+void
+dfilter_cache_store(dfilter_cache_t *cache, const dfilter_t *df,
+			guint32 num_frames, const guint8 *passed,
+			const guint8 *dependents)
+{
+	cache_entry_t	*entry;
+	gsize		size = DFILTER_CACHE_BITMAP_SIZE(num_frames);
+
+	if (df == NULL || df->expr == NULL)
+		return;
+
+	entry = (cache_entry_t *)g_hash_table_lookup(cache->entries, df->expr->key);
+	if (entry != NULL) {
+		g_queue_delete_link(&cache->lru, entry->lru_link);
+		g_hash_table_remove(cache->entries, df->expr->key);
+	}
+	else if (g_hash_table_size(cache->entries) >= cache->max_entries) {
+		entry = (cache_entry_t *)g_queue_pop_tail(&cache->lru);
+		g_hash_table_remove(cache->entries, entry->key);
+	}
+
+	entry = g_new0(cache_entry_t, 1);
+	entry->key = g_strdup(df->expr->key);
+	entry->num_frames = num_frames;
+	bitmap_pack(&entry->passed, passed, size);
+	if (dependents != NULL)
+		bitmap_pack(&entry->dependents, dependents, size);
+	g_queue_push_head(&cache->lru, entry);
+	entry->lru_link = cache->lru.head;
+	g_hash_table_insert(cache->entries, entry->key, entry);
+}
+
+static cache_entry_t *
+cache_get(dfilter_cache_t *cache, const char *key, guint32 num_frames)
+{
+	cache_entry_t *entry;
+
+	entry = (cache_entry_t *)g_hash_table_lookup(cache->entries, key);
+	if (entry == NULL || entry->num_frames != num_frames)
+		return NULL;
+
+	g_queue_unlink(&cache->lru, entry->lru_link);
+	g_queue_push_head_link(&cache->lru, entry->lru_link);
+	return entry;
+}
+
+/*
+ * Returns the result of expr, from the cache or by combining the results
+ * of its operands, or NULL.
+ */
+static guint8 *
+expr_result(dfilter_cache_t *cache, const dfilter_expr_t *expr,
+		guint32 num_frames)
+{
+	cache_entry_t	*entry;
+	guint8		*left, *right;
+	gsize		size = DFILTER_CACHE_BITMAP_SIZE(num_frames);
+	gsize		i;
+
+	entry = cache_get(cache, expr->key, num_frames);
+	if (entry != NULL)
+		return bitmap_unpack(&entry->passed, size);
+
+	switch (expr->op) {
+		case TEST_OP_AND:
+		case TEST_OP_OR:
+			left = expr_result(cache, expr->left, num_frames);
+			if (left == NULL)
+				return NULL;
+			right = expr_result(cache, expr->right, num_frames);
+			if (right == NULL) {
+				g_free(left);
+				return NULL;
+			}
+			for (i = 0; i < size; i++) {
+				if (expr->op == TEST_OP_AND)
+					left[i] &= right[i];
+				else
+					left[i] |= right[i];
+			}
+			g_free(right);
+			return left;
+
+		case TEST_OP_NOT:
+			left = expr_result(cache, expr->left, num_frames);
+			if (left == NULL)
+				return NULL;
+			for (i = 0; i < size; i++)
+				left[i] = ~left[i];
+			/* There is no frame 0, nor any frame after the last. */
+			left[0] &= ~1;
+			if ((num_frames + 1) % 8)
+				left[size - 1] &= (1 << ((num_frames + 1) % 8)) - 1;
+			return left;
+
+		default:
+			return NULL;
+	}
+}
+
+gboolean
+dfilter_cache_lookup(dfilter_cache_t *cache, const dfilter_t *df,
+			guint32 num_frames, guint8 **passed,
+			guint8 **dependents)
+{
+	cache_entry_t	*entry;
+	gsize		size = DFILTER_CACHE_BITMAP_SIZE(num_frames);
+
+	*passed = NULL;
+	if (dependents != NULL)
+		*dependents = NULL;
+
+	if (df == NULL || df->expr == NULL)
+		return FALSE;
+
+	entry = cache_get(cache, df->expr->key, num_frames);
+	if (entry != NULL) {
+		*passed = bitmap_unpack(&entry->passed, size);
+		if (dependents != NULL && entry->dependents.data != NULL)
+			*dependents = bitmap_unpack(&entry->dependents, size);
+		return TRUE;
+	}
+
+	*passed = expr_result(cache, df->expr, num_frames);
+	return *passed != NULL;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
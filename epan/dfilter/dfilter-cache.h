@@ -0,0 +1,104 @@
+/** @file
+ *
+ * Cache of display filter results for the frames of a capture file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef DFILTER_CACHE_H
+#define DFILTER_CACHE_H
+
+#include <glib.h>
+#include "ws_symbol_export.h"
+#include "dfilter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * A dfilter_cache_t remembers which frames of a capture file matched the
+ * display filters that were applied to it, so that applying one of them
+ * again doesn't require dissecting every frame.
+ *
+ * Results are keyed by the filter's syntax tree after the semantic check
+ * and optimization, so "tcp.port==80" and "tcp.port eq 80" share an
+ * entry.  A filter that isn't in the cache, but is an "and", "or" or
+ * "not" of filters that are, is computed from their results.
+ *
+ * The results are frame bitmaps: bit (n % 8) of byte (n / 8) is set
+ * if frame number n matched.  They take DFILTER_CACHE_BITMAP_SIZE()
+ * bytes.  The cache stores them run-length encoded when that is
+ * smaller.
+ *
+ * The cache doesn't know when the results become stale; it must be
+ * cleared whenever something that can change the dissection or the
+ * filter results (preferences, "decode as", ignored, marked or time
+ * reference frames, ...) changes.
+ */
+typedef struct epan_dfilter_cache dfilter_cache_t;
+
+#define DFILTER_CACHE_BITMAP_SIZE(num_frames)	((num_frames) / 8 + 1)
+
+/* Create a cache that keeps the results of up to max_entries filters. */
+WS_DLL_PUBLIC
+dfilter_cache_t *
+dfilter_cache_new(guint max_entries);
+
+WS_DLL_PUBLIC
+void
+dfilter_cache_free(dfilter_cache_t *cache);
+
+/* Forget all the results. */
+WS_DLL_PUBLIC
+void
+dfilter_cache_clear(dfilter_cache_t *cache);
+
+/*
+ * Store the result of df for frames 1 to num_frames.  dependents, which
+ * can be NULL, is a second bitmap with the frames that matching frames
+ * depend on (e.g. for reassembly), which is only returned for exact
+ * matches.
+ */
+WS_DLL_PUBLIC
+void
+dfilter_cache_store(dfilter_cache_t *cache, const dfilter_t *df,
+			guint32 num_frames, const guint8 *passed,
+			const guint8 *dependents);
+
+/*
+ * Look up the result of df for frames 1 to num_frames.  Returns FALSE
+ * if it isn't in the cache and can't be computed from other results.
+ * Otherwise sets *passed to a newly allocated bitmap, and, if dependents
+ * isn't NULL, *dependents to a newly allocated bitmap of the dependent
+ * frames, or to NULL if that isn't known for this result.  The bitmaps
+ * must be freed with g_free().
+ */
+WS_DLL_PUBLIC
+gboolean
+dfilter_cache_lookup(dfilter_cache_t *cache, const dfilter_t *df,
+			guint32 num_frames, guint8 **passed,
+			guint8 **dependents);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* DFILTER_CACHE_H */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
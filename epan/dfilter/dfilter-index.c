@@ -0,0 +1,546 @@
+/*
+ * Index of field values for the frames of a capture file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include "dfilter-index.h"
+
+#include <string.h>
+
+#include "dfilter-cache.h"
+#include "dfilter-int.h"
+#include <wsutil/wmem/wmem.h>
+
+/* The frames in which a field has a value. */
+typedef struct {
+	fvalue_t	*value;
+	GArray		*frames;	/* guint32, ascending */
+} index_value_t;
+
+typedef struct {
+	header_field_info *hfinfo;	/* first field with the name */
+	GArray		*present;	/* frames that have the field */
+	GHashTable	*values;	/* representation -> index_value_t */
+	gboolean	have_values;	/* FALSE if a value couldn't be indexed */
+} index_field_t;
+
+struct epan_dfilter_index {
+	GPtrArray	*fields;	/* index_field_t */
+	guint32		num_frames;
+};
+
+static void
+index_value_free(gpointer data)
+{
+	index_value_t *iv = (index_value_t *)data;
+
+	fvalue_free(iv->value);
+	g_array_free(iv->frames, TRUE);
+	g_free(iv);
+}
+
+static void
+index_field_free(gpointer data)
+{
+	index_field_t *field = (index_field_t *)data;
+
+	g_array_free(field->present, TRUE);
+	if (field->values)
+		g_hash_table_destroy(field->values);
+	g_free(field);
+}
+
+/*
+ * Whether the values of a field are all known after the first pass.
+ * Dissectors add the fields of frame numbers that refer to later frames,
+ * such as dns.response_in or tcp.reassembled_in, only once they have
+ * seen those frames, so frames without them on the first pass might
+ * still match a filter of them.
+ */
+static gboolean
+index_field_first_pass_stable(header_field_info *hfinfo)
+{
+	for (; hfinfo; hfinfo = hfinfo->same_name_next) {
+		if (hfinfo->type == FT_FRAMENUM)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+dfilter_index_t *
+dfilter_index_new(const char *fields)
+{
+	dfilter_index_t	*idx;
+	index_field_t	*field;
+	header_field_info *hfinfo;
+	gchar		**names;
+	guint		i, j;
+
+	if (fields == NULL)
+		return NULL;
+
+	idx = g_new0(dfilter_index_t, 1);
+	idx->fields = g_ptr_array_new_with_free_func(index_field_free);
+
+	names = g_strsplit_set(fields, ", \t", -1);
+	for (i = 0; names[i] != NULL; i++) {
+		if (names[i][0] == '\0')
+			continue;
+		hfinfo = proto_registrar_get_byname(names[i]);
+		if (hfinfo == NULL)
+			continue;
+		for (j = 0; j < idx->fields->len; j++) {
+			field = (index_field_t *)g_ptr_array_index(idx->fields, j);
+			if (field->hfinfo == hfinfo)
+				break;
+		}
+		if (j < idx->fields->len)
+			continue;
+		if (!index_field_first_pass_stable(hfinfo))
+			continue;
+
+		field = g_new0(index_field_t, 1);
+		field->hfinfo = hfinfo;
+		field->present = g_array_new(FALSE, FALSE, sizeof(guint32));
+		field->have_values = hfinfo->type != FT_NONE && hfinfo->type != FT_PROTOCOL;
+		if (field->have_values)
+			field->values = g_hash_table_new_full(g_str_hash, g_str_equal,
+								g_free, index_value_free);
+		g_ptr_array_add(idx->fields, field);
+	}
+	g_strfreev(names);
+
+	if (idx->fields->len == 0) {
+		dfilter_index_free(idx);
+		return NULL;
+	}
+	return idx;
+}
+
+void
+dfilter_index_free(dfilter_index_t *idx)
+{
+	if (idx == NULL)
+		return;
+	g_ptr_array_free(idx->fields, TRUE);
+	g_free(idx);
+}
+
+void
+dfilter_index_prime_proto_tree(const dfilter_index_t *idx, proto_tree *tree)
+{
+	header_field_info *hfinfo;
+	guint		i;
+
+	for (i = 0; i < idx->fields->len; i++) {
+		hfinfo = ((index_field_t *)g_ptr_array_index(idx->fields, i))->hfinfo;
+		for (; hfinfo; hfinfo = hfinfo->same_name_next)
+			proto_tree_prime_with_hfid(tree, hfinfo->id);
+	}
+}
+
+/* Make a copy of a field value that outlives the tree, for the types
+ * whose values can be set directly. */
+static fvalue_t *
+index_value_copy(fvalue_t *fv)
+{
+	ftenum_t	ftype = fvalue_type_ftenum(fv);
+	fvalue_t	*copy;
+	GByteArray	*bytes;
+
+	switch (ftype) {
+		case FT_CHAR:
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+		case FT_FRAMENUM:
+		case FT_IPXNET:
+		case FT_IPv4:
+			copy = fvalue_new(ftype);
+			fvalue_set_uinteger(copy, fvalue_get_uinteger(fv));
+			return copy;
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+			copy = fvalue_new(ftype);
+			fvalue_set_sinteger(copy, fvalue_get_sinteger(fv));
+			return copy;
+		case FT_UINT40:
+		case FT_UINT48:
+		case FT_UINT56:
+		case FT_UINT64:
+		case FT_EUI64:
+		case FT_BOOLEAN:
+			copy = fvalue_new(ftype);
+			fvalue_set_uinteger64(copy, fvalue_get_uinteger64(fv));
+			return copy;
+		case FT_INT40:
+		case FT_INT48:
+		case FT_INT56:
+		case FT_INT64:
+			copy = fvalue_new(ftype);
+			fvalue_set_sinteger64(copy, fvalue_get_sinteger64(fv));
+			return copy;
+		case FT_FLOAT:
+		case FT_DOUBLE:
+			copy = fvalue_new(ftype);
+			fvalue_set_floating(copy, fvalue_get_floating(fv));
+			return copy;
+		case FT_ABSOLUTE_TIME:
+		case FT_RELATIVE_TIME:
+			copy = fvalue_new(ftype);
+			fvalue_set_time(copy, (const nstime_t *)fvalue_get(fv));
+			return copy;
+		case FT_GUID:
+			copy = fvalue_new(ftype);
+			fvalue_set_guid(copy, (const e_guid_t *)fvalue_get(fv));
+			return copy;
+		case FT_IPv6:
+			copy = fvalue_new(ftype);
+			fvalue_set_bytes(copy, (const guint8 *)fvalue_get(fv));
+			return copy;
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_STRINGZPAD:
+		case FT_STRINGZTRUNC:
+		case FT_UINT_STRING:
+			copy = fvalue_new(ftype);
+			fvalue_set_string(copy, (const gchar *)fvalue_get(fv));
+			return copy;
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_OID:
+		case FT_REL_OID:
+		case FT_SYSTEM_ID:
+			bytes = (GByteArray *)fvalue_get(fv);
+			copy = fvalue_new(ftype);
+			fvalue_set_byte_array(copy,
+				g_byte_array_append(g_byte_array_new(), bytes->data, bytes->len));
+			return copy;
+		case FT_AX25:
+		case FT_VINES:
+		case FT_ETHER:
+		case FT_FCWWN:
+			bytes = (GByteArray *)fvalue_get(fv);
+			copy = fvalue_new(ftype);
+			fvalue_set_bytes(copy, bytes->data);
+			return copy;
+		default:
+			return NULL;
+	}
+}
+
+/* Append a frame to a list of frames, unless it's already the last one. */
+static void
+frames_add(GArray *frames, guint32 framenum)
+{
+	if (frames->len == 0 || g_array_index(frames, guint32, frames->len - 1) != framenum)
+		g_array_append_val(frames, framenum);
+}
+
+static void
+index_field_add(index_field_t *field, guint32 framenum, GPtrArray *finfos)
+{
+	field_info	*finfo;
+	index_value_t	*iv;
+	wmem_strbuf_t	*key;
+	char		*repr;
+	guint		i;
+
+	frames_add(field->present, framenum);
+	if (!field->have_values)
+		return;
+
+	for (i = 0; i < finfos->len; i++) {
+		finfo = (field_info *)g_ptr_array_index(finfos, i);
+		repr = fvalue_to_string_repr(NULL, &finfo->value, FTREPR_DFILTER, BASE_NONE);
+		if (repr == NULL) {
+			field->have_values = FALSE;
+			g_hash_table_remove_all(field->values);
+			return;
+		}
+		/* Fields with the same name can have different types. */
+		key = wmem_strbuf_new(NULL, fvalue_type_name(&finfo->value));
+		wmem_strbuf_append_c(key, ':');
+		wmem_strbuf_append(key, repr);
+		wmem_free(NULL, repr);
+
+		iv = (index_value_t *)g_hash_table_lookup(field->values, wmem_strbuf_get_str(key));
+		if (iv == NULL) {
+			iv = g_new0(index_value_t, 1);
+			iv->value = index_value_copy(&finfo->value);
+			if (iv->value == NULL) {
+				g_free(iv);
+				wmem_strbuf_destroy(key);
+				field->have_values = FALSE;
+				g_hash_table_remove_all(field->values);
+				return;
+			}
+			iv->frames = g_array_new(FALSE, FALSE, sizeof(guint32));
+			g_hash_table_insert(field->values,
+					g_strdup(wmem_strbuf_get_str(key)), iv);
+		}
+		wmem_strbuf_destroy(key);
+		frames_add(iv->frames, framenum);
+	}
+}
+
+void
+dfilter_index_add_frame(dfilter_index_t *idx, guint32 framenum,
+			proto_tree *tree)
+{
+	index_field_t	*field;
+	header_field_info *hfinfo;
+	GPtrArray	*finfos;
+	guint		i;
+
+	ws_assert(framenum > idx->num_frames);
+	idx->num_frames = framenum;
+
+	if (tree == NULL)
+		return;
+
+	for (i = 0; i < idx->fields->len; i++) {
+		field = (index_field_t *)g_ptr_array_index(idx->fields, i);
+		for (hfinfo = field->hfinfo; hfinfo; hfinfo = hfinfo->same_name_next) {
+			finfos = proto_get_finfo_ptr_array(tree, hfinfo->id);
+			if (finfos != NULL && finfos->len > 0)
+				index_field_add(field, framenum, finfos);
+		}
+	}
+}
+
+guint32
+dfilter_index_num_frames(const dfilter_index_t *idx)
+{
+	return idx->num_frames;
+}
+
+static index_field_t *
+index_find_field(const dfilter_index_t *idx, const header_field_info *hfinfo)
+{
+	index_field_t	*field;
+	guint		i;
+
+	for (i = 0; i < idx->fields->len; i++) {
+		field = (index_field_t *)g_ptr_array_index(idx->fields, i);
+		if (field->hfinfo == hfinfo)
+			return field;
+	}
+	return NULL;
+}
+
+static void
+bitmap_set_frames(guint8 *bitmap, const GArray *frames)
+{
+	guint32	framenum;
+	guint	i;
+
+	for (i = 0; i < frames->len; i++) {
+		framenum = g_array_index(frames, guint32, i);
+		bitmap[framenum / 8] |= 1 << (framenum % 8);
+	}
+}
+
+/* Apply the test of a leaf to one value, with the operands in the same
+ * order as the filter engine. */
+static gboolean
+leaf_test_value(const dfilter_expr_t *expr, const fvalue_t *fv)
+{
+	const fvalue_t	*a = expr->swapped ? expr->value : fv;
+	const fvalue_t	*b = expr->swapped ? fv : expr->value;
+	guint		i;
+
+	switch (expr->op) {
+		case TEST_OP_ANY_EQ:
+			return fvalue_eq(a, b);
+		case TEST_OP_ALL_NE:
+			/* Collects the values that make the test fail. */
+			return !fvalue_ne(a, b);
+		case TEST_OP_ANY_NE:
+			return fvalue_ne(a, b);
+		case TEST_OP_GT:
+			return fvalue_gt(a, b);
+		case TEST_OP_GE:
+			return fvalue_ge(a, b);
+		case TEST_OP_LT:
+			return fvalue_lt(a, b);
+		case TEST_OP_LE:
+			return fvalue_le(a, b);
+		case TEST_OP_BITWISE_AND:
+			return fvalue_bitwise_and(a, b);
+		case TEST_OP_CONTAINS:
+			return fvalue_contains(a, b);
+		case TEST_OP_MATCHES:
+			return fvalue_matches(fv, expr->regex);
+		case TEST_OP_IN:
+			for (i = 0; i < expr->set->len; i += 2) {
+				fvalue_t *lower = (fvalue_t *)g_ptr_array_index(expr->set, i);
+				fvalue_t *upper = (fvalue_t *)g_ptr_array_index(expr->set, i + 1);
+
+				if (upper) {
+					if (fvalue_ge(fv, lower) && fvalue_le(fv, upper))
+						return TRUE;
+				}
+				else if (fvalue_eq(fv, lower)) {
+					return TRUE;
+				}
+			}
+			return FALSE;
+		default:
+			ws_assert_not_reached();
+			return FALSE;
+	}
+}
+
+/* Returns the frames that match a test of a single field, or NULL if the
+ * index can't tell. */
+static guint8 *
+leaf_lookup(const dfilter_index_t *idx, const dfilter_expr_t *expr)
+{
+	index_field_t	*field;
+	index_value_t	*iv;
+	GHashTableIter	iter;
+	guint8		*bitmap, *failed;
+	gsize		size = DFILTER_CACHE_BITMAP_SIZE(idx->num_frames);
+	gsize		i;
+
+	if (expr->hfinfo == NULL)
+		return NULL;
+	field = index_find_field(idx, expr->hfinfo);
+	if (field == NULL)
+		return NULL;
+
+	bitmap = (guint8 *)g_malloc0(size);
+	if (expr->op == TEST_OP_EXISTS) {
+		bitmap_set_frames(bitmap, field->present);
+		return bitmap;
+	}
+
+	if (!field->have_values) {
+		g_free(bitmap);
+		return NULL;
+	}
+
+	g_hash_table_iter_init(&iter, field->values);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&iv)) {
+		if (leaf_test_value(expr, iv->value))
+			bitmap_set_frames(bitmap, iv->frames);
+	}
+
+	if (expr->op == TEST_OP_ALL_NE) {
+		/* The frames with the field, except those with a value that
+		 * is equal. */
+		failed = bitmap;
+		bitmap = (guint8 *)g_malloc0(size);
+		bitmap_set_frames(bitmap, field->present);
+		for (i = 0; i < size; i++)
+			bitmap[i] &= ~failed[i];
+		g_free(failed);
+	}
+	return bitmap;
+}
+
+/*
+ * Returns the frames that can match expr, or NULL if that can be any
+ * frame.  Sets *exact if exactly those frames match.
+ */
+static guint8 *
+expr_lookup(const dfilter_index_t *idx, const dfilter_expr_t *expr,
+		gboolean *exact)
+{
+	guint8		*left, *right;
+	gboolean	left_exact, right_exact;
+	gsize		size = DFILTER_CACHE_BITMAP_SIZE(idx->num_frames);
+	gsize		i;
+
+	switch (expr->op) {
+		case TEST_OP_AND:
+			left = expr_lookup(idx, expr->left, &left_exact);
+			right = expr_lookup(idx, expr->right, &right_exact);
+			if (left == NULL || right == NULL) {
+				/* Whatever the other side matches is still a
+				 * superset of the result. */
+				*exact = FALSE;
+				return left ? left : right;
+			}
+			for (i = 0; i < size; i++)
+				left[i] &= right[i];
+			g_free(right);
+			*exact = left_exact && right_exact;
+			return left;
+
+		case TEST_OP_OR:
+			left = expr_lookup(idx, expr->left, &left_exact);
+			if (left == NULL)
+				return NULL;
+			right = expr_lookup(idx, expr->right, &right_exact);
+			if (right == NULL) {
+				g_free(left);
+				return NULL;
+			}
+			for (i = 0; i < size; i++)
+				left[i] |= right[i];
+			g_free(right);
+			*exact = left_exact && right_exact;
+			return left;
+
+		case TEST_OP_NOT:
+			left = expr_lookup(idx, expr->left, &left_exact);
+			if (left == NULL || !left_exact) {
+				/* The complement of a superset says nothing. */
+				g_free(left);
+				return NULL;
+			}
+			for (i = 0; i < size; i++)
+				left[i] = ~left[i];
+			/* There is no frame 0, nor any frame after the last. */
+			left[0] &= ~1;
+			if ((idx->num_frames + 1) % 8)
+				left[size - 1] &= (1 << ((idx->num_frames + 1) % 8)) - 1;
+			*exact = TRUE;
+			return left;
+
+		default:
+			*exact = TRUE;
+			return leaf_lookup(idx, expr);
+	}
+}
+
+dfilter_index_match_t
+dfilter_index_lookup(const dfilter_index_t *idx, const dfilter_t *df,
+			guint8 **frames)
+{
+	gboolean exact;
+
+	*frames = NULL;
+	if (df == NULL || df->expr == NULL)
+		return DFILTER_INDEX_NONE;
+
+	*frames = expr_lookup(idx, df->expr, &exact);
+	if (*frames == NULL)
+		return DFILTER_INDEX_NONE;
+	return exact ? DFILTER_INDEX_EXACT : DFILTER_INDEX_CANDIDATES;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,107 @@
+/** @file
+ *
+ * Index of field values for the frames of a capture file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef DFILTER_INDEX_H
+#define DFILTER_INDEX_H
+
+#include <glib.h>
+#include "ws_symbol_export.h"
+#include "dfilter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * A dfilter_index_t maps each value of a set of fields to the frames
+ * that have a field with that value.  It is filled while the frames are
+ * dissected for the first time, and then used to find the frames that
+ * can match a display filter without dissecting them again.
+ *
+ * Tests of an indexed field against constants ("==", "!=", "<", ...,
+ * "&", "contains", "matches" and "in") and existence tests are answered
+ * from the index by applying the test to each distinct value of the
+ * field instead of to each frame.  The results of those tests are then
+ * combined following the "and", "or" and "not" operators of the filter;
+ * for tests that can't be answered from the index every frame is
+ * assumed to match.
+ */
+typedef struct epan_dfilter_index dfilter_index_t;
+
+typedef enum {
+	DFILTER_INDEX_NONE,		/* the index doesn't help */
+	DFILTER_INDEX_CANDIDATES,	/* only these frames can match */
+	DFILTER_INDEX_EXACT		/* exactly these frames match */
+} dfilter_index_match_t;
+
+/*
+ * Create an index for the fields in the comma or space separated list
+ * of field names.  Names of fields that don't exist are ignored, as are
+ * those of frame number fields, which dissectors can add after the
+ * first pass.  Returns NULL if there is no field to index.
+ */
+WS_DLL_PUBLIC
+dfilter_index_t *
+dfilter_index_new(const char *fields);
+
+WS_DLL_PUBLIC
+void
+dfilter_index_free(dfilter_index_t *idx);
+
+/* Make sure the indexed fields are put in the tree of a frame that is
+ * about to be dissected. */
+WS_DLL_PUBLIC
+void
+dfilter_index_prime_proto_tree(const dfilter_index_t *idx, proto_tree *tree);
+
+/*
+ * Add the values of the indexed fields in tree to the index.  Frames
+ * must be added in order, starting with frame 1.
+ */
+WS_DLL_PUBLIC
+void
+dfilter_index_add_frame(dfilter_index_t *idx, guint32 framenum,
+			proto_tree *tree);
+
+/* The number of the last frame added. */
+WS_DLL_PUBLIC
+guint32
+dfilter_index_num_frames(const dfilter_index_t *idx);
+
+/*
+ * Find the frames that match df.  Unless DFILTER_INDEX_NONE is
+ * returned, sets *frames to a newly allocated bitmap of the frames, in
+ * the format of the dfilter-cache.h bitmaps, for frames 1 to
+ * dfilter_index_num_frames(); it must be freed with g_free().
+ */
+WS_DLL_PUBLIC
+dfilter_index_match_t
+dfilter_index_lookup(const dfilter_index_t *idx, const dfilter_t *df,
+			guint8 **frames);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* DFILTER_INDEX_H */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -16,6 +16,43 @@
 #include <epan/proto.h>
 #include <stdio.h>
 
+/* The "and", "or" and "not" structure of a filter, with the canonical
+ * text of every subexpression. Used by dfilter-cache.c and
+ * dfilter-index.c. */
+typedef struct _dfilter_expr {
+	test_op_t		op;	/* AND, OR, NOT, or anything else for a leaf */
+	char			*key;
+	struct _dfilter_expr	*left;
+	struct _dfilter_expr	*right;
+
+	/* For a leaf that tests a field, possibly against constants: the
+	 * field and the constants, which belong to the compiled filter. */
+	header_field_info	*hfinfo;
+	fvalue_t		*value;
+	gboolean		swapped;	/* the constant is on the left */
+	ws_regex_t		*regex;		/* for "matches" */
+	GPtrArray		*set;		/* (lower, upper) pairs for "in" */
+} dfilter_expr_t;
+
+/* A test ("leaf" of the "and", "or" and "not" structure) whose result
+ * is set by a single instruction, so that its pass rate can be counted. */
+typedef struct {
+	char		*key;		/* dfilter_node_key() of the test */
+	int		first;		/* first instruction of the test */
+	int		result;		/* instruction that sets the result */
+} dfilter_leaf_t;
+
+/* Execution counts for the instructions of a filter. */
+typedef struct {
+	gboolean	timed;
+	guint64		applied;
+	guint64		passed;
+	guint64		*count;		/* times each instruction ran */
+	guint64		*true_count;	/* times accum was TRUE after it */
+	gint64		*time;		/* microseconds spent in it, if timed */
+	gint64		insn_start;
+} dfilter_profile_t;
+
 /* Passed back to user */
 struct epan_dfilter {
 	GPtrArray	*insns;
@@ -28,6 +65,11 @@ struct epan_dfilter {
 	int		*interesting_fields;
 	int		num_interesting_fields;
 	GPtrArray	*deprecated;
+	struct _dfspec	*spec;		/* specialized evaluator, if any */
+	dfilter_expr_t	*expr;
+	char		*text;
+	GPtrArray	*leaves;	/* dfilter_leaf_t */
+	dfilter_profile_t *profile;	/* NULL unless profiling */
 };
 
 typedef struct {
@@ -38,12 +80,14 @@ typedef struct {
 	GPtrArray	*insns;
 	GPtrArray	*consts;
 	GHashTable	*loaded_fields;
+	GHashTable	*loaded_ranges;
 	GHashTable	*interesting_fields;
 	int		next_insn_id;
 	int		next_const_id;
 	int		next_register;
 	int		first_constant; /* first register used as a constant */
 	GPtrArray	*deprecated;
+	GPtrArray	*leaves;	/* dfilter_leaf_t */
 } dfwork_t;
 
 /*
@@ -113,6 +157,30 @@ dfilter_fail_throw(dfwork_t *dfw, long code, const char *format, ...) G_GNUC_PRI
 void
 add_deprecated_token(dfwork_t *dfw, const char *token);
 
+dfilter_expr_t *
+dfilter_expr_new(stnode_t *root);
+
+void
+dfilter_expr_free(dfilter_expr_t *expr);
+
+char *
+dfilter_node_key(stnode_t *node);
+
+void
+dfilter_leaf_free(gpointer data);
+
+void
+dfilter_profile_register(dfilter_t *df);
+
+void
+dfilter_profile_unregister(dfilter_t *df);
+
+double
+dfilter_selectivity(const char *key);
+
+void
+dfilter_profile_cleanup(void);
+
 void
 free_deprecated(GPtrArray *deprecated);
 
@@ -0,0 +1,295 @@
+/*
+ * Execution counts of display filters, and the pass rates of their tests
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#define WS_LOG_DOMAIN LOG_DOMAIN_DFILTER
+
+#include <stdio.h>
+
+#include "dfilter-int.h"
+#include "dfvm.h"
+#include <epan/prefs.h>
+#include <wsutil/wmem/wmem.h>
+#include <wsutil/wslog.h>
+
+/*
+ * While profiling is on, every filter counts how many times each of its
+ * instructions runs, how often the result of each instruction is TRUE
+ * and how long each one takes.  Turning it on also starts profiling the
+ * filters that are already compiled, so that "tshark -z dfilter,stats"
+ * sees the filters from the command line.
+ *
+ * Otherwise, if the "protocols.filter_selectivity_feedback" preference
+ * is set, filters that have tests whose pass rate can be counted, and
+ * no specialized evaluator (see specialize.c), only count.  Programs
+ * built from several rules (see dfilter_compile_rules()) are left out,
+ * since nothing learns from them.  When a
+ * filter has been applied to a capture file, dfilter_learn_selectivity()
+ * adds the pass rates of its tests to a table that the optimizer uses
+ * to order the operands of "&&" and "||" (see optimize.c).
+ *
+ * Timing uses g_get_monotonic_time().  Its resolution is coarse compared
+ * to an instruction, but the differences of successive readings add up
+ * to the right total over many runs.
+ */
+
+/* Pass rates based on fewer evaluations aren't used. */
+#define SELECTIVITY_MIN_EVALUATED	64
+
+typedef struct {
+	guint64		evaluated;
+	guint64		passed;
+} selectivity_t;
+
+static GMutex		profile_mutex;
+static gboolean		profiling = FALSE;
+static GHashTable	*live_filters = NULL;	/* dfilter_t * */
+static GHashTable	*selectivity = NULL;	/* key -> selectivity_t */
+
+void
+dfilter_leaf_free(gpointer data)
+{
+	dfilter_leaf_t *leaf = (dfilter_leaf_t *)data;
+
+	wmem_free(NULL, leaf->key);
+	g_free(leaf);
+}
+
+static void
+profile_attach(dfilter_t *df, gboolean timed)
+{
+	dfilter_profile_t *profile;
+	guint		length = df->insns->len;
+
+	if (df->profile != NULL) {
+		df->profile->timed |= timed;
+		return;
+	}
+
+	profile = g_new0(dfilter_profile_t, 1);
+	profile->timed = timed;
+	profile->count = g_new0(guint64, length);
+	profile->true_count = g_new0(guint64, length);
+	profile->time = g_new0(gint64, length);
+	df->profile = profile;
+}
+
+static void
+profile_free(dfilter_profile_t *profile)
+{
+	if (profile == NULL)
+		return;
+	g_free(profile->count);
+	g_free(profile->true_count);
+	g_free(profile->time);
+	g_free(profile);
+}
+
+void
+dfilter_profile_register(dfilter_t *df)
+{
+	g_mutex_lock(&profile_mutex);
+	if (live_filters == NULL)
+		live_filters = g_hash_table_new(g_direct_hash, g_direct_equal);
+	g_hash_table_add(live_filters, df);
+
+	if (profiling)
+		profile_attach(df, TRUE);
+	else if (prefs.filter_selectivity_feedback && df->text != NULL &&
+			df->spec == NULL && df->leaves && df->leaves->len > 0)
+		profile_attach(df, FALSE);
+	g_mutex_unlock(&profile_mutex);
+}
+
+void
+dfilter_profile_unregister(dfilter_t *df)
+{
+	g_mutex_lock(&profile_mutex);
+	if (live_filters != NULL)
+		g_hash_table_remove(live_filters, df);
+	g_mutex_unlock(&profile_mutex);
+
+	profile_free(df->profile);
+	df->profile = NULL;
+}
+
+void
+dfilter_set_profiling(gboolean profile)
+{
+	GHashTableIter	iter;
+	gpointer	df;
+
+	g_mutex_lock(&profile_mutex);
+	profiling = profile;
+	if (profiling && live_filters != NULL) {
+		g_hash_table_iter_init(&iter, live_filters);
+		while (g_hash_table_iter_next(&iter, &df, NULL))
+			profile_attach((dfilter_t *)df, TRUE);
+	}
+	g_mutex_unlock(&profile_mutex);
+}
+
+void
+dfilter_print_profile(FILE *f, dfilter_t *df)
+{
+	dfilter_profile_t *profile = df->profile;
+	gint64		total = 0;
+	guint		id;
+
+	if (df->text)
+		fprintf(f, "Filter: %s\n", df->text);
+	else
+		fprintf(f, "Filter: (combined rules)\n");
+
+	if (profile == NULL || profile->applied == 0) {
+		fprintf(f, "Not applied\n");
+		return;
+	}
+
+	for (id = 0; id < df->insns->len; id++)
+		total += profile->time[id];
+
+	fprintf(f, "Applied: %" G_GUINT64_FORMAT ", passed: %" G_GUINT64_FORMAT
+		" (%.2f%%)", profile->applied, profile->passed,
+		100.0 * profile->passed / profile->applied);
+	if (profile->timed)
+		fprintf(f, ", time: %.3f ms", total / 1000.0);
+	fprintf(f, "\n");
+
+	dfvm_dump(f, df);
+}
+
+static gint
+compare_filter_text(gconstpointer a, gconstpointer b)
+{
+	const dfilter_t *df_a = *(const dfilter_t * const *)a;
+	const dfilter_t *df_b = *(const dfilter_t * const *)b;
+
+	return g_strcmp0(df_a->text, df_b->text);
+}
+
+void
+dfilter_print_all_profiles(FILE *f)
+{
+	GPtrArray	*filters;
+	GHashTableIter	iter;
+	gpointer	df;
+	guint		i;
+
+	filters = g_ptr_array_new();
+	g_mutex_lock(&profile_mutex);
+	if (live_filters != NULL) {
+		g_hash_table_iter_init(&iter, live_filters);
+		while (g_hash_table_iter_next(&iter, &df, NULL)) {
+			if (((dfilter_t *)df)->profile != NULL &&
+					((dfilter_t *)df)->profile->applied > 0)
+				g_ptr_array_add(filters, df);
+		}
+	}
+	g_mutex_unlock(&profile_mutex);
+
+	g_ptr_array_sort(filters, compare_filter_text);
+	for (i = 0; i < filters->len; i++) {
+		if (i > 0)
+			fprintf(f, "\n");
+		dfilter_print_profile(f, (dfilter_t *)g_ptr_array_index(filters, i));
+	}
+	g_ptr_array_free(filters, TRUE);
+}
+
+void
+dfilter_learn_selectivity(dfilter_t *df)
+{
+	dfilter_profile_t *profile;
+	dfilter_leaf_t	*leaf;
+	selectivity_t	*sel;
+	guint		i;
+
+	if (df == NULL || df->profile == NULL || df->leaves == NULL)
+		return;
+	if (!prefs.filter_selectivity_feedback)
+		return;
+
+	profile = df->profile;
+	g_mutex_lock(&profile_mutex);
+	if (selectivity == NULL)
+		selectivity = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	for (i = 0; i < df->leaves->len; i++) {
+		leaf = (dfilter_leaf_t *)g_ptr_array_index(df->leaves, i);
+		if (profile->count[leaf->first] == 0)
+			continue;
+
+		sel = (selectivity_t *)g_hash_table_lookup(selectivity, leaf->key);
+		if (sel == NULL) {
+			sel = g_new0(selectivity_t, 1);
+			g_hash_table_insert(selectivity, g_strdup(leaf->key), sel);
+		}
+		sel->evaluated += profile->count[leaf->first];
+		/* Jump threading can skip the first instruction of a test
+		 * and still reach its result, so it can pass more often
+		 * than it was started. */
+		sel->passed += MIN(profile->true_count[leaf->result],
+				   profile->count[leaf->first]);
+
+		/* Don't count these runs again. */
+		profile->count[leaf->first] = 0;
+		profile->true_count[leaf->result] = 0;
+	}
+	g_mutex_unlock(&profile_mutex);
+}
+
+double
+dfilter_selectivity(const char *key)
+{
+	selectivity_t	*sel = NULL;
+	double		rate = -1.0;
+
+	if (!prefs.filter_selectivity_feedback)
+		return rate;
+
+	g_mutex_lock(&profile_mutex);
+	if (selectivity != NULL)
+		sel = (selectivity_t *)g_hash_table_lookup(selectivity, key);
+	if (sel != NULL && sel->evaluated >= SELECTIVITY_MIN_EVALUATED)
+		rate = (double)sel->passed / (double)sel->evaluated;
+	g_mutex_unlock(&profile_mutex);
+
+	return rate;
+}
+
+void
+dfilter_profile_cleanup(void)
+{
+	g_mutex_lock(&profile_mutex);
+	if (selectivity != NULL) {
+		g_hash_table_destroy(selectivity);
+		selectivity = NULL;
+	}
+	if (live_filters != NULL) {
+		g_hash_table_destroy(live_filters);
+		live_filters = NULL;
+	}
+	profiling = FALSE;
+	g_mutex_unlock(&profile_mutex);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
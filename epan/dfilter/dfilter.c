@@ -16,6 +16,8 @@
 #include "syntax-tree.h"
 #include "gencode.h"
 #include "semcheck.h"
+#include "optimize.h"
+#include "specialize.h"
 #include "dfvm.h"
 #include <epan/epan_dissect.h>
 #include <epan/exceptions.h>
@@ -41,6 +43,8 @@ static void*	ParserObj = NULL;
  */
 dfwork_t *global_dfw;
 
+static gboolean optimize_filters = TRUE;
+
 void
 dfilter_vfail(dfwork_t *dfw, const char *format, va_list args)
 {
@@ -149,6 +153,8 @@ dfilter_cleanup(void)
 
 	/* Clean up the syntax-tree sub-sub-system */
 	sttype_cleanup();
+
+	dfilter_profile_cleanup();
 }
 
 static dfilter_t*
@@ -188,6 +194,8 @@ dfilter_free(dfilter_t *df)
 	if (!df)
 		return;
 
+	dfilter_profile_unregister(df);
+
 	if (df->insns) {
 		free_insns(df->insns);
 	}
@@ -197,6 +205,12 @@ dfilter_free(dfilter_t *df)
 
 	g_free(df->interesting_fields);
 
+	dfspec_free(df->spec);
+	dfilter_expr_free(df->expr);
+	g_free(df->text);
+	if (df->leaves)
+		g_ptr_array_free(df->leaves, TRUE);
+
 	/* Clear registers with constant values (as set by dfvm_init_const).
 	 * Other registers were cleared on RETURN by free_register_overhead. */
 	for (i = df->num_registers; i < df->max_registers; i++) {
@@ -235,6 +249,10 @@ dfwork_free(dfwork_t *dfw)
 		g_hash_table_destroy(dfw->loaded_fields);
 	}
 
+	if (dfw->loaded_ranges) {
+		g_hash_table_destroy(dfw->loaded_ranges);
+	}
+
 	if (dfw->interesting_fields) {
 		g_hash_table_destroy(dfw->interesting_fields);
 	}
@@ -250,6 +268,9 @@ dfwork_free(dfwork_t *dfw)
 	if (dfw->deprecated)
 		g_ptr_array_unref(dfw->deprecated);
 
+	if (dfw->leaves)
+		g_ptr_array_free(dfw->leaves, TRUE);
+
 	/*
 	 * We don't free the error message string; our caller will return
 	 * it to its caller.
@@ -308,57 +329,34 @@ add_deprecated_token(dfwork_t *dfw, const char *token)
 	g_ptr_array_add(deprecated, g_strdup(token));
 }
 
-gboolean
-dfilter_compile_real(const gchar *text, dfilter_t **dfp,
-			gchar **error_ret, const char *caller)
+/*
+ * Parses text into dfw->st_root, which is left NULL for an empty filter,
+ * checks its semantics and optimizes it.  Returns FALSE, with
+ * dfw->error_message set, on failure.
+ */
+static gboolean
+dfw_compile_tree(dfwork_t *dfw, const gchar *text)
 {
 	gchar		*expanded_text;
 	int		token;
-	dfilter_t	*dfilter;
-	dfwork_t	*dfw;
 	df_scanner_state_t state;
 	yyscan_t	scanner;
 	YY_BUFFER_STATE in_buffer;
 	gboolean failure = FALSE;
 	unsigned token_count = 0;
-
-	ws_assert(dfp);
-	*dfp = NULL;
-
-	if (text == NULL) {
-		ws_log(WS_LOG_DOMAIN, LOG_LEVEL_DEBUG,
-			"%s() called from %s() with null filter",
-			__func__, caller);
-		if (error_ret != NULL) {
-			/* XXX This BUG happens often. Some callers are ignoring these errors. */
-			*error_ret = g_strdup("BUG: NULL text pointer passed to dfilter_compile");
-		}
-		return FALSE;
-	}
-	else if (*text == '\0') {
-		/* An empty filter is considered a valid input. */
-		ws_log(WS_LOG_DOMAIN, LOG_LEVEL_DEBUG,
-			"%s() called from %s() with empty filter",
-			__func__, caller);
-	}
-	else {
-		ws_log(WS_LOG_DOMAIN, LOG_LEVEL_DEBUG,
-			"%s() called from %s(), compiling filter: %s",
-			__func__, caller, text);
-	}
-
-	dfw = dfwork_new();
+	df_lval_t	*df_lval;
 
 	expanded_text = dfilter_macro_apply(text, &dfw->error_message);
 	if (expanded_text == NULL) {
-		goto FAILURE;
+		return FALSE;
 	}
 
 	ws_noisy("Expanded text: %s", expanded_text);
 
 	if (df_lex_init(&scanner) != 0) {
 		dfw->error_message = ws_strdup_printf("Can't initialize scanner: %s", g_strerror(errno));
-		goto FAILURE;
+		wmem_free(NULL, expanded_text);
+		return FALSE;
 	}
 
 	in_buffer = df__scan_string(expanded_text, scanner);
@@ -425,45 +423,138 @@ dfilter_compile_real(const gchar *text, dfilter_t **dfp,
 	df__delete_buffer(in_buffer, scanner);
 	df_lex_destroy(scanner);
 
+	wmem_free(NULL, expanded_text);
+
 	if (failure)
-		goto FAILURE;
+		return FALSE;
+
+	/* Success, but was it an empty filter? */
+	if (dfw->st_root == NULL)
+		return TRUE;
+
+	log_syntax_tree(LOG_LEVEL_NOISY, dfw->st_root, "Syntax tree before semantic check");
+
+	/* Check semantics and do necessary type conversion*/
+	if (!dfw_semcheck(dfw)) {
+		return FALSE;
+	}
+
+	log_syntax_tree(LOG_LEVEL_NOISY, dfw->st_root, "Syntax tree after successful semantic check");
+
+	if (optimize_filters) {
+		dfw_optimize(dfw);
+		log_syntax_tree(LOG_LEVEL_NOISY, dfw->st_root, "Syntax tree after optimization");
+	}
+
+	return TRUE;
+}
+
+/* Tucks away the bytecode generated in dfw in a new dfilter_t. */
+static dfilter_t *
+dfw_to_dfilter(dfwork_t *dfw)
+{
+	dfilter_t	*dfilter;
+
+	dfilter = dfilter_new(dfw->deprecated);
+	dfilter->insns = dfw->insns;
+	dfilter->consts = dfw->consts;
+	dfilter->leaves = dfw->leaves;
+	dfw->insns = NULL;
+	dfw->consts = NULL;
+	dfw->leaves = NULL;
+	dfilter->interesting_fields = dfw_interesting_fields(dfw,
+		&dfilter->num_interesting_fields);
+
+	/* Initialize run-time space */
+	dfilter->num_registers = dfw->first_constant;
+	dfilter->max_registers = dfw->next_register;
+	dfilter->registers = g_new0(GList*, dfilter->max_registers);
+	dfilter->attempted_load = g_new0(gboolean, dfilter->max_registers);
+	dfilter->owns_memory = g_new0(gboolean, dfilter->max_registers);
+
+	/* Initialize constants */
+	dfvm_init_const(dfilter);
+
+	return dfilter;
+}
 
-	/* Success, but was it an empty filter? If so, discard
-	 * it and set *dfp to NULL */
-	if (dfw->st_root == NULL) {
-		*dfp = NULL;
+static void
+dfw_fail(dfwork_t *dfw, const gchar *text, gchar **error_ret)
+{
+	if (dfw->error_message == NULL) {
+		/* We require an error message. */
+		ws_critical("Unknown error compiling filter: %s", text);
 	}
 	else {
-		log_syntax_tree(LOG_LEVEL_NOISY, dfw->st_root, "Syntax tree before semantic check");
+		ws_debug("Compiling filter failed with error: %s.", dfw->error_message);
+		if (error_ret != NULL) {
+			*error_ret = dfw->error_message;
+		}
+		else {
+			g_free(dfw->error_message);
+		}
+	}
+}
 
-		/* Check semantics and do necessary type conversion*/
-		if (!dfw_semcheck(dfw)) {
-			goto FAILURE;
+gboolean
+dfilter_compile_real(const gchar *text, dfilter_t **dfp,
+			gchar **error_ret, const char *caller)
+{
+	dfilter_t	*dfilter;
+	dfwork_t	*dfw;
+	dfilter_expr_t	*expr;
+
+	ws_assert(dfp);
+	*dfp = NULL;
+
+	if (text == NULL) {
+		ws_log(WS_LOG_DOMAIN, LOG_LEVEL_DEBUG,
+			"%s() called from %s() with null filter",
+			__func__, caller);
+		if (error_ret != NULL) {
+			/* XXX This BUG happens often. Some callers are ignoring these errors. */
+			*error_ret = g_strdup("BUG: NULL text pointer passed to dfilter_compile");
 		}
+		return FALSE;
+	}
+	else if (*text == '\0') {
+		/* An empty filter is considered a valid input. */
+		ws_log(WS_LOG_DOMAIN, LOG_LEVEL_DEBUG,
+			"%s() called from %s() with empty filter",
+			__func__, caller);
+	}
+	else {
+		ws_log(WS_LOG_DOMAIN, LOG_LEVEL_DEBUG,
+			"%s() called from %s(), compiling filter: %s",
+			__func__, caller, text);
+	}
+
+	dfw = dfwork_new();
+
+	if (!dfw_compile_tree(dfw, text)) {
+		dfw_fail(dfw, text, error_ret);
+		global_dfw = NULL;
+		dfwork_free(dfw);
+		return FALSE;
+	}
 
-		log_syntax_tree(LOG_LEVEL_NOISY, dfw->st_root, "Syntax tree after successful semantic check");
+	/* If it was an empty filter, leave *dfp set to NULL */
+	if (dfw->st_root != NULL) {
+		/* Remember the structure of the filter for the result cache
+		 * before the code generator takes the tree apart. */
+		expr = dfilter_expr_new(dfw->st_root);
 
 		/* Create bytecode */
 		dfw_gencode(dfw);
 
-		/* Tuck away the bytecode in the dfilter_t */
-		dfilter = dfilter_new(dfw->deprecated);
-		dfilter->insns = dfw->insns;
-		dfilter->consts = dfw->consts;
-		dfw->insns = NULL;
-		dfw->consts = NULL;
-		dfilter->interesting_fields = dfw_interesting_fields(dfw,
-			&dfilter->num_interesting_fields);
-
-		/* Initialize run-time space */
-		dfilter->num_registers = dfw->first_constant;
-		dfilter->max_registers = dfw->next_register;
-		dfilter->registers = g_new0(GList*, dfilter->max_registers);
-		dfilter->attempted_load = g_new0(gboolean, dfilter->max_registers);
-		dfilter->owns_memory = g_new0(gboolean, dfilter->max_registers);
-
-		/* Initialize constants */
-		dfvm_init_const(dfilter);
+		dfilter = dfw_to_dfilter(dfw);
+		dfilter->expr = expr;
+		dfilter->text = g_strdup(text);
+
+		if (optimize_filters) {
+			dfvm_specialize(dfilter);
+		}
+		dfilter_profile_register(dfilter);
 
 		/* And give it to the user. */
 		*dfp = dfilter;
@@ -475,43 +566,97 @@ dfilter_compile_real(const gchar *text, dfilter_t **dfp,
 		ws_log(WS_LOG_DOMAIN, LOG_LEVEL_INFO, "Compiled display filter: %s", text);
 	else
 		ws_debug("Compiled empty filter (successfully).");
-	wmem_free(NULL, expanded_text);
 	return TRUE;
+}
 
-FAILURE:
-	ws_assert(dfw);
-	if (dfw->error_message == NULL) {
-		/* We require an error message. */
-		ws_critical("Unknown error compiling filter: %s", text);
-	}
-	else {
-		ws_debug("Compiling filter failed with error: %s.", dfw->error_message);
-		if (error_ret != NULL) {
-			*error_ret = dfw->error_message;
-		}
-		else {
-			g_free(dfw->error_message);
+gboolean
+dfilter_compile_rules(const gchar **texts, guint num_texts, dfilter_t **dfp,
+			gchar **error_ret)
+{
+	dfwork_t	*dfw;
+	stnode_t	**roots;
+	guint		i;
+	gboolean	empty = TRUE;
+
+	ws_assert(dfp);
+	*dfp = NULL;
+
+	dfw = dfwork_new();
+	roots = g_new0(stnode_t *, num_texts);
+
+	for (i = 0; i < num_texts; i++) {
+		if (texts[i] == NULL || !dfw_compile_tree(dfw, texts[i])) {
+			if (texts[i] == NULL && error_ret != NULL)
+				*error_ret = g_strdup("BUG: NULL text pointer passed to dfilter_compile_rules");
+			else
+				dfw_fail(dfw, texts[i], error_ret);
+			goto FAILURE;
 		}
+		/* An empty filter never matches. */
+		roots[i] = dfw->st_root;
+		dfw->st_root = NULL;
+		if (roots[i] != NULL)
+			empty = FALSE;
 	}
 
-	global_dfw = NULL;
+	if (!empty) {
+		dfw_gencode_rules(dfw, roots, num_texts);
+		*dfp = dfw_to_dfilter(dfw);
+		dfilter_profile_register(*dfp);
+	}
+
+	for (i = 0; i < num_texts; i++) {
+		if (roots[i] != NULL)
+			stnode_free(roots[i]);
+	}
+	g_free(roots);
+	dfwork_free(dfw);
+	return TRUE;
+
+FAILURE:
+	for (i = 0; i < num_texts; i++) {
+		if (roots[i] != NULL)
+			stnode_free(roots[i]);
+	}
+	g_free(roots);
 	dfwork_free(dfw);
-	wmem_free(NULL, expanded_text);
-	*dfp = NULL;
 	return FALSE;
 }
 
 
+void
+dfilter_set_optimize(gboolean optimize)
+{
+	optimize_filters = optimize;
+}
+
 gboolean
 dfilter_apply(dfilter_t *df, proto_tree *tree)
 {
+	/* The specialized evaluator doesn't count instructions. */
+	if (df->spec && df->profile == NULL)
+		return dfspec_apply(df->spec, tree);
 	return dfvm_apply(df, tree);
 }
 
+int
+dfilter_apply_rules(dfilter_t *df, proto_tree *tree)
+{
+	return dfvm_apply_rules(df, tree);
+}
+
+void
+dfilter_apply_all_rules(dfilter_t *df, proto_tree *tree, gboolean *results,
+			guint num_results)
+{
+	memset(results, 0, num_results * sizeof(*results));
+	dfvm_apply_all_rules(df, tree, results);
+}
+
 gboolean
 dfilter_apply_edt(dfilter_t *df, epan_dissect_t* edt)
 {
-	return dfvm_apply(df, edt->tree);
+	return dfilter_apply(df, edt->tree);
 }
 
 
@@ -547,6 +692,11 @@ dfilter_dump(dfilter_t *df)
 
 	dfvm_dump(stdout, df);
 
+	if (df->spec) {
+		printf("\nSpecialized:\n");
+		dfspec_dump(stdout, df->spec);
+	}
+
 	if (df->deprecated && df->deprecated->len) {
 		printf("\nDeprecated tokens: ");
 		for (i = 0; i < df->deprecated->len; i++) {
@@ -10,6 +10,8 @@
 #ifndef DFILTER_H
 #define DFILTER_H
 
+#include <stdio.h>
+
 #include <glib.h>
 #include "ws_symbol_export.h"
 
@@ -54,6 +56,24 @@ dfilter_compile_real(const gchar *text, dfilter_t **dfp,
 #define dfilter_compile(text, dfp, err_msg) \
 	dfilter_compile_real(text, dfp, err_msg, __func__)
 
+/* Compiles a list of filters into a single program for
+ * dfilter_apply_rules(). The filters share the fields they read, so
+ * evaluating the list costs less than applying each filter in turn.
+ * Empty filters never match; if all of them are empty, *dfp is set to
+ * NULL. Errors are reported as for dfilter_compile(). */
+gboolean
+dfilter_compile_rules(const gchar **texts, guint num_texts, dfilter_t **dfp,
+			gchar **err_msg);
+
+/* Sets whether dfilter_compile() optimizes the syntax tree before
+ * generating the bytecode, and builds a specialized evaluator for
+ * filters that only compare integer and address fields with constants.
+ * This is on by default; turning it off is only useful for debugging
+ * (see dftest). */
+WS_DLL_PUBLIC
+void
+dfilter_set_optimize(gboolean optimize);
+
 /* Frees all memory used by dfilter, and frees
  * the dfilter itself. */
 WS_DLL_PUBLIC
@@ -69,6 +89,18 @@ dfilter_apply_edt(dfilter_t *df, struct epan_dissect *edt);
 gboolean
 dfilter_apply(dfilter_t *df, proto_tree *tree);
 
+/* Apply a program compiled by dfilter_compile_rules(). Returns the
+ * index of the first filter that matches, or -1 if none does. */
+int
+dfilter_apply_rules(dfilter_t *df, proto_tree *tree);
+
+/* Apply a program compiled by dfilter_compile_rules() and store the
+ * result of every filter in results, which has one entry for each of
+ * the num_results filters that were compiled. */
+void
+dfilter_apply_all_rules(dfilter_t *df, proto_tree *tree, gboolean *results,
+			guint num_results);
+
 /* Prime a proto_tree using the fields/protocols used in a dfilter. */
 void
 dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree);
@@ -86,6 +118,30 @@ WS_DLL_PUBLIC
 void
 dfilter_dump(dfilter_t *df);
 
+/* Count how often each instruction of every display filter runs, how
+ * often its result is TRUE and how long it takes. This also applies to
+ * the filters that are already compiled. */
+WS_DLL_PUBLIC
+void
+dfilter_set_profiling(gboolean profile);
+
+/* Print the counts of a filter along with its bytecode */
+WS_DLL_PUBLIC
+void
+dfilter_print_profile(FILE *f, dfilter_t *df);
+
+/* Print the counts of every filter that has been applied */
+WS_DLL_PUBLIC
+void
+dfilter_print_all_profiles(FILE *f);
+
+/* Add the pass rates of the tests in a filter, counted since the last
+ * call, to those the optimizer uses to order "&&" and "||" operands.
+ * Call this after applying the filter to a capture file. */
+WS_DLL_PUBLIC
+void
+dfilter_learn_selectivity(dfilter_t *df);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -40,6 +40,9 @@ dfvm_value_free(dfvm_value_t *v)
 		case PCRE:
 			ws_regex_free(v->value.pcre);
 			break;
+		case DSET:
+			dset_free(v->value.dset);
+			break;
 		default:
 			/* nothing */
 			;
@@ -77,6 +80,186 @@ dfvm_value_new(dfvm_value_type_t type)
 }
 
 
+static void
+dump_insn(FILE *f, dfvm_insn_t *insn, int id)
+{
+	dfvm_value_t	*arg1;
+	dfvm_value_t	*arg2;
+	dfvm_value_t	*arg3;
+	dfvm_value_t	*arg4;
+	GSList		*range_list;
+	drange_node	*range_item;
+
+	arg1 = insn->arg1;
+	arg2 = insn->arg2;
+	arg3 = insn->arg3;
+	arg4 = insn->arg4;
+
+	switch (insn->op) {
+		case CHECK_EXISTS:
+			fprintf(f, "%05d CHECK_EXISTS\t%s\n",
+				id, arg1->value.hfinfo->abbrev);
+			break;
+
+		case READ_TREE:
+			fprintf(f, "%05d READ_TREE\t\t%s -> reg#%u\n",
+				id, arg1->value.hfinfo->abbrev,
+				arg2->value.numeric);
+			break;
+
+		case CALL_FUNCTION:
+			fprintf(f, "%05d CALL_FUNCTION\t%s (",
+				id, arg1->value.funcdef->name);
+			if (arg3) {
+				fprintf(f, "reg#%u", arg3->value.numeric);
+			}
+			if (arg4) {
+				fprintf(f, ", reg#%u", arg4->value.numeric);
+			}
+			fprintf(f, ") --> reg#%u\n", arg2->value.numeric);
+			break;
+
+		case PUT_FVALUE:
+			/* We already dumped these */
+			ws_assert_not_reached();
+			break;
+
+		case PUT_PCRE:
+			/* We already dumped these */
+			ws_assert_not_reached();
+			break;
+
+		case MK_RANGE:
+			arg3 = insn->arg3;
+			fprintf(f, "%05d MK_RANGE\t\treg#%u[",
+				id,
+				arg1->value.numeric);
+			for (range_list = arg3->value.drange->range_list;
+			     range_list != NULL;
+			     range_list = range_list->next) {
+				range_item = (drange_node *)range_list->data;
+				switch (range_item->ending) {
+
+				case DRANGE_NODE_END_T_UNINITIALIZED:
+					fprintf(f, "?");
+					break;
+
+				case DRANGE_NODE_END_T_LENGTH:
+					fprintf(f, "%d:%d",
+					    range_item->start_offset,
+					    range_item->length);
+					break;
+
+				case DRANGE_NODE_END_T_OFFSET:
+					fprintf(f, "%d-%d",
+					    range_item->start_offset,
+					    range_item->end_offset);
+					break;
+
+				case DRANGE_NODE_END_T_TO_THE_END:
+					fprintf(f, "%d:",
+					    range_item->start_offset);
+					break;
+				}
+				if (range_list->next != NULL)
+					fprintf(f, ",");
+			}
+			fprintf(f, "] -> reg#%u\n",
+				arg2->value.numeric);
+			break;
+
+		case ANY_EQ:
+			fprintf(f, "%05d ANY_EQ\t\treg#%u == reg#%u\n",
+				id, arg1->value.numeric, arg2->value.numeric);
+			break;
+
+		case ALL_NE:
+			fprintf(f, "%05d ALL_NE\t\treg#%u == reg#%u\n",
+				id, arg1->value.numeric, arg2->value.numeric);
+			break;
+
+		case ANY_NE:
+			fprintf(f, "%05d ANY_NE\t\treg#%u == reg#%u\n",
+				id, arg1->value.numeric, arg2->value.numeric);
+			break;
+
+		case ANY_GT:
+			fprintf(f, "%05d ANY_GT\t\treg#%u == reg#%u\n",
+				id, arg1->value.numeric, arg2->value.numeric);
+			break;
+
+		case ANY_GE:
+			fprintf(f, "%05d ANY_GE\t\treg#%u == reg#%u\n",
+				id, arg1->value.numeric, arg2->value.numeric);
+			break;
+
+		case ANY_LT:
+			fprintf(f, "%05d ANY_LT\t\treg#%u == reg#%u\n",
+				id, arg1->value.numeric, arg2->value.numeric);
+			break;
+
+		case ANY_LE:
+			fprintf(f, "%05d ANY_LE\t\treg#%u == reg#%u\n",
+				id, arg1->value.numeric, arg2->value.numeric);
+			break;
+
+		case ANY_BITWISE_AND:
+			fprintf(f, "%05d ANY_BITWISE_AND\t\treg#%u == reg#%u\n",
+				id, arg1->value.numeric, arg2->value.numeric);
+			break;
+
+		case ANY_CONTAINS:
+			fprintf(f, "%05d ANY_CONTAINS\treg#%u contains reg#%u\n",
+				id, arg1->value.numeric, arg2->value.numeric);
+			break;
+
+		case ANY_MATCHES:
+			fprintf(f, "%05d ANY_MATCHES\treg#%u matches reg#%u\n",
+				id, arg1->value.numeric, arg2->value.numeric);
+			break;
+
+		case ANY_IN_RANGE:
+			fprintf(f, "%05d ANY_IN_RANGE\treg#%u in range reg#%u,reg#%u\n",
+				id, arg1->value.numeric, arg2->value.numeric,
+				arg3->value.numeric);
+			break;
+
+		case ANY_IN_SET:
+			fprintf(f, "%05d ANY_IN_SET\treg#%u in set of %u elements (%u intervals)\n",
+				id, arg1->value.numeric,
+				dset_num_elements(arg2->value.dset),
+				dset_num_intervals(arg2->value.dset));
+			break;
+
+		case NOT:
+			fprintf(f, "%05d NOT\n", id);
+			break;
+
+		case RETURN:
+			fprintf(f, "%05d RETURN\n", id);
+			break;
+
+		case RETURN_IF_TRUE:
+			fprintf(f, "%05d RETURN-IF-TRUE\t%u\n",
+					id, arg1->value.numeric);
+			break;
+
+		case IF_TRUE_GOTO:
+			fprintf(f, "%05d IF-TRUE-GOTO\t%u\n",
+					id, arg1->value.numeric);
+			break;
+
+		case IF_FALSE_GOTO:
+			fprintf(f, "%05d IF-FALSE-GOTO\t%u\n",
+					id, arg1->value.numeric);
+			break;
+
+		default:
+			ws_assert_not_reached();
+			break;
+	}
+}
+
 void
 dfvm_dump(FILE *f, dfilter_t *df)
 {
@@ -84,11 +267,8 @@ dfvm_dump(FILE *f, dfilter_t *df)
 	dfvm_insn_t	*insn;
 	dfvm_value_t	*arg1;
 	dfvm_value_t	*arg2;
-	dfvm_value_t	*arg3;
-	dfvm_value_t	*arg4;
 	char		*value_str;
-	GSList		*range_list;
-	drange_node	*range_item;
+	dfilter_profile_t *profile;
 
 	/* First dump the constant initializations */
 	fprintf(f, "Constants:\n");
@@ -130,8 +310,10 @@ dfvm_dump(FILE *f, dfilter_t *df)
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
 			case ANY_IN_RANGE:
+			case ANY_IN_SET:
 			case NOT:
 			case RETURN:
+			case RETURN_IF_TRUE:
 			case IF_TRUE_GOTO:
 			case IF_FALSE_GOTO:
 			default:
@@ -141,167 +323,25 @@ dfvm_dump(FILE *f, dfilter_t *df)
 	}
 
 	fprintf(f, "\nInstructions:\n");
+	profile = df->profile;
+	if (profile != NULL && profile->applied == 0)
+		profile = NULL;
+	if (profile != NULL) {
+		fprintf(f, "%12s %7s %12s\n", "Count", "True", "Time (ms)");
+	}
 	/* Now dump the operations */
 	length = df->insns->len;
 	for (id = 0; id < length; id++) {
 
 		insn = (dfvm_insn_t	*)g_ptr_array_index(df->insns, id);
-		arg1 = insn->arg1;
-		arg2 = insn->arg2;
-		arg3 = insn->arg3;
-		arg4 = insn->arg4;
-
-		switch (insn->op) {
-			case CHECK_EXISTS:
-				fprintf(f, "%05d CHECK_EXISTS\t%s\n",
-					id, arg1->value.hfinfo->abbrev);
-				break;
-
-			case READ_TREE:
-				fprintf(f, "%05d READ_TREE\t\t%s -> reg#%u\n",
-					id, arg1->value.hfinfo->abbrev,
-					arg2->value.numeric);
-				break;
-
-			case CALL_FUNCTION:
-				fprintf(f, "%05d CALL_FUNCTION\t%s (",
-					id, arg1->value.funcdef->name);
-				if (arg3) {
-					fprintf(f, "reg#%u", arg3->value.numeric);
-				}
-				if (arg4) {
-					fprintf(f, ", reg#%u", arg4->value.numeric);
-				}
-				fprintf(f, ") --> reg#%u\n", arg2->value.numeric);
-				break;
-
-			case PUT_FVALUE:
-				/* We already dumped these */
-				ws_assert_not_reached();
-				break;
-
-			case PUT_PCRE:
-				/* We already dumped these */
-				ws_assert_not_reached();
-				break;
-
-			case MK_RANGE:
-				arg3 = insn->arg3;
-				fprintf(f, "%05d MK_RANGE\t\treg#%u[",
-					id,
-					arg1->value.numeric);
-				for (range_list = arg3->value.drange->range_list;
-				     range_list != NULL;
-				     range_list = range_list->next) {
-					range_item = (drange_node *)range_list->data;
-					switch (range_item->ending) {
-
-					case DRANGE_NODE_END_T_UNINITIALIZED:
-						fprintf(f, "?");
-						break;
-
-					case DRANGE_NODE_END_T_LENGTH:
-						fprintf(f, "%d:%d",
-						    range_item->start_offset,
-						    range_item->length);
-						break;
-
-					case DRANGE_NODE_END_T_OFFSET:
-						fprintf(f, "%d-%d",
-						    range_item->start_offset,
-						    range_item->end_offset);
-						break;
-
-					case DRANGE_NODE_END_T_TO_THE_END:
-						fprintf(f, "%d:",
-						    range_item->start_offset);
-						break;
-					}
-					if (range_list->next != NULL)
-						fprintf(f, ",");
-				}
-				fprintf(f, "] -> reg#%u\n",
-					arg2->value.numeric);
-				break;
-
-			case ANY_EQ:
-				fprintf(f, "%05d ANY_EQ\t\treg#%u == reg#%u\n",
-					id, arg1->value.numeric, arg2->value.numeric);
-				break;
-
-			case ALL_NE:
-				fprintf(f, "%05d ALL_NE\t\treg#%u == reg#%u\n",
-					id, arg1->value.numeric, arg2->value.numeric);
-				break;
-
-			case ANY_NE:
-				fprintf(f, "%05d ANY_NE\t\treg#%u == reg#%u\n",
-					id, arg1->value.numeric, arg2->value.numeric);
-				break;
-
-			case ANY_GT:
-				fprintf(f, "%05d ANY_GT\t\treg#%u == reg#%u\n",
-					id, arg1->value.numeric, arg2->value.numeric);
-				break;
-
-			case ANY_GE:
-				fprintf(f, "%05d ANY_GE\t\treg#%u == reg#%u\n",
-					id, arg1->value.numeric, arg2->value.numeric);
-				break;
-
-			case ANY_LT:
-				fprintf(f, "%05d ANY_LT\t\treg#%u == reg#%u\n",
-					id, arg1->value.numeric, arg2->value.numeric);
-				break;
-
-			case ANY_LE:
-				fprintf(f, "%05d ANY_LE\t\treg#%u == reg#%u\n",
-					id, arg1->value.numeric, arg2->value.numeric);
-				break;
-
-			case ANY_BITWISE_AND:
-				fprintf(f, "%05d ANY_BITWISE_AND\t\treg#%u == reg#%u\n",
-					id, arg1->value.numeric, arg2->value.numeric);
-				break;
-
-			case ANY_CONTAINS:
-				fprintf(f, "%05d ANY_CONTAINS\treg#%u contains reg#%u\n",
-					id, arg1->value.numeric, arg2->value.numeric);
-				break;
-
-			case ANY_MATCHES:
-				fprintf(f, "%05d ANY_MATCHES\treg#%u matches reg#%u\n",
-					id, arg1->value.numeric, arg2->value.numeric);
-				break;
-
-			case ANY_IN_RANGE:
-				fprintf(f, "%05d ANY_IN_RANGE\treg#%u in range reg#%u,reg#%u\n",
-					id, arg1->value.numeric, arg2->value.numeric,
-					arg3->value.numeric);
-				break;
-
-			case NOT:
-				fprintf(f, "%05d NOT\n", id);
-				break;
-
-			case RETURN:
-				fprintf(f, "%05d RETURN\n", id);
-				break;
-
-			case IF_TRUE_GOTO:
-				fprintf(f, "%05d IF-TRUE-GOTO\t%u\n",
-						id, arg1->value.numeric);
-				break;
-
-			case IF_FALSE_GOTO:
-				fprintf(f, "%05d IF-FALSE-GOTO\t%u\n",
-						id, arg1->value.numeric);
-				break;
-
-			default:
-				ws_assert_not_reached();
-				break;
+		if (profile != NULL) {
+			fprintf(f, "%12" G_GUINT64_FORMAT " %6.2f%% %12.3f ",
+				profile->count[id],
+				profile->count[id] ?
+					100.0 * profile->true_count[id] / profile->count[id] : 0.0,
+				profile->time[id] / 1000.0);
 		}
+		dump_insn(f, insn, id);
 	}
 }
 
@@ -499,6 +539,19 @@ any_in_range(dfilter_t *df, int reg1, int reg2, int reg3)
 	return FALSE;
 }
 
+static gboolean
+any_in_set(dfilter_t *df, int reg1, const dset_t *set)
+{
+	GList	*list1;
+
+	for (list1 = df->registers[reg1]; list1; list1 = g_list_next(list1)) {
+		if (dset_contains(set, (fvalue_t *)list1->data)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
 
 static void
 free_owned_register(gpointer data, gpointer user_data _U_)
@@ -536,6 +589,12 @@ mk_range(dfilter_t *df, int from_reg, int to_reg, drange_t *d_range)
 	GList		*from_list, *to_list;
 	fvalue_t	*old_fv, *new_fv;
 
+	/* Already made in this run of the dfilter? */
+	if (df->attempted_load[to_reg]) {
+		return;
+	}
+	df->attempted_load[to_reg] = TRUE;
+
 	to_list = NULL;
 	from_list = df->registers[from_reg];
 
@@ -557,8 +616,47 @@ mk_range(dfilter_t *df, int from_reg, int to_reg, drange_t *d_range)
 
 
 
-gboolean
-dfvm_apply(dfilter_t *df, proto_tree *tree)
+/*
+ * Counts the run of instruction id. The result of an instruction is the
+ * value of accum when the next one starts, so it is counted then.
+ */
+static inline void
+profile_insn(dfilter_profile_t *profile, int *prev, int id, gboolean accum)
+{
+	gint64		now;
+
+	if (*prev >= 0) {
+		if (accum)
+			profile->true_count[*prev]++;
+		if (profile->timed) {
+			now = g_get_monotonic_time();
+			profile->time[*prev] += now - profile->insn_start;
+			profile->insn_start = now;
+		}
+	}
+	else if (profile->timed) {
+		profile->insn_start = g_get_monotonic_time();
+	}
+	profile->count[id]++;
+	*prev = id;
+}
+
+static inline void
+profile_return(dfilter_profile_t *profile, gboolean accum)
+{
+	profile->applied++;
+	if (accum)
+		profile->passed++;
+}
+
+/*
+ * Runs the program. For a program generated from a list of filters,
+ * *rule is set to the index of the filter at which it stopped; if
+ * results is not NULL, the program doesn't stop at the first filter
+ * that matches but stores the result of every filter in results.
+ */
+static gboolean
+dfvm_run(dfilter_t *df, proto_tree *tree, guint32 *rule, gboolean *results)
 {
 	int		id, length;
 	gboolean	accum = TRUE;
@@ -570,6 +668,8 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 	header_field_info	*hfinfo;
 	GList		*param1;
 	GList		*param2;
+	dfilter_profile_t *profile = df->profile;
+	int		prev = -1;
 
 	ws_assert(tree);
 
@@ -578,6 +678,8 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 	for (id = 0; id < length; id++) {
 
 	  AGAIN:
+		if (profile)
+			profile_insn(profile, &prev, id, accum);
 		insn = (dfvm_insn_t	*)g_ptr_array_index(df->insns, id);
 		arg1 = insn->arg1;
 		arg2 = insn->arg2;
@@ -680,14 +782,35 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 						arg3->value.numeric);
 				break;
 
+			case ANY_IN_SET:
+				accum = any_in_set(df, arg1->value.numeric,
+						arg2->value.dset);
+				break;
+
 			case NOT:
 				accum = !accum;
 				break;
 
 			case RETURN:
+				if (profile)
+					profile_return(profile, accum);
 				free_register_overhead(df);
 				return accum;
 
+			case RETURN_IF_TRUE:
+				if (results != NULL) {
+					results[arg1->value.numeric] = accum;
+					break;
+				}
+				if (accum) {
+					if (profile)
+						profile_return(profile, accum);
+					free_register_overhead(df);
+					*rule = arg1->value.numeric;
+					return TRUE;
+				}
+				break;
+
 			case IF_TRUE_GOTO:
 				if (accum) {
 					id = arg1->value.numeric;
@@ -728,6 +851,32 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 	return FALSE; /* to appease the compiler */
 }
 
+gboolean
+dfvm_apply(dfilter_t *df, proto_tree *tree)
+{
+	guint32		rule;
+
+	return dfvm_run(df, tree, &rule, NULL);
+}
+
+int
+dfvm_apply_rules(dfilter_t *df, proto_tree *tree)
+{
+	guint32		rule;
+
+	if (!dfvm_run(df, tree, &rule, NULL))
+		return -1;
+	return (int)rule;
+}
+
+void
+dfvm_apply_all_rules(dfilter_t *df, proto_tree *tree, gboolean *results)
+{
+	guint32		rule;
+
+	dfvm_run(df, tree, &rule, results);
+}
+
 void
 dfvm_init_const(dfilter_t *df)
 {
@@ -768,8 +917,10 @@ dfvm_init_const(dfilter_t *df)
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
 			case ANY_IN_RANGE:
+			case ANY_IN_SET:
 			case NOT:
 			case RETURN:
+			case RETURN_IF_TRUE:
 			case IF_TRUE_GOTO:
 			case IF_FALSE_GOTO:
 			default:
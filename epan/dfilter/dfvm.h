@@ -15,6 +15,7 @@
 #include "dfilter-int.h"
 #include "syntax-tree.h"
 #include "drange.h"
+#include "dset.h"
 #include "dfunctions.h"
 
 typedef enum {
@@ -26,7 +27,8 @@ typedef enum {
 	INTEGER,
 	DRANGE,
 	FUNCTION_DEF,
-	PCRE
+	PCRE,
+	DSET
 } dfvm_value_type_t;
 
 typedef struct {
@@ -39,6 +41,7 @@ typedef struct {
 		header_field_info	*hfinfo;
 		df_func_def_t		*funcdef;
 		ws_regex_t		*pcre;
+		dset_t			*dset;
 	} value;
 
 } dfvm_value_t;
@@ -51,6 +54,7 @@ typedef enum {
 	CHECK_EXISTS,
 	NOT,
 	RETURN,
+	RETURN_IF_TRUE,
 	READ_TREE,
 	PUT_FVALUE,
 	PUT_PCRE,
@@ -66,7 +70,8 @@ typedef enum {
 	ANY_MATCHES,
 	MK_RANGE,
 	CALL_FUNCTION,
-	ANY_IN_RANGE
+	ANY_IN_RANGE,
+	ANY_IN_SET
 
 } dfvm_opcode_t;
 
@@ -94,6 +99,12 @@ dfvm_dump(FILE *f, dfilter_t *df);
 gboolean
 dfvm_apply(dfilter_t *df, proto_tree *tree);
 
+int
+dfvm_apply_rules(dfilter_t *df, proto_tree *tree);
+
+void
+dfvm_apply_all_rules(dfilter_t *df, proto_tree *tree, gboolean *results);
+
 void
 dfvm_init_const(dfilter_t *df);
 
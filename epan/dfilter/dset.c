@@ -0,0 +1,400 @@
+/*
+ * Precompiled sets of constants for the "in" membership operator
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include "dset.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+	DSET_UINT,	/* key is the value */
+	DSET_SINT,	/* key is the value with the sign bit flipped */
+	DSET_IPV4,	/* key is the address, CIDR blocks are intervals */
+	DSET_STRING,	/* hashed as strings */
+	DSET_BYTES	/* hashed as byte arrays */
+} dset_kind_t;
+
+typedef struct {
+	guint64		low;
+	guint64		high;
+} dset_interval_t;
+
+struct _dset {
+	ftenum_t	ftype;
+	dset_kind_t	kind;
+	guint		num_elements;
+	GHashTable	*values;
+	guint64		*keys;		/* storage for the integer hash keys */
+	dset_interval_t	*intervals;	/* sorted and disjoint */
+	guint		num_intervals;
+	fvalue_t	**elements;	/* (lower, upper) pairs, upper may be NULL */
+};
+
+#define SIGN_FLIP	G_GUINT64_CONSTANT(0x8000000000000000)
+
+static gboolean
+dset_kind(ftenum_t ftype, dset_kind_t *kind)
+{
+	switch (ftype) {
+		case FT_CHAR:
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+		case FT_UINT40:
+		case FT_UINT48:
+		case FT_UINT56:
+		case FT_UINT64:
+		case FT_IPXNET:
+		case FT_FRAMENUM:
+		case FT_EUI64:
+			*kind = DSET_UINT;
+			return TRUE;
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+		case FT_INT40:
+		case FT_INT48:
+		case FT_INT56:
+		case FT_INT64:
+			*kind = DSET_SINT;
+			return TRUE;
+		case FT_IPv4:
+			*kind = DSET_IPV4;
+			return TRUE;
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_STRINGZPAD:
+		case FT_STRINGZTRUNC:
+		case FT_UINT_STRING:
+			*kind = DSET_STRING;
+			return TRUE;
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_AX25:
+		case FT_VINES:
+		case FT_ETHER:
+		case FT_OID:
+		case FT_REL_OID:
+		case FT_SYSTEM_ID:
+		case FT_FCWWN:
+			*kind = DSET_BYTES;
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+/* Map an integer value to a 64-bit key that sorts the same way. */
+static guint64
+dset_int_key(const dset_t *set, const fvalue_t *fv)
+{
+	switch (set->kind) {
+		case DSET_UINT:
+			if (IS_FT_UINT64(set->ftype) || set->ftype == FT_EUI64)
+				return fv->value.uinteger64;
+			return fv->value.uinteger;
+		case DSET_SINT:
+			if (IS_FT_INT64(set->ftype))
+				return (guint64)fv->value.sinteger64 ^ SIGN_FLIP;
+			return (guint64)(gint64)fv->value.sinteger ^ SIGN_FLIP;
+		case DSET_IPV4:
+			return fv->value.ipv4.addr;
+		default:
+			ws_assert_not_reached();
+			return 0;
+	}
+}
+
+static guint
+bytes_hash(gconstpointer key)
+{
+	const GByteArray *bytes = (const GByteArray *)key;
+	guint hash = 5381;
+	guint i;
+
+	for (i = 0; i < bytes->len; i++)
+		hash = (hash << 5) + hash + bytes->data[i];
+	return hash;
+}
+
+static gboolean
+bytes_equal(gconstpointer a, gconstpointer b)
+{
+	const GByteArray *bytes_a = (const GByteArray *)a;
+	const GByteArray *bytes_b = (const GByteArray *)b;
+
+	return bytes_a->len == bytes_b->len &&
+		memcmp(bytes_a->data, bytes_b->data, bytes_a->len) == 0;
+}
+
+static int
+compare_intervals(const void *a, const void *b)
+{
+	const dset_interval_t *ia = (const dset_interval_t *)a;
+	const dset_interval_t *ib = (const dset_interval_t *)b;
+
+	if (ia->low != ib->low)
+		return ia->low < ib->low ? -1 : 1;
+	if (ia->high != ib->high)
+		return ia->high < ib->high ? -1 : 1;
+	return 0;
+}
+
+/* Sort the intervals and merge the ones that overlap or touch. */
+static void
+merge_intervals(dset_t *set)
+{
+	dset_interval_t *cur;
+	guint i, n;
+
+	if (set->num_intervals == 0)
+		return;
+
+	qsort(set->intervals, set->num_intervals, sizeof(dset_interval_t),
+			compare_intervals);
+	n = 0;
+	cur = &set->intervals[0];
+	for (i = 1; i < set->num_intervals; i++) {
+		if (cur->high == G_MAXUINT64 || set->intervals[i].low <= cur->high + 1) {
+			if (set->intervals[i].high > cur->high)
+				cur->high = set->intervals[i].high;
+		}
+		else {
+			cur = &set->intervals[++n];
+			*cur = set->intervals[i];
+		}
+	}
+	set->num_intervals = n + 1;
+}
+
+dset_t *
+dset_new(ftenum_t ftype, GSList *elements)
+{
+	dset_t		*set;
+	dset_kind_t	kind;
+	GSList		*l;
+	fvalue_t	*lower, *upper;
+	guint		num_elements, num_ranges, i;
+	guint		num_keys = 0;
+
+	if (!dset_kind(ftype, &kind))
+		return NULL;
+
+	/* Check that we can handle all the elements before doing anything. */
+	num_elements = num_ranges = 0;
+	for (l = elements; l; l = l->next->next) {
+		lower = (fvalue_t *)l->data;
+		upper = (fvalue_t *)l->next->data;
+		if (fvalue_type_ftenum(lower) != ftype)
+			return NULL;
+		if (upper) {
+			if (fvalue_type_ftenum(upper) != ftype)
+				return NULL;
+			/* Ranges are only supported for the ordered integer types. */
+			if (kind == DSET_STRING || kind == DSET_BYTES)
+				return NULL;
+			num_ranges++;
+		}
+		else if (kind == DSET_IPV4 && lower->value.ipv4.nmask != G_MAXUINT32) {
+			num_ranges++;
+		}
+		num_elements++;
+	}
+	if (num_elements == 0)
+		return NULL;
+
+	set = g_new0(dset_t, 1);
+	set->ftype = ftype;
+	set->kind = kind;
+	set->num_elements = num_elements;
+	set->elements = g_new(fvalue_t *, num_elements * 2);
+	set->intervals = g_new(dset_interval_t, num_ranges);
+
+	switch (kind) {
+		case DSET_STRING:
+			set->values = g_hash_table_new(g_str_hash, g_str_equal);
+			break;
+		case DSET_BYTES:
+			set->values = g_hash_table_new(bytes_hash, bytes_equal);
+			break;
+		default:
+			set->values = g_hash_table_new(g_int64_hash, g_int64_equal);
+			set->keys = g_new(guint64, num_elements);
+			break;
+	}
+
+	for (l = elements, i = 0; l; l = l->next->next, i += 2) {
+		dset_interval_t interval;
+
+		lower = (fvalue_t *)l->data;
+		upper = (fvalue_t *)l->next->data;
+		set->elements[i] = lower;
+		set->elements[i + 1] = upper;
+
+		if (kind == DSET_STRING) {
+			g_hash_table_add(set->values, lower->value.string);
+			continue;
+		}
+		if (kind == DSET_BYTES) {
+			g_hash_table_add(set->values, lower->value.bytes);
+			continue;
+		}
+
+		if (kind == DSET_IPV4) {
+			/* Field values are compared with the netmask of the
+			 * constant, so "10.0.0.0/8" and "10.0.0.0/8 .. 11.0.0.0/8"
+			 * match everything from the lowest address in the first
+			 * network to the highest address in the last one. */
+			if (upper) {
+				interval.low = lower->value.ipv4.addr & lower->value.ipv4.nmask;
+				interval.high = (upper->value.ipv4.addr & upper->value.ipv4.nmask) |
+						~upper->value.ipv4.nmask;
+			}
+			else if (lower->value.ipv4.nmask != G_MAXUINT32) {
+				interval.low = lower->value.ipv4.addr & lower->value.ipv4.nmask;
+				interval.high = interval.low | ~lower->value.ipv4.nmask;
+			}
+			else {
+				set->keys[num_keys] = lower->value.ipv4.addr;
+				g_hash_table_add(set->values, &set->keys[num_keys++]);
+				continue;
+			}
+		}
+		else if (upper) {
+			interval.low = dset_int_key(set, lower);
+			interval.high = dset_int_key(set, upper);
+		}
+		else {
+			set->keys[num_keys] = dset_int_key(set, lower);
+			g_hash_table_add(set->values, &set->keys[num_keys++]);
+			continue;
+		}
+
+		/* An empty range never matches. */
+		if (interval.low <= interval.high)
+			set->intervals[set->num_intervals++] = interval;
+	}
+
+	merge_intervals(set);
+	return set;
+}
+
+void
+dset_free(dset_t *set)
+{
+	guint i;
+
+	for (i = 0; i < set->num_elements * 2; i++) {
+		if (set->elements[i])
+			fvalue_free(set->elements[i]);
+	}
+	g_free(set->elements);
+	g_hash_table_destroy(set->values);
+	g_free(set->keys);
+	g_free(set->intervals);
+	g_free(set);
+}
+
+guint
+dset_num_elements(const dset_t *set)
+{
+	return set->num_elements;
+}
+
+guint
+dset_num_intervals(const dset_t *set)
+{
+	return set->num_intervals;
+}
+
+static gboolean
+dset_contains_interval(const dset_t *set, guint64 key)
+{
+	guint lo = 0, hi = set->num_intervals;
+
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+
+		if (key < set->intervals[mid].low)
+			hi = mid;
+		else if (key > set->intervals[mid].high)
+			lo = mid + 1;
+		else
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* Compare against every element, like the ANY_EQ/ANY_IN_RANGE chain
+ * would, for values that the hashed representation doesn't cover. */
+static gboolean
+dset_contains_linear(const dset_t *set, fvalue_t *fv)
+{
+	guint i;
+
+	for (i = 0; i < set->num_elements * 2; i += 2) {
+		fvalue_t *lower = set->elements[i];
+		fvalue_t *upper = set->elements[i + 1];
+
+		if (upper) {
+			if (fvalue_ge(fv, lower) && fvalue_le(fv, upper))
+				return TRUE;
+		}
+		else if (fvalue_eq(fv, lower)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+gboolean
+dset_contains(const dset_t *set, fvalue_t *fv)
+{
+	guint64 key;
+
+	/* Fields with the same name can have different types. */
+	if (fvalue_type_ftenum(fv) != set->ftype)
+		return dset_contains_linear(set, fv);
+
+	switch (set->kind) {
+		case DSET_STRING:
+			return g_hash_table_contains(set->values, fv->value.string);
+		case DSET_BYTES:
+			return g_hash_table_contains(set->values, fv->value.bytes);
+		case DSET_IPV4:
+			if (fv->value.ipv4.nmask != G_MAXUINT32)
+				return dset_contains_linear(set, fv);
+			break;
+		default:
+			break;
+	}
+
+	key = dset_int_key(set, fv);
+	if (g_hash_table_contains(set->values, &key))
+		return TRUE;
+	return dset_contains_interval(set, key);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,71 @@
+/** @file
+ *
+ * Precompiled sets of constants for the "in" membership operator
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __DSET_H__
+#define __DSET_H__
+
+#include <wireshark.h>
+#include <epan/ftypes/ftypes.h>
+
+/*
+ * A dset_t holds the elements of a "field in {...}" set whose elements
+ * are all constants.  Single values of integer, IPv4, string and
+ * byte-string types are put in a hash table; integer and IPv4 ranges
+ * (including IPv4 CIDR blocks, which are ranges in disguise) are merged
+ * into a sorted list of disjoint intervals that is binary searched.
+ * A lookup is therefore O(1) or O(log n) instead of one comparison per
+ * element.
+ */
+typedef struct _dset dset_t;
+
+/*
+ * Build a set from a list of (lower, upper) fvalue pairs, where upper
+ * is NULL for single values, as found in an STTYPE_SET node.  All values
+ * must be of type ftype.  On success the set takes ownership of the
+ * fvalues; returns NULL, without taking ownership of anything, if the
+ * type or the elements aren't supported.
+ */
+dset_t *
+dset_new(ftenum_t ftype, GSList *elements);
+
+void
+dset_free(dset_t *set);
+
+/* Number of elements the set was built from. */
+guint
+dset_num_elements(const dset_t *set);
+
+/* Number of disjoint intervals the ranges were merged into. */
+guint
+dset_num_intervals(const dset_t *set);
+
+/*
+ * Returns TRUE if fv is equal to an element of the set or lies in one
+ * of its ranges, with the same semantics as fvalue_eq(), fvalue_ge() and
+ * fvalue_le().
+ */
+gboolean
+dset_contains(const dset_t *set, fvalue_t *fv);
+
+#endif /* __DSET_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -127,12 +127,30 @@ dfw_append_mk_range(dfwork_t *dfw, stnode_t *node, dfvm_value_t **p_jmp)
 	stnode_t                *entity;
 	dfvm_insn_t		*insn;
 	dfvm_value_t		*val;
+	char			*drange_str, *key;
 
 	entity = sttype_range_entity(node);
 
 	/* XXX, check if p_jmp logic is OK */
 	hf_reg = gen_entity(dfw, entity, p_jmp);
 
+	/* The same slice of the same register is made only once per run
+	 * of the filter (MK_RANGE does nothing if the destination register
+	 * is already loaded), so re-use its register, as for fields. */
+	drange_str = drange_tostr(sttype_range_drange(node));
+	key = ws_strdup_printf("%d[%s]", hf_reg, drange_str);
+	g_free(drange_str);
+	reg = GPOINTER_TO_INT(g_hash_table_lookup(dfw->loaded_ranges, key));
+	if (reg) {
+		/* Stored as reg+1, as in loaded_fields. */
+		reg--;
+		g_free(key);
+	}
+	else {
+		reg = dfw->next_register++;
+		g_hash_table_insert(dfw->loaded_ranges, key, GINT_TO_POINTER(reg + 1));
+	}
+
 	insn = dfvm_insn_new(MK_RANGE);
 
 	val = dfvm_value_new(REGISTER);
@@ -140,7 +158,6 @@ dfw_append_mk_range(dfwork_t *dfw, stnode_t *node, dfvm_value_t **p_jmp)
 	insn->arg1 = val;
 
 	val = dfvm_value_new(REGISTER);
-	reg =dfw->next_register++;
 	val->value.numeric = reg;
 	insn->arg2 = val;
 
@@ -309,6 +326,41 @@ fixup_jumps(gpointer data, gpointer user_data)
 	}
 }
 
+/* Put the elements of a set in a dset_t, if they are all constants of
+ * a type that dset_t supports. On success the fvalues are moved from the
+ * set nodes to the dset_t. */
+static dset_t *
+gen_constant_set(GSList *nodelist)
+{
+	GSList		*l, *values = NULL;
+	stnode_t	*node1, *node2;
+	dset_t		*set = NULL;
+
+	for (l = nodelist; l; l = g_slist_next(g_slist_next(l))) {
+		node1 = (stnode_t*)l->data;
+		node2 = (stnode_t*)l->next->data;
+		if (stnode_type_id(node1) != STTYPE_FVALUE ||
+				(node2 && stnode_type_id(node2) != STTYPE_FVALUE)) {
+			goto done;
+		}
+		values = g_slist_prepend(values, stnode_data(node1));
+		values = g_slist_prepend(values, node2 ? stnode_data(node2) : NULL);
+	}
+	values = g_slist_reverse(values);
+
+	set = dset_new(fvalue_type_ftenum((fvalue_t*)values->data), values);
+	if (set) {
+		for (l = nodelist; l; l = g_slist_next(l)) {
+			if (l->data) {
+				stnode_steal_data((stnode_t*)l->data);
+			}
+		}
+	}
+done:
+	g_slist_free(values);
+	return set;
+}
+
 /* Generate the code for the in operator.  It behaves much like an OR-ed
  * series of == tests, but without the redundant existence checks. */
 static void
@@ -321,12 +373,29 @@ gen_relation_in(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
 	stnode_t	*node1, *node2;
 	GSList		*nodelist_head, *nodelist;
 	GSList		*jumplist = NULL;
+	dset_t		*set;
 
 	/* Create code for the LHS of the relation */
 	reg1 = gen_entity(dfw, st_arg1, &jmp1);
 
 	/* Create code for the set on the RHS of the relation */
 	nodelist_head = nodelist = (GSList*)stnode_steal_data(st_arg2);
+
+	/* If all the elements are constants, test against all of them with a
+	 * single lookup instead of a chain of comparisons. */
+	set = gen_constant_set(nodelist_head);
+	if (set) {
+		insn = dfvm_insn_new(ANY_IN_SET);
+		val1 = dfvm_value_new(REGISTER);
+		val1->value.numeric = reg1;
+		val2 = dfvm_value_new(DSET);
+		val2->value.dset = set;
+		insn->arg1 = val1;
+		insn->arg2 = val2;
+		dfw_append_insn(dfw, insn);
+		nodelist = NULL;
+	}
+
 	while (nodelist) {
 		node1 = (stnode_t*)nodelist->data;
 		nodelist = g_slist_next(nodelist);
@@ -437,6 +506,39 @@ gen_entity(dfwork_t *dfw, stnode_t *st_arg, dfvm_value_t **p_jmp)
 }
 
 
+/*
+ * Remembers where the code of a test starts and which instruction sets
+ * its result, so that its pass rate can be counted, if it has only one
+ * such instruction.
+ */
+static void
+dfw_add_leaf(dfwork_t *dfw, char *key, int first)
+{
+	dfilter_leaf_t	*leaf;
+	dfvm_insn_t	*insn;
+	int		id, last = dfw->next_insn_id - 1;
+
+	if (last < first) {
+		wmem_free(NULL, key);
+		return;
+	}
+
+	for (id = first; id <= last; id++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(dfw->insns, id);
+		if (insn->op == IF_TRUE_GOTO ||
+		    (id == last && insn->op == IF_FALSE_GOTO)) {
+			wmem_free(NULL, key);
+			return;
+		}
+	}
+
+	leaf = g_new(dfilter_leaf_t, 1);
+	leaf->key = key;
+	leaf->first = first;
+	leaf->result = last;
+	g_ptr_array_add(dfw->leaves, leaf);
+}
+
 static void
 gen_test(dfwork_t *dfw, stnode_t *st_node)
 {
@@ -444,11 +546,20 @@ gen_test(dfwork_t *dfw, stnode_t *st_node)
 	stnode_t	*st_arg1, *st_arg2;
 	dfvm_value_t	*val1;
 	dfvm_insn_t	*insn;
+	char		*leaf_key = NULL;
+	int		leaf_first = 0;
 
 	header_field_info	*hfinfo;
 
 	sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
 
+	/* The key must be made before the code generation steals the
+	 * constants from the syntax tree. */
+	if (st_op != TEST_OP_AND && st_op != TEST_OP_OR && st_op != TEST_OP_NOT) {
+		leaf_key = dfilter_node_key(st_node);
+		leaf_first = dfw->next_insn_id;
+	}
+
 	switch (st_op) {
 		case TEST_OP_UNINITIALIZED:
 			ws_assert_not_reached();
@@ -551,6 +662,9 @@ gen_test(dfwork_t *dfw, stnode_t *st_node)
 			gen_relation_in(dfw, st_arg1, st_arg2);
 			break;
 	}
+
+	if (leaf_key != NULL)
+		dfw_add_leaf(dfw, leaf_key, leaf_first);
 }
 
 static void
@@ -570,19 +684,23 @@ gencode(dfwork_t *dfw, stnode_t *st_node)
 }
 
 
-void
-dfw_gencode(dfwork_t *dfw)
+static void
+gencode_init(dfwork_t *dfw)
 {
-	int		id, id1, length;
-	dfvm_insn_t	*insn, *insn1, *prev;
-	dfvm_value_t	*arg1;
-
 	dfw->insns = g_ptr_array_new();
 	dfw->consts = g_ptr_array_new();
 	dfw->loaded_fields = g_hash_table_new(g_direct_hash, g_direct_equal);
+	dfw->loaded_ranges = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 	dfw->interesting_fields = g_hash_table_new(g_direct_hash, g_direct_equal);
-	gencode(dfw, dfw->st_root);
-	dfw_append_insn(dfw, dfvm_insn_new(RETURN));
+	dfw->leaves = g_ptr_array_new_with_free_func(dfilter_leaf_free);
+}
+
+static void
+gencode_fixup(dfwork_t *dfw)
+{
+	int		id, id1, length;
+	dfvm_insn_t	*insn, *insn1, *prev;
+	dfvm_value_t	*arg1;
 
 	/* fixup goto */
 	length = dfw->insns->len;
@@ -657,6 +775,44 @@ dfw_gencode(dfwork_t *dfw)
 
 }
 
+void
+dfw_gencode(dfwork_t *dfw)
+{
+	gencode_init(dfw);
+	gencode(dfw, dfw->st_root);
+	dfw_append_insn(dfw, dfvm_insn_new(RETURN));
+	gencode_fixup(dfw);
+}
+
+/*
+ * Generates one program for a list of filters. Each filter is followed
+ * by a RETURN_IF_TRUE with its index, so the program stops at the
+ * first filter that matches. The filters share their field and range
+ * registers, so a field used by several of them is read only once.
+ */
+void
+dfw_gencode_rules(dfwork_t *dfw, stnode_t **roots, guint num_roots)
+{
+	dfvm_insn_t	*insn;
+	dfvm_value_t	*val;
+	guint		i;
+
+	gencode_init(dfw);
+	for (i = 0; i < num_roots; i++) {
+		/* Skip empty filters. */
+		if (roots[i] == NULL)
+			continue;
+		gencode(dfw, roots[i]);
+		insn = dfvm_insn_new(RETURN_IF_TRUE);
+		val = dfvm_value_new(INTEGER);
+		val->value.numeric = i;
+		insn->arg1 = val;
+		dfw_append_insn(dfw, insn);
+	}
+	dfw_append_insn(dfw, dfvm_insn_new(RETURN));
+	gencode_fixup(dfw);
+}
+
 
 
 typedef struct {
@@ -0,0 +1,518 @@
+/*
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#define WS_LOG_DOMAIN LOG_DOMAIN_DFILTER
+
+#include "dfilter-int.h"
+#include "optimize.h"
+#include "syntax-tree.h"
+#include "sttype-test.h"
+#include "sttype-set.h"
+
+#include <wsutil/ws_assert.h>
+#include <wsutil/wslog.h>
+
+#include <ftypes/ftypes.h>
+
+/*
+ * Rewrites a semantically checked syntax tree into an equivalent one that
+ * is cheaper to evaluate:
+ *
+ *  - "!!a" becomes "a";
+ *  - "f == a || f == b || f in {c d}" becomes "f in {a b c d}", which
+ *    reads f once instead of once per comparison;
+ *  - duplicate and empty ("b..a" with b > a) elements are removed from
+ *    constant sets;
+ *  - the operands of chains of "&&" (or "||") are ordered by estimated
+ *    cost, so that cheap tests (existence checks, integer comparisons)
+ *    run before expensive ones ("contains", "matches", slices and
+ *    function calls) and can short-circuit them.  Where the pass rates
+ *    of tests are known from earlier runs, the order also takes into
+ *    account how likely each operand is to short-circuit the chain.
+ *
+ * Display filter tests have no side effects, so none of this changes the
+ * result of a filter.
+ */
+
+static stnode_t *
+optimize(stnode_t *node);
+
+static gboolean
+is_test(stnode_t *node, test_op_t op)
+{
+	test_op_t node_op;
+
+	if (stnode_type_id(node) != STTYPE_TEST)
+		return FALSE;
+	sttype_test_get(node, &node_op, NULL, NULL);
+	return node_op == op;
+}
+
+/* Frees a test node, but not its operands. */
+static void
+free_test_node(stnode_t *node)
+{
+	sttype_test_set2_args(node, NULL, NULL);
+	stnode_free(node);
+}
+
+static void
+free_test_node1(stnode_t *node)
+{
+	sttype_test_set1_args(node, NULL);
+	stnode_free(node);
+}
+
+/*
+ * Estimated relative cost of evaluating an entity or a test.  This
+ * only has to get the order right.
+ */
+static int
+entity_cost(stnode_t *node)
+{
+	switch (stnode_type_id(node)) {
+		case STTYPE_FIELD:
+			return 2;
+		case STTYPE_RANGE:
+			return 4;
+		case STTYPE_FUNCTION:
+			return 8;
+		default:
+			/* Constants are loaded once, when the filter is compiled. */
+			return 0;
+	}
+}
+
+static int
+test_cost(stnode_t *node)
+{
+	test_op_t	op;
+	stnode_t	*arg1, *arg2;
+
+	sttype_test_get(node, &op, &arg1, &arg2);
+
+	switch (op) {
+		case TEST_OP_EXISTS:
+			return 1;
+		case TEST_OP_NOT:
+			return test_cost(arg1);
+		case TEST_OP_AND:
+		case TEST_OP_OR:
+			return test_cost(arg1) + test_cost(arg2);
+		case TEST_OP_CONTAINS:
+			return entity_cost(arg1) + entity_cost(arg2) + 8;
+		case TEST_OP_MATCHES:
+			return entity_cost(arg1) + entity_cost(arg2) + 16;
+		case TEST_OP_IN:
+			return entity_cost(arg1) + 2;
+		default:
+			return entity_cost(arg1) + entity_cost(arg2) + 1;
+	}
+}
+
+/* Collects the operands of a chain of "&&" (or "||") tests, left to
+ * right, and the test nodes that join them. */
+static void
+collect_chain(stnode_t *node, test_op_t op, GPtrArray *operands, GPtrArray *joins)
+{
+	stnode_t *arg1, *arg2;
+
+	if (!is_test(node, op)) {
+		g_ptr_array_add(operands, node);
+		return;
+	}
+
+	sttype_test_get(node, NULL, &arg1, &arg2);
+	g_ptr_array_add(joins, node);
+	collect_chain(arg1, op, operands, joins);
+	collect_chain(arg2, op, operands, joins);
+}
+
+/*
+ * If node is "field == constant" (either way around) or "field in {...}",
+ * return the field node.
+ */
+static stnode_t *
+membership_field(stnode_t *node)
+{
+	test_op_t	op;
+	stnode_t	*arg1, *arg2;
+
+	if (stnode_type_id(node) != STTYPE_TEST)
+		return NULL;
+
+	sttype_test_get(node, &op, &arg1, &arg2);
+	if (op == TEST_OP_ANY_EQ) {
+		if (stnode_type_id(arg1) == STTYPE_FIELD && stnode_type_id(arg2) == STTYPE_FVALUE)
+			return arg1;
+		if (stnode_type_id(arg1) == STTYPE_FVALUE && stnode_type_id(arg2) == STTYPE_FIELD)
+			return arg2;
+	}
+	else if (op == TEST_OP_IN) {
+		if (stnode_type_id(arg1) == STTYPE_FIELD)
+			return arg1;
+	}
+	return NULL;
+}
+
+/* Takes the set elements out of node, a test accepted by membership_field(),
+ * and frees it, except for field_keep if that is its field. */
+static GSList *
+membership_steal_elements(stnode_t *node, stnode_t *field_keep)
+{
+	test_op_t	op;
+	stnode_t	*arg1, *arg2, *field, *value;
+	GSList		*elements;
+
+	sttype_test_get(node, &op, &arg1, &arg2);
+	if (op == TEST_OP_IN) {
+		field = arg1;
+		elements = (GSList *)stnode_steal_data(arg2);
+		stnode_free(arg2);
+	}
+	else if (stnode_type_id(arg1) == STTYPE_FIELD) {
+		field = arg1;
+		value = arg2;
+		elements = g_slist_append(g_slist_append(NULL, value), NULL);
+	}
+	else {
+		field = arg2;
+		value = arg1;
+		elements = g_slist_append(g_slist_append(NULL, value), NULL);
+	}
+
+	free_test_node(node);
+	if (field != field_keep)
+		stnode_free(field);
+	return elements;
+}
+
+static gboolean
+set_element_is_const(stnode_t *node)
+{
+	return node == NULL || stnode_type_id(node) == STTYPE_FVALUE;
+}
+
+/*
+ * fvalue_eq() compares IPv4 and IPv6 addresses under the shorter of their
+ * netmasks, so that 10.1.2.3 is "equal" to 10.0.0.0/8; set elements are
+ * only duplicates if their netmasks are the same, too.
+ */
+static gboolean
+set_values_identical(fvalue_t *a, fvalue_t *b)
+{
+	switch (fvalue_type_ftenum(a)) {
+		case FT_IPv4:
+			if (a->value.ipv4.nmask != b->value.ipv4.nmask)
+				return FALSE;
+			break;
+		case FT_IPv6:
+			if (a->value.ipv6.prefix != b->value.ipv6.prefix)
+				return FALSE;
+			break;
+		default:
+			break;
+	}
+	return fvalue_eq(a, b);
+}
+
+/*
+ * Removes elements that can never match (ranges with a lower bound above
+ * the upper bound) and duplicates from a set, as long as that leaves at
+ * least one element.
+ */
+static GSList *
+optimize_set_elements(GSList *elements)
+{
+	GSList		*result = NULL, *l, *r;
+	stnode_t	*lower, *upper, *r_lower, *r_upper;
+	gboolean	keep;
+	int		num_kept = 0;
+
+	for (l = elements; l != NULL; l = l->next->next) {
+		lower = (stnode_t *)l->data;
+		upper = (stnode_t *)l->next->data;
+		keep = TRUE;
+
+		if (set_element_is_const(lower) && set_element_is_const(upper)) {
+			if (upper != NULL &&
+			    fvalue_gt((fvalue_t *)stnode_data(lower), (fvalue_t *)stnode_data(upper))) {
+				keep = FALSE;
+			}
+			for (r = result; keep && r != NULL; r = r->next->next) {
+				r_lower = (stnode_t *)r->data;
+				r_upper = (stnode_t *)r->next->data;
+				if (!set_element_is_const(r_lower) || !set_element_is_const(r_upper))
+					continue;
+				if ((upper == NULL) != (r_upper == NULL))
+					continue;
+				if (set_values_identical((fvalue_t *)stnode_data(lower), (fvalue_t *)stnode_data(r_lower)) &&
+				    (upper == NULL ||
+				     set_values_identical((fvalue_t *)stnode_data(upper), (fvalue_t *)stnode_data(r_upper)))) {
+					keep = FALSE;
+				}
+			}
+		}
+
+		/* Keep the last element if everything else was dropped. */
+		if (!keep && (num_kept > 0 || l->next->next != NULL)) {
+			stnode_free(lower);
+			if (upper)
+				stnode_free(upper);
+			continue;
+		}
+
+		result = g_slist_prepend(result, lower);
+		result = g_slist_prepend(result, upper);
+		num_kept++;
+	}
+
+	g_slist_free(elements);
+	/* We prepended (lower, upper) pairs, so reversing restores the order. */
+	return g_slist_reverse(result);
+}
+
+static void
+optimize_set(stnode_t *node)
+{
+	stnode_t	*arg1, *arg2;
+	GSList		*elements;
+
+	sttype_test_get(node, NULL, &arg1, &arg2);
+	elements = (GSList *)stnode_steal_data(arg2);
+	stnode_replace(arg2, STTYPE_SET, optimize_set_elements(elements));
+}
+
+/*
+ * Merges equality and membership tests of the same field in the operands
+ * of a "||" chain into a single membership test.  Operands are replaced in
+ * place; merged ones are set to NULL.
+ */
+static void
+merge_membership_tests(GPtrArray *operands)
+{
+	stnode_t	*field_i, *field_j, *merged, *set;
+	GSList		*elements;
+	guint		i, j;
+
+	for (i = 0; i < operands->len; i++) {
+		field_i = membership_field(g_ptr_array_index(operands, i));
+		if (field_i == NULL)
+			continue;
+
+		elements = NULL;
+		for (j = i + 1; j < operands->len; j++) {
+			if (g_ptr_array_index(operands, j) == NULL)
+				continue;
+			field_j = membership_field(g_ptr_array_index(operands, j));
+			if (field_j == NULL ||
+			    stnode_data(field_j) != stnode_data(field_i))
+				continue;
+
+			elements = g_slist_concat(elements,
+			    membership_steal_elements(g_ptr_array_index(operands, j), NULL));
+			g_ptr_array_index(operands, j) = NULL;
+		}
+		if (elements == NULL)
+			continue;
+
+		elements = g_slist_concat(
+		    membership_steal_elements(g_ptr_array_index(operands, i), field_i),
+		    elements);
+		set = stnode_new(STTYPE_SET, optimize_set_elements(elements), NULL);
+		merged = stnode_new_test(TEST_OP_IN, NULL);
+		sttype_test_set2_args(merged, field_i, set);
+		g_ptr_array_index(operands, i) = merged;
+
+		ws_noisy("Merged tests of %s into %s", stnode_todisplay(field_i),
+				stnode_todebug(set));
+	}
+}
+
+/*
+ * Estimated probability that a test is TRUE, from the pass rates that
+ * earlier runs of filters counted (see dfilter-profile.c).  Tests that
+ * haven't been counted are assumed to be TRUE half of the time.
+ */
+static double
+test_pass_rate(stnode_t *node)
+{
+	test_op_t	op;
+	stnode_t	*arg1, *arg2;
+	double		p1, p2;
+	char		*key;
+
+	sttype_test_get(node, &op, &arg1, &arg2);
+
+	switch (op) {
+		case TEST_OP_NOT:
+			return 1.0 - test_pass_rate(arg1);
+		case TEST_OP_AND:
+			return test_pass_rate(arg1) * test_pass_rate(arg2);
+		case TEST_OP_OR:
+			p1 = test_pass_rate(arg1);
+			p2 = test_pass_rate(arg2);
+			return p1 + p2 - p1 * p2;
+		default:
+			key = dfilter_node_key(node);
+			p1 = dfilter_selectivity(key);
+			wmem_free(NULL, key);
+			return p1 < 0 ? 0.5 : p1;
+	}
+}
+
+typedef struct {
+	stnode_t	*node;
+	double		rank;
+} operand_rank_t;
+
+static gint
+compare_operand_rank(gconstpointer a, gconstpointer b)
+{
+	const operand_rank_t *rank_a = (const operand_rank_t *)a;
+	const operand_rank_t *rank_b = (const operand_rank_t *)b;
+
+	return (rank_a->rank > rank_b->rank) - (rank_a->rank < rank_b->rank);
+}
+
+/*
+ * Orders the operands of a chain so that the expected cost of the chain
+ * is lowest: an operand of "&&" comes first if it is cheap and likely to
+ * be FALSE, one of "||" if it is cheap and likely to be TRUE.  When
+ * nothing is known about the pass rates this is the order of cost.
+ */
+static void
+sort_operands(GPtrArray *operands, test_op_t op)
+{
+	GArray		*ranks;
+	operand_rank_t	rank;
+	double		p;
+	guint		i;
+
+	ranks = g_array_sized_new(FALSE, FALSE, sizeof(operand_rank_t), operands->len);
+	for (i = 0; i < operands->len; i++) {
+		rank.node = g_ptr_array_index(operands, i);
+		p = test_pass_rate(rank.node);
+		if (op == TEST_OP_AND)
+			p = 1.0 - p;
+		rank.rank = test_cost(rank.node) / MAX(p, 0.01);
+		g_array_append_val(ranks, rank);
+	}
+
+	/* GLib's sort is stable, so tests of the same rank keep the
+	 * order they were written in. */
+	g_array_sort(ranks, compare_operand_rank);
+
+	for (i = 0; i < operands->len; i++) {
+		g_ptr_array_index(operands, i) = g_array_index(ranks, operand_rank_t, i).node;
+	}
+	g_array_free(ranks, TRUE);
+}
+
+static stnode_t *
+optimize_chain(stnode_t *node, test_op_t op)
+{
+	GPtrArray	*operands, *joins, *kept;
+	stnode_t	*result;
+	guint		i;
+
+	operands = g_ptr_array_new();
+	joins = g_ptr_array_new();
+	collect_chain(node, op, operands, joins);
+
+	for (i = 0; i < operands->len; i++) {
+		g_ptr_array_index(operands, i) = optimize(g_ptr_array_index(operands, i));
+	}
+
+	if (op == TEST_OP_OR) {
+		merge_membership_tests(operands);
+	}
+
+	kept = g_ptr_array_new();
+	for (i = 0; i < operands->len; i++) {
+		if (g_ptr_array_index(operands, i) != NULL)
+			g_ptr_array_add(kept, g_ptr_array_index(operands, i));
+	}
+
+	sort_operands(kept, op);
+
+	/* Rebuild a left-associative chain, reusing the join nodes. */
+	result = g_ptr_array_index(kept, 0);
+	for (i = 1; i < kept->len; i++) {
+		stnode_t *join = g_ptr_array_index(joins, i - 1);
+		sttype_test_set2_args(join, result, g_ptr_array_index(kept, i));
+		result = join;
+	}
+	/* Joins left over from merged operands. */
+	for (i = kept->len - 1; i < joins->len; i++) {
+		free_test_node(g_ptr_array_index(joins, i));
+	}
+
+	g_ptr_array_free(kept, TRUE);
+	g_ptr_array_free(joins, TRUE);
+	g_ptr_array_free(operands, TRUE);
+	return result;
+}
+
+static stnode_t *
+optimize(stnode_t *node)
+{
+	test_op_t	op;
+	stnode_t	*arg1, *arg2, *child;
+
+	ws_assert(stnode_type_id(node) == STTYPE_TEST);
+
+	sttype_test_get(node, &op, &arg1, &arg2);
+
+	switch (op) {
+		case TEST_OP_NOT:
+			if (is_test(arg1, TEST_OP_NOT)) {
+				sttype_test_get(arg1, NULL, &child, NULL);
+				free_test_node1(arg1);
+				free_test_node1(node);
+				return optimize(child);
+			}
+			sttype_test_set1_args(node, optimize(arg1));
+			return node;
+
+		case TEST_OP_AND:
+		case TEST_OP_OR:
+			return optimize_chain(node, op);
+
+		case TEST_OP_IN:
+			optimize_set(node);
+			return node;
+
+		default:
+			return node;
+	}
+}
+
+void
+dfw_optimize(dfwork_t *dfw)
+{
+	if (dfw->st_root == NULL)
+		return;
+
+	dfw->st_root = optimize(dfw->st_root);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
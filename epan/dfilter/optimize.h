@@ -0,0 +1,18 @@
+/** @file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef OPTIMIZE_H
+#define OPTIMIZE_H
+
+/* Rewrite the syntax tree, after the semantic check, into an
+ * equivalent one that is cheaper to evaluate. */
+void
+dfw_optimize(dfwork_t *dfw);
+
+#endif
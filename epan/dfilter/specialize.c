@@ -0,0 +1,618 @@
+/*
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/*
+ * Specialized evaluator for simple display filters.
+ *
+ * Most filters people type compare a few integer or address fields with
+ * constants: "tcp.port == 80 && ip.ttl < 64".  The interpreter in dfvm.c
+ * runs those by copying every field value into a GList register and
+ * calling the comparison through the ftype function pointers, once per
+ * value.
+ *
+ * Here the bytecode for such filters is translated into a shorter program
+ * where each "READ_TREE, IF_FALSE_GOTO, ANY_xx" sequence becomes a single
+ * test that reads the values straight out of the field_info structures in
+ * the tree and compares them with a kernel specialized for the type and
+ * the operator.  The kernels are generated below with macros, one per
+ * (type, operator) pair.  Anything else falls back to the interpreter.
+ */
+
+#include "config.h"
+
+#include "specialize.h"
+#include "dfvm.h"
+
+#include <epan/proto.h>
+#include <wsutil/ws_assert.h>
+
+typedef enum {
+	SPEC_KIND_UINT32,
+	SPEC_KIND_SINT32,
+	SPEC_KIND_UINT64,
+	SPEC_KIND_SINT64,
+	SPEC_KIND_BOOLEAN,
+	SPEC_KIND_IPV4,
+	SPEC_NUM_KINDS,
+	SPEC_KIND_NONE = SPEC_NUM_KINDS
+} dfspec_kind_t;
+
+typedef enum {
+	SPEC_CMP_EQ,
+	SPEC_CMP_NE,
+	SPEC_CMP_GT,
+	SPEC_CMP_GE,
+	SPEC_CMP_LT,
+	SPEC_CMP_LE,
+	SPEC_CMP_BITWISE_AND,
+	SPEC_NUM_CMPS
+} dfspec_cmp_t;
+
+static const char *cmp_names[SPEC_NUM_CMPS] = {
+	"==", "!=", ">", ">=", "<", "<=", "&"
+};
+
+/* The constant, in the representation the kernels want. */
+typedef struct {
+	guint64		u64;	/* unsigned, boolean (0 or 1) and bitwise-and */
+	gint64		s64;	/* signed */
+	guint32		addr;	/* IPv4, already masked */
+	guint32		nmask;	/* IPv4 */
+	const dset_t	*set;	/* "in" */
+} dfspec_key_t;
+
+typedef gboolean (*dfspec_kernel_t)(const GPtrArray *finfos, const dfspec_key_t *key);
+
+typedef enum {
+	SPEC_TEST,
+	SPEC_CHECK_EXISTS,
+	SPEC_NOT,
+	SPEC_IF_TRUE_GOTO,
+	SPEC_IF_FALSE_GOTO,
+	SPEC_RETURN
+} dfspec_op_t;
+
+typedef struct {
+	dfspec_op_t		op;
+	int			target;		/* jumps, and TEST if no value */
+	header_field_info	*hfinfo;	/* first field with the name */
+	dfspec_kernel_t		kernel;
+	gboolean		all;		/* TEST: ALL_NE, the kernel tests == */
+	dfspec_key_t		key;
+	/* For dfspec_dump() */
+	dfvm_opcode_t		dfvm_op;
+	dfspec_cmp_t		cmp;
+	const fvalue_t		*fv;
+} dfspec_insn_t;
+
+struct _dfspec {
+	dfspec_insn_t	*insns;
+	int		num_insns;
+};
+
+/*
+ * The kernels.  Each one returns TRUE if any of the field values
+ * compares true with the key.  "fv" is the field value and "key" the
+ * constant in the value and key expressions.
+ */
+#define CMP_EQ(a, b)		((a) == (b))
+#define CMP_NE(a, b)		((a) != (b))
+#define CMP_GT(a, b)		((a) > (b))
+#define CMP_GE(a, b)		((a) >= (b))
+#define CMP_LT(a, b)		((a) < (b))
+#define CMP_LE(a, b)		((a) <= (b))
+#define CMP_BITWISE_AND(a, b)	(((a) & (b)) != 0)
+
+#define SPEC_KERNEL(name, value_expr, key_expr, cmp)			\
+static gboolean								\
+name(const GPtrArray *finfos, const dfspec_key_t *key)			\
+{									\
+	guint i;							\
+	for (i = 0; i < finfos->len; i++) {				\
+		const fvalue_t *fv = &((const field_info *)finfos->pdata[i])->value; \
+		if (cmp(value_expr, key_expr))				\
+			return TRUE;					\
+	}								\
+	return FALSE;							\
+}
+
+#define SPEC_ORDER_KERNELS(kind, value_expr, key_expr)			\
+	SPEC_KERNEL(kind##_eq, value_expr, key_expr, CMP_EQ)		\
+	SPEC_KERNEL(kind##_ne, value_expr, key_expr, CMP_NE)		\
+	SPEC_KERNEL(kind##_gt, value_expr, key_expr, CMP_GT)		\
+	SPEC_KERNEL(kind##_ge, value_expr, key_expr, CMP_GE)		\
+	SPEC_KERNEL(kind##_lt, value_expr, key_expr, CMP_LT)		\
+	SPEC_KERNEL(kind##_le, value_expr, key_expr, CMP_LE)
+
+SPEC_ORDER_KERNELS(spec_uint32, fv->value.uinteger, (guint32)key->u64)
+SPEC_ORDER_KERNELS(spec_sint32, (gint64)fv->value.sinteger, key->s64)
+SPEC_ORDER_KERNELS(spec_uint64, fv->value.uinteger64, key->u64)
+SPEC_ORDER_KERNELS(spec_sint64, fv->value.sinteger64, key->s64)
+SPEC_ORDER_KERNELS(spec_boolean, (guint64)(fv->value.uinteger64 != 0), key->u64)
+/* Field values always have a full netmask, so comparing them with a
+ * constant that has a netmask is comparing the masked values. */
+SPEC_ORDER_KERNELS(spec_ipv4, fv->value.ipv4.addr & key->nmask, key->addr)
+
+/* The signed types do a bitwise-and of the raw bits. */
+SPEC_KERNEL(spec_uint32_bitwise_and, fv->value.uinteger, (guint32)key->u64, CMP_BITWISE_AND)
+SPEC_KERNEL(spec_uint64_bitwise_and, fv->value.uinteger64, key->u64, CMP_BITWISE_AND)
+
+static gboolean
+spec_in_set(const GPtrArray *finfos, const dfspec_key_t *key)
+{
+	guint i;
+
+	for (i = 0; i < finfos->len; i++) {
+		if (dset_contains(key->set, &((field_info *)finfos->pdata[i])->value))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static const dfspec_kernel_t spec_kernels[SPEC_NUM_KINDS][SPEC_NUM_CMPS] = {
+	/* SPEC_KIND_UINT32 */
+	{ spec_uint32_eq, spec_uint32_ne, spec_uint32_gt, spec_uint32_ge,
+	  spec_uint32_lt, spec_uint32_le, spec_uint32_bitwise_and },
+	/* SPEC_KIND_SINT32 */
+	{ spec_sint32_eq, spec_sint32_ne, spec_sint32_gt, spec_sint32_ge,
+	  spec_sint32_lt, spec_sint32_le, spec_uint32_bitwise_and },
+	/* SPEC_KIND_UINT64 */
+	{ spec_uint64_eq, spec_uint64_ne, spec_uint64_gt, spec_uint64_ge,
+	  spec_uint64_lt, spec_uint64_le, spec_uint64_bitwise_and },
+	/* SPEC_KIND_SINT64 */
+	{ spec_sint64_eq, spec_sint64_ne, spec_sint64_gt, spec_sint64_ge,
+	  spec_sint64_lt, spec_sint64_le, spec_uint64_bitwise_and },
+	/* SPEC_KIND_BOOLEAN */
+	{ spec_boolean_eq, spec_boolean_ne, spec_boolean_gt, spec_boolean_ge,
+	  spec_boolean_lt, spec_boolean_le, NULL },
+	/* SPEC_KIND_IPV4 */
+	{ spec_ipv4_eq, spec_ipv4_ne, spec_ipv4_gt, spec_ipv4_ge,
+	  spec_ipv4_lt, spec_ipv4_le, NULL },
+};
+
+static dfspec_kind_t
+spec_kind(ftenum_t ftype)
+{
+	switch (ftype) {
+		case FT_CHAR:
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+		case FT_FRAMENUM:
+		case FT_IPXNET:
+			return SPEC_KIND_UINT32;
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+			return SPEC_KIND_SINT32;
+		case FT_UINT40:
+		case FT_UINT48:
+		case FT_UINT56:
+		case FT_UINT64:
+		case FT_EUI64:
+			return SPEC_KIND_UINT64;
+		case FT_INT40:
+		case FT_INT48:
+		case FT_INT56:
+		case FT_INT64:
+			return SPEC_KIND_SINT64;
+		case FT_BOOLEAN:
+			return SPEC_KIND_BOOLEAN;
+		case FT_IPv4:
+			return SPEC_KIND_IPV4;
+		default:
+			return SPEC_KIND_NONE;
+	}
+}
+
+static void
+spec_make_key(dfspec_kind_t kind, fvalue_t *fv, dfspec_key_t *key)
+{
+	switch (kind) {
+		case SPEC_KIND_UINT32:
+			key->u64 = fv->value.uinteger;
+			break;
+		case SPEC_KIND_SINT32:
+			key->s64 = fv->value.sinteger;
+			key->u64 = (guint32)fv->value.sinteger;
+			break;
+		case SPEC_KIND_UINT64:
+			key->u64 = fv->value.uinteger64;
+			break;
+		case SPEC_KIND_SINT64:
+			key->s64 = fv->value.sinteger64;
+			key->u64 = (guint64)fv->value.sinteger64;
+			break;
+		case SPEC_KIND_BOOLEAN:
+			key->u64 = fv->value.uinteger64 != 0;
+			break;
+		case SPEC_KIND_IPV4:
+			key->nmask = fv->value.ipv4.nmask;
+			key->addr = fv->value.ipv4.addr & key->nmask;
+			break;
+		default:
+			ws_assert_not_reached();
+	}
+}
+
+/* All the fields with the name of hfinfo must store their values the
+ * same way. */
+static gboolean
+spec_fields_have_kind(header_field_info *hfinfo, dfspec_kind_t kind)
+{
+	for (; hfinfo; hfinfo = hfinfo->same_name_next) {
+		if (spec_kind(hfinfo->type) != kind)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* Returns the constant in a register, or NULL if it isn't a constant
+ * register. */
+static fvalue_t *
+spec_const(dfilter_t *df, guint32 reg)
+{
+	GList *list;
+
+	if (reg < df->num_registers)
+		return NULL;
+	list = df->registers[reg];
+	if (!list || g_list_next(list))
+		return NULL;
+	return (fvalue_t *)list->data;
+}
+
+/* Translate the relation in dfvm instruction "rel", whose field was read
+ * by READ_TREE instruction "read", into a TEST. */
+static gboolean
+spec_test(dfilter_t *df, dfvm_insn_t *read, dfvm_insn_t *rel, dfspec_insn_t *test)
+{
+	guint32		reg = read->arg2->value.numeric;
+	header_field_info *hfinfo = read->arg1->value.hfinfo;
+	fvalue_t	*fv;
+	dfspec_kind_t	kind;
+	dfspec_cmp_t	cmp;
+	gboolean	swapped;
+
+	test->op = SPEC_TEST;
+	test->hfinfo = hfinfo;
+	test->dfvm_op = rel->op;
+
+	if (rel->op == ANY_IN_SET) {
+		if (rel->arg1->value.numeric != reg)
+			return FALSE;
+		test->key.set = rel->arg2->value.dset;
+		test->kernel = spec_in_set;
+		return TRUE;
+	}
+
+	switch (rel->op) {
+		case ANY_EQ:		cmp = SPEC_CMP_EQ; break;
+		case ALL_NE:		cmp = SPEC_CMP_EQ; test->all = TRUE; break;
+		case ANY_NE:		cmp = SPEC_CMP_NE; break;
+		case ANY_GT:		cmp = SPEC_CMP_GT; break;
+		case ANY_GE:		cmp = SPEC_CMP_GE; break;
+		case ANY_LT:		cmp = SPEC_CMP_LT; break;
+		case ANY_LE:		cmp = SPEC_CMP_LE; break;
+		case ANY_BITWISE_AND:	cmp = SPEC_CMP_BITWISE_AND; break;
+		default:
+			return FALSE;
+	}
+
+	/* One side must be the field and the other a constant. */
+	if (rel->arg1->value.numeric == reg) {
+		fv = spec_const(df, rel->arg2->value.numeric);
+		swapped = FALSE;
+	}
+	else if (rel->arg2->value.numeric == reg) {
+		fv = spec_const(df, rel->arg1->value.numeric);
+		swapped = TRUE;
+	}
+	else {
+		return FALSE;
+	}
+	if (!fv)
+		return FALSE;
+
+	kind = spec_kind(fvalue_type_ftenum(fv));
+	if (kind == SPEC_KIND_NONE || !spec_fields_have_kind(hfinfo, kind))
+		return FALSE;
+
+	if (swapped) {
+		switch (cmp) {
+			case SPEC_CMP_GT: cmp = SPEC_CMP_LT; break;
+			case SPEC_CMP_GE: cmp = SPEC_CMP_LE; break;
+			case SPEC_CMP_LT: cmp = SPEC_CMP_GT; break;
+			case SPEC_CMP_LE: cmp = SPEC_CMP_GE; break;
+			default: break;
+		}
+	}
+
+	test->kernel = spec_kernels[kind][cmp];
+	if (!test->kernel)
+		return FALSE;
+	test->cmp = cmp;
+	spec_make_key(kind, fv, &test->key);
+	test->fv = fv;
+	return TRUE;
+}
+
+static gboolean
+is_relation(dfvm_opcode_t op)
+{
+	switch (op) {
+		case ANY_EQ:
+		case ALL_NE:
+		case ANY_NE:
+		case ANY_GT:
+		case ANY_GE:
+		case ANY_LT:
+		case ANY_LE:
+		case ANY_BITWISE_AND:
+		case ANY_IN_SET:
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+void
+dfvm_specialize(dfilter_t *df)
+{
+	int		length, id, n;
+	int		*new_id;
+	dfvm_insn_t	*insn, *next, *rel;
+	dfspec_insn_t	*insns;
+	gboolean	ok = TRUE;
+
+	df->spec = NULL;
+	length = df->insns->len;
+	new_id = g_new(int, length + 1);
+	insns = g_new0(dfspec_insn_t, length);
+
+	/* Map the dfvm instructions to specialized ones. The fields read by
+	 * READ_TREE go straight to the following relation, so the READ_TREE
+	 * and IF_FALSE_GOTO don't get an instruction of their own; -1 marks
+	 * them, as nothing may jump there. */
+	for (id = 0, n = 0; id < length && ok; id++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, id);
+		new_id[id] = n;
+
+		switch (insn->op) {
+			case READ_TREE:
+				if (id + 2 >= length) {
+					ok = FALSE;
+					break;
+				}
+				next = (dfvm_insn_t *)g_ptr_array_index(df->insns, id + 1);
+				rel = (dfvm_insn_t *)g_ptr_array_index(df->insns, id + 2);
+				if (next->op != IF_FALSE_GOTO || !is_relation(rel->op) ||
+						!spec_test(df, insn, rel, &insns[n])) {
+					ok = FALSE;
+					break;
+				}
+				/* Target fixed up below */
+				insns[n].target = next->arg1->value.numeric;
+				new_id[id + 1] = new_id[id + 2] = -1;
+				id += 2;
+				n++;
+				break;
+
+			case CHECK_EXISTS:
+				insns[n].op = SPEC_CHECK_EXISTS;
+				insns[n].hfinfo = insn->arg1->value.hfinfo;
+				n++;
+				break;
+
+			case NOT:
+				insns[n++].op = SPEC_NOT;
+				break;
+
+			case RETURN:
+				insns[n++].op = SPEC_RETURN;
+				break;
+
+			case IF_TRUE_GOTO:
+			case IF_FALSE_GOTO:
+				insns[n].op = insn->op == IF_TRUE_GOTO ?
+						SPEC_IF_TRUE_GOTO : SPEC_IF_FALSE_GOTO;
+				insns[n].target = insn->arg1->value.numeric;
+				n++;
+				break;
+
+			default:
+				ok = FALSE;
+				break;
+		}
+	}
+	new_id[length] = n;
+
+	/* Fix up the jumps. */
+	for (id = 0; id < n && ok; id++) {
+		switch (insns[id].op) {
+			case SPEC_TEST:
+			case SPEC_IF_TRUE_GOTO:
+			case SPEC_IF_FALSE_GOTO:
+				if (insns[id].target > length || new_id[insns[id].target] < 0) {
+					ok = FALSE;
+				}
+				else {
+					insns[id].target = new_id[insns[id].target];
+				}
+				break;
+			default:
+				break;
+		}
+	}
+
+	g_free(new_id);
+	if (!ok) {
+		g_free(insns);
+		return;
+	}
+
+	df->spec = g_new(dfspec_t, 1);
+	df->spec->insns = insns;
+	df->spec->num_insns = n;
+}
+
+static gboolean
+spec_run_test(const dfspec_insn_t *insn, proto_tree *tree, gboolean *found)
+{
+	header_field_info *hfinfo;
+	GPtrArray	*finfos;
+
+	*found = FALSE;
+	for (hfinfo = insn->hfinfo; hfinfo; hfinfo = hfinfo->same_name_next) {
+		finfos = proto_get_finfo_ptr_array(tree, hfinfo->id);
+		if (finfos == NULL || finfos->len == 0)
+			continue;
+		*found = TRUE;
+		if (insn->kernel(finfos, &insn->key))
+			return !insn->all;
+	}
+	return insn->all;
+}
+
+gboolean
+dfspec_apply(const dfspec_t *spec, proto_tree *tree)
+{
+	const dfspec_insn_t *insn;
+	header_field_info *hfinfo;
+	gboolean	accum = TRUE;
+	gboolean	found;
+	int		id = 0;
+
+	ws_assert(tree);
+
+	while (id < spec->num_insns) {
+		insn = &spec->insns[id];
+		switch (insn->op) {
+			case SPEC_TEST:
+				accum = spec_run_test(insn, tree, &found);
+				if (!found) {
+					/* Like a failed READ_TREE */
+					accum = FALSE;
+					id = insn->target;
+					continue;
+				}
+				break;
+
+			case SPEC_CHECK_EXISTS:
+				accum = FALSE;
+				for (hfinfo = insn->hfinfo; hfinfo && !accum;
+						hfinfo = hfinfo->same_name_next) {
+					accum = proto_check_for_protocol_or_field(tree,
+							hfinfo->id);
+				}
+				break;
+
+			case SPEC_NOT:
+				accum = !accum;
+				break;
+
+			case SPEC_RETURN:
+				return accum;
+
+			case SPEC_IF_TRUE_GOTO:
+				if (accum) {
+					id = insn->target;
+					continue;
+				}
+				break;
+
+			case SPEC_IF_FALSE_GOTO:
+				if (!accum) {
+					id = insn->target;
+					continue;
+				}
+				break;
+		}
+		id++;
+	}
+
+	ws_assert_not_reached();
+	return FALSE;
+}
+
+void
+dfspec_dump(FILE *f, const dfspec_t *spec)
+{
+	const dfspec_insn_t *insn;
+	char		*value_str;
+	int		id;
+
+	for (id = 0; id < spec->num_insns; id++) {
+		insn = &spec->insns[id];
+		switch (insn->op) {
+			case SPEC_TEST:
+				if (insn->dfvm_op == ANY_IN_SET) {
+					fprintf(f, "%05d TEST\t\t%s in set of %u elements, else goto %d\n",
+						id, insn->hfinfo->abbrev,
+						dset_num_elements(insn->key.set),
+						insn->target);
+					break;
+				}
+				value_str = fvalue_to_string_repr(NULL, insn->fv,
+						FTREPR_DFILTER, BASE_NONE);
+				fprintf(f, "%05d TEST\t\t%s%s %s %s <%s>, else goto %d\n",
+					id, insn->all ? "all " : "",
+					insn->hfinfo->abbrev,
+					insn->all ? "!=" : cmp_names[insn->cmp],
+					value_str, fvalue_type_name(insn->fv),
+					insn->target);
+				wmem_free(NULL, value_str);
+				break;
+
+			case SPEC_CHECK_EXISTS:
+				fprintf(f, "%05d CHECK_EXISTS\t%s\n",
+					id, insn->hfinfo->abbrev);
+				break;
+
+			case SPEC_NOT:
+				fprintf(f, "%05d NOT\n", id);
+				break;
+
+			case SPEC_RETURN:
+				fprintf(f, "%05d RETURN\n", id);
+				break;
+
+			case SPEC_IF_TRUE_GOTO:
+				fprintf(f, "%05d IF-TRUE-GOTO\t%d\n", id, insn->target);
+				break;
+
+			case SPEC_IF_FALSE_GOTO:
+				fprintf(f, "%05d IF-FALSE-GOTO\t%d\n", id, insn->target);
+				break;
+		}
+	}
+}
+
+void
+dfspec_free(dfspec_t *spec)
+{
+	if (!spec)
+		return;
+	g_free(spec->insns);
+	g_free(spec);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
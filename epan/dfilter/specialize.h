@@ -0,0 +1,35 @@
+/** @file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SPECIALIZE_H
+#define SPECIALIZE_H
+
+#include <stdio.h>
+#include "dfilter-int.h"
+
+typedef struct _dfspec dfspec_t;
+
+/* If the bytecode of df only compares fields of fixed-width integer,
+ * boolean and IPv4 types with constants (or tests them for membership
+ * in constant sets or existence), build a specialized evaluator for it
+ * in df->spec. Otherwise df->spec is left NULL and the filter is run by
+ * the interpreter. Must be called after dfvm_init_const(). */
+void
+dfvm_specialize(dfilter_t *df);
+
+gboolean
+dfspec_apply(const dfspec_t *spec, proto_tree *tree);
+
+void
+dfspec_dump(FILE *f, const dfspec_t *spec);
+
+void
+dfspec_free(dfspec_t *spec);
+
+#endif
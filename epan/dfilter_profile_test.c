@@ -0,0 +1,228 @@
+/* dfilter_profile_test.c
+ * Tests for the execution counts of display filters and the optimizer
+ * feedback that uses them
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+#undef G_DISABLE_ASSERT
+
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+
+#include <wiretap/wtap.h>
+#include <epan/epan.h>
+#include <epan/epan_dissect.h>
+#include <epan/frame_data.h>
+#include <epan/prefs.h>
+#include <epan/dfilter/dfilter.h>
+#include <epan/dfilter/dfilter-cache.h>
+
+/* More than the evaluations the optimizer needs before it uses a rate */
+#define NUM_TEST_FRAMES 128
+
+/*
+ * Slices aren't handled by the specialized evaluator, so these filters
+ * run in the interpreter and are counted. The first byte of every
+ * frame is 01 and the second is 02.
+ */
+#define TEST_ALWAYS "frame[0] == 01"
+#define TEST_NEVER "frame[1] == 03"
+
+static epan_t *test_epan;
+
+static const nstime_t *
+test_get_frame_ts(struct packet_provider_data *prov _U_, guint32 frame_num _U_)
+{
+  static nstime_t empty;
+
+  return &empty;
+}
+
+/* Dissect frames 1 to num_frames and return how many of them pass df */
+static guint
+test_apply(dfilter_t *df, guint32 num_frames)
+{
+  static const guint8 frame[] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08 };
+  epan_dissect_t *edt;
+  guint32 num;
+  guint passed = 0;
+
+  edt = epan_dissect_new(test_epan, TRUE, FALSE);
+
+  for (num = 1; num <= num_frames; num++) {
+    wtap_rec rec;
+    frame_data fdata;
+
+    memset(&rec, 0, sizeof rec);
+    rec.rec_type = REC_TYPE_PACKET;
+    rec.rec_header.packet_header.caplen = sizeof frame;
+    rec.rec_header.packet_header.len = sizeof frame;
+    rec.rec_header.packet_header.pkt_encap = WTAP_ENCAP_UNKNOWN;
+    rec.presence_flags = WTAP_HAS_CAP_LEN;
+
+    frame_data_init(&fdata, num, &rec, 0, 0);
+    epan_dissect_prime_with_dfilter(edt, df);
+    epan_dissect_run(edt, WTAP_FILE_TYPE_SUBTYPE_UNKNOWN, &rec,
+                     tvb_new_real_data(frame, sizeof frame, sizeof frame),
+                     &fdata, NULL);
+    if (dfilter_apply_edt(df, edt))
+      passed++;
+    epan_dissect_reset(edt);
+    frame_data_destroy(&fdata);
+  }
+
+  epan_dissect_free(edt);
+  return passed;
+}
+
+/* The output of dfilter_print_profile() */
+static char *
+test_print_profile(dfilter_t *df)
+{
+  FILE *f;
+  long size;
+  char *str;
+
+  f = tmpfile();
+  g_assert_nonnull(f);
+  dfilter_print_profile(f, df);
+  size = ftell(f);
+  g_assert_cmpint(size, >, 0);
+  rewind(f);
+  str = (char *)g_malloc0(size + 1);
+  g_assert_cmpuint(fread(str, 1, size, f), ==, (size_t)size);
+  fclose(f);
+
+  return str;
+}
+
+/* Whether the test "first" is evaluated before "second" in the bytecode */
+static gboolean
+test_evaluated_before(dfilter_t *df, const char *first, const char *second)
+{
+  char *profile, *pos_first, *pos_second;
+  gboolean before;
+
+  /* The bytecode is only printed once the filter has been applied. */
+  test_apply(df, 1);
+  profile = test_print_profile(df);
+  pos_first = strstr(profile, first);
+  pos_second = strstr(profile, second);
+  g_assert_nonnull(pos_first);
+  g_assert_nonnull(pos_second);
+  before = pos_first < pos_second;
+  g_free(profile);
+
+  return before;
+}
+
+static void
+dfilter_profile_test_counts(void)
+{
+  dfilter_t *df;
+  gchar *err_msg = NULL;
+  char *profile;
+
+  dfilter_set_profiling(TRUE);
+
+  g_assert_true(dfilter_compile("frame.number <= 32", &df, &err_msg));
+  g_assert_null(err_msg);
+  g_assert_cmpuint(test_apply(df, NUM_TEST_FRAMES), ==, 32);
+
+  profile = test_print_profile(df);
+  g_assert_nonnull(strstr(profile, "Filter: frame.number <= 32\n"));
+  g_assert_nonnull(strstr(profile, "Applied: 128, passed: 32 (25.00%)"));
+  g_free(profile);
+
+  dfilter_free(df);
+  dfilter_set_profiling(FALSE);
+}
+
+static void
+dfilter_profile_test_feedback(void)
+{
+  dfilter_t *df_before, *df_after;
+  dfilter_cache_t *cache;
+  gchar *err_msg = NULL;
+  guint8 passed[DFILTER_CACHE_BITMAP_SIZE(NUM_TEST_FRAMES)];
+  guint8 *cached;
+
+  prefs.filter_selectivity_feedback = TRUE;
+
+  /* Without counts, tests of the same cost keep their order. */
+  g_assert_true(dfilter_compile(TEST_ALWAYS " && " TEST_NEVER, &df_before, &err_msg));
+  g_assert_null(err_msg);
+  g_assert_cmpuint(test_apply(df_before, NUM_TEST_FRAMES), ==, 0);
+  dfilter_learn_selectivity(df_before);
+
+  /* The test that is FALSE goes first once its rate is known. */
+  g_assert_true(dfilter_compile(TEST_ALWAYS " && " TEST_NEVER, &df_after, &err_msg));
+  g_assert_null(err_msg);
+  g_assert_true(test_evaluated_before(df_before, "[0:1]", "[1:1]"));
+  g_assert_true(test_evaluated_before(df_after, "[1:1]", "[0:1]"));
+  g_assert_cmpuint(test_apply(df_after, NUM_TEST_FRAMES), ==, 0);
+
+  /* Both orders are the same filter for the result cache. */
+  cache = dfilter_cache_new(4);
+  memset(passed, 0, sizeof passed);
+  dfilter_cache_store(cache, df_before, NUM_TEST_FRAMES, passed, NULL);
+  g_assert_true(dfilter_cache_lookup(cache, df_after, NUM_TEST_FRAMES, &cached, NULL));
+  g_assert_nonnull(cached);
+  g_assert_true(memcmp(cached, passed, sizeof passed) == 0);
+  g_free(cached);
+  dfilter_cache_free(cache);
+
+  dfilter_free(df_before);
+  dfilter_free(df_after);
+
+  prefs.filter_selectivity_feedback = FALSE;
+}
+
+int
+main(int argc, char **argv)
+{
+  static const struct packet_provider_funcs funcs = {
+    test_get_frame_ts,
+    NULL,
+    NULL,
+    NULL
+  };
+  int result;
+
+  g_test_init(&argc, &argv, NULL);
+
+  wtap_init(FALSE);
+  if (!epan_init(NULL, NULL, FALSE))
+    return 2;
+  test_epan = epan_new(NULL, &funcs);
+
+  g_test_add_func("/dfilter/profile/feedback", dfilter_profile_test_feedback);
+  g_test_add_func("/dfilter/profile/counts", dfilter_profile_test_counts);
+
+  result = g_test_run();
+
+  epan_free(test_epan);
+  epan_cleanup();
+
+  return result;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 2
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=2 tabstop=8 expandtab:
+ * :indentSize=2:tabSize=8:noTabs=true:
+ */
@@ -43,6 +43,7 @@
 #include "addr_resolv.h"
 #include "oids.h"
 #include <epan/wmem_scopes.h>
+#include <epan/proto_data.h>
 #include "expert.h"
 #include "print.h"
 #include "capture_dissectors.h"
@@ -105,7 +106,10 @@
 static GSList *epan_plugin_register_all_procotols = NULL;
 static GSList *epan_plugin_register_all_handoffs = NULL;
 
+/* Protected by pinfo_pool_cache_mtx, as epan_dissect_t's may be
+   initialized and cleaned up in several threads. */
 static wmem_allocator_t *pinfo_pool_cache = NULL;
+static GMutex pinfo_pool_cache_mtx;
 
 /* Global variables holding the content of the corresponding environment variable
  * to save fetching it repeatedly.
@@ -435,6 +439,20 @@ epan_cleanup(void)
 	wtap_cleanup();
 }
 
+void
+epan_init_thread(void)
+{
+	wmem_init_thread_scopes();
+	tap_init_thread();
+}
+
+void
+epan_cleanup_thread(void)
+{
+	tap_cleanup_thread();
+	wmem_cleanup_thread_scopes();
+}
+
 struct epan_session {
 	struct packet_provider_data *prov;	/* packet provider data for this session */
 	struct packet_provider_funcs funcs;	/* functions using that data */
@@ -536,11 +554,11 @@ epan_dissect_init(epan_dissect_t *edt, epan_t *session, const gboolean create_pr
 	edt->session = session;
 
 	memset(&edt->pi, 0, sizeof(edt->pi));
-	if (pinfo_pool_cache != NULL) {
-		edt->pi.pool = pinfo_pool_cache;
-		pinfo_pool_cache = NULL;
-	}
-	else {
+	g_mutex_lock(&pinfo_pool_cache_mtx);
+	edt->pi.pool = pinfo_pool_cache;
+	pinfo_pool_cache = NULL;
+	g_mutex_unlock(&pinfo_pool_cache_mtx);
+	if (edt->pi.pool == NULL) {
 		edt->pi.pool = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK_FAST);
 	}
 
@@ -567,7 +585,7 @@ epan_dissect_reset(epan_dissect_t *edt)
 
 	wtap_block_unref(edt->pi.rec->block);
 
-	g_slist_free(edt->pi.proto_data);
+	p_free_proto_data_store(edt->pi.proto_data);
 	g_slist_free(edt->pi.dependent_frames);
 
 	/* Free the data sources list. */
@@ -678,7 +696,7 @@ epan_dissect_cleanup(epan_dissect_t* edt)
 
 	g_slist_foreach(epan_plugins, epan_plugin_dissect_cleanup, edt);
 
-	g_slist_free(edt->pi.proto_data);
+	p_free_proto_data_store(edt->pi.proto_data);
 	g_slist_free(edt->pi.dependent_frames);
 
 	/* Free the data sources list. */
@@ -693,11 +711,14 @@ epan_dissect_cleanup(epan_dissect_t* edt)
 		proto_tree_free(edt->tree);
 	}
 
+	wmem_free_all(edt->pi.pool);
+	g_mutex_lock(&pinfo_pool_cache_mtx);
 	if (pinfo_pool_cache == NULL) {
-		wmem_free_all(edt->pi.pool);
 		pinfo_pool_cache = edt->pi.pool;
+		edt->pi.pool = NULL;
 	}
-	else {
+	g_mutex_unlock(&pinfo_pool_cache_mtx);
+	if (edt->pi.pool != NULL) {
 		wmem_destroy_allocator(edt->pi.pool);
 	}
 }
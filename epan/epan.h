@@ -115,6 +115,26 @@ e_prefs *epan_load_settings(void);
 WS_DLL_PUBLIC
 void epan_cleanup(void);
 
+/**
+ * Set up the per-thread dissection state (packet scope and tap queue) of
+ * the calling thread.
+ *
+ * Must be called by a thread, other than the one that called epan_init(),
+ * before it creates and runs its own epan_dissect_t, and paired with
+ * epan_cleanup_thread() before the thread exits.
+ *
+ * This only makes the state owned by a dissection private to its thread;
+ * the file scope, tap listeners, conversation and reassembly tables and
+ * the dissectors' own static state are still shared, so the dissections
+ * themselves still have to be serialized.
+ */
+WS_DLL_PUBLIC
+void epan_init_thread(void);
+
+/** Release the per-thread state set up by epan_init_thread() */
+WS_DLL_PUBLIC
+void epan_cleanup_thread(void);
+
 typedef struct {
 	void (*init)(void);
 	void (*dissect_init)(epan_dissect_t *);
@@ -0,0 +1,200 @@
+/* epan_thread_test.c
+ * Tests for the per-thread dissection state set up by epan_init_thread()
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+#undef G_DISABLE_ASSERT
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+
+#include <wiretap/wtap.h>
+#include <epan/epan.h>
+#include <epan/epan_dissect.h>
+#include <epan/frame_data.h>
+#include <epan/tap.h>
+#include <epan/wmem_scopes.h>
+
+#define NUM_TEST_THREADS 2
+#define NUM_TEST_FRAMES 200
+
+typedef struct {
+  guint32 first_num;
+  wmem_allocator_t *packet_scope;
+  guint tapped;
+} test_thread_t;
+
+static epan_t *test_epan;
+
+/*
+ * Only the packet scope and the tap queue are per-thread: the dissectors
+ * themselves still share state, so the dissections are serialized while
+ * everything else the threads do runs concurrently.
+ */
+static GMutex dissect_mutex;
+
+/* Threads wait for each other to be set up, so that they overlap. */
+static GMutex start_mutex;
+static GCond start_cond;
+static guint started;
+
+static GPrivate current_thread;
+
+static const nstime_t *
+test_get_frame_ts(struct packet_provider_data *prov _U_, guint32 frame_num _U_)
+{
+  static nstime_t empty;
+
+  return &empty;
+}
+
+static tap_packet_status
+test_tap_packet(void *tapdata _U_, packet_info *pinfo, epan_dissect_t *edt _U_, const void *data _U_)
+{
+  test_thread_t *t = (test_thread_t *)g_private_get(&current_thread);
+
+  /* Only the frames dissected by this thread are pushed to it. */
+  g_assert_nonnull(t);
+  g_assert_true(wmem_packet_scope() == t->packet_scope);
+  g_assert_cmpuint(pinfo->num, ==, t->first_num + t->tapped);
+  t->tapped++;
+
+  return TAP_PACKET_DONT_REDRAW;
+}
+
+static gpointer
+test_thread_main(gpointer data)
+{
+  test_thread_t *t = (test_thread_t *)data;
+  static const guint8 frame[] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08 };
+  epan_dissect_t *edt;
+  guint i;
+
+  epan_init_thread();
+  g_private_set(&current_thread, t);
+  t->packet_scope = wmem_packet_scope();
+
+  g_mutex_lock(&start_mutex);
+  started++;
+  g_cond_broadcast(&start_cond);
+  while (started < NUM_TEST_THREADS)
+    g_cond_wait(&start_cond, &start_mutex);
+  g_mutex_unlock(&start_mutex);
+
+  edt = epan_dissect_new(test_epan, FALSE, FALSE);
+
+  for (i = 0; i < NUM_TEST_FRAMES; i++) {
+    wtap_rec rec;
+    frame_data fdata;
+    char *str;
+
+    /* The packet scope can be used while another thread dissects. */
+    wmem_enter_packet_scope();
+    str = wmem_strdup_printf(wmem_packet_scope(), "%u", t->first_num + i);
+    g_assert_cmpuint(strtoul(str, NULL, 10), ==, t->first_num + i);
+    wmem_leave_packet_scope();
+
+    memset(&rec, 0, sizeof rec);
+    rec.rec_type = REC_TYPE_PACKET;
+    rec.rec_header.packet_header.caplen = sizeof frame;
+    rec.rec_header.packet_header.len = sizeof frame;
+    rec.rec_header.packet_header.pkt_encap = WTAP_ENCAP_UNKNOWN;
+    rec.presence_flags = WTAP_HAS_CAP_LEN;
+
+    frame_data_init(&fdata, t->first_num + i, &rec, 0, 0);
+
+    g_mutex_lock(&dissect_mutex);
+    epan_dissect_run_with_taps(edt, WTAP_FILE_TYPE_SUBTYPE_UNKNOWN, &rec,
+                               tvb_new_real_data(frame, sizeof frame, sizeof frame),
+                               &fdata, NULL);
+    g_mutex_unlock(&dissect_mutex);
+
+    epan_dissect_reset(edt);
+    frame_data_destroy(&fdata);
+  }
+
+  epan_dissect_free(edt);
+  g_private_set(&current_thread, NULL);
+  epan_cleanup_thread();
+
+  return NULL;
+}
+
+static void
+epan_thread_test_scopes_and_taps(void)
+{
+  test_thread_t threads[NUM_TEST_THREADS];
+  GThread *handles[NUM_TEST_THREADS];
+  GString *error;
+  guint i;
+
+  error = register_tap_listener("frame", &threads, NULL, 0, NULL, test_tap_packet, NULL, NULL);
+  g_assert_null(error);
+
+  for (i = 0; i < NUM_TEST_THREADS; i++) {
+    threads[i].first_num = 1 + i * NUM_TEST_FRAMES;
+    threads[i].packet_scope = NULL;
+    threads[i].tapped = 0;
+    handles[i] = g_thread_new("epan_thread_test", test_thread_main, &threads[i]);
+  }
+  for (i = 0; i < NUM_TEST_THREADS; i++)
+    g_thread_join(handles[i]);
+
+  for (i = 0; i < NUM_TEST_THREADS; i++) {
+    g_assert_cmpuint(threads[i].tapped, ==, NUM_TEST_FRAMES);
+    /* Each thread had its own packet scope, not the main thread's one. */
+    g_assert_nonnull(threads[i].packet_scope);
+    g_assert_true(threads[i].packet_scope != wmem_packet_scope());
+  }
+  g_assert_true(threads[0].packet_scope != threads[1].packet_scope);
+
+  remove_tap_listener(&threads);
+}
+
+int
+main(int argc, char **argv)
+{
+  static const struct packet_provider_funcs funcs = {
+    test_get_frame_ts,
+    NULL,
+    NULL,
+    NULL
+  };
+  int result;
+
+  g_test_init(&argc, &argv, NULL);
+
+  wtap_init(FALSE);
+  if (!epan_init(NULL, NULL, FALSE))
+    return 2;
+  test_epan = epan_new(NULL, &funcs);
+
+  g_test_add_func("/epan/thread/scopes_and_taps", epan_thread_test_scopes_and_taps);
+
+  result = g_test_run();
+
+  epan_free(test_epan);
+  epan_cleanup();
+
+  return result;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 2
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=2 tabstop=8 expandtab:
+ * :indentSize=2:tabSize=8:noTabs=true:
+ */
@@ -16,6 +16,7 @@
 #include <epan/epan.h>
 #include <wiretap/wtap.h>
 #include <epan/frame_data.h>
+#include <epan/proto_data.h>
 #include <epan/column-utils.h>
 #include <epan/timestamp.h>
 #include <wsutil/ws_assert.h>
@@ -293,7 +294,7 @@ frame_data_reset(frame_data *fdata)
   fdata->subnum = 0;
 
   if (fdata->pfd) {
-    g_slist_free(fdata->pfd);
+    p_free_proto_data_store(fdata->pfd);
     fdata->pfd = NULL;
   }
 }
@@ -302,7 +303,7 @@ void
 frame_data_destroy(frame_data *fdata)
 {
   if (fdata->pfd) {
-    g_slist_free(fdata->pfd);
+    p_free_proto_data_store(fdata->pfd);
     fdata->pfd = NULL;
   }
 }
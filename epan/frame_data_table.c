@@ -0,0 +1,532 @@
+/* frame_data_table.c
+ * Compact, column-oriented storage for frame_data structures
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <epan/packet.h>
+#include <epan/proto_data.h>
+#include <wsutil/bits_count_ones.h>
+#include <wsutil/ws_assert.h>
+
+#include "frame_data_table.h"
+
+/*
+ * Frames are stored in blocks of 64, so that each flag of a block fits
+ * in a single 64-bit word.
+ *
+ * The fields that are only set when the frame is read (file offset,
+ * time stamps, lengths, ...) are stored in a per-block byte stream of
+ * variable-length records.  Offsets and time stamps are stored as the
+ * difference from the previous frame in the same block, so that a frame
+ * can be decoded by walking at most 63 records and without having to
+ * look at other blocks.  Each block starts again from zero.
+ *
+ * The fields that are recomputed every time the packets are filtered
+ * (cumulative bytes, reference and previous displayed frame) are stored
+ * in fixed-size arrays so that writing them back is cheap.
+ *
+ * The per-frame proto data pointers are only allocated for a block once
+ * a frame in it has some.
+ */
+#define LOG2_FRAMES_PER_BLOCK   6
+#define FRAMES_PER_BLOCK        (1<<LOG2_FRAMES_PER_BLOCK)
+
+#define BLOCK_INDEX(idx)        ((idx) >> LOG2_FRAMES_PER_BLOCK)
+#define FRAME_INDEX(idx)        ((idx) & (FRAMES_PER_BLOCK - 1))
+
+/* Bits of the first byte of a record */
+#define REC_TSPREC_MASK         0x0F
+#define REC_HAS_SHIFT_OFFSET    0x10
+#define REC_HAS_SUBNUM          0x20
+
+/* Longest possible record: the flags byte, 8 zigzag varints of up to
+   10 bytes each and a varint of up to 3 bytes for the 16-bit subnum. */
+#define MAX_RECORD_LEN          (1 + 8*10 + 3)
+
+typedef struct {
+  guint64            flags[FRAME_DATA_NUM_FLAGS];
+  guint32            cum_bytes[FRAMES_PER_BLOCK];
+  guint32            frame_ref_num[FRAMES_PER_BLOCK];
+  guint32            prev_dis_num[FRAMES_PER_BLOCK];
+  guint16            color[FRAMES_PER_BLOCK];
+  proto_data_store **pfd;           /* NULL if no frame in the block has any */
+  guint8            *records;       /* Encoded records */
+  guint32            records_len;   /* Used bytes in records */
+  guint32            records_size;  /* Allocated bytes in records */
+} fdt_block;
+
+/* The part of a frame_data that is stored in the record stream. */
+typedef struct {
+  gint64       file_off;
+  nstime_t     abs_ts;
+  nstime_t     shift_offset;
+  guint32      pkt_len;
+  guint32      cap_len;
+  guint16      subnum;
+  guint8       tsprec;
+} fdt_record;
+
+struct _frame_data_table {
+  guint32      count;           /* Total number of frames */
+  GPtrArray   *blocks;          /* Array of fdt_block * */
+  fdt_record   last;            /* Last record appended to the last block */
+  GPtrArray   *color_filters;   /* Color index -> color filter, 0 is none */
+  GHashTable  *color_indices;   /* Color filter -> color index */
+};
+
+static inline guint64
+zigzag_encode(gint64 value)
+{
+  return ((guint64)value << 1) ^ (guint64)(value >> 63);
+}
+
+static inline gint64
+zigzag_decode(guint64 value)
+{
+  return (gint64)(value >> 1) ^ -(gint64)(value & 1);
+}
+
+static inline guint8 *
+varint_encode(guint8 *p, guint64 value)
+{
+  while (value >= 0x80) {
+    *p++ = (guint8)(value | 0x80);
+    value >>= 7;
+  }
+  *p++ = (guint8)value;
+  return p;
+}
+
+static inline const guint8 *
+varint_decode(const guint8 *p, guint64 *value)
+{
+  guint64 result = 0;
+  guint   shift = 0;
+
+  do {
+    result |= (guint64)(*p & 0x7F) << shift;
+    shift += 7;
+  } while (*p++ & 0x80);
+  *value = result;
+  return p;
+}
+
+/*
+ * Encode rec, the successor of prev, at p, and return the end of the
+ * encoded record.
+ */
+static guint8 *
+record_encode(guint8 *p, const fdt_record *rec, const fdt_record *prev)
+{
+  guint8 flags = rec->tsprec & REC_TSPREC_MASK;
+
+  if (rec->shift_offset.secs != 0 || rec->shift_offset.nsecs != 0)
+    flags |= REC_HAS_SHIFT_OFFSET;
+  if (rec->subnum != 0)
+    flags |= REC_HAS_SUBNUM;
+  *p++ = flags;
+
+  p = varint_encode(p, zigzag_encode(rec->file_off - prev->file_off));
+  p = varint_encode(p, zigzag_encode((gint64)rec->abs_ts.secs - (gint64)prev->abs_ts.secs));
+  p = varint_encode(p, zigzag_encode((gint64)rec->abs_ts.nsecs - (gint64)prev->abs_ts.nsecs));
+  p = varint_encode(p, rec->pkt_len);
+  p = varint_encode(p, zigzag_encode((gint64)rec->pkt_len - (gint64)rec->cap_len));
+  if (flags & REC_HAS_SHIFT_OFFSET) {
+    p = varint_encode(p, zigzag_encode((gint64)rec->shift_offset.secs));
+    p = varint_encode(p, zigzag_encode((gint64)rec->shift_offset.nsecs));
+  }
+  if (flags & REC_HAS_SUBNUM)
+    p = varint_encode(p, rec->subnum);
+  return p;
+}
+
+/*
+ * Decode the record at p, the successor of prev, into rec, and return
+ * the start of the next record.  rec and prev may be the same.
+ */
+static const guint8 *
+record_decode(const guint8 *p, fdt_record *rec, const fdt_record *prev)
+{
+  guint8  flags = *p++;
+  guint64 value;
+
+  rec->tsprec = flags & REC_TSPREC_MASK;
+  p = varint_decode(p, &value);
+  rec->file_off = prev->file_off + zigzag_decode(value);
+  p = varint_decode(p, &value);
+  rec->abs_ts.secs = (time_t)((gint64)prev->abs_ts.secs + zigzag_decode(value));
+  p = varint_decode(p, &value);
+  rec->abs_ts.nsecs = (int)((gint64)prev->abs_ts.nsecs + zigzag_decode(value));
+  p = varint_decode(p, &value);
+  rec->pkt_len = (guint32)value;
+  p = varint_decode(p, &value);
+  rec->cap_len = (guint32)((gint64)rec->pkt_len - zigzag_decode(value));
+  if (flags & REC_HAS_SHIFT_OFFSET) {
+    p = varint_decode(p, &value);
+    rec->shift_offset.secs = (time_t)zigzag_decode(value);
+    p = varint_decode(p, &value);
+    rec->shift_offset.nsecs = (int)zigzag_decode(value);
+  } else {
+    rec->shift_offset.secs = 0;
+    rec->shift_offset.nsecs = 0;
+  }
+  if (flags & REC_HAS_SUBNUM) {
+    p = varint_decode(p, &value);
+    rec->subnum = (guint16)value;
+  } else {
+    rec->subnum = 0;
+  }
+  return p;
+}
+
+static void
+record_from_frame_data(fdt_record *rec, const frame_data *fdata)
+{
+  rec->file_off = fdata->file_off;
+  rec->abs_ts = fdata->abs_ts;
+  rec->shift_offset = fdata->shift_offset;
+  rec->pkt_len = fdata->pkt_len;
+  rec->cap_len = fdata->cap_len;
+  rec->subnum = fdata->subnum;
+  rec->tsprec = fdata->tsprec;
+}
+
+static gboolean
+record_equal(const fdt_record *a, const fdt_record *b)
+{
+  return a->file_off == b->file_off &&
+         nstime_cmp(&a->abs_ts, &b->abs_ts) == 0 &&
+         nstime_cmp(&a->shift_offset, &b->shift_offset) == 0 &&
+         a->pkt_len == b->pkt_len &&
+         a->cap_len == b->cap_len &&
+         a->subnum == b->subnum &&
+         a->tsprec == b->tsprec;
+}
+
+/*
+ * Decode the records of a block up to and including the one at index
+ * frame_idx.
+ */
+static void
+block_decode(const fdt_block *block, guint frame_idx, fdt_record *rec)
+{
+  const guint8 *p = block->records;
+  guint i;
+
+  memset(rec, 0, sizeof *rec);
+  for (i = 0; i <= frame_idx; i++)
+    p = record_decode(p, rec, rec);
+}
+
+static void
+block_append_record(fdt_block *block, const fdt_record *rec, const fdt_record *prev)
+{
+  while (block->records_size - block->records_len < MAX_RECORD_LEN) {
+    block->records_size = block->records_size ? block->records_size * 2 : 4 * MAX_RECORD_LEN;
+    block->records = (guint8 *)g_realloc(block->records, block->records_size);
+  }
+  block->records_len = (guint32)(record_encode(block->records + block->records_len, rec, prev) - block->records);
+}
+
+/* Release the slack at the end of the record stream of a full block. */
+static void
+block_shrink(fdt_block *block)
+{
+  block->records_size = block->records_len;
+  block->records = (guint8 *)g_realloc(block->records, block->records_size);
+}
+
+static void
+block_set_flag(fdt_block *block, guint frame_idx, frame_data_flag flag, gboolean value)
+{
+  if (value)
+    block->flags[flag] |= G_GUINT64_CONSTANT(1) << frame_idx;
+  else
+    block->flags[flag] &= ~(G_GUINT64_CONSTANT(1) << frame_idx);
+}
+
+static inline gboolean
+block_get_flag(const fdt_block *block, guint frame_idx, frame_data_flag flag)
+{
+  return (block->flags[flag] >> frame_idx) & 1;
+}
+
+static guint16
+color_index(frame_data_table *fdt, const struct _color_filter *color_filter)
+{
+  gpointer idx;
+
+  if (color_filter == NULL)
+    return 0;
+
+  if (!g_hash_table_lookup_extended(fdt->color_indices, color_filter, NULL, &idx)) {
+    /* We don't expect to see anywhere near this many coloring rules. */
+    ws_assert(fdt->color_filters->len <= G_MAXUINT16);
+    idx = GUINT_TO_POINTER(fdt->color_filters->len);
+    g_ptr_array_add(fdt->color_filters, (gpointer)color_filter);
+    g_hash_table_insert(fdt->color_indices, (gpointer)color_filter, idx);
+  }
+  return (guint16)GPOINTER_TO_UINT(idx);
+}
+
+static void
+block_set_mutable(frame_data_table *fdt, fdt_block *block, guint frame_idx,
+                  const frame_data *fdata)
+{
+  block_set_flag(block, frame_idx, FRAME_DATA_FLAG_PASSED_DFILTER, fdata->passed_dfilter);
+  block_set_flag(block, frame_idx, FRAME_DATA_FLAG_DEPENDENT_OF_DISPLAYED, fdata->dependent_of_displayed);
+  block_set_flag(block, frame_idx, FRAME_DATA_FLAG_ENCODING, fdata->encoding);
+  block_set_flag(block, frame_idx, FRAME_DATA_FLAG_VISITED, fdata->visited);
+  block_set_flag(block, frame_idx, FRAME_DATA_FLAG_MARKED, fdata->marked);
+  block_set_flag(block, frame_idx, FRAME_DATA_FLAG_REF_TIME, fdata->ref_time);
+  block_set_flag(block, frame_idx, FRAME_DATA_FLAG_IGNORED, fdata->ignored);
+  block_set_flag(block, frame_idx, FRAME_DATA_FLAG_HAS_TS, fdata->has_ts);
+  block_set_flag(block, frame_idx, FRAME_DATA_FLAG_HAS_MODIFIED_BLOCK, fdata->has_modified_block);
+  block_set_flag(block, frame_idx, FRAME_DATA_FLAG_NEED_COLORIZE, fdata->need_colorize);
+
+  block->cum_bytes[frame_idx] = fdata->cum_bytes;
+  block->frame_ref_num[frame_idx] = fdata->frame_ref_num;
+  block->prev_dis_num[frame_idx] = fdata->prev_dis_num;
+  block->color[frame_idx] = color_index(fdt, fdata->color_filter);
+
+  if (fdata->pfd != NULL && block->pfd == NULL)
+    block->pfd = g_new0(proto_data_store *, FRAMES_PER_BLOCK);
+  if (block->pfd != NULL)
+    block->pfd[frame_idx] = fdata->pfd;
+}
+
+frame_data_table *
+frame_data_table_new(void)
+{
+  frame_data_table *fdt;
+
+  fdt = g_new0(frame_data_table, 1);
+  fdt->blocks = g_ptr_array_new();
+  fdt->color_filters = g_ptr_array_new();
+  g_ptr_array_add(fdt->color_filters, NULL);
+  fdt->color_indices = g_hash_table_new(g_direct_hash, g_direct_equal);
+  return fdt;
+}
+
+void
+frame_data_table_free(frame_data_table *fdt)
+{
+  guint i, j;
+
+  for (i = 0; i < fdt->blocks->len; i++) {
+    fdt_block *block = (fdt_block *)g_ptr_array_index(fdt->blocks, i);
+
+    if (block->pfd != NULL) {
+      for (j = 0; j < FRAMES_PER_BLOCK; j++)
+        p_free_proto_data_store(block->pfd[j]);
+      g_free(block->pfd);
+    }
+    g_free(block->records);
+    g_free(block);
+  }
+  g_ptr_array_free(fdt->blocks, TRUE);
+  g_ptr_array_free(fdt->color_filters, TRUE);
+  g_hash_table_destroy(fdt->color_indices);
+  g_free(fdt);
+}
+
+guint32
+frame_data_table_count(const frame_data_table *fdt)
+{
+  return fdt->count;
+}
+
+void
+frame_data_table_add(frame_data_table *fdt, const frame_data *fdata)
+{
+  fdt_block  *block;
+  fdt_record  rec;
+  guint       frame_idx = FRAME_INDEX(fdt->count);
+
+  ws_assert(fdata->num == fdt->count + 1);
+
+  if (frame_idx == 0) {
+    /* Start a new block; the deltas start from zero again. */
+    if (fdt->blocks->len > 0)
+      block_shrink((fdt_block *)g_ptr_array_index(fdt->blocks, fdt->blocks->len - 1));
+    block = g_new0(fdt_block, 1);
+    g_ptr_array_add(fdt->blocks, block);
+    memset(&fdt->last, 0, sizeof fdt->last);
+  } else {
+    block = (fdt_block *)g_ptr_array_index(fdt->blocks, fdt->blocks->len - 1);
+  }
+
+  record_from_frame_data(&rec, fdata);
+  block_append_record(block, &rec, &fdt->last);
+  fdt->last = rec;
+
+  block_set_mutable(fdt, block, frame_idx, fdata);
+  fdt->count++;
+}
+
+gboolean
+frame_data_table_get(const frame_data_table *fdt, guint32 num, frame_data *fdata)
+{
+  const fdt_block *block;
+  fdt_record       rec;
+  guint            frame_idx;
+
+  if (num == 0 || num > fdt->count) {
+    /* There is no frame number 0, and there aren't that many frames. */
+    return FALSE;
+  }
+
+  block = (const fdt_block *)g_ptr_array_index(fdt->blocks, BLOCK_INDEX(num - 1));
+  frame_idx = FRAME_INDEX(num - 1);
+  block_decode(block, frame_idx, &rec);
+
+  fdata->num = num;
+  fdata->pkt_len = rec.pkt_len;
+  fdata->cap_len = rec.cap_len;
+  fdata->cum_bytes = block->cum_bytes[frame_idx];
+  fdata->file_off = rec.file_off;
+  fdata->pfd = block->pfd ? block->pfd[frame_idx] : NULL;
+  fdata->color_filter = (const struct _color_filter *)g_ptr_array_index(fdt->color_filters, block->color[frame_idx]);
+  fdata->subnum = rec.subnum;
+  fdata->passed_dfilter = block_get_flag(block, frame_idx, FRAME_DATA_FLAG_PASSED_DFILTER);
+  fdata->dependent_of_displayed = block_get_flag(block, frame_idx, FRAME_DATA_FLAG_DEPENDENT_OF_DISPLAYED);
+  fdata->encoding = block_get_flag(block, frame_idx, FRAME_DATA_FLAG_ENCODING);
+  fdata->visited = block_get_flag(block, frame_idx, FRAME_DATA_FLAG_VISITED);
+  fdata->marked = block_get_flag(block, frame_idx, FRAME_DATA_FLAG_MARKED);
+  fdata->ref_time = block_get_flag(block, frame_idx, FRAME_DATA_FLAG_REF_TIME);
+  fdata->ignored = block_get_flag(block, frame_idx, FRAME_DATA_FLAG_IGNORED);
+  fdata->has_ts = block_get_flag(block, frame_idx, FRAME_DATA_FLAG_HAS_TS);
+  fdata->has_modified_block = block_get_flag(block, frame_idx, FRAME_DATA_FLAG_HAS_MODIFIED_BLOCK);
+  fdata->need_colorize = block_get_flag(block, frame_idx, FRAME_DATA_FLAG_NEED_COLORIZE);
+  fdata->tsprec = rec.tsprec;
+  fdata->abs_ts = rec.abs_ts;
+  fdata->shift_offset = rec.shift_offset;
+  fdata->frame_ref_num = block->frame_ref_num[frame_idx];
+  fdata->prev_dis_num = block->prev_dis_num[frame_idx];
+  return TRUE;
+}
+
+void
+frame_data_table_set(frame_data_table *fdt, const frame_data *fdata)
+{
+  fdt_block  *block;
+  fdt_record  old_rec, new_rec;
+  guint       frame_idx;
+
+  ws_assert(fdata->num != 0 && fdata->num <= fdt->count);
+
+  block = (fdt_block *)g_ptr_array_index(fdt->blocks, BLOCK_INDEX(fdata->num - 1));
+  frame_idx = FRAME_INDEX(fdata->num - 1);
+
+  block_set_mutable(fdt, block, frame_idx, fdata);
+
+  /*
+   * The encoded fields rarely change after the frame has been added
+   * (time shifting does that, for example); if they did, re-encode the
+   * block, as the size of the record and the delta of the following
+   * one may change.
+   */
+  block_decode(block, frame_idx, &old_rec);
+  record_from_frame_data(&new_rec, fdata);
+  if (!record_equal(&old_rec, &new_rec)) {
+    fdt_record    recs[FRAMES_PER_BLOCK];
+    fdt_record    prev;
+    const guint8 *p = block->records;
+    guint         nframes, i;
+
+    nframes = (BLOCK_INDEX(fdata->num - 1) == fdt->blocks->len - 1) ?
+                FRAME_INDEX(fdt->count - 1) + 1 : FRAMES_PER_BLOCK;
+    memset(&prev, 0, sizeof prev);
+    for (i = 0; i < nframes; i++) {
+      p = record_decode(p, &recs[i], &prev);
+      prev = recs[i];
+    }
+    recs[frame_idx] = new_rec;
+
+    block->records_len = 0;
+    memset(&prev, 0, sizeof prev);
+    for (i = 0; i < nframes; i++) {
+      block_append_record(block, &recs[i], &prev);
+      prev = recs[i];
+    }
+    if (nframes == FRAMES_PER_BLOCK)
+      block_shrink(block);
+    else
+      fdt->last = recs[nframes - 1];
+  }
+}
+
+gboolean
+frame_data_table_get_flag(const frame_data_table *fdt, guint32 num, frame_data_flag flag)
+{
+  const fdt_block *block;
+
+  if (num == 0 || num > fdt->count)
+    return FALSE;
+
+  block = (const fdt_block *)g_ptr_array_index(fdt->blocks, BLOCK_INDEX(num - 1));
+  return block_get_flag(block, FRAME_INDEX(num - 1), flag);
+}
+
+void
+frame_data_table_set_flag(frame_data_table *fdt, guint32 num, frame_data_flag flag, gboolean value)
+{
+  ws_assert(num != 0 && num <= fdt->count);
+
+  block_set_flag((fdt_block *)g_ptr_array_index(fdt->blocks, BLOCK_INDEX(num - 1)),
+                 FRAME_INDEX(num - 1), flag, value);
+}
+
+guint32
+frame_data_table_count_flag(const frame_data_table *fdt, frame_data_flag flag)
+{
+  guint32 count = 0;
+  guint   i;
+
+  for (i = 0; i < fdt->blocks->len; i++) {
+    const fdt_block *block = (const fdt_block *)g_ptr_array_index(fdt->blocks, i);
+
+    count += (guint32)ws_count_ones(block->flags[flag]);
+  }
+  return count;
+}
+
+gsize
+frame_data_table_memory_size(const frame_data_table *fdt)
+{
+  gsize size = sizeof *fdt + fdt->blocks->len * sizeof(gpointer);
+  guint i;
+
+  for (i = 0; i < fdt->blocks->len; i++) {
+    const fdt_block *block = (const fdt_block *)g_ptr_array_index(fdt->blocks, i);
+
+    size += sizeof *block + block->records_size;
+    if (block->pfd != NULL)
+      size += FRAMES_PER_BLOCK * sizeof(proto_data_store *);
+  }
+  return size;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 2
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=2 tabstop=8 expandtab:
+ * :indentSize=2:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,119 @@
+/** @file
+ * Compact, column-oriented storage for frame_data structures
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __FRAME_DATA_TABLE_H__
+#define __FRAME_DATA_TABLE_H__
+
+#include <epan/frame_data.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * A frame_data_table is an alternative to frame_data_sequence for very
+ * large captures.  Instead of storing a frame_data structure per frame,
+ * it stores the frames in blocks, with the values that never change
+ * after the first pass (file offset, time stamps, lengths) delta- and
+ * varint-encoded, the single-bit flags in per-block bitmaps and the
+ * color filter as a small index.
+ *
+ * Since there is no frame_data structure in the table, callers that need
+ * one get a copy ("view") with frame_data_table_get() and, if they change
+ * it, write it back with frame_data_table_set().  Individual flags can be
+ * read and changed without materializing the whole structure.
+ */
+typedef struct _frame_data_table frame_data_table;
+
+/** Bits of frame_data that are stored as per-frame bitmaps */
+typedef enum {
+  FRAME_DATA_FLAG_PASSED_DFILTER,
+  FRAME_DATA_FLAG_DEPENDENT_OF_DISPLAYED,
+  FRAME_DATA_FLAG_ENCODING,
+  FRAME_DATA_FLAG_VISITED,
+  FRAME_DATA_FLAG_MARKED,
+  FRAME_DATA_FLAG_REF_TIME,
+  FRAME_DATA_FLAG_IGNORED,
+  FRAME_DATA_FLAG_HAS_TS,
+  FRAME_DATA_FLAG_HAS_MODIFIED_BLOCK,
+  FRAME_DATA_FLAG_NEED_COLORIZE,
+  FRAME_DATA_NUM_FLAGS
+} frame_data_flag;
+
+WS_DLL_PUBLIC frame_data_table *frame_data_table_new(void);
+
+/*
+ * Free a frame_data_table, including the per-frame proto data of the
+ * frames in it.
+ */
+WS_DLL_PUBLIC void frame_data_table_free(frame_data_table *fdt);
+
+/*
+ * Number of frames in the table.
+ */
+WS_DLL_PUBLIC guint32 frame_data_table_count(const frame_data_table *fdt);
+
+/*
+ * Append a frame to the table.  fdata->num must be the number of frames
+ * in the table plus one.  The table takes ownership of fdata->pfd.
+ */
+WS_DLL_PUBLIC void frame_data_table_add(frame_data_table *fdt,
+    const frame_data *fdata);
+
+/*
+ * Fill in *fdata with the frame_data for the specified frame number.
+ * Returns FALSE if there is no such frame.
+ */
+WS_DLL_PUBLIC gboolean frame_data_table_get(const frame_data_table *fdt,
+    guint32 num, frame_data *fdata);
+
+/*
+ * Store a (possibly modified) frame_data, previously obtained with
+ * frame_data_table_get(), back into the table.
+ */
+WS_DLL_PUBLIC void frame_data_table_set(frame_data_table *fdt,
+    const frame_data *fdata);
+
+WS_DLL_PUBLIC gboolean frame_data_table_get_flag(const frame_data_table *fdt,
+    guint32 num, frame_data_flag flag);
+
+WS_DLL_PUBLIC void frame_data_table_set_flag(frame_data_table *fdt,
+    guint32 num, frame_data_flag flag, gboolean value);
+
+/*
+ * Number of frames in the table that have the given flag set.
+ */
+WS_DLL_PUBLIC guint32 frame_data_table_count_flag(const frame_data_table *fdt,
+    frame_data_flag flag);
+
+/*
+ * Approximate number of bytes of memory used by the table, not counting
+ * per-frame proto data and color filters.
+ */
+WS_DLL_PUBLIC gsize frame_data_table_memory_size(const frame_data_table *fdt);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __FRAME_DATA_TABLE_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 2
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=2 tabstop=8 expandtab:
+ * :indentSize=2:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,223 @@
+/* frame_data_table_test.c
+ * Tests for the compact frame_data table
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+#undef G_DISABLE_ASSERT
+
+#include <string.h>
+#include <glib.h>
+
+#include <epan/frame_data.h>
+#include "frame_data_table.h"
+
+#define NUM_TEST_FRAMES 1000
+
+/* Some distinct, never dereferenced, color filter pointers. */
+static const int color_filter_storage[3];
+#define TEST_COLOR_FILTER(i) ((const struct _color_filter *)&color_filter_storage[i])
+
+static void
+make_frame(frame_data *fdata, guint32 num)
+{
+  memset(fdata, 0, sizeof *fdata);
+  fdata->num = num;
+  fdata->pkt_len = 60 + (num * 37) % 1454;
+  fdata->cap_len = (num % 7 == 0) ? 64 : fdata->pkt_len;
+  fdata->cum_bytes = num * 1000;
+  fdata->file_off = 24 + (gint64)num * 1530;
+  fdata->abs_ts.secs = 1600000000 + num / 10;
+  fdata->abs_ts.nsecs = (num * 123457) % 1000000000;
+  /* Time going backwards now and then */
+  if (num % 97 == 0)
+    fdata->abs_ts.secs -= 3600;
+  fdata->tsprec = WTAP_TSPREC_USEC;
+  fdata->has_ts = 1;
+  fdata->passed_dfilter = num % 2;
+  fdata->marked = (num % 5 == 0);
+  fdata->ignored = (num % 11 == 0);
+  fdata->subnum = (num % 13 == 0) ? 2 : 0;
+  fdata->color_filter = (num % 3 == 0) ? NULL : TEST_COLOR_FILTER(num % 3);
+  fdata->frame_ref_num = (num > 1) ? 1 : 0;
+  fdata->prev_dis_num = num - 1;
+}
+
+static void
+check_frame(const frame_data *expected, const frame_data *actual)
+{
+  g_assert_cmpuint(actual->num, ==, expected->num);
+  g_assert_cmpuint(actual->pkt_len, ==, expected->pkt_len);
+  g_assert_cmpuint(actual->cap_len, ==, expected->cap_len);
+  g_assert_cmpuint(actual->cum_bytes, ==, expected->cum_bytes);
+  g_assert_cmpint(actual->file_off, ==, expected->file_off);
+  g_assert_true(actual->pfd == expected->pfd);
+  g_assert_true(actual->color_filter == expected->color_filter);
+  g_assert_cmpuint(actual->subnum, ==, expected->subnum);
+  g_assert_cmpuint(actual->passed_dfilter, ==, expected->passed_dfilter);
+  g_assert_cmpuint(actual->marked, ==, expected->marked);
+  g_assert_cmpuint(actual->ignored, ==, expected->ignored);
+  g_assert_cmpuint(actual->ref_time, ==, expected->ref_time);
+  g_assert_cmpuint(actual->has_ts, ==, expected->has_ts);
+  g_assert_cmpuint(actual->tsprec, ==, expected->tsprec);
+  g_assert_cmpint(actual->abs_ts.secs, ==, expected->abs_ts.secs);
+  g_assert_cmpint(actual->abs_ts.nsecs, ==, expected->abs_ts.nsecs);
+  g_assert_cmpint(actual->shift_offset.secs, ==, expected->shift_offset.secs);
+  g_assert_cmpint(actual->shift_offset.nsecs, ==, expected->shift_offset.nsecs);
+  g_assert_cmpuint(actual->frame_ref_num, ==, expected->frame_ref_num);
+  g_assert_cmpuint(actual->prev_dis_num, ==, expected->prev_dis_num);
+}
+
+static frame_data_table *
+make_table(void)
+{
+  frame_data_table *fdt = frame_data_table_new();
+  frame_data fdata;
+  guint32 num;
+
+  for (num = 1; num <= NUM_TEST_FRAMES; num++) {
+    make_frame(&fdata, num);
+    frame_data_table_add(fdt, &fdata);
+  }
+  return fdt;
+}
+
+static void
+frame_data_table_test_roundtrip(void)
+{
+  frame_data_table *fdt = make_table();
+  frame_data expected, actual;
+  guint32 num;
+
+  g_assert_cmpuint(frame_data_table_count(fdt), ==, NUM_TEST_FRAMES);
+  g_assert_false(frame_data_table_get(fdt, 0, &actual));
+  g_assert_false(frame_data_table_get(fdt, NUM_TEST_FRAMES + 1, &actual));
+
+  /* Backwards, so that we don't only test sequential access. */
+  for (num = NUM_TEST_FRAMES; num >= 1; num--) {
+    make_frame(&expected, num);
+    g_assert_true(frame_data_table_get(fdt, num, &actual));
+    check_frame(&expected, &actual);
+  }
+
+  /* It has to be smaller than the structures it replaces. */
+  g_assert_cmpuint(frame_data_table_memory_size(fdt), <, NUM_TEST_FRAMES * sizeof(frame_data) / 2);
+
+  frame_data_table_free(fdt);
+}
+
+static void
+frame_data_table_test_flags(void)
+{
+  frame_data_table *fdt = make_table();
+  frame_data fdata;
+
+  g_assert_cmpuint(frame_data_table_count_flag(fdt, FRAME_DATA_FLAG_PASSED_DFILTER), ==, NUM_TEST_FRAMES / 2);
+  g_assert_cmpuint(frame_data_table_count_flag(fdt, FRAME_DATA_FLAG_MARKED), ==, NUM_TEST_FRAMES / 5);
+  g_assert_cmpuint(frame_data_table_count_flag(fdt, FRAME_DATA_FLAG_REF_TIME), ==, 0);
+
+  g_assert_false(frame_data_table_get_flag(fdt, 64, FRAME_DATA_FLAG_REF_TIME));
+  frame_data_table_set_flag(fdt, 64, FRAME_DATA_FLAG_REF_TIME, TRUE);
+  g_assert_true(frame_data_table_get_flag(fdt, 64, FRAME_DATA_FLAG_REF_TIME));
+  g_assert_false(frame_data_table_get_flag(fdt, 63, FRAME_DATA_FLAG_REF_TIME));
+  g_assert_false(frame_data_table_get_flag(fdt, 65, FRAME_DATA_FLAG_REF_TIME));
+  g_assert_cmpuint(frame_data_table_count_flag(fdt, FRAME_DATA_FLAG_REF_TIME), ==, 1);
+
+  g_assert_true(frame_data_table_get(fdt, 64, &fdata));
+  g_assert_cmpuint(fdata.ref_time, ==, 1);
+
+  frame_data_table_set_flag(fdt, 64, FRAME_DATA_FLAG_REF_TIME, FALSE);
+  g_assert_cmpuint(frame_data_table_count_flag(fdt, FRAME_DATA_FLAG_REF_TIME), ==, 0);
+
+  frame_data_table_free(fdt);
+}
+
+static void
+frame_data_table_test_set(void)
+{
+  frame_data_table *fdt = make_table();
+  frame_data expected, actual;
+  guint32 num;
+
+  /* Fields that are stored as is. */
+  g_assert_true(frame_data_table_get(fdt, 100, &actual));
+  actual.cum_bytes = 42;
+  actual.prev_dis_num = 17;
+  actual.color_filter = TEST_COLOR_FILTER(0);
+  actual.visited = 1;
+  frame_data_table_set(fdt, &actual);
+  expected = actual;
+  g_assert_true(frame_data_table_get(fdt, 100, &actual));
+  check_frame(&expected, &actual);
+  g_assert_cmpuint(actual.visited, ==, 1);
+
+  /* Fields that are encoded, in a full block and in the last one. */
+  for (num = 1; num <= NUM_TEST_FRAMES; num += 333) {
+    g_assert_true(frame_data_table_get(fdt, num, &actual));
+    actual.shift_offset.secs = -86400;
+    actual.shift_offset.nsecs = 5;
+    actual.abs_ts.secs -= 86400;
+    actual.pkt_len = 100000;
+    actual.subnum = 0;
+    frame_data_table_set(fdt, &actual);
+  }
+  for (num = 1; num <= NUM_TEST_FRAMES; num++) {
+    make_frame(&expected, num);
+    if (num == 100) {
+      expected.cum_bytes = 42;
+      expected.prev_dis_num = 17;
+      expected.color_filter = TEST_COLOR_FILTER(0);
+    }
+    if (num % 333 == 1) {
+      expected.shift_offset.secs = -86400;
+      expected.shift_offset.nsecs = 5;
+      expected.abs_ts.secs -= 86400;
+      expected.pkt_len = 100000;
+      expected.subnum = 0;
+    }
+    g_assert_true(frame_data_table_get(fdt, num, &actual));
+    check_frame(&expected, &actual);
+  }
+
+  /* Appending after rewriting the last block must still work. */
+  make_frame(&expected, NUM_TEST_FRAMES + 1);
+  frame_data_table_add(fdt, &expected);
+  g_assert_true(frame_data_table_get(fdt, NUM_TEST_FRAMES + 1, &actual));
+  check_frame(&expected, &actual);
+
+  frame_data_table_free(fdt);
+}
+
+int
+main(int argc, char **argv)
+{
+  int result;
+
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/frame_data_table/roundtrip", frame_data_table_test_roundtrip);
+  g_test_add_func("/frame_data_table/flags", frame_data_table_test_flags);
+  g_test_add_func("/frame_data_table/set", frame_data_table_test_set);
+
+  result = g_test_run();
+
+  return result;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 2
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=2 tabstop=8 expandtab:
+ * :indentSize=2:tabSize=8:noTabs=true:
+ */
@@ -163,6 +163,9 @@ struct heur_dissector_list {
 
 static GHashTable *heur_dissector_lists = NULL;
 
+/* Number of heuristic dissectors registered so far */
+static guint heur_dissector_registrations = 0;
+
 /* Name hashtables for fast detection of duplicate names */
 static GHashTable* heuristic_short_names  = NULL;
 
@@ -310,6 +313,34 @@ register_shutdown_routine(void (*func)(void))
 	shutdown_routines = g_slist_prepend(shutdown_routines, (gpointer)func);
 }
 
+static gint
+heur_dissector_compare_registration(gconstpointer a, gconstpointer b)
+{
+	const heur_dtbl_entry_t *entry_a = (const heur_dtbl_entry_t *)a;
+	const heur_dtbl_entry_t *entry_b = (const heur_dtbl_entry_t *)b;
+
+	/* Heuristic dissectors are prepended to their list when registered. */
+	return (entry_a->registration < entry_b->registration) ? 1 :
+	    (entry_a->registration > entry_b->registration) ? -1 : 0;
+}
+
+static void
+reset_heur_dissector_list(gpointer key _U_, gpointer value, gpointer user_data _U_)
+{
+	heur_dissector_list_t sub_dissectors = (heur_dissector_list_t)value;
+	GSList *entry;
+
+	for (entry = sub_dissectors->dissectors; entry != NULL; entry = g_slist_next(entry)) {
+		heur_dtbl_entry_t *hdtbl_entry = (heur_dtbl_entry_t *)entry->data;
+
+		hdtbl_entry->tried = 0;
+		hdtbl_entry->accepted = 0;
+	}
+
+	sub_dissectors->dissectors = g_slist_sort(sub_dissectors->dissectors,
+	    heur_dissector_compare_registration);
+}
+
 /* Initialize all data structures used for dissection. */
 void
 init_dissection(void)
@@ -334,6 +365,14 @@ init_dissection(void)
 
 	/* Initialize the expert infos */
 	expert_packet_init();
+
+	/*
+	 * The heuristic hit counts are per capture file, and so is the
+	 * order of the heuristic dissectors they led to: start again from
+	 * the registration order, which is also the order kept if the
+	 * "protocols.pin_heuristic_order" preference is set.
+	 */
+	g_hash_table_foreach(heur_dissector_lists, reset_heur_dissector_list, NULL);
 }
 
 void
@@ -2758,6 +2797,9 @@ heur_dissector_add(const char *name, heur_dissector_t dissector, const char *dis
 	hdtbl_entry->short_name = g_strdup(internal_name);
 	hdtbl_entry->list_name = g_strdup(name);
 	hdtbl_entry->enabled   = (enable == HEURISTIC_ENABLE);
+	hdtbl_entry->tried     = 0;
+	hdtbl_entry->accepted  = 0;
+	hdtbl_entry->registration = heur_dissector_registrations++;
 
 	/* do the table insertion */
 	g_hash_table_insert(heuristic_short_names, (gpointer)hdtbl_entry->short_name, hdtbl_entry);
@@ -2881,6 +2923,7 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 
 		pinfo->heur_list_name = hdtbl_entry->list_name;
 
+		hdtbl_entry->tried++;
 		len = (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
 		if (hdtbl_entry->protocol != NULL &&
 			(len == 0 || (tree && saved_tree_count == tree->tree_data->count))) {
@@ -2904,11 +2947,21 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 		}
 		if (len) {
 			*heur_dtbl_entry = hdtbl_entry;
+			hdtbl_entry->accepted++;
 
-			/* Bubble the matched entry to the top for faster search next time. */
-			if (prev_entry != NULL) {
-				sub_dissectors->dissectors = g_slist_remove_link(sub_dissectors->dissectors, entry);
-				sub_dissectors->dissectors = g_slist_concat(entry, sub_dissectors->dissectors);
+			/*
+			 * Move the matched entry one step towards the head of
+			 * the list if it now accepted more packets than the
+			 * one before it, so that the list converges to being
+			 * sorted by hit count and the most successful
+			 * heuristics are tried first.  Unlike moving it
+			 * straight to the head, this doesn't let a single hit
+			 * of a rare protocol push back a common one.
+			 */
+			if (prev_entry != NULL && !prefs.pin_heuristic_order &&
+			    ((heur_dtbl_entry_t *)prev_entry->data)->accepted < hdtbl_entry->accepted) {
+				entry->data = prev_entry->data;
+				prev_entry->data = hdtbl_entry;
 			}
 			status = TRUE;
 			break;
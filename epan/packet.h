@@ -453,6 +453,9 @@ typedef struct heur_dtbl_entry {
 	const gchar *display_name;     /* the string used to present heuristic to user */
 	gchar *short_name;     /* string used for "internal" use to uniquely identify heuristic */
 	gboolean enabled;
+	guint64 tried;         /* number of times the dissector was called in this capture */
+	guint64 accepted;      /* number of times it accepted the packet */
+	guint registration;    /* order in which the dissector was registered */
 } heur_dtbl_entry_t;
 
 /** A protocol uses this function to register a heuristic sub-dissector list.
@@ -498,6 +501,12 @@ WS_DLL_PUBLIC gboolean has_heur_dissector_list(const gchar *name);
  *  until we find one that recognizes the protocol.
  *  Call this while the parent dissector running.
  *
+ *  The number of times each dissector was tried and accepted the packet is
+ *  counted in its heur_dtbl_entry_t, and dissectors that accept more packets
+ *  are moved ahead of those that accept fewer, so that the common case costs
+ *  as few failed attempts as possible; see the "protocols.pin_heuristic_order"
+ *  preference to keep the registration order instead.
+ *
  * @param sub_dissectors the sub-dissector list
  * @param tvb the tvbuff with the (remaining) packet data
  * @param pinfo the packet info of this packet (additional info)
@@ -3693,6 +3693,37 @@ prefs_register_modules(void)
                                    "Currently ICMP and ICMPv6 use this preference to add VLAN ID to conversation tracking, and IPv4 uses this preference to take VLAN ID into account during reassembly",
                                    &prefs.strict_conversation_tracking_heuristics);
 
+    prefs_register_bool_preference(protocols_module, "pin_heuristic_order",
+                                   "Keep heuristic dissectors in registration order",
+                                   "Try heuristic dissectors always in the same order instead of trying "
+                                   "first the ones that recognized the most packets so far. "
+                                   "This makes dissection slower, but more reproducible when several heuristic "
+                                   "dissectors can recognize the same packets.",
+                                   &prefs.pin_heuristic_order);
+
+    register_string_like_preference(protocols_module, "filter_index_fields",
+        "Fields to index for display filters",
+        "Comma-separated list of fields whose values are indexed when a capture file is read. "
+        "Display filters that compare these fields with constants only dissect the frames "
+        "that the index selects. Frame number fields aren't indexed. This uses more memory "
+        "while the file is open.",
+        &prefs.filter_index_fields, PREF_STRING, NULL, TRUE);
+
+    prefs_register_bool_preference(protocols_module, "filter_selectivity_feedback",
+                                   "Order display filter tests by observed pass rates",
+                                   "Count how often the tests of a display filter pass while it is applied "
+                                   "to a capture file, and use the counts to evaluate the tests that are most "
+                                   "likely to decide the result first when the filter is compiled again.",
+                                   &prefs.filter_selectivity_feedback);
+
+    register_string_like_preference(protocols_module, "first_pass_conversation_tables",
+        "Conversation tables to fill while reading",
+        "Comma-separated list of conversation table names (e.g. \"Ethernet,IPv4,TCP,UDP\") whose "
+        "conversations and endpoints are counted when a capture file is read, so that "
+        "showing them doesn't need another pass over the file. "
+        "This uses more memory while the file is open.",
+        &prefs.first_pass_conversation_tables, PREF_STRING, NULL, TRUE);
+
     /* Obsolete preferences
      * These "modules" were reorganized/renamed to correspond to their GUI
      * configuration screen within the preferences dialog
@@ -4202,6 +4233,12 @@ pre_init_prefs(void)
     prefs.st_sort_showfullname = FALSE;
     prefs.display_hidden_proto_items = FALSE;
     prefs.display_byte_fields_with_spaces = FALSE;
+    prefs.pin_heuristic_order = FALSE;
+    g_free(prefs.filter_index_fields);
+    prefs.filter_index_fields = g_strdup("");
+    prefs.filter_selectivity_feedback = FALSE;
+    g_free(prefs.first_pass_conversation_tables);
+    prefs.first_pass_conversation_tables = g_strdup("");
 
     /* set the default values for the io graph dialog */
     prefs.gui_io_graph_automatic_update = TRUE;
@@ -213,6 +213,10 @@ typedef struct _e_prefs {
   gboolean     enable_incomplete_dissectors_check;
   gboolean     incomplete_dissectors_check_debug;
   gboolean     strict_conversation_tracking_heuristics;
+  gboolean     pin_heuristic_order;
+  gchar       *filter_index_fields;
+  gboolean     filter_selectivity_feedback;
+  gchar       *first_pass_conversation_tables;
   gboolean     filter_expressions_old;  /* TRUE if old filter expressions preferences were loaded. */
   gboolean     gui_update_enabled;
   software_update_channel_e gui_update_channel;
@@ -419,6 +419,20 @@ static header_field_info *same_name_hfinfo;
 /* Hash table protocol aliases. const char * -> const char * */
 static GHashTable *gpa_protocol_aliases = NULL;
 
+/*
+ * Compiled lookups for the value_string, val64_string and range_string
+ * arrays of registered fields, built once at registration time and
+ * shared between all fields using the same array.
+ */
+struct _hf_strings_index {
+	const void         *strings;   /* the array the index was built from */
+	value_string_index *vsi;
+	guint               ref_count;
+};
+
+/* Hash table of strings array -> struct _hf_strings_index * */
+static GHashTable *gpa_strings_index = NULL;
+
 /*
  * We're called repeatedly with the same field name when sorting a column.
  * Cache our last gpa_name_map hit for faster lookups.
@@ -431,6 +445,16 @@ static void save_same_name_hfinfo(gpointer data)
 	same_name_hfinfo = (header_field_info*)data;
 }
 
+static void free_hf_strings_index(gpointer data)
+{
+	struct _hf_strings_index *hsi = (struct _hf_strings_index *)data;
+
+	value_string_index_free(hsi->vsi);
+	g_free(hsi);
+}
+
+static void unref_hf_strings_index(header_field_info *hfinfo);
+
 /* Points to the first element of an array of bits, indexed by
    a subtree item type; that array element is TRUE if subtrees of
    an item of that type are to be expanded. */
@@ -534,6 +558,7 @@ proto_init(GSList *register_all_plugin_protocols_list,
 	gpa_hfinfo.hfi           = NULL;
 	gpa_name_map             = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, save_same_name_hfinfo);
 	gpa_protocol_aliases     = g_hash_table_new(g_str_hash, g_str_equal);
+	gpa_strings_index        = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, free_hf_strings_index);
 	deregistered_fields      = g_ptr_array_new();
 	deregistered_data        = g_ptr_array_new();
 	deregistered_slice       = g_ptr_array_new();
@@ -610,6 +635,10 @@ proto_cleanup_base(void)
 		g_hash_table_destroy(gpa_protocol_aliases);
 		gpa_protocol_aliases = NULL;
 	}
+	if (gpa_strings_index) {
+		g_hash_table_destroy(gpa_strings_index);
+		gpa_strings_index = NULL;
+	}
 	g_free(last_field_name);
 	last_field_name = NULL;
 
@@ -8094,6 +8123,7 @@ free_deregistered_field (gpointer data, gpointer user_data _U_)
 	g_free((char *)hfi->abbrev);
 	g_free((char *)hfi->blurb);
 
+	unref_hf_strings_index(hfi);
 	proto_free_field_strings(hfi->type, hfi->display, hfi->strings);
 
 	if (hfi->parent == -1)
@@ -8767,6 +8797,66 @@ register_string_errors(void)
 	proto_set_cant_toggle(proto_string_errors);
 }
 
+/*
+ * Get (building it if necessary) the compiled lookup for the strings
+ * of a field, or NULL if the field's strings aren't something we index
+ * or aren't worth indexing.
+ */
+static struct _hf_strings_index *
+ref_hf_strings_index(const header_field_info *hfinfo)
+{
+	struct _hf_strings_index *hsi;
+	value_string_index *vsi;
+
+	/* Only VALS(), VALS64() and RVALS() strings: those of frame numbers
+	 * are their FRAMENUM_TYPE(), and those of unit strings and custom
+	 * fields aren't arrays of values. */
+	if (hfinfo->strings == NULL ||
+	    !(IS_FT_INT(hfinfo->type) || IS_FT_UINT(hfinfo->type)) ||
+	    hfinfo->type == FT_FRAMENUM ||
+	    (hfinfo->display & (BASE_EXT_STRING|BASE_UNIT_STRING|BASE_PROTOCOL_INFO)) ||
+	    FIELD_DISPLAY(hfinfo->display) == BASE_CUSTOM)
+		return NULL;
+
+	hsi = (struct _hf_strings_index *)g_hash_table_lookup(gpa_strings_index, hfinfo->strings);
+	if (hsi == NULL) {
+		if (hfinfo->display & BASE_RANGE_STRING)
+			vsi = range_string_index_new((const range_string *)hfinfo->strings);
+		else if (hfinfo->display & BASE_VAL64_STRING)
+			vsi = val64_string_index_new((const val64_string *)hfinfo->strings);
+		else if (IS_FT_INT32(hfinfo->type) || IS_FT_UINT32(hfinfo->type))
+			vsi = value_string_index_new((const value_string *)hfinfo->strings);
+		else
+			vsi = NULL;	/* 64-bit field with a 32-bit value_string */
+
+		if (vsi == NULL)
+			return NULL;
+
+		hsi = g_new(struct _hf_strings_index, 1);
+		hsi->strings = hfinfo->strings;
+		hsi->vsi = vsi;
+		hsi->ref_count = 0;
+		g_hash_table_insert(gpa_strings_index, (gpointer)hfinfo->strings, hsi);
+	}
+	hsi->ref_count++;
+
+	return hsi;
+}
+
+/* The strings of a deregistered field might be freed and the memory reused. */
+static void
+unref_hf_strings_index(header_field_info *hfinfo)
+{
+	struct _hf_strings_index *hsi = (struct _hf_strings_index *)hfinfo->strings_index;
+
+	hfinfo->strings_index = NULL;
+	if (hsi == NULL)
+		return;
+
+	if (--hsi->ref_count == 0)
+		g_hash_table_remove(gpa_strings_index, hsi->strings);
+}
+
 #define PROTO_PRE_ALLOC_HF_FIELDS_MEM (260000+PRE_ALLOC_EXPERT_FIELDS_MEM)
 static int
 proto_register_field_init(header_field_info *hfinfo, const int parent)
@@ -8777,6 +8867,7 @@ proto_register_field_init(header_field_info *hfinfo, const int parent)
 	hfinfo->parent         = parent;
 	hfinfo->same_name_next = NULL;
 	hfinfo->same_name_prev_id = -1;
+	hfinfo->strings_index  = ref_hf_strings_index(hfinfo);
 
 	/* if we always add and never delete, then id == len - 1 is correct */
 	if (gpa_hfinfo.len >= gpa_hfinfo.allocated_len) {
@@ -9358,6 +9449,10 @@ fill_label_boolean(field_info *fi, gchar *label_str)
 static const char *
 hf_try_val_to_str(guint32 value, const header_field_info *hfinfo)
 {
+	/* The dissector might have replaced the strings after registration. */
+	if (hfinfo->strings_index && hfinfo->strings_index->strings == hfinfo->strings)
+		return try_val_to_str_index(value, hfinfo->strings_index->vsi);
+
 	if (hfinfo->display & BASE_RANGE_STRING)
 		return try_rval_to_str(value, (const range_string *) hfinfo->strings);
 
@@ -9380,6 +9475,9 @@ hf_try_val_to_str(guint32 value, const header_field_info *hfinfo)
 static const char *
 hf_try_val64_to_str(guint64 value, const header_field_info *hfinfo)
 {
+	if (hfinfo->strings_index && hfinfo->strings_index->strings == hfinfo->strings)
+		return try_val_to_str_index(value, hfinfo->strings_index->vsi);
+
 	if (hfinfo->display & BASE_VAL64_STRING) {
 		if (hfinfo->display & BASE_EXT_STRING)
 			return try_val64_to_str_ext(value, (val64_string_ext *) hfinfo->strings);
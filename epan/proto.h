@@ -748,6 +748,7 @@ struct _header_field_info {
     hf_ref_type        ref_type;          /**< is this field referenced by a filter */
     int                same_name_prev_id; /**< ID of previous hfinfo with same abbrev */
     header_field_info *same_name_next;    /**< Link to next hfinfo with same abbrev */
+    const struct _hf_strings_index *strings_index; /**< Compiled lookup for strings, if any */
 };
 
 /**
@@ -755,14 +756,15 @@ struct _header_field_info {
  * _header_field_info. If new fields are added or removed, it should
  * be changed as necessary.
  */
-#define HFILL -1, 0, HF_REF_TYPE_NONE, -1, NULL
+#define HFILL -1, 0, HF_REF_TYPE_NONE, -1, NULL, NULL
 
 #define HFILL_INIT(hf)   \
     (hf).hfinfo.id                = -1;   \
     (hf).hfinfo.parent            = 0;   \
     (hf).hfinfo.ref_type          = HF_REF_TYPE_NONE;   \
     (hf).hfinfo.same_name_prev_id = -1;   \
-    (hf).hfinfo.same_name_next    = NULL;
+    (hf).hfinfo.same_name_next    = NULL;   \
+    (hf).hfinfo.strings_index     = NULL;
 
 /** Used when registering many fields at once, using proto_register_field_array() */
 typedef struct hf_register_info {
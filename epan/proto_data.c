@@ -10,6 +10,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <glib.h>
 
 #include <epan/wmem_scopes.h>
@@ -26,18 +28,30 @@ typedef struct _proto_data {
   void *proto_data;
 } proto_data_t;
 
+/* The items attached to a frame (or to a packet_info) are kept in a
+   single growable array sorted by (proto, key), so that lookups are a
+   binary search and adding an item is at most one reallocation instead
+   of a list node plus an item allocation per entry.  Items added with
+   the same (proto, key) pair are kept in insertion order, and the most
+   recently added one is the one returned by p_get_proto_data() and
+   removed by p_remove_proto_data(), as with the list we used to keep. */
+struct _proto_data_store {
+  guint32      count;
+  guint32      capacity;
+  proto_data_t items[];
+};
+
+#define PROTO_DATA_STORE_INITIAL_CAPACITY 4
+
 static gint
-p_compare(gconstpointer a, gconstpointer b)
+p_compare(const proto_data_t *ap, int proto, guint32 key)
 {
-  const proto_data_t *ap = (const proto_data_t *)a;
-  const proto_data_t *bp = (const proto_data_t *)b;
-
-  if (ap -> proto > bp -> proto) {
+  if (ap->proto > proto) {
     return 1;
-  } else if (ap -> proto == bp -> proto) {
-    if (ap->key > bp->key){
+  } else if (ap->proto == proto) {
+    if (ap->key > key) {
       return 1;
-    } else if (ap -> key == bp -> key) {
+    } else if (ap->key == key) {
       return 0;
     }
     return -1;
@@ -46,53 +60,88 @@ p_compare(gconstpointer a, gconstpointer b)
   }
 }
 
-void
-p_add_proto_data(wmem_allocator_t *tmp_scope, struct _packet_info* pinfo, int proto, guint32 key, void *proto_data)
+/* Returns the index of the first item that sorts after (proto, key). */
+static guint32
+p_upper_bound(const proto_data_store *store, int proto, guint32 key)
 {
-  proto_data_t     *p1;
-  GSList          **proto_list;
-  wmem_allocator_t *scope;
-
-  if (tmp_scope == pinfo->pool) {
-    scope = tmp_scope;
-    proto_list = &pinfo->proto_data;
-  } else if (tmp_scope == wmem_file_scope()) {
-    scope = wmem_file_scope();
-    proto_list = &pinfo->fd->pfd;
-  } else {
-    DISSECTOR_ASSERT(!"invalid wmem scope");
-  }
-
-  p1 = wmem_new(scope, proto_data_t);
+  guint32 lo = 0, hi = store->count;
 
-  p1->proto = proto;
-  p1->key = key;
-  p1->proto_data = proto_data;
+  while (lo < hi) {
+    guint32 mid = lo + (hi - lo) / 2;
 
-  /* Add it to the GSLIST */
-  *proto_list = g_slist_prepend(*proto_list, p1);
+    if (p_compare(&store->items[mid], proto, key) > 0) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return lo;
 }
 
-void *
-p_get_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, guint32 key)
+/* Returns the most recently added item for (proto, key), or NULL. */
+static proto_data_t *
+p_find(proto_data_store *store, int proto, guint32 key)
 {
-  proto_data_t  temp, *p1;
-  GSList       *item;
+  guint32 idx;
 
-  temp.proto = proto;
-  temp.key = key;
-  temp.proto_data = NULL;
+  if (store == NULL)
+    return NULL;
 
+  idx = p_upper_bound(store, proto, key);
+  if (idx > 0 && p_compare(&store->items[idx - 1], proto, key) == 0)
+    return &store->items[idx - 1];
+
+  return NULL;
+}
+
+static proto_data_store **
+p_get_store(wmem_allocator_t *scope, struct _packet_info* pinfo)
+{
   if (scope == pinfo->pool) {
-    item = g_slist_find_custom(pinfo->proto_data, &temp, p_compare);
+    return &pinfo->proto_data;
   } else if (scope == wmem_file_scope()) {
-    item = g_slist_find_custom(pinfo->fd->pfd, &temp, p_compare);
+    return &pinfo->fd->pfd;
   } else {
     DISSECTOR_ASSERT(!"invalid wmem scope");
   }
+  return NULL;
+}
+
+void
+p_add_proto_data(wmem_allocator_t *tmp_scope, struct _packet_info* pinfo, int proto, guint32 key, void *proto_data)
+{
+  proto_data_store **storep = p_get_store(tmp_scope, pinfo);
+  proto_data_store  *store = *storep;
+  guint32            idx;
+
+  if (store == NULL || store->count == store->capacity) {
+    guint32 capacity = store ? store->capacity * 2 : PROTO_DATA_STORE_INITIAL_CAPACITY;
+
+    store = (proto_data_store *)g_realloc(store,
+        sizeof(proto_data_store) + capacity * sizeof(proto_data_t));
+    if (*storep == NULL)
+      store->count = 0;
+    store->capacity = capacity;
+    *storep = store;
+  }
 
-  if (item) {
-    p1 = (proto_data_t *)item->data;
+  idx = p_upper_bound(store, proto, key);
+  if (idx < store->count) {
+    memmove(&store->items[idx + 1], &store->items[idx],
+            (store->count - idx) * sizeof(proto_data_t));
+  }
+  store->items[idx].proto = proto;
+  store->items[idx].key = key;
+  store->items[idx].proto_data = proto_data;
+  store->count++;
+}
+
+void *
+p_get_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, guint32 key)
+{
+  proto_data_t *p1 = p_find(*p_get_store(scope, pinfo), proto, key);
+
+  if (p1) {
     return p1->proto_data;
   }
 
@@ -102,44 +151,45 @@ p_get_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto,
 void
 p_remove_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, guint32 key)
 {
-  proto_data_t  temp;
-  GSList       *item;
-  GSList      **proto_list;
+  proto_data_store *store = *p_get_store(scope, pinfo);
+  proto_data_t     *p1 = p_find(store, proto, key);
 
-  temp.proto = proto;
-  temp.key = key;
-  temp.proto_data = NULL;
+  if (p1) {
+    guint32 idx = (guint32)(p1 - store->items);
 
-  if (scope == pinfo->pool) {
-    item = g_slist_find_custom(pinfo->proto_data, &temp, p_compare);
-    proto_list = &pinfo->proto_data;
-  } else if (scope == wmem_file_scope()) {
-    item = g_slist_find_custom(pinfo->fd->pfd, &temp, p_compare);
-    proto_list = &pinfo->fd->pfd;
-  } else {
-    DISSECTOR_ASSERT(!"invalid wmem scope");
+    store->count--;
+    if (idx < store->count) {
+      memmove(&store->items[idx], &store->items[idx + 1],
+              (store->count - idx) * sizeof(proto_data_t));
+    }
   }
+}
 
-  if (item) {
-    *proto_list = g_slist_remove(*proto_list, item->data);
-  }
+guint
+p_get_proto_data_count(wmem_allocator_t *scope, struct _packet_info* pinfo)
+{
+  proto_data_store *store = *p_get_store(scope, pinfo);
+
+  return store ? store->count : 0;
 }
 
 gchar *
 p_get_proto_name_and_key(wmem_allocator_t *scope, struct _packet_info* pinfo, guint pfd_index){
-  proto_data_t  *temp;
+  proto_data_store *store = *p_get_store(scope, pinfo);
+  proto_data_t     *temp;
 
-  if (scope == pinfo->pool) {
-    temp = (proto_data_t *)g_slist_nth_data(pinfo->proto_data, pfd_index);
-  } else if (scope == wmem_file_scope()) {
-    temp = (proto_data_t *)g_slist_nth_data(pinfo->fd->pfd, pfd_index);
-  } else {
-    DISSECTOR_ASSERT(!"invalid wmem scope");
-  }
+  DISSECTOR_ASSERT(store && pfd_index < store->count);
+  temp = &store->items[pfd_index];
 
   return wmem_strdup_printf(pinfo->pool, "[%s, key %u]",proto_get_protocol_name(temp->proto), temp->key);
 }
 
+void
+p_free_proto_data_store(proto_data_store *store)
+{
+  g_free(store);
+}
+
 #define PROTO_DEPTH_KEY 0x3c233fb5 // printf "0x%02x%02x\n" ${RANDOM} ${RANDOM}
 
 void p_set_proto_depth(struct _packet_info *pinfo, int proto, unsigned depth) {
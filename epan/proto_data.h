@@ -32,6 +32,12 @@ WS_DLL_PUBLIC void *p_get_proto_data(wmem_allocator_t *scope, struct _packet_inf
 WS_DLL_PUBLIC void p_remove_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, guint32 key);
 gchar *p_get_proto_name_and_key(wmem_allocator_t *scope, struct _packet_info* pinfo, guint pfd_index);
 
+/** Number of items in the pinfo->pool or wmem_file_scope() protocol data store */
+guint p_get_proto_data_count(wmem_allocator_t *scope, struct _packet_info* pinfo);
+
+/** Free a protocol data store, as found in frame_data::pfd and packet_info::proto_data */
+void p_free_proto_data_store(struct _proto_data_store *store);
+
 /**
  * Initialize or update a per-protocol and per-packet check for recursion, nesting, cycling, etc.
  *
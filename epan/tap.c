@@ -25,11 +25,10 @@
 
 #include <epan/packet_info.h>
 #include <epan/dfilter/dfilter.h>
+#include <epan/epan_dissect.h>
 #include <epan/tap.h>
 #include <wsutil/wslog.h>
 
-static gboolean tapping_is_active=FALSE;
-
 typedef struct _tap_dissector_t {
 	struct _tap_dissector_t *next;
 	char *name;
@@ -75,8 +74,35 @@ typedef struct _tap_packet_t {
 #define TAP_PACKET_IS_ERROR_PACKET	0x00000001	/* packet being queued is an error packet */
 
 #define TAP_PACKET_QUEUE_LEN 5000
-static tap_packet_t tap_packet_array[TAP_PACKET_QUEUE_LEN];
-static guint tap_packet_index;
+
+/*
+ * The queue of tapped packets belongs to the dissection being done, so
+ * every thread that dissects packets has its own (see tap_init_thread());
+ * the thread that initialized epan uses main_tap_packet_queue.
+ */
+typedef struct _tap_packet_queue_t {
+	gboolean tapping_is_active;
+	guint tap_packet_index;
+	tap_packet_t tap_packet_array[TAP_PACKET_QUEUE_LEN];
+	/* The result of every filter in tap_filter_program for the
+	 * packet being pushed, if filters_evaluated is set. */
+	gboolean filters_evaluated;
+	gboolean *filter_results;
+	guint filter_results_len;
+} tap_packet_queue_t;
+
+static void free_tap_packet_queue(gpointer data);
+
+static tap_packet_queue_t main_tap_packet_queue;
+static GPrivate thread_tap_packet_queue = G_PRIVATE_INIT(free_tap_packet_queue);
+
+static inline tap_packet_queue_t *
+tap_packet_queue(void)
+{
+	tap_packet_queue_t *queue = (tap_packet_queue_t *)g_private_get(&thread_tap_packet_queue);
+
+	return queue ? queue : &main_tap_packet_queue;
+}
 
 typedef struct _tap_listener_t {
 	struct _tap_listener_t *next;
@@ -86,6 +112,7 @@ typedef struct _tap_listener_t {
 	guint flags;
 	gchar *fstring;
 	dfilter_t *code;
+	int filter_idx;		/* filter in tap_filter_program, or -1 */
 	void *tapdata;
 	tap_reset_cb reset;
 	tap_packet_cb packet;
@@ -95,6 +122,18 @@ typedef struct _tap_listener_t {
 
 static tap_listener_t *tap_listener_queue=NULL;
 
+/*
+ * The filters of all the tap listeners compiled into one program, so
+ * that a field used by several filters is read only once per packet,
+ * and listeners with the same filter string share its result.  The
+ * program is run at most once per packet, the first time a listener
+ * with a filter has a tapped packet.  It is rebuilt when the listeners
+ * or their filters change.
+ */
+static dfilter_t *tap_filter_program=NULL;
+static guint tap_filter_count=0;
+static gboolean tap_filters_dirty=TRUE;
+
 static GSList *tap_plugins = NULL;
 
 #ifdef HAVE_PLUGINS
@@ -150,7 +189,29 @@ register_all_tap_listeners(tap_reg_t *tap_reg_listeners)
 void
 tap_init(void)
 {
-	tap_packet_index=0;
+	main_tap_packet_queue.tapping_is_active=FALSE;
+	main_tap_packet_queue.tap_packet_index=0;
+}
+
+void
+tap_init_thread(void)
+{
+	g_private_replace(&thread_tap_packet_queue, g_new0(tap_packet_queue_t, 1));
+}
+
+void
+tap_cleanup_thread(void)
+{
+	g_private_replace(&thread_tap_packet_queue, NULL);
+}
+
+static void
+free_tap_packet_queue(gpointer data)
+{
+	tap_packet_queue_t *queue = (tap_packet_queue_t *)data;
+
+	g_free(queue->filter_results);
+	g_free(queue);
 }
 
 /* **********************************************************************
@@ -228,28 +289,29 @@ register_tap(const char *name)
 void
 tap_queue_packet(int tap_id, packet_info *pinfo, const void *tap_specific_data)
 {
+	tap_packet_queue_t *queue = tap_packet_queue();
 	tap_packet_t *tpt;
 
-	if(!tapping_is_active){
+	if(!queue->tapping_is_active){
 		return;
 	}
 	/*
 	 * XXX - should we allocate this with an ep_allocator,
 	 * rather than having a fixed maximum number of entries?
 	 */
-	if(tap_packet_index >= TAP_PACKET_QUEUE_LEN){
+	if(queue->tap_packet_index >= TAP_PACKET_QUEUE_LEN){
 		ws_warning("Too many taps queued");
 		return;
 	}
 
-	tpt=&tap_packet_array[tap_packet_index];
+	tpt=&queue->tap_packet_array[queue->tap_packet_index];
 	tpt->tap_id=tap_id;
 	tpt->flags = 0;
 	if (pinfo->flags.in_error_pkt)
 		tpt->flags |= TAP_PACKET_IS_ERROR_PACKET;
 	tpt->pinfo=pinfo;
 	tpt->tap_specific_data=tap_specific_data;
-	tap_packet_index++;
+	queue->tap_packet_index++;
 }
 
 
@@ -260,6 +322,61 @@ tap_queue_packet(int tap_id, packet_info *pinfo, const void *tap_specific_data)
  * Functions used by file.c to drive the tap subsystem
  * ********************************************************************** */
 
+/* (Re)build tap_filter_program from the filters of the tap listeners */
+static void
+tap_build_filter_program(void)
+{
+	tap_listener_t *tl;
+	GHashTable *filter_idx;
+	GPtrArray *texts;
+	gpointer idx;
+	gchar *err_msg;
+
+	tap_filters_dirty=FALSE;
+
+	dfilter_free(tap_filter_program);
+	tap_filter_program=NULL;
+	tap_filter_count=0;
+
+	/* Compile each distinct filter string once. */
+	filter_idx=g_hash_table_new(g_str_hash, g_str_equal);
+	texts=g_ptr_array_new();
+	for(tl=tap_listener_queue;tl;tl=tl->next){
+		tl->filter_idx=-1;
+		if(!tl->code || !tl->fstring){
+			continue;
+		}
+		if(!g_hash_table_lookup_extended(filter_idx, tl->fstring, NULL, &idx)){
+			idx=GUINT_TO_POINTER(texts->len);
+			g_hash_table_insert(filter_idx, tl->fstring, idx);
+			g_ptr_array_add(texts, tl->fstring);
+		}
+		tl->filter_idx=GPOINTER_TO_INT(idx);
+	}
+
+	if(texts->len > 0){
+		/* The filters compiled on their own, so this only fails if
+		 * a field went away since (see tap_listeners_dfilter_recompile);
+		 * then every listener applies its own filter. */
+		if(dfilter_compile_rules((const gchar **)texts->pdata, texts->len,
+					&tap_filter_program, &err_msg)){
+			tap_filter_count=texts->len;
+		} else {
+			ws_debug("Could not combine the tap filters: %s", err_msg);
+			g_free(err_msg);
+			tap_filter_program=NULL;
+		}
+	}
+	if(!tap_filter_program){
+		for(tl=tap_listener_queue;tl;tl=tl->next){
+			tl->filter_idx=-1;
+		}
+	}
+
+	g_ptr_array_free(texts, TRUE);
+	g_hash_table_destroy(filter_idx);
+}
+
 void tap_build_interesting (epan_dissect_t *edt)
 {
 	tap_listener_t *tl;
@@ -269,15 +386,43 @@ void tap_build_interesting (epan_dissect_t *edt)
 		return;
 	}
 
+	if(tap_filters_dirty){
+		tap_build_filter_program();
+	}
+
 	/* loop over all tap listeners and build the list of all
 	   interesting hf_fields */
+	if(tap_filter_program){
+		epan_dissect_prime_with_dfilter(edt, tap_filter_program);
+	}
 	for(tl=tap_listener_queue;tl;tl=tl->next){
-		if(tl->code){
+		if(tl->code && tl->filter_idx < 0){
 			epan_dissect_prime_with_dfilter(edt, tl->code);
 		}
 	}
 }
 
+/* See if the packet being pushed passes the filter of a tap listener */
+static gboolean
+tap_listener_filter_passes(tap_packet_queue_t *queue, tap_listener_t *tl,
+			   epan_dissect_t *edt)
+{
+	if(tl->filter_idx < 0){
+		return dfilter_apply_edt(tl->code, edt);
+	}
+
+	if(!queue->filters_evaluated){
+		if(queue->filter_results_len < tap_filter_count){
+			queue->filter_results=g_renew(gboolean, queue->filter_results, tap_filter_count);
+			queue->filter_results_len=tap_filter_count;
+		}
+		dfilter_apply_all_rules(tap_filter_program, edt->tree,
+					queue->filter_results, tap_filter_count);
+		queue->filters_evaluated=TRUE;
+	}
+	return queue->filter_results[tl->filter_idx];
+}
+
 /* This function is used to delete/initialize the tap queue and prime an
    epan_dissect_t with all the filters for tap listeners.
    To free the tap queue, we just prepend the used queue to the free queue.
@@ -285,14 +430,17 @@ void tap_build_interesting (epan_dissect_t *edt)
 void
 tap_queue_init(epan_dissect_t *edt)
 {
+	tap_packet_queue_t *queue;
+
 	/* nothing to do, just return */
 	if(!tap_listener_queue){
 		return;
 	}
 
-	tapping_is_active=TRUE;
+	queue = tap_packet_queue();
+	queue->tapping_is_active=TRUE;
 
-	tap_packet_index=0;
+	queue->tap_packet_index=0;
 
 	tap_build_interesting (edt);
 }
@@ -303,27 +451,31 @@ tap_queue_init(epan_dissect_t *edt)
 void
 tap_push_tapped_queue(epan_dissect_t *edt)
 {
+	tap_packet_queue_t *queue = tap_packet_queue();
 	tap_packet_t *tp;
 	tap_listener_t *tl;
 	guint i;
 
 	/* nothing to do, just return */
-	if(!tapping_is_active){
+	if(!queue->tapping_is_active){
 		return;
 	}
 
-	tapping_is_active=FALSE;
+	queue->tapping_is_active=FALSE;
 
 	/* nothing to do, just return */
-	if(!tap_packet_index){
+	if(!queue->tap_packet_index){
 		return;
 	}
 
+	/* The filters are applied when a listener first needs them. */
+	queue->filters_evaluated=FALSE;
+
 	/* loop over all tap listeners and call the listener callback
 	   for all packets that match the filter. */
-	for(i=0;i<tap_packet_index;i++){
+	for(i=0;i<queue->tap_packet_index;i++){
 		for(tl=tap_listener_queue;tl;tl=tl->next){
-			tp=&tap_packet_array[i];
+			tp=&queue->tap_packet_array[i];
 			/* Don't tap the packet if it's an "error packet"
 			 * unless the listener has requested that we do so.
 			 */
@@ -349,7 +501,7 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 					 * packet passes.
 					 */
 					if(tl->code){
-						if (!dfilter_apply_edt(tl->code, edt)){
+						if (!tap_listener_filter_passes(queue, tl, edt)){
 							/* The packet didn't
 							 * pass the filter. */
 							continue;
@@ -398,22 +550,23 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 const void *
 fetch_tapped_data(int tap_id, int idx)
 {
+	tap_packet_queue_t *queue = tap_packet_queue();
 	tap_packet_t *tp;
 	guint i;
 
 	/* nothing to do, just return */
-	if(!tapping_is_active){
+	if(!queue->tapping_is_active){
 		return NULL;
 	}
 
 	/* nothing to do, just return */
-	if(!tap_packet_index){
+	if(!queue->tap_packet_index){
 		return NULL;
 	}
 
 	/* loop over all tapped packets and return the one with index idx */
-	for(i=0;i<tap_packet_index;i++){
-		tp=&tap_packet_array[i];
+	for(i=0;i<queue->tap_packet_index;i++){
+		tp=&queue->tap_packet_array[i];
 		if(tp->tap_id==tap_id){
 			if(!idx--){
 				return tp->tap_specific_data;
@@ -563,6 +716,7 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 	}
 	tl->fstring=g_strdup(fstring);
 	tl->code=code;
+	tl->filter_idx=-1;
 
 	tl->tap_id=tap_id;
 	tl->tapdata=tapdata;
@@ -573,6 +727,7 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 	tl->next=tap_listener_queue;
 
 	tap_listener_queue=tl;
+	tap_filters_dirty=TRUE;
 
 	return NULL;
 }
@@ -608,6 +763,8 @@ set_tap_dfilter(void *tapdata, const char *fstring)
 			dfilter_free(tl->code);
 			tl->code=NULL;
 		}
+		tl->filter_idx=-1;
+		tap_filters_dirty=TRUE;
 		tl->needs_redraw=TRUE;
 		g_free(tl->fstring);
 		if(fstring){
@@ -655,6 +812,7 @@ tap_listeners_dfilter_recompile(void)
 		}
 		tl->code=code;
 	}
+	tap_filters_dirty=TRUE;
 }
 
 /* this function removes a tap listener
@@ -686,6 +844,7 @@ remove_tap_listener(void *tapdata)
 		}
 	}
 	free_tap_listener(tl);
+	tap_filters_dirty=TRUE;
 }
 
 /*
@@ -770,6 +929,14 @@ void tap_cleanup(void)
 	}
 	tap_listener_queue = NULL;
 
+	dfilter_free(tap_filter_program);
+	tap_filter_program = NULL;
+	tap_filter_count = 0;
+	tap_filters_dirty = TRUE;
+	g_free(main_tap_packet_queue.filter_results);
+	main_tap_packet_queue.filter_results = NULL;
+	main_tap_packet_queue.filter_results_len = 0;
+
 	while(head_dl){
 		elem_dl = head_dl;
 		head_dl = head_dl->next;
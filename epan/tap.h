@@ -71,6 +71,11 @@ WS_DLL_PUBLIC void register_all_tap_listeners(tap_reg_t *tap_reg_listeners);
 
 extern void tap_init(void);
 
+/** Give the calling thread its own queue of tapped packets; see
+ *  epan_init_thread(). */
+extern void tap_init_thread(void);
+extern void tap_cleanup_thread(void);
+
 /** This function registers that a dissector has the packet tap ability
  *  available.  The name parameter is the name of this tap and extensions can
  *  use open_tap(char *name,... to specify that it wants to receive packets/
@@ -0,0 +1,265 @@
+/* tap_test.c
+ * Tests for the filters of the tap listeners, which are evaluated together
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+#undef G_DISABLE_ASSERT
+
+#include <string.h>
+#include <glib.h>
+
+#include <wiretap/wtap.h>
+#include <epan/epan.h>
+#include <epan/epan_dissect.h>
+#include <epan/frame_data.h>
+#include <epan/tap.h>
+
+#define NUM_TEST_FRAMES 16
+
+/* A listener on the "frame" tap, with the frames it got as a bit mask. */
+typedef struct {
+  const char *filter;
+  guint32 tapped;
+} test_listener_t;
+
+static epan_t *test_epan;
+
+static const nstime_t *
+test_get_frame_ts(struct packet_provider_data *prov _U_, guint32 frame_num _U_)
+{
+  static nstime_t empty;
+
+  return &empty;
+}
+
+static tap_packet_status
+test_tap_packet(void *tapdata, packet_info *pinfo, epan_dissect_t *edt _U_, const void *data _U_)
+{
+  test_listener_t *l = (test_listener_t *)tapdata;
+
+  /* Every frame is pushed once. */
+  g_assert_false(l->tapped & (1U << pinfo->num));
+  l->tapped |= 1U << pinfo->num;
+
+  return TAP_PACKET_DONT_REDRAW;
+}
+
+static void
+test_register(test_listener_t *l, const char *filter)
+{
+  GString *error;
+
+  l->filter = filter;
+  l->tapped = 0;
+  error = register_tap_listener("frame", l, filter, 0, NULL, test_tap_packet, NULL, NULL);
+  g_assert_null(error);
+}
+
+static void
+test_set_filter(test_listener_t *l, const char *filter)
+{
+  GString *error;
+
+  l->filter = filter;
+  error = set_tap_dfilter(l, filter);
+  g_assert_null(error);
+}
+
+/* Dissect frames 1 to NUM_TEST_FRAMES with the taps */
+static void
+test_dissect_frames(test_listener_t *listeners, guint num_listeners)
+{
+  static const guint8 frame[] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08 };
+  epan_dissect_t *edt;
+  guint32 num;
+  guint i;
+
+  for (i = 0; i < num_listeners; i++)
+    listeners[i].tapped = 0;
+
+  /* The filters need a tree. */
+  edt = epan_dissect_new(test_epan, TRUE, FALSE);
+
+  for (num = 1; num <= NUM_TEST_FRAMES; num++) {
+    wtap_rec rec;
+    frame_data fdata;
+
+    memset(&rec, 0, sizeof rec);
+    rec.rec_type = REC_TYPE_PACKET;
+    rec.rec_header.packet_header.caplen = sizeof frame;
+    rec.rec_header.packet_header.len = sizeof frame;
+    rec.rec_header.packet_header.pkt_encap = WTAP_ENCAP_UNKNOWN;
+    rec.presence_flags = WTAP_HAS_CAP_LEN;
+
+    frame_data_init(&fdata, num, &rec, 0, 0);
+    epan_dissect_run_with_taps(edt, WTAP_FILE_TYPE_SUBTYPE_UNKNOWN, &rec,
+                               tvb_new_real_data(frame, sizeof frame, sizeof frame),
+                               &fdata, NULL);
+    epan_dissect_reset(edt);
+    frame_data_destroy(&fdata);
+  }
+
+  epan_dissect_free(edt);
+}
+
+/* The frames that pass the filters used below */
+static guint32
+test_expected(const char *filter)
+{
+  guint32 expected = 0;
+  guint32 num;
+
+  for (num = 1; num <= NUM_TEST_FRAMES; num++) {
+    gboolean even = (num % 2 == 0 && num <= 8);
+
+    if (filter == NULL ||
+        (strcmp(filter, "frame.number in {2 4 6 8}") == 0 && even) ||
+        (strcmp(filter, "frame.number > 6") == 0 && num > 6) ||
+        (strcmp(filter, "frame.number > 6 && frame.number in {2 4 6 8}") == 0 && num > 6 && even) ||
+        (strcmp(filter, "frame.number < 3") == 0 && num < 3) ||
+        (strcmp(filter, "!(frame.number > 6)") == 0 && !(num > 6)))
+      expected |= 1U << num;
+  }
+
+  return expected;
+}
+
+static void
+test_check(test_listener_t *listeners, guint num_listeners)
+{
+  guint i;
+
+  for (i = 0; i < num_listeners; i++) {
+    if (listeners[i].tapped != test_expected(listeners[i].filter))
+      g_error("listener %u with filter \"%s\" got frames 0x%x, expected 0x%x",
+              i, listeners[i].filter ? listeners[i].filter : "",
+              listeners[i].tapped, test_expected(listeners[i].filter));
+  }
+}
+
+static void
+test_remove(test_listener_t *listeners, guint num_listeners)
+{
+  guint i;
+
+  for (i = 0; i < num_listeners; i++)
+    remove_tap_listener(&listeners[i]);
+}
+
+/* Listeners with the same filter string share one result. */
+static void
+tap_test_same_filter(void)
+{
+  test_listener_t listeners[2];
+
+  test_register(&listeners[0], "frame.number in {2 4 6 8}");
+  test_register(&listeners[1], "frame.number in {2 4 6 8}");
+
+  test_dissect_frames(listeners, 2);
+  test_check(listeners, 2);
+  g_assert_cmpuint(listeners[0].tapped, ==, listeners[1].tapped);
+
+  test_remove(listeners, 2);
+}
+
+/* Different filters in the same program, with and without a filter. */
+static void
+tap_test_different_filters(void)
+{
+  test_listener_t listeners[6];
+
+  test_register(&listeners[0], "frame.number in {2 4 6 8}");
+  test_register(&listeners[1], "frame.number > 6");
+  test_register(&listeners[2], NULL);
+  test_register(&listeners[3], "frame.number > 6 && frame.number in {2 4 6 8}");
+  test_register(&listeners[4], "frame.number in {2 4 6 8}");
+  test_register(&listeners[5], "!(frame.number > 6)");
+
+  test_dissect_frames(listeners, 6);
+  test_check(listeners, 6);
+
+  test_remove(listeners, 6);
+}
+
+/* The program is rebuilt when the listeners or their filters change. */
+static void
+tap_test_filter_changes(void)
+{
+  test_listener_t listeners[3];
+
+  test_register(&listeners[0], "frame.number in {2 4 6 8}");
+  test_register(&listeners[1], "frame.number in {2 4 6 8}");
+  test_register(&listeners[2], "frame.number > 6");
+
+  test_dissect_frames(listeners, 3);
+  test_check(listeners, 3);
+
+  /* A listener no longer shares the result of the other one. */
+  test_set_filter(&listeners[1], "frame.number < 3");
+  test_dissect_frames(listeners, 3);
+  test_check(listeners, 3);
+
+  /* Removing a listener doesn't shift the results of the others. */
+  remove_tap_listener(&listeners[0]);
+  listeners[0].filter = NULL;
+  test_dissect_frames(listeners, 3);
+  g_assert_cmpuint(listeners[0].tapped, ==, 0);
+  test_check(&listeners[1], 2);
+
+  /* Nor does removing every filter. */
+  test_set_filter(&listeners[1], NULL);
+  test_set_filter(&listeners[2], NULL);
+  test_dissect_frames(&listeners[1], 2);
+  test_check(&listeners[1], 2);
+
+  test_remove(&listeners[1], 2);
+}
+
+int
+main(int argc, char **argv)
+{
+  static const struct packet_provider_funcs funcs = {
+    test_get_frame_ts,
+    NULL,
+    NULL,
+    NULL
+  };
+  int result;
+
+  g_test_init(&argc, &argv, NULL);
+
+  wtap_init(FALSE);
+  if (!epan_init(NULL, NULL, FALSE))
+    return 2;
+  test_epan = epan_new(NULL, &funcs);
+
+  g_test_add_func("/epan/tap/same_filter", tap_test_same_filter);
+  g_test_add_func("/epan/tap/different_filters", tap_test_different_filters);
+  g_test_add_func("/epan/tap/filter_changes", tap_test_filter_changes);
+
+  result = g_test_run();
+
+  epan_free(test_epan);
+  epan_cleanup();
+
+  return result;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 2
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=2 tabstop=8 expandtab:
+ * :indentSize=2:tabSize=8:noTabs=true:
+ */
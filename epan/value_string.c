@@ -12,6 +12,7 @@
 #define WS_LOG_DOMAIN LOG_DOMAIN_EPAN
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <epan/wmem_scopes.h>
@@ -918,6 +919,234 @@ try_rval64_to_str(const guint64 val, const range_string *rs)
 }
 
 
+/* COMPILED LOOKUPS */
+
+/* Arrays with fewer entries than this are searched linearly; an index
+ * doesn't buy anything for them. */
+#define VALUE_STRING_INDEX_MIN_ENTRIES 8
+
+/* A direct-indexed table is used if it needs at most this many slots
+ * per entry in the array. */
+#define VALUE_STRING_INDEX_MAX_SLOTS_PER_ENTRY 2
+
+typedef enum {
+    VS_INDEX_DIRECT,    /* strings[val - first_value]                  */
+    VS_INDEX_SORTED,    /* binary search in values[]                   */
+    VS_INDEX_RANGES     /* binary search in values[], check values_max */
+} value_string_index_type;
+
+struct _value_string_index {
+    value_string_index_type type;
+    guint                   num_entries; /* slots (direct) or entries  */
+    guint64                 first_value; /* VS_INDEX_DIRECT only       */
+    guint64                *values;      /* values, or range minimums  */
+    guint64                *values_max;  /* VS_INDEX_RANGES only       */
+    const gchar           **strings;
+};
+
+typedef struct {
+    guint64      value_min;
+    guint64      value_max;
+    guint        order;     /* position in the original array */
+    const gchar *strptr;
+} value_string_index_entry;
+
+static int
+value_string_index_entry_compare(const void *a, const void *b)
+{
+    const value_string_index_entry *ea = (const value_string_index_entry *)a;
+    const value_string_index_entry *eb = (const value_string_index_entry *)b;
+
+    if (ea->value_min != eb->value_min)
+        return (ea->value_min < eb->value_min) ? -1 : 1;
+    /* The first entry in the array wins, as with the linear search. */
+    if (ea->order != eb->order)
+        return (ea->order < eb->order) ? -1 : 1;
+    return 0;
+}
+
+/* Takes ownership of entries. */
+static value_string_index *
+value_string_index_build(value_string_index_entry *entries, guint count,
+        gboolean ranges)
+{
+    value_string_index *vsi;
+    guint64 span;
+    guint i, n;
+
+    if (count < VALUE_STRING_INDEX_MIN_ENTRIES) {
+        g_free(entries);
+        return NULL;
+    }
+
+    qsort(entries, count, sizeof *entries, value_string_index_entry_compare);
+
+    if (ranges) {
+        /* Overlapping ranges would need the original order to be
+         * resolved; leave those to the linear search. */
+        for (i = 1; i < count; i++) {
+            if (entries[i].value_min <= entries[i - 1].value_max) {
+                g_free(entries);
+                return NULL;
+            }
+        }
+    } else {
+        /* Keep only the first entry for each value. */
+        for (i = 0, n = 0; i < count; i++) {
+            if (n == 0 || entries[i].value_min != entries[n - 1].value_min)
+                entries[n++] = entries[i];
+        }
+        count = n;
+    }
+
+    vsi = g_new0(value_string_index, 1);
+    span = entries[count - 1].value_min - entries[0].value_min;
+
+    if (!ranges && span < (guint64)count * VALUE_STRING_INDEX_MAX_SLOTS_PER_ENTRY) {
+        vsi->type        = VS_INDEX_DIRECT;
+        vsi->num_entries = (guint)span + 1;
+        vsi->first_value = entries[0].value_min;
+        vsi->strings     = g_new0(const gchar *, vsi->num_entries);
+        for (i = 0; i < count; i++)
+            vsi->strings[entries[i].value_min - vsi->first_value] = entries[i].strptr;
+    } else {
+        vsi->type        = ranges ? VS_INDEX_RANGES : VS_INDEX_SORTED;
+        vsi->num_entries = count;
+        vsi->values      = g_new(guint64, count);
+        vsi->strings     = g_new(const gchar *, count);
+        if (ranges)
+            vsi->values_max = g_new(guint64, count);
+        for (i = 0; i < count; i++) {
+            vsi->values[i]  = entries[i].value_min;
+            vsi->strings[i] = entries[i].strptr;
+            if (ranges)
+                vsi->values_max[i] = entries[i].value_max;
+        }
+    }
+
+    g_free(entries);
+    return vsi;
+}
+
+value_string_index *
+value_string_index_new(const value_string *vs)
+{
+    value_string_index_entry *entries;
+    guint i, count = 0;
+
+    if (vs == NULL)
+        return NULL;
+
+    while (vs[count].strptr)
+        count++;
+
+    entries = g_new(value_string_index_entry, count);
+    for (i = 0; i < count; i++) {
+        entries[i].value_min = vs[i].value;
+        entries[i].value_max = vs[i].value;
+        entries[i].order     = i;
+        entries[i].strptr    = vs[i].strptr;
+    }
+
+    return value_string_index_build(entries, count, FALSE);
+}
+
+value_string_index *
+val64_string_index_new(const val64_string *vs)
+{
+    value_string_index_entry *entries;
+    guint i, count = 0;
+
+    if (vs == NULL)
+        return NULL;
+
+    while (vs[count].strptr)
+        count++;
+
+    entries = g_new(value_string_index_entry, count);
+    for (i = 0; i < count; i++) {
+        entries[i].value_min = vs[i].value;
+        entries[i].value_max = vs[i].value;
+        entries[i].order     = i;
+        entries[i].strptr    = vs[i].strptr;
+    }
+
+    return value_string_index_build(entries, count, FALSE);
+}
+
+value_string_index *
+range_string_index_new(const range_string *rs)
+{
+    value_string_index_entry *entries;
+    guint i, n, count = 0;
+
+    if (rs == NULL)
+        return NULL;
+
+    while (rs[count].strptr)
+        count++;
+
+    entries = g_new(value_string_index_entry, count);
+    for (i = 0, n = 0; i < count; i++) {
+        /* An empty range never matches anything. */
+        if (rs[i].value_min > rs[i].value_max)
+            continue;
+        entries[n].value_min = rs[i].value_min;
+        entries[n].value_max = rs[i].value_max;
+        entries[n].order     = i;
+        entries[n].strptr    = rs[i].strptr;
+        n++;
+    }
+
+    return value_string_index_build(entries, n, TRUE);
+}
+
+void
+value_string_index_free(value_string_index *vsi)
+{
+    if (vsi == NULL)
+        return;
+
+    g_free(vsi->values);
+    g_free(vsi->values_max);
+    g_free(vsi->strings);
+    g_free(vsi);
+}
+
+/* Like try_val_to_str, try_val64_to_str or try_rval64_to_str (depending
+   on what the index was built from), but using the index. */
+const gchar *
+try_val_to_str_index(const guint64 val, const value_string_index *vsi)
+{
+    guint low, high, mid;
+
+    if (vsi->type == VS_INDEX_DIRECT) {
+        if (val < vsi->first_value || val - vsi->first_value >= vsi->num_entries)
+            return NULL;
+        return vsi->strings[val - vsi->first_value];
+    }
+
+    /* Find the last entry with a value (minimum) <= val. */
+    low  = 0;
+    high = vsi->num_entries;
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        if (vsi->values[mid] <= val)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if (low == 0)
+        return NULL;
+    low--;
+
+    if (vsi->type == VS_INDEX_RANGES)
+        return (val <= vsi->values_max[low]) ? vsi->strings[low] : NULL;
+
+    return (vsi->values[low] == val) ? vsi->strings[low] : NULL;
+}
+
+
 /* BYTE BUFFER TO STRING MATCHING */
 
 /* Like val_to_str except for bytes_string */
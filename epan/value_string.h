@@ -342,6 +342,46 @@ WS_DLL_PUBLIC
 const gchar *
 try_bytesprefix_to_str(const guint8 *haystack, const size_t haystack_len, const bytes_string *bs);
 
+/* COMPILED LOOKUPS */
+
+/*
+ * A value_string_index is a lookup structure built once from a
+ * value_string, val64_string or range_string array.  Depending on the
+ * values in the array it is either a direct-indexed table (for dense
+ * values), a sorted array searched with a binary search, or a sorted
+ * array of non-overlapping ranges.  Lookups return the same string as
+ * the corresponding linear try_*_to_str() function, including for
+ * arrays with duplicate values.
+ *
+ * The index refers to the strings in the original array, which
+ * therefore must not be changed or freed while the index exists.
+ *
+ * The *_index_new() functions return NULL if the array is too small
+ * to be worth indexing, or (for range_strings) if the ranges overlap;
+ * callers should then fall back to the linear functions.
+ */
+typedef struct _value_string_index value_string_index;
+
+WS_DLL_PUBLIC
+value_string_index *
+value_string_index_new(const value_string *vs);
+
+WS_DLL_PUBLIC
+value_string_index *
+val64_string_index_new(const val64_string *vs);
+
+WS_DLL_PUBLIC
+value_string_index *
+range_string_index_new(const range_string *rs);
+
+WS_DLL_PUBLIC
+void
+value_string_index_free(value_string_index *vsi);
+
+WS_DLL_PUBLIC
+const gchar *
+try_val_to_str_index(const guint64 val, const value_string_index *vsi);
+
 /* MISC (generally do not use) */
 
 WS_DLL_LOCAL
@@ -0,0 +1,313 @@
+/* value_string_test.c
+ * Tests for the compiled value_string lookups
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+#undef G_DISABLE_ASSERT
+
+#include <stdio.h>
+#include <glib.h>
+
+#include <wiretap/wtap.h>
+#include "epan.h"
+#include "proto.h"
+#include "unit_strings.h"
+#include "value_string.h"
+
+static const value_string dense_vals[] = {
+    {  3, "three" },
+    {  1, "one" },
+    {  2, "two" },
+    {  5, "five" },
+    {  4, "four" },
+    {  7, "seven" },
+    {  6, "six" },
+    {  2, "two again" },
+    {  9, "nine" },
+    { 10, "ten" },
+    { 0, NULL }
+};
+
+static const value_string sparse_vals[] = {
+    { 0xffffffff, "all ones" },
+    {          0, "zero" },
+    {       1000, "thousand" },
+    {         10, "ten" },
+    {     100000, "hundred thousand" },
+    {        100, "hundred" },
+    {    1000000, "million" },
+    {      10000, "ten thousand" },
+    {       1000, "thousand again" },
+    {         42, "forty-two" },
+    { 0, NULL }
+};
+
+static const val64_string sparse_val64s[] = {
+    { G_GUINT64_CONSTANT(0xffffffffffffffff), "all ones" },
+    { G_GUINT64_CONSTANT(0x100000000), "2^32" },
+    {           1, "one" },
+    {          10, "ten" },
+    {         100, "hundred" },
+    {        1000, "thousand" },
+    {       10000, "ten thousand" },
+    {      100000, "hundred thousand" },
+    { 0, NULL }
+};
+
+static const range_string disjoint_rvals[] = {
+    {   0,   0, "zero" },
+    { 100, 199, "hundreds" },
+    {   1,   9, "ones" },
+    {  20,  29, "twenties" },
+    {  10,  19, "teens" },
+    { 300, 300, "three hundred" },
+    {  50,  40, "empty" },
+    { 1000, 0xffffffff, "large" },
+    {  30,  99, "up to a hundred" },
+    { 0, 0, NULL }
+};
+
+static const range_string overlapping_rvals[] = {
+    {   0, 255, "byte" },
+    {   1,   9, "ones" },
+    {  10,  19, "teens" },
+    {  20,  29, "twenties" },
+    {  30,  39, "thirties" },
+    {  40,  49, "forties" },
+    {  50,  59, "fifties" },
+    {  60,  69, "sixties" },
+    { 0, 0, NULL }
+};
+
+static const value_string short_vals[] = {
+    { 1, "one" },
+    { 2, "two" },
+    { 0, NULL }
+};
+
+static const guint64 probe_values[] = {
+    0, 1, 2, 3, 8, 9, 10, 11, 19, 20, 42, 43, 99, 100, 101, 150, 199, 200,
+    300, 301, 999, 1000, 1001, 10000, 100000, 1000000, 0xfffffffe, 0xffffffff,
+    G_GUINT64_CONSTANT(0x100000000), G_GUINT64_CONSTANT(0xffffffffffffffff)
+};
+
+static void
+value_string_test_vals(void)
+{
+    value_string_index *vsi;
+    const value_string *arrays[] = { dense_vals, sparse_vals };
+    guint i, j;
+
+    for (i = 0; i < G_N_ELEMENTS(arrays); i++) {
+        vsi = value_string_index_new(arrays[i]);
+        g_assert_nonnull(vsi);
+        for (j = 0; j < G_N_ELEMENTS(probe_values); j++) {
+            if (probe_values[j] > G_MAXUINT32)
+                continue;
+            g_assert_true(try_val_to_str_index(probe_values[j], vsi) ==
+                          try_val_to_str((guint32)probe_values[j], arrays[i]));
+        }
+        value_string_index_free(vsi);
+    }
+
+    /* Duplicates resolve to the first entry, as with the linear search. */
+    vsi = value_string_index_new(dense_vals);
+    g_assert_cmpstr(try_val_to_str_index(2, vsi), ==, "two");
+    value_string_index_free(vsi);
+
+    /* Not worth indexing. */
+    g_assert_null(value_string_index_new(short_vals));
+    g_assert_null(value_string_index_new(NULL));
+}
+
+static void
+value_string_test_val64s(void)
+{
+    value_string_index *vsi;
+    guint j;
+
+    vsi = val64_string_index_new(sparse_val64s);
+    g_assert_nonnull(vsi);
+    for (j = 0; j < G_N_ELEMENTS(probe_values); j++) {
+        g_assert_true(try_val_to_str_index(probe_values[j], vsi) ==
+                      try_val64_to_str(probe_values[j], sparse_val64s));
+    }
+    value_string_index_free(vsi);
+}
+
+static void
+value_string_test_rvals(void)
+{
+    value_string_index *vsi;
+    guint j;
+
+    vsi = range_string_index_new(disjoint_rvals);
+    g_assert_nonnull(vsi);
+    for (j = 0; j < G_N_ELEMENTS(probe_values); j++) {
+        g_assert_true(try_val_to_str_index(probe_values[j], vsi) ==
+                      try_rval64_to_str(probe_values[j], disjoint_rvals));
+    }
+    value_string_index_free(vsi);
+
+    /* Overlapping ranges are left to the linear search. */
+    g_assert_null(range_string_index_new(overlapping_rvals));
+}
+
+static const unit_name_string test_units = { " units", NULL };
+
+static void
+test_custom_fmt(gchar *result, guint32 value)
+{
+    snprintf(result, ITEM_LABEL_LENGTH, "%u", value);
+}
+
+/* Only the fields whose strings are value_string arrays get an index. */
+static void
+value_string_test_registration(void)
+{
+    static int proto_test = -1;
+    static int hf_vals = -1;
+    static int hf_framenum = -1;
+    static int hf_unit = -1;
+    static int hf_custom = -1;
+    static hf_register_info hf[] = {
+        { &hf_vals,
+          { "Values", "vsitest.vals", FT_UINT32, BASE_DEC,
+            VALS(dense_vals), 0x0, NULL, HFILL }},
+        { &hf_framenum,
+          { "Response in", "vsitest.response_in", FT_FRAMENUM, BASE_NONE,
+            FRAMENUM_TYPE(FT_FRAMENUM_RESPONSE), 0x0, NULL, HFILL }},
+        { &hf_unit,
+          { "Length", "vsitest.length", FT_UINT32, BASE_DEC|BASE_UNIT_STRING,
+            &test_units, 0x0, NULL, HFILL }},
+        { &hf_custom,
+          { "Custom", "vsitest.custom", FT_UINT32, BASE_CUSTOM,
+            CF_FUNC(test_custom_fmt), 0x0, NULL, HFILL }},
+    };
+
+    /* Registers the fields of all dissectors, with their FT_FRAMENUM fields. */
+    wtap_init(FALSE);
+    g_assert_true(epan_init(NULL, NULL, FALSE));
+
+    proto_test = proto_register_protocol("Value String Index Test", "VSITEST", "vsitest");
+    proto_register_field_array(proto_test, hf, G_N_ELEMENTS(hf));
+
+    g_assert_nonnull(proto_registrar_get_nth(hf_vals)->strings_index);
+    g_assert_null(proto_registrar_get_nth(hf_framenum)->strings_index);
+    g_assert_null(proto_registrar_get_nth(hf_unit)->strings_index);
+    g_assert_null(proto_registrar_get_nth(hf_custom)->strings_index);
+
+    epan_cleanup();
+}
+
+/* NOTE: You have to run "value_string_test -m perf" to run the performance tests. */
+#define PERF_NUM_ENTRIES 256
+#define PERF_LOOP_COUNT (10 * 1000 * 1000)
+
+static void
+value_string_test_perf(void)
+{
+    value_string *vs = g_new0(value_string, PERF_NUM_ENTRIES + 1);
+    range_string *rs = g_new0(range_string, PERF_NUM_ENTRIES + 1);
+    value_string_index *vsi, *rsi;
+    guint linear_hits = 0, index_hits = 0;
+    GTimer *timer;
+    guint32 val;
+    int i;
+
+    /* Sparse values, so that the index uses binary search rather than
+     * direct indexing. */
+    for (i = 0; i < PERF_NUM_ENTRIES; i++) {
+        vs[i].value = i * 7;
+        vs[i].strptr = "value";
+        rs[i].value_min = i * 16;
+        rs[i].value_max = i * 16 + 7;
+        rs[i].strptr = "range";
+    }
+    vsi = value_string_index_new(vs);
+    rsi = range_string_index_new(rs);
+    timer = g_timer_new();
+
+    g_timer_start(timer);
+    for (i = 0; i < PERF_LOOP_COUNT; i++) {
+        val = (i * 2654435761U) % (PERF_NUM_ENTRIES * 7);
+        if (try_val_to_str(val, vs))
+            linear_hits++;
+    }
+    g_test_minimized_result(g_timer_elapsed(timer, NULL),
+        "try_val_to_str, %d entries: %.3f s", PERF_NUM_ENTRIES, g_timer_elapsed(timer, NULL));
+
+    g_timer_start(timer);
+    for (i = 0; i < PERF_LOOP_COUNT; i++) {
+        val = (i * 2654435761U) % (PERF_NUM_ENTRIES * 7);
+        if (try_val_to_str_index(val, vsi))
+            index_hits++;
+    }
+    g_test_minimized_result(g_timer_elapsed(timer, NULL),
+        "try_val_to_str_index, %d entries: %.3f s", PERF_NUM_ENTRIES, g_timer_elapsed(timer, NULL));
+
+    g_timer_start(timer);
+    for (i = 0; i < PERF_LOOP_COUNT; i++) {
+        val = (i * 2654435761U) % (PERF_NUM_ENTRIES * 16);
+        if (try_rval_to_str(val, rs))
+            linear_hits++;
+    }
+    g_test_minimized_result(g_timer_elapsed(timer, NULL),
+        "try_rval_to_str, %d ranges: %.3f s", PERF_NUM_ENTRIES, g_timer_elapsed(timer, NULL));
+
+    g_timer_start(timer);
+    for (i = 0; i < PERF_LOOP_COUNT; i++) {
+        val = (i * 2654435761U) % (PERF_NUM_ENTRIES * 16);
+        if (try_val_to_str_index(val, rsi))
+            index_hits++;
+    }
+    g_test_minimized_result(g_timer_elapsed(timer, NULL),
+        "try_val_to_str_index, %d ranges: %.3f s", PERF_NUM_ENTRIES, g_timer_elapsed(timer, NULL));
+
+    g_assert_cmpuint(linear_hits, ==, index_hits);
+
+    g_timer_destroy(timer);
+    value_string_index_free(vsi);
+    value_string_index_free(rsi);
+    g_free(vs);
+    g_free(rs);
+}
+
+int
+main(int argc, char **argv)
+{
+    int result;
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/value_string/index/vals", value_string_test_vals);
+    g_test_add_func("/value_string/index/val64s", value_string_test_val64s);
+    g_test_add_func("/value_string/index/rvals", value_string_test_rvals);
+    g_test_add_func("/value_string/index/registration", value_string_test_registration);
+    if (g_test_perf()) {
+        g_test_add_func("/value_string/index/perf", value_string_test_perf);
+    }
+
+    result = g_test_run();
+
+    return result;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -35,38 +35,60 @@
  * perfect, but it should stop most of the bad behaviour that emem permitted.
  */
 
-/* TODO: Make these thread-local */
 static wmem_allocator_t *packet_scope = NULL;
 static wmem_allocator_t *file_scope   = NULL;
 static wmem_allocator_t *epan_scope   = NULL;
 
+/* The packet scope is the only one that is thread-local: a thread other
+ * than the one that called wmem_init_scopes() that wants to dissect packets
+ * gets its own packet scope with wmem_init_thread_scopes(), so that
+ * packet-scoped allocations made (and freed) while dissecting in that thread
+ * don't touch the allocator used by the main thread. The file and epan
+ * scopes are still shared.
+ */
+static GPrivate thread_packet_scope = G_PRIVATE_INIT(NULL);
+
 /* Packet Scope */
 
+static inline wmem_allocator_t *
+current_packet_scope(void)
+{
+    wmem_allocator_t *scope = (wmem_allocator_t *)g_private_get(&thread_packet_scope);
+
+    return scope ? scope : packet_scope;
+}
+
 wmem_allocator_t *
 wmem_packet_scope(void)
 {
-    ws_assert(packet_scope);
+    wmem_allocator_t *scope = current_packet_scope();
 
-    return packet_scope;
+    ws_assert(scope);
+
+    return scope;
 }
 
 void
 wmem_enter_packet_scope(void)
 {
-    ws_assert(packet_scope);
+    wmem_allocator_t *scope = current_packet_scope();
+
+    ws_assert(scope);
     ws_assert(wmem_in_scope(file_scope));
-    ws_assert(!wmem_in_scope(packet_scope));
+    ws_assert(!wmem_in_scope(scope));
 
-    wmem_enter_scope(packet_scope);
+    wmem_enter_scope(scope);
 }
 
 void
 wmem_leave_packet_scope(void)
 {
-    ws_assert(packet_scope);
-    ws_assert(wmem_in_scope(packet_scope));
+    wmem_allocator_t *scope = current_packet_scope();
 
-    wmem_leave_scope(packet_scope);
+    ws_assert(scope);
+    ws_assert(wmem_in_scope(scope));
+
+    wmem_leave_scope(scope);
 }
 
 /* File Scope */
@@ -93,13 +115,13 @@ wmem_leave_file_scope(void)
 {
     ws_assert(file_scope);
     ws_assert(wmem_in_scope(file_scope));
-    ws_assert(!wmem_in_scope(packet_scope));
+    ws_assert(!wmem_in_scope(current_packet_scope()));
 
     wmem_leave_scope(file_scope);
 
     /* this seems like a good time to do garbage collection */
     wmem_gc(file_scope);
-    wmem_gc(packet_scope);
+    wmem_gc(current_packet_scope());
 }
 
 /* Epan Scope */
@@ -153,6 +175,31 @@ wmem_cleanup_scopes(void)
     epan_scope   = NULL;
 }
 
+void
+wmem_init_thread_scopes(void)
+{
+    wmem_allocator_t *scope;
+
+    ws_assert(packet_scope);
+    ws_assert(g_private_get(&thread_packet_scope) == NULL);
+
+    scope = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK_FAST);
+    wmem_leave_scope(scope);
+    g_private_set(&thread_packet_scope, scope);
+}
+
+void
+wmem_cleanup_thread_scopes(void)
+{
+    wmem_allocator_t *scope = (wmem_allocator_t *)g_private_get(&thread_packet_scope);
+
+    ws_assert(scope);
+    ws_assert(!wmem_in_scope(scope));
+
+    g_private_set(&thread_packet_scope, NULL);
+    wmem_destroy_allocator(scope);
+}
+
 /*
  * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
  *
@@ -62,6 +62,18 @@ WS_DLL_PUBLIC
 void
 wmem_cleanup_scopes(void);
 
+/* Give the calling thread its own packet scope. Must be called by threads
+ * other than the one that called wmem_init_scopes() before they dissect
+ * packets, and be paired with wmem_cleanup_thread_scopes() before the
+ * thread exits. */
+WS_DLL_PUBLIC
+void
+wmem_init_thread_scopes(void);
+
+WS_DLL_PUBLIC
+void
+wmem_cleanup_thread_scopes(void);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
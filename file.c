@@ -117,6 +117,9 @@ static void cf_rename_failure_alert_box(const char *filename, int err);
 /* Show the progress bar after this many seconds. */
 #define PROGBAR_SHOW_DELAY 0.5
 
+/* Number of display filter results remembered for each file. */
+#define FILTER_CACHE_MAX_ENTRIES 16
+
 /*
  * Maximum number of records we support in a file.
  *
@@ -313,6 +316,16 @@ cf_open(capture_file *cf, const char *fname, unsigned int type, gboolean is_temp
   /* Allocate a frame_data_sequence for the frames in this file */
   cf->provider.frames = new_frame_data_sequence();
 
+  /* Index the values of the fields the user asked for while reading the
+     frames, so that display filters on them don't have to dissect
+     every frame. */
+  cf->field_index = dfilter_index_new(prefs.filter_index_fields);
+
+  /* Count the conversations the user asked for while reading the
+     frames, so that the conversation and endpoint tables don't have
+     to dissect every frame again. */
+  cf->conv_tables = conversation_table_first_pass_new(prefs.first_pass_conversation_tables);
+
   nstime_set_zero(&cf->elapsed_time);
   cf->provider.ref = NULL;
   cf->provider.prev_dis = NULL;
@@ -402,6 +415,12 @@ cf_close(capture_file *cf)
 
   dfilter_free(cf->rfcode);
   cf->rfcode = NULL;
+  dfilter_cache_free(cf->filter_cache);
+  cf->filter_cache = NULL;
+  dfilter_index_free(cf->field_index);
+  cf->field_index = NULL;
+  conversation_table_first_pass_free(cf->conv_tables);
+  cf->conv_tables = NULL;
   if (cf->provider.frames != NULL) {
     free_frame_data_sequence(cf->provider.frames);
     cf->provider.frames = NULL;
@@ -544,11 +563,14 @@ cf_read(capture_file *cf, gboolean reloading)
    *    one of the tap listeners requires a protocol tree;
    *
    *    a postdissector wants field values or protocols on
-   *    the first pass.
+   *    the first pass;
+   *
+   *    we're indexing field values.
    */
   create_proto_tree =
     (dfcode != NULL || have_filtering_tap_listeners() ||
-     (tap_flags & TL_REQUIRES_PROTO_TREE) || postdissectors_want_hfids());
+     (tap_flags & TL_REQUIRES_PROTO_TREE) || postdissectors_want_hfids() ||
+     cf->field_index != NULL);
 
   reset_tap_listeners();
 
@@ -680,7 +702,9 @@ cf_read(capture_file *cf, gboolean reloading)
   /* Free the display name */
   g_free(name_ptr);
 
-  /* Cleanup and release all dfilter resources */
+  /* Let the filter optimizer know how often the tests of the
+     filter passed, then release all dfilter resources */
+  dfilter_learn_selectivity(dfcode);
   dfilter_free(dfcode);
 
   epan_dissect_cleanup(&edt);
@@ -805,11 +829,14 @@ cf_continue_tail(capture_file *cf, volatile int to_read, wtap_rec *rec,
    *    one of the tap listeners requires a protocol tree;
    *
    *    a postdissector wants field values or protocols on
-   *    the first pass.
+   *    the first pass;
+   *
+   *    we're indexing field values.
    */
   create_proto_tree =
     (dfcode != NULL || have_filtering_tap_listeners() ||
-     (tap_flags & TL_REQUIRES_PROTO_TREE) || postdissectors_want_hfids());
+     (tap_flags & TL_REQUIRES_PROTO_TREE) || postdissectors_want_hfids() ||
+     cf->field_index != NULL);
 
   *err = 0;
 
@@ -863,7 +890,9 @@ cf_continue_tail(capture_file *cf, volatile int to_read, wtap_rec *rec,
      packets we've read. */
   cf->lnk_t = wtap_file_encap(cf->provider.wth);
 
-  /* Cleanup and release all dfilter resources */
+  /* Let the filter optimizer know how often the tests of the
+     filter passed, then release all dfilter resources */
+  dfilter_learn_selectivity(dfcode);
   dfilter_free(dfcode);
 
   epan_dissect_cleanup(&edt);
@@ -945,11 +974,14 @@ cf_finish_tail(capture_file *cf, wtap_rec *rec, Buffer *buf, int *err)
    *    one of the tap listeners requires a protocol tree;
    *
    *    a postdissector wants field values or protocols on
-   *    the first pass.
+   *    the first pass;
+   *
+   *    we're indexing field values.
    */
   create_proto_tree =
     (dfcode != NULL || have_filtering_tap_listeners() ||
-     (tap_flags & TL_REQUIRES_PROTO_TREE) || postdissectors_want_hfids());
+     (tap_flags & TL_REQUIRES_PROTO_TREE) || postdissectors_want_hfids() ||
+     cf->field_index != NULL);
 
   if (cf->provider.wth == NULL) {
     cf_close(cf);
@@ -972,7 +1004,9 @@ cf_finish_tail(capture_file *cf, wtap_rec *rec, Buffer *buf, int *err)
     wtap_rec_reset(rec);
   }
 
-  /* Cleanup and release all dfilter resources */
+  /* Let the filter optimizer know how often the tests of the
+     filter passed, then release all dfilter resources */
+  dfilter_learn_selectivity(dfcode);
   dfilter_free(dfcode);
 
   epan_dissect_cleanup(&edt);
@@ -1174,6 +1208,11 @@ add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
     epan_dissect_t *edt, dfilter_t *dfcode, column_info *cinfo,
     wtap_rec *rec, Buffer *buf, gboolean add_to_packet_list)
 {
+  /* Index the field values of the frame on the first pass. */
+  gboolean index_frame = cf->field_index != NULL && !fdata->visited;
+  /* Count its conversations on the first pass as well. */
+  gboolean count_conversations = cf->conv_tables != NULL && !fdata->visited;
+
   frame_data_set_before_dissect(fdata, &cf->elapsed_time,
                                 &cf->provider.ref, cf->provider.prev_dis);
   cf->provider.prev_cap = fdata;
@@ -1197,10 +1236,20 @@ add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
     prime_epan_dissect_with_postdissector_wanted_hfids(edt);
   }
 
+  if (index_frame)
+    dfilter_index_prime_proto_tree(cf->field_index, edt->tree);
+
   /* Dissect the frame. */
+  if (count_conversations)
+    conversation_table_first_pass_set_active(cf->conv_tables, TRUE);
   epan_dissect_run_with_taps(edt, cf->cd_t, rec,
                              frame_tvbuff_new_buffer(&cf->provider, fdata, buf),
                              fdata, cinfo);
+  if (count_conversations)
+    conversation_table_first_pass_set_active(cf->conv_tables, FALSE);
+
+  if (index_frame)
+    dfilter_index_add_frame(cf->field_index, fdata->num, edt->tree);
 
   /* If we don't have a display filter, set "passed_dfilter" to 1. */
   if (dfcode != NULL) {
@@ -1240,6 +1289,66 @@ add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
   epan_dissect_reset(edt);
 }
 
+/*
+ * Like add_packet_to_packet_list(), for a frame whose display filter
+ * result is already known, so it doesn't have to be dissected.
+ */
+static void
+add_filtered_packet_to_packet_list(frame_data *fdata, capture_file *cf,
+    gboolean passed)
+{
+  frame_data_set_before_dissect(fdata, &cf->elapsed_time,
+                                &cf->provider.ref, cf->provider.prev_dis);
+  cf->provider.prev_cap = fdata;
+
+  fdata->passed_dfilter = passed ? 1 : 0;
+
+  if (fdata->passed_dfilter || fdata->ref_time)
+  {
+    cf->displayed_count++;
+
+    frame_data_set_after_dissect(fdata, &cf->cum_bytes);
+    cf->provider.prev_dis = fdata;
+
+    /* If we haven't yet seen the first frame, this is it. */
+    if (cf->first_displayed == 0)
+      cf->first_displayed = fdata->num;
+
+    /* This is the last frame we've seen so far. */
+    cf->last_displayed = fdata->num;
+  }
+}
+
+/*
+ * Remember which of the first frames_count frames passed dfcode, and
+ * which frames they depend on, so that the filter can be applied again
+ * without dissecting them.
+ */
+static void
+cache_filter_results(capture_file *cf, dfilter_t *dfcode, guint32 frames_count)
+{
+  guint32     framenum;
+  frame_data *fdata;
+  guint8     *passed, *dependents;
+  gsize       size = DFILTER_CACHE_BITMAP_SIZE(frames_count);
+
+  if (cf->filter_cache == NULL)
+    cf->filter_cache = dfilter_cache_new(FILTER_CACHE_MAX_ENTRIES);
+
+  passed = (guint8 *)g_malloc0(size);
+  dependents = (guint8 *)g_malloc0(size);
+  for (framenum = 1; framenum <= frames_count; framenum++) {
+    fdata = frame_data_sequence_find(cf->provider.frames, framenum);
+    if (fdata->passed_dfilter)
+      passed[framenum / 8] |= 1 << (framenum % 8);
+    if (fdata->dependent_of_displayed)
+      dependents[framenum / 8] |= 1 << (framenum % 8);
+  }
+  dfilter_cache_store(cf->filter_cache, dfcode, frames_count, passed, dependents);
+  g_free(passed);
+  g_free(dependents);
+}
+
 /*
  * Read in a new record.
  * Returns TRUE if the packet was added to the packet (record) list,
@@ -1646,6 +1755,10 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
   gboolean    compiled _U_;
   guint32     frames_count;
   gboolean    queued_rescan_type = RESCAN_NONE;
+  guint8     *cached_passed = NULL;
+  guint8     *cached_dependents = NULL;
+  guint8     *candidates = NULL;
+  gboolean    dissect;
 
   /* Rescan in progress, clear pending actions. */
   cf->redissection_queued = RESCAN_NONE;
@@ -1662,6 +1775,37 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
   compiled = dfilter_compile(cf->dfilter, &dfcode, NULL);
   ws_assert(!cf->dfilter || (compiled && dfcode));
 
+  /*
+   * If we're not redissecting, and we've applied this filter before,
+   * we already know which frames pass it and which frames those depend
+   * on, so we don't need to dissect anything - unless a tap listener
+   * wants to see the frames.
+   */
+  if (redissect) {
+    dfilter_cache_clear(cf->filter_cache);
+  } else if (dfcode != NULL && !tap_listeners_require_dissection()) {
+    if (cf->filter_cache != NULL &&
+        dfilter_cache_lookup(cf->filter_cache, dfcode, cf->count,
+                             &cached_passed, &cached_dependents) &&
+        cached_dependents == NULL) {
+      /* Computed from other results; we don't know the dependent frames. */
+      g_free(cached_passed);
+      cached_passed = NULL;
+    }
+
+    /*
+     * Otherwise, if the index of field values tells us which frames
+     * can pass the filter, we only need to dissect those.  (We even
+     * dissect them if the index gives the exact result, to find the
+     * frames they depend on.)
+     */
+    if (cached_passed == NULL && cf->field_index != NULL &&
+        dfilter_index_num_frames(cf->field_index) == cf->count &&
+        dfilter_index_lookup(cf->field_index, dfcode, &candidates) == DFILTER_INDEX_NONE) {
+      candidates = NULL;
+    }
+  }
+
   /* Get the union of the flags for all tap listeners. */
   tap_flags = union_of_tap_listener_flags();
 
@@ -1721,6 +1865,16 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
     cf->epan = ws_epan_new(cf);
     cf->cinfo.epan = cf->epan;
 
+    /* The field values might change, so index them again. */
+    dfilter_index_free(cf->field_index);
+    cf->field_index = dfilter_index_new(prefs.filter_index_fields);
+    if (cf->field_index != NULL)
+      create_proto_tree = TRUE;
+
+    /* So might the conversations. */
+    conversation_table_first_pass_free(cf->conv_tables);
+    cf->conv_tables = conversation_table_first_pass_new(prefs.first_pass_conversation_tables);
+
     /* A new Lua tap listener may be registered in lua_prime_all_fields()
        called via epan_new() / init_dissection() when reloading Lua plugins. */
     if (!create_proto_tree && have_filtering_tap_listeners()) {
@@ -1855,10 +2009,18 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
       frames_count = cf->count;
     }
 
-    /* Frame dependencies from the previous dissection/filtering are no longer valid. */
-    fdata->dependent_of_displayed = 0;
+    if (cached_passed != NULL) {
+      fdata->dependent_of_displayed =
+        (cached_dependents[framenum / 8] >> (framenum % 8)) & 1;
+      dissect = FALSE;
+    } else {
+      /* Frame dependencies from the previous dissection/filtering are no longer valid. */
+      fdata->dependent_of_displayed = 0;
+      dissect = candidates == NULL ||
+                (candidates[framenum / 8] >> (framenum % 8)) & 1;
+    }
 
-    if (!cf_read_record(cf, fdata, &rec, &buf))
+    if (dissect && !cf_read_record(cf, fdata, &rec, &buf))
       break; /* error reading the frame */
 
     /* If the previous frame is displayed, and we haven't yet seen the
@@ -1869,9 +2031,13 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
       preceding_frame = prev_frame;
     }
 
-    add_packet_to_packet_list(fdata, cf, &edt, dfcode,
-                                    cinfo, &rec, &buf,
-                                    add_to_packet_list);
+    if (dissect)
+      add_packet_to_packet_list(fdata, cf, &edt, dfcode,
+                                      cinfo, &rec, &buf,
+                                      add_to_packet_list);
+    else
+      add_filtered_packet_to_packet_list(fdata, cf, cached_passed != NULL &&
+          (cached_passed[framenum / 8] >> (framenum % 8)) & 1);
 
     /* If this frame is displayed, and this is the first frame we've
        seen displayed after the selected frame, remember this frame -
@@ -1898,6 +2064,13 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
   wtap_rec_cleanup(&rec);
   ws_buffer_free(&buf);
 
+  /* If we filtered every frame, remember the results. */
+  if (dfcode != NULL && cached_passed == NULL && framenum > frames_count)
+    cache_filter_results(cf, dfcode, frames_count);
+  g_free(cached_passed);
+  g_free(cached_dependents);
+  g_free(candidates);
+
   /* We are done redissecting the packet list. */
   cf->redissecting = FALSE;
 
@@ -1994,7 +2167,9 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
     }
   }
 
-  /* Cleanup and release all dfilter resources */
+  /* Let the filter optimizer know how often the tests of the
+     filter passed, then release all dfilter resources */
+  dfilter_learn_selectivity(dfcode);
   dfilter_free(dfcode);
 
   /* It is safe again to execute redissections. */
@@ -2022,6 +2197,10 @@ cf_reftime_packets(capture_file* cf)
   frame_data *fdata;
   nstime_t rel_ts;
 
+  /* The relative times of the frames, and thus the results of filters
+     that test them, change. */
+  dfilter_cache_clear(cf->filter_cache);
+
   cf->provider.ref = NULL;
   cf->provider.prev_dis = NULL;
   cf->cum_bytes = 0;
@@ -3144,7 +3323,7 @@ match_subtree_text(proto_node *node, gpointer data)
   }
 
   if (cf->regex) {
-    if (g_regex_match(cf->regex, label_ptr, (GRegexMatchFlags) 0, NULL)) {
+    if (ws_regex_matches(cf->regex, label_ptr)) {
       mdata->frame_matched = TRUE;
       mdata->finfo = fi;
       return;
@@ -3221,7 +3400,7 @@ match_summary_line(capture_file *cf, frame_data *fdata,
       info_column = edt.pi.cinfo->columns[colx].col_data;
       info_column_len = strlen(info_column);
       if (cf->regex) {
-        if (g_regex_match(cf->regex, info_column, (GRegexMatchFlags) 0, NULL)) {
+        if (ws_regex_matches_length(cf->regex, info_column, info_column_len)) {
           result = MR_MATCHED;
           break;
         }
@@ -3494,7 +3673,7 @@ match_regex(capture_file *cf, frame_data *fdata,
             wtap_rec *rec, Buffer *buf, void *criterion _U_)
 {
     match_result  result = MR_NOTMATCHED;
-    GMatchInfo   *match_info = NULL;
+    size_t        pos[2];
 
     /* Load the frame's data. */
     if (!cf_read_record(cf, fdata, rec, buf)) {
@@ -3502,13 +3681,10 @@ match_regex(capture_file *cf, frame_data *fdata,
         return MR_ERROR;
     }
 
-    if (g_regex_match_full(cf->regex, (const gchar *)ws_buffer_start_ptr(buf), fdata->cap_len,
-                           0, (GRegexMatchFlags) 0, &match_info, NULL))
+    if (ws_regex_matches_pos(cf->regex, (const char *)ws_buffer_start_ptr(buf), fdata->cap_len, pos))
     {
-        gint start_pos = 0, end_pos = 0;
-        g_match_info_fetch_pos (match_info, 0, &start_pos, &end_pos);
-        cf->search_pos = end_pos - 1;
-        cf->search_len = end_pos - start_pos;
+        cf->search_pos = (guint32)pos[1] - 1;
+        cf->search_len = (guint32)(pos[1] - pos[0]);
         result = MR_MATCHED;
     }
     return result;
@@ -3916,6 +4092,7 @@ cf_mark_frame(capture_file *cf, frame_data *frame)
 {
   if (! frame->marked) {
     frame->marked = TRUE;
+    dfilter_cache_clear(cf->filter_cache);
     if (cf->count > cf->marked_count)
       cf->marked_count++;
   }
@@ -3929,6 +4106,7 @@ cf_unmark_frame(capture_file *cf, frame_data *frame)
 {
   if (frame->marked) {
     frame->marked = FALSE;
+    dfilter_cache_clear(cf->filter_cache);
     if (cf->marked_count > 0)
       cf->marked_count--;
   }
@@ -3942,6 +4120,7 @@ cf_ignore_frame(capture_file *cf, frame_data *frame)
 {
   if (! frame->ignored) {
     frame->ignored = TRUE;
+    dfilter_cache_clear(cf->filter_cache);
     if (cf->count > cf->ignored_count)
       cf->ignored_count++;
   }
@@ -3955,6 +4134,7 @@ cf_unignore_frame(capture_file *cf, frame_data *frame)
 {
   if (frame->ignored) {
     frame->ignored = FALSE;
+    dfilter_cache_clear(cf->filter_cache);
     if (cf->ignored_count > 0)
       cf->ignored_count--;
   }
@@ -4057,8 +4237,10 @@ cf_set_modified_block(capture_file *cf, frame_data *fd, const wtap_block_t new_b
     expert_update_comment_count(cf->packet_comment_count);
   }
 
-  /* Either way, we have unsaved changes. */
+  /* Either way, we have unsaved changes, and filters that test the
+     block may give different results. */
   wtap_block_unref(pkt_block);
+  dfilter_cache_clear(cf->filter_cache);
   cf->unsaved_changes = TRUE;
   return TRUE;
 }
@@ -18,6 +18,15 @@
 #include <errno.h>
 #include <signal.h>
 
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
 #include <glib.h>
 
 #include <epan/exceptions.h>
@@ -30,6 +39,7 @@
 #include <wsutil/privileges.h>
 #include <wsutil/report_message.h>
 #include <wsutil/wslog.h>
+#include <wsutil/ws_assert.h>
 #include <ui/version_info.h>
 #include <wiretap/wtap_opttypes.h>
 
@@ -50,6 +60,7 @@
 #include "ui/failure_message.h"
 #include "wtap.h"
 #include <epan/epan_dissect.h>
+#include <epan/frame_data_table.h>
 #include <epan/tap.h>
 #include <epan/uat-int.h>
 #include <epan/secrets.h>
@@ -68,11 +79,55 @@
 #define INIT_FAILED 1
 #define EPAN_INIT_FAIL 2
 
+/* Number of display filter results remembered. */
+#define SHARKD_FILTER_CACHE_MAX_ENTRIES 64
+
+/* Approximate memory used for column values remembered. */
+#define SHARKD_COLUMN_CACHE_MAX_BYTES (64 * 1024 * 1024)
+
+/* Microseconds between progress reports of passes over the frames. */
+#define SHARKD_PROGRESS_INTERVAL 250000
+
+/* Files with fewer frames are filtered in a single process. */
+#define SHARKD_FILTER_PARALLEL_MIN_FRAMES 65536
+#define SHARKD_FILTER_MAX_WORKERS 16
+/* Frames between progress reports of a worker; a power of 2. */
+#define SHARKD_FILTER_WORKER_PROGRESS_FRAMES 4096
+
 capture_file cfile;
 
 static guint32 cum_bytes;
 static frame_data ref_frame;
+static frame_data prev_frame;
+
+/*
+ * The frames of the file are kept in a frame_data_table; the frame_data
+ * of a frame in use is a copy of it, see sharkd_get_frame().
+ */
+typedef struct {
+  frame_data fdata;
+  guint      refcount;
+} sharkd_frame_view;
+
+static frame_data_table *frames;
+/* sharkd_frame_view of the frames in use, by frame number */
+static GHashTable *frame_views;
+
+#ifndef _WIN32
+/* Write end of the pipe that keeps the capture shared, see sharkd_share_capture() */
+static int share_alive_fd = -1;
+#endif
+
+static sharkd_progress_func_t progress_func;
+static void *progress_data;
+static gboolean progress_stopped;
 
+/* State of the first pass over the file being loaded, if any */
+static gboolean load_running;
+static gint64 load_bytes_read;
+static gint64 load_start_time;
+
+static gboolean sharkd_progress(guint32 done, guint32 total, gint64 *next_update);
 static void sharkd_cmdarg_err(const char *msg_format, va_list ap);
 static void sharkd_cmdarg_err_cont(const char *msg_format, va_list ap);
 
@@ -225,15 +280,53 @@ sharkd_get_frame_ts(struct packet_provider_data *prov, guint32 frame_num)
   if (prov->prev_cap && prov->prev_cap->num == frame_num)
     return &prov->prev_cap->abs_ts;
 
-  if (prov->frames) {
-     frame_data *fd = frame_data_sequence_find(prov->frames, frame_num);
+  if (frames) {
+     static frame_data fd;
 
-     return (fd) ? &fd->abs_ts : NULL;
+     return frame_data_table_get(frames, frame_num, &fd) ? &fd.abs_ts : NULL;
   }
 
   return NULL;
 }
 
+static void
+sharkd_mark_frame_depended_upon(gpointer data, gpointer user_data _U_)
+{
+  guint32 dependent_frame = GPOINTER_TO_UINT(data);
+  sharkd_frame_view *view;
+
+  if (dependent_frame == 0 || dependent_frame > frame_data_table_count(frames))
+    return;
+
+  frame_data_table_set_flag(frames, dependent_frame, FRAME_DATA_FLAG_DEPENDENT_OF_DISPLAYED, TRUE);
+
+  /* Don't let a copy in use write the old value back. */
+  view = (sharkd_frame_view *)g_hash_table_lookup(frame_views, GUINT_TO_POINTER(dependent_frame));
+  if (view)
+    view->fdata.dependent_of_displayed = 1;
+}
+
+/*
+ * Forgets the frames of the previous file, if any.
+ */
+static void
+sharkd_frames_reset(capture_file *cf)
+{
+  /* The modified blocks are keyed by the frame_data of their frames. */
+  if (cf->provider.frames_modified_blocks) {
+    g_tree_destroy(cf->provider.frames_modified_blocks);
+    cf->provider.frames_modified_blocks = NULL;
+  }
+
+  if (frame_views)
+    g_hash_table_destroy(frame_views);
+  frame_views = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+
+  if (frames)
+    frame_data_table_free(frames);
+  frames = frame_data_table_new();
+}
+
 static epan_t *
 sharkd_epan_new(capture_file *cf)
 {
@@ -284,6 +377,9 @@ process_packet(capture_file *cf, epan_dissect_t *edt,
        with the hfids postdissectors want on the first pass. */
     prime_epan_dissect_with_postdissector_wanted_hfids(edt);
 
+    if (cf->field_index)
+      dfilter_index_prime_proto_tree(cf->field_index, edt->tree);
+
     frame_data_set_before_dissect(&fdlocal, &cf->elapsed_time,
                                   &cf->provider.ref, cf->provider.prev_dis);
     if (cf->provider.ref == &fdlocal) {
@@ -291,9 +387,18 @@ process_packet(capture_file *cf, epan_dissect_t *edt,
       cf->provider.ref = &ref_frame;
     }
 
-    epan_dissect_run(edt, cf->cd_t, rec,
-                     frame_tvbuff_new_buffer(&cf->provider, &fdlocal, buf),
-                     &fdlocal, NULL);
+    /* Run the taps only for the conversation tables filled while reading. */
+    if (cf->conv_tables) {
+      conversation_table_first_pass_set_active(cf->conv_tables, TRUE);
+      epan_dissect_run_with_taps(edt, cf->cd_t, rec,
+                                 frame_tvbuff_new_buffer(&cf->provider, &fdlocal, buf),
+                                 &fdlocal, NULL);
+      conversation_table_first_pass_set_active(cf->conv_tables, FALSE);
+    } else {
+      epan_dissect_run(edt, cf->cd_t, rec,
+                       frame_tvbuff_new_buffer(&cf->provider, &fdlocal, buf),
+                       &fdlocal, NULL);
+    }
 
     /* Run the read filter if we have one. */
     if (cf->rfcode)
@@ -302,7 +407,9 @@ process_packet(capture_file *cf, epan_dissect_t *edt,
 
   if (passed) {
     frame_data_set_after_dissect(&fdlocal, &cum_bytes);
-    cf->provider.prev_cap = cf->provider.prev_dis = frame_data_sequence_add(cf->provider.frames, &fdlocal);
+    frame_data_table_add(frames, &fdlocal);
+    prev_frame = fdlocal;
+    cf->provider.prev_cap = cf->provider.prev_dis = &prev_frame;
 
     /* If we're not doing dissection then there won't be any dependent frames.
      * More importantly, edt.pi.dependent_frames won't be initialized because
@@ -312,13 +419,16 @@ process_packet(capture_file *cf, epan_dissect_t *edt,
      */
     if (edt && cf->dfcode) {
       if (dfilter_apply_edt(cf->dfcode, edt)) {
-        g_slist_foreach(edt->pi.dependent_frames, find_and_mark_frame_depended_upon, cf->provider.frames);
+        g_slist_foreach(edt->pi.dependent_frames, sharkd_mark_frame_depended_upon, NULL);
       }
     }
 
+    if (edt && cf->field_index)
+      dfilter_index_add_frame(cf->field_index, fdlocal.num, edt->tree);
+
     cf->count++;
   } else {
-    /* if we don't add it to the frame_data_sequence, clean it up right now
+    /* if we don't add it to the frame_data_table, clean it up right now
      * to avoid leaks */
     frame_data_destroy(&fdlocal);
   }
@@ -330,6 +440,13 @@ process_packet(capture_file *cf, epan_dissect_t *edt,
 }
 
 
+/*
+ * Reads the file, reporting the progress as it goes: the progress
+ * function can answer requests about the frames read so far, see
+ * sharkd_load_progress().
+ *
+ * If the progress function asks to stop, the frames read so far are kept.
+ */
 static int
 load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
 {
@@ -339,10 +456,21 @@ load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
   wtap_rec     rec;
   Buffer       buf;
   epan_dissect_t *edt = NULL;
+  gint64       next_update = 0;
 
   {
-    /* Allocate a frame_data_sequence for all the frames. */
-    cf->provider.frames = new_frame_data_sequence();
+    /* Allocate a frame_data_table for all the frames. */
+    sharkd_frames_reset(cf);
+
+    /* Index the values of the fields the user asked for, so that
+       filters on them don't have to dissect every frame. */
+    dfilter_index_free(cf->field_index);
+    cf->field_index = dfilter_index_new(prefs.filter_index_fields);
+
+    /* Count the conversations the user asked for, so that the
+       conversation and endpoint taps don't need a retap. */
+    conversation_table_first_pass_free(cf->conv_tables);
+    cf->conv_tables = conversation_table_first_pass_new(prefs.first_pass_conversation_tables);
 
     {
       gboolean create_proto_tree;
@@ -356,10 +484,13 @@ load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
        *    we're going to apply a display filter;
        *
        *    a postdissector wants field values or protocols
-       *    on the first pass.
+       *    on the first pass;
+       *
+       *    we're indexing field values.
        */
       create_proto_tree =
-        (cf->rfcode != NULL || cf->dfcode != NULL || postdissectors_want_hfids());
+        (cf->rfcode != NULL || cf->dfcode != NULL || postdissectors_want_hfids() ||
+         cf->field_index != NULL);
 
       /* We're not going to display the protocol tree on this pass,
          so it's not going to be "visible". */
@@ -369,6 +500,11 @@ load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
     wtap_rec_init(&rec);
     ws_buffer_init(&buf, 1514);
 
+    load_running = TRUE;
+    load_bytes_read = 0;
+    load_start_time = g_get_monotonic_time();
+    progress_stopped = FALSE;
+
     while (wtap_read(cf->provider.wth, &rec, &buf, &err, &err_info, &data_offset)) {
       if (process_packet(cf, edt, data_offset, &rec, &buf)) {
         wtap_rec_reset(&rec);
@@ -382,8 +518,17 @@ load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
           break;
         }
       }
+
+      /* The total number of frames isn't known until the end. */
+      load_bytes_read = wtap_read_so_far(cf->provider.wth);
+      if (!sharkd_progress(cf->count, 0, &next_update)) {
+        err = 0;
+        break;
+      }
     }
 
+    load_running = FALSE;
+
     if (edt) {
       epan_dissect_free(edt);
       edt = NULL;
@@ -401,6 +546,10 @@ load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
 
     cf->provider.prev_dis = NULL;
     cf->provider.prev_cap = NULL;
+
+    /* The columns of the frames shown while reading might depend on
+       the frames read after them. */
+    sharkd_column_cache_clear();
   }
 
   if (err != 0) {
@@ -451,6 +600,17 @@ cf_open(capture_file *cf, const char *fname, unsigned int type, gboolean is_temp
   epan_free(cf->epan);
   cf->epan = sharkd_epan_new(cf);
 
+  /* Columns of the previous file, if any, are of no use. */
+  sharkd_column_cache_clear();
+
+#ifndef _WIN32
+  /* Stop sharing the previous file, if any. */
+  if (share_alive_fd != -1) {
+    close(share_alive_fd);
+    share_alive_fd = -1;
+  }
+#endif
+
   cf->state = FILE_READ_IN_PROGRESS;
 
   wtap_set_cb_new_ipv4(cf->provider.wth, add_ipv4_name);
@@ -497,10 +657,65 @@ sharkd_load_cap_file(void)
   return load_cap_file(&cfile, 0, 0);
 }
 
+/*
+ * Returns TRUE while the file is being read, with the number of bytes
+ * read so far and the microseconds since the start of the reading.
+ */
+gboolean
+sharkd_load_progress(gint64 *bytes_read, gint64 *elapsed)
+{
+  if (!load_running)
+    return FALSE;
+
+  *bytes_read = load_bytes_read;
+  *elapsed = g_get_monotonic_time() - load_start_time;
+  return TRUE;
+}
+
+/*
+ * Returns the frame_data of a frame, or NULL if there is no such frame.
+ *
+ * It's a copy of the frame in the frame_data_table: it stays valid, and
+ * changes to it are written back, until the matching sharkd_release_frame().
+ * Getting a frame that is already in use returns the same copy.
+ */
 frame_data *
 sharkd_get_frame(guint32 framenum)
 {
-  return frame_data_sequence_find(cfile.provider.frames, framenum);
+  sharkd_frame_view *view;
+
+  if (frames == NULL)
+    return NULL;
+
+  view = (sharkd_frame_view *)g_hash_table_lookup(frame_views, GUINT_TO_POINTER(framenum));
+  if (view == NULL) {
+    view = g_new(sharkd_frame_view, 1);
+    if (!frame_data_table_get(frames, framenum, &view->fdata)) {
+      g_free(view);
+      return NULL;
+    }
+    view->refcount = 0;
+    g_hash_table_insert(frame_views, GUINT_TO_POINTER(framenum), view);
+  }
+
+  view->refcount++;
+  return &view->fdata;
+}
+
+/*
+ * Writes the changes to a frame_data returned by sharkd_get_frame() back
+ * to the frame_data_table and releases it. The copies of frames with a
+ * modified block are kept, as the modified blocks are keyed by them.
+ */
+void
+sharkd_release_frame(frame_data *fdata)
+{
+  sharkd_frame_view *view = (sharkd_frame_view *)fdata;
+
+  frame_data_table_set(frames, fdata);
+
+  if (--view->refcount == 0 && !fdata->has_modified_block)
+    g_hash_table_remove(frame_views, GUINT_TO_POINTER(fdata->num));
 }
 
 enum dissect_request_status
@@ -521,6 +736,7 @@ sharkd_dissect_request(guint32 framenum, guint32 frame_ref_num,
   if (!wtap_seek_read(cfile.provider.wth, fdata->file_off, rec, buf, err, err_info)) {
     if (cinfo != NULL)
       col_fill_in_error(cinfo, fdata, FALSE, FALSE /* fill_fd_columns */);
+    sharkd_release_frame(fdata);
     return DISSECT_REQUEST_READ_ERROR; /* error reading the record */
   }
 
@@ -559,9 +775,57 @@ sharkd_dissect_request(guint32 framenum, guint32 frame_ref_num,
 
   wtap_rec_reset(rec);
   epan_dissect_cleanup(&edt);
+  sharkd_release_frame(fdata);
   return DISSECT_REQUEST_SUCCESS;
 }
 
+/*
+ * Reports the progress of a pass over the frames, at most every
+ * SHARKD_PROGRESS_INTERVAL microseconds. Returns FALSE if the pass
+ * should stop.
+ */
+static gboolean
+sharkd_progress(guint32 done, guint32 total, gint64 *next_update)
+{
+  gint64 now;
+
+  if (progress_stopped)
+    return FALSE;
+  if (progress_func == NULL)
+    return TRUE;
+
+  now = g_get_monotonic_time();
+  if (*next_update == 0) {
+    /* Passes that take less time than that don't report at all. */
+    *next_update = now + SHARKD_PROGRESS_INTERVAL;
+    return TRUE;
+  }
+  if (now < *next_update)
+    return TRUE;
+
+  *next_update = now + SHARKD_PROGRESS_INTERVAL;
+  if (!progress_func(done, total, progress_data))
+    progress_stopped = TRUE;
+  return !progress_stopped;
+}
+
+void
+sharkd_set_progress_func(sharkd_progress_func_t func, void *data)
+{
+  progress_func = func;
+  progress_data = data;
+}
+
+/*
+ * Runs the tap listeners over all frames. The caller draws them, if it
+ * wants to, with draw_tap_listeners().
+ *
+ * The frames are dissected one at a time: unlike the result of a filter,
+ * the data the tap listeners collect can't be split up between workers
+ * and merged afterwards.
+ *
+ * Returns -1 if the progress function asked to stop.
+ */
 int
 sharkd_retap(void)
 {
@@ -576,6 +840,7 @@ sharkd_retap(void)
   gboolean      create_proto_tree;
   epan_dissect_t edt;
   column_info   *cinfo;
+  gint64        next_update = 0;
 
   /* Get the union of the flags for all tap listeners. */
   tap_flags = union_of_tap_listener_flags();
@@ -599,12 +864,18 @@ sharkd_retap(void)
   epan_dissect_init(&edt, cfile.epan, create_proto_tree, FALSE);
 
   reset_tap_listeners();
+  progress_stopped = FALSE;
 
   for (framenum = 1; framenum <= cfile.count; framenum++) {
+    if (!sharkd_progress(framenum - 1, cfile.count, &next_update))
+      break;
+
     fdata = sharkd_get_frame(framenum);
 
-    if (!wtap_seek_read(cfile.provider.wth, fdata->file_off, &rec, &buf, &err, &err_info))
+    if (!wtap_seek_read(cfile.provider.wth, fdata->file_off, &rec, &buf, &err, &err_info)) {
+      sharkd_release_frame(fdata);
       break;
+    }
 
     fdata->ref_time = FALSE;
     fdata->frame_ref_num = (framenum != 1) ? 1 : 0;
@@ -614,64 +885,140 @@ sharkd_retap(void)
                                fdata, cinfo);
     wtap_rec_reset(&rec);
     epan_dissect_reset(&edt);
+    sharkd_release_frame(fdata);
   }
 
   wtap_rec_cleanup(&rec);
   ws_buffer_free(&buf);
   epan_dissect_cleanup(&edt);
 
-  draw_tap_listeners(TRUE);
-
-  return 0;
+  return progress_stopped ? -1 : 0;
 }
 
+/*
+ * Dissects the frames whose bit is set in filter_bits, or all frames if
+ * it's NULL, and calls cb with the protocol tree of each one. The tree
+ * isn't visible: it's only sure to have the fields hfids.
+ *
+ * Returns -1 if the progress function asked to stop, -2 if a frame
+ * couldn't be read.
+ */
 int
-sharkd_filter(const char *dftext, guint8 **result)
+sharkd_dissect_fields(const guint8 *filter_bits, GArray *hfids,
+                      sharkd_dissect_func_t cb, void *data)
 {
-  dfilter_t  *dfcode = NULL;
-
-  guint32 framenum, prev_dis_num = 0;
-  guint32 frames_count;
-  Buffer buf;
-  wtap_rec rec;
+  guint32          framenum;
+  frame_data      *fdata;
+  Buffer           buf;
+  wtap_rec         rec;
   int err;
   char *err_info = NULL;
 
-  guint8 *result_bits;
-  guint8  passed_bits;
-
   epan_dissect_t edt;
+  gint64        next_update = 0;
+  gboolean      read_failed = FALSE;
 
-  if (!dfilter_compile(dftext, &dfcode, &err_info)) {
-    g_free(err_info);
-    return -1;
-  }
+  wtap_rec_init(&rec);
+  ws_buffer_init(&buf, 1514);
+  epan_dissect_init(&edt, cfile.epan, TRUE, FALSE);
 
-  /* if dfilter_compile() success, but (dfcode == NULL) all frames are matching */
-  if (dfcode == NULL) {
-    *result = NULL;
-    return 0;
+  progress_stopped = FALSE;
+
+  for (framenum = 1; framenum <= cfile.count; framenum++) {
+    if (!sharkd_progress(framenum - 1, cfile.count, &next_update))
+      break;
+
+    if (filter_bits && !(filter_bits[framenum / 8] & (1 << (framenum % 8))))
+      continue;
+
+    fdata = sharkd_get_frame(framenum);
+
+    if (!wtap_seek_read(cfile.provider.wth, fdata->file_off, &rec, &buf, &err, &err_info)) {
+      g_free(err_info);
+      sharkd_release_frame(fdata);
+      read_failed = TRUE;
+      break;
+    }
+
+    /* Resetting the tree forgets the fields it was primed with. */
+    epan_dissect_prime_with_hfid_array(&edt, hfids);
+
+    fdata->ref_time = FALSE;
+    fdata->frame_ref_num = (framenum != 1) ? 1 : 0;
+    fdata->prev_dis_num = framenum - 1;
+    epan_dissect_run(&edt, cfile.cd_t, &rec,
+                     frame_tvbuff_new_buffer(&cfile.provider, fdata, &buf),
+                     fdata, NULL);
+
+    cb(&edt, edt.tree, NULL, NULL, data);
+
+    wtap_rec_reset(&rec);
+    epan_dissect_reset(&edt);
+    sharkd_release_frame(fdata);
   }
 
-  frames_count = cfile.count;
+  wtap_rec_cleanup(&rec);
+  ws_buffer_free(&buf);
+  epan_dissect_cleanup(&edt);
+
+  if (read_failed)
+    return -2;
+  return progress_stopped ? -1 : 0;
+}
+
+/*
+ * Applies a filter to the frames first..last and sets the bits of the
+ * frames that pass in result_bits, which covers all frames. Frames that
+ * candidates, if not NULL, rules out are skipped.
+ *
+ * Returns the number of the first frame that wasn't done: last + 1,
+ * unless a frame couldn't be read or the progress function (or, if
+ * progress_func is NULL, sharkd_progress()) asked to stop.
+ */
+static guint32
+sharkd_filter_frames(dfilter_t *dfcode, guint32 first, guint32 last,
+                     const guint8 *candidates, guint8 *result_bits,
+                     gboolean (*worker_progress)(guint32 done, void *data),
+                     void *worker_data)
+{
+  guint32 framenum, prev_dis_num = 0;
+  guint32 reported = first;
+  gint64 next_update = 0;
+  Buffer buf;
+  wtap_rec rec;
+  int err;
+  char *err_info = NULL;
+
+  epan_dissect_t edt;
 
   wtap_rec_init(&rec);
   ws_buffer_init(&buf, 1514);
   epan_dissect_init(&edt, cfile.epan, TRUE, FALSE);
 
-  passed_bits = 0;
-  result_bits = (guint8 *) g_malloc(2 + (frames_count / 8));
+  for (framenum = first; framenum <= last; framenum++) {
+    frame_data *fdata;
 
-  for (framenum = 1; framenum <= frames_count; framenum++) {
-    frame_data *fdata = sharkd_get_frame(framenum);
-
-    if ((framenum & 7) == 0) {
-      result_bits[(framenum / 8) - 1] = passed_bits;
-      passed_bits = 0;
+    if (worker_progress != NULL) {
+      if ((framenum & (SHARKD_FILTER_WORKER_PROGRESS_FRAMES - 1)) == 0) {
+        if (!worker_progress(framenum - reported, worker_data))
+          break;
+        reported = framenum;
+      }
+    } else if (!sharkd_progress(framenum - first, last - first + 1, &next_update)) {
+      break;
     }
 
-    if (!wtap_seek_read(cfile.provider.wth, fdata->file_off, &rec, &buf, &err, &err_info))
+    /* The index says this frame can't match. */
+    if (candidates != NULL && !((candidates[framenum / 8] >> (framenum % 8)) & 1))
+      continue;
+
+    fdata = sharkd_get_frame(framenum);
+
+    if (!wtap_seek_read(cfile.provider.wth, fdata->file_off, &rec, &buf, &err, &err_info)) {
+      g_free(err_info);
+      sharkd_release_frame(fdata);
       break;
+    }
 
     /* frame_data_set_before_dissect */
     epan_dissect_prime_with_dfilter(&edt, dfcode);
@@ -684,7 +1031,7 @@ sharkd_filter(const char *dftext, guint8 **result)
                      fdata, NULL);
 
     if (dfilter_apply_edt(dfcode, &edt)) {
-      passed_bits |= (1 << (framenum % 8));
+      result_bits[framenum / 8] |= (1 << (framenum % 8));
       prev_dis_num = framenum;
     }
 
@@ -692,16 +1039,399 @@ sharkd_filter(const char *dftext, guint8 **result)
 
     wtap_rec_reset(&rec);
     epan_dissect_reset(&edt);
+    sharkd_release_frame(fdata);
   }
 
-  if ((framenum & 7) == 0)
-      framenum--;
-  result_bits[framenum / 8] = passed_bits;
-
   wtap_rec_cleanup(&rec);
   ws_buffer_free(&buf);
   epan_dissect_cleanup(&edt);
 
+  return framenum;
+}
+
+#ifndef _WIN32
+/*
+ * Applying a filter to a large file is split up between worker processes,
+ * each of which does a range of frames. Dissection isn't thread-safe, but
+ * a fork()ed worker has its own copy of the dissection state, so this is
+ * as safe as sharkd_daemon.c forking a process per session.
+ *
+ * A worker reports its progress and, at the end, its result over a pipe:
+ * a message with the frame number it stopped at, followed by the bytes of
+ * the result bitmap that cover its range.
+ */
+#define SHARKD_FILTER_WORKER_PROGRESS 1
+#define SHARKD_FILTER_WORKER_RESULT   2
+
+typedef struct {
+  guint32 type;
+  guint32 value;    /* frames done since last time, or frame stopped at */
+} sharkd_filter_worker_msg;
+
+typedef struct {
+  pid_t   pid;
+  int     fd;       /* -1 when done */
+  guint32 first;
+  guint32 last;
+  guint32 stopped;  /* first frame not done */
+} sharkd_filter_worker;
+
+static gboolean
+sharkd_filter_write(int fd, const void *data, size_t len)
+{
+  const char *p = (const char *) data;
+  ssize_t written;
+
+  while (len > 0) {
+    written = write(fd, p, len);
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written <= 0)
+      return FALSE;
+    p += written;
+    len -= written;
+  }
+  return TRUE;
+}
+
+static gboolean
+sharkd_filter_read(int fd, void *data, size_t len)
+{
+  char *p = (char *) data;
+  ssize_t got;
+
+  while (len > 0) {
+    got = read(fd, p, len);
+    if (got < 0 && errno == EINTR)
+      continue;
+    if (got <= 0)
+      return FALSE;
+    p += got;
+    len -= got;
+  }
+  return TRUE;
+}
+
+static gboolean
+sharkd_filter_worker_progress(guint32 done, void *data)
+{
+  sharkd_filter_worker_msg msg = { SHARKD_FILTER_WORKER_PROGRESS, done };
+
+  return sharkd_filter_write(*(int *) data, &msg, sizeof(msg));
+}
+
+static void G_GNUC_NORETURN
+sharkd_filter_worker_main(int fd, dfilter_t *dfcode, guint32 first, guint32 last,
+                          const guint8 *candidates, guint8 *result_bits)
+{
+  sharkd_filter_worker_msg msg = { SHARKD_FILTER_WORKER_RESULT, first };
+  int err;
+
+  /* Don't share the file offset with the other processes. */
+  if (wtap_fdreopen(cfile.provider.wth, cfile.filename, &err))
+    msg.value = sharkd_filter_frames(dfcode, first, last, candidates, result_bits,
+                                     sharkd_filter_worker_progress, &fd);
+
+  if (sharkd_filter_write(fd, &msg, sizeof(msg)))
+    sharkd_filter_write(fd, &result_bits[first / 8], last / 8 - first / 8 + 1);
+
+  /* Don't run atexit() handlers or flush stdio buffers of the parent. */
+  _exit(0);
+}
+
+static void
+sharkd_filter_stop_worker(sharkd_filter_worker *worker, gboolean kill_it)
+{
+  if (worker->fd != -1) {
+    close(worker->fd);
+    worker->fd = -1;
+  }
+  if (worker->pid > 0) {
+    if (kill_it)
+      kill(worker->pid, SIGKILL);
+    /* Fails with ECHILD if SIGCHLD is ignored, which is fine. */
+    while (waitpid(worker->pid, NULL, 0) < 0 && errno == EINTR)
+      ;
+    worker->pid = 0;
+  }
+}
+
+/*
+ * Applies a filter to frames 1..frames_count with num_workers processes,
+ * and sets *stopped to the first frame that wasn't done, as the return
+ * value of sharkd_filter_frames(). Returns FALSE if the workers couldn't
+ * be started.
+ */
+static gboolean
+sharkd_filter_parallel(dfilter_t *dfcode, guint32 frames_count, int num_workers,
+                       const guint8 *candidates, guint8 *result_bits,
+                       guint32 *stopped)
+{
+  sharkd_filter_worker *workers;
+  struct pollfd *fds;
+  guint32 chunk, done = 0;
+  gint64 next_update = 0;
+  int running = 0;
+  int i, j;
+
+  /* Ranges start at a multiple of 8 frames, so that workers don't share
+     bytes of the bitmap. */
+  chunk = ((frames_count / num_workers) + 7) & ~7u;
+
+  workers = g_new0(sharkd_filter_worker, num_workers);
+  fds = g_new(struct pollfd, num_workers);
+
+  /* The workers must not write what the parent has buffered. */
+  fflush(stdout);
+  fflush(stderr);
+
+  for (i = 0; i < num_workers; i++) {
+    sharkd_filter_worker *worker = &workers[i];
+    int pipe_fds[2];
+
+    worker->first = (i == 0) ? 1 : (guint32) i * chunk;
+    worker->last = (i == num_workers - 1) ? frames_count : (guint32) (i + 1) * chunk - 1;
+    worker->stopped = worker->first;
+    worker->fd = -1;
+
+    if (pipe(pipe_fds) < 0)
+      break;
+
+    worker->pid = fork();
+    if (worker->pid == 0) {
+      close(pipe_fds[0]);
+      for (j = 0; j < i; j++)
+        close(workers[j].fd);
+      sharkd_filter_worker_main(pipe_fds[1], dfcode, worker->first, worker->last,
+                                candidates, result_bits);
+    }
+
+    close(pipe_fds[1]);
+    if (worker->pid < 0) {
+      close(pipe_fds[0]);
+      worker->pid = 0;
+      break;
+    }
+    worker->fd = pipe_fds[0];
+    running++;
+  }
+
+  if (i < num_workers) {
+    /* Not all workers could be started; do it the simple way. */
+    for (j = 0; j < i; j++)
+      sharkd_filter_stop_worker(&workers[j], TRUE);
+    g_free(fds);
+    g_free(workers);
+    return FALSE;
+  }
+
+  while (running > 0) {
+    int num_fds = 0;
+
+    for (i = 0; i < num_workers; i++) {
+      if (workers[i].fd != -1) {
+        fds[num_fds].fd = workers[i].fd;
+        fds[num_fds].events = POLLIN;
+        fds[num_fds].revents = 0;
+        num_fds++;
+      }
+    }
+
+    if (poll(fds, num_fds, SHARKD_PROGRESS_INTERVAL / 1000) < 0 && errno != EINTR)
+      break;
+
+    for (i = 0; i < num_workers; i++) {
+      sharkd_filter_worker *worker = &workers[i];
+      sharkd_filter_worker_msg msg;
+
+      if (worker->fd == -1)
+        continue;
+      for (j = 0; j < num_fds; j++) {
+        if (fds[j].fd == worker->fd)
+          break;
+      }
+      if (j == num_fds || fds[j].revents == 0)
+        continue;
+
+      if (!sharkd_filter_read(worker->fd, &msg, sizeof(msg))) {
+        /* The worker died without a result. */
+        sharkd_filter_stop_worker(worker, FALSE);
+        running--;
+      } else if (msg.type == SHARKD_FILTER_WORKER_PROGRESS) {
+        done += msg.value;
+      } else {
+        if (sharkd_filter_read(worker->fd, &result_bits[worker->first / 8],
+                               worker->last / 8 - worker->first / 8 + 1))
+          worker->stopped = msg.value;
+        else
+          memset(&result_bits[worker->first / 8], 0, worker->last / 8 - worker->first / 8 + 1);
+        sharkd_filter_stop_worker(worker, FALSE);
+        running--;
+      }
+    }
+
+    if (!sharkd_progress(done, frames_count, &next_update))
+      break;
+  }
+
+  *stopped = frames_count + 1;
+  for (i = 0; i < num_workers; i++) {
+    sharkd_filter_stop_worker(&workers[i], TRUE);
+    if (workers[i].stopped <= workers[i].last && workers[i].stopped < *stopped)
+      *stopped = workers[i].stopped;
+  }
+
+  g_free(fds);
+  g_free(workers);
+
+  return TRUE;
+}
+#endif
+
+/*
+ * Returns the number of worker processes to apply a filter with, or 1
+ * to apply it in this process.
+ */
+static int
+sharkd_filter_num_workers(dfilter_t *dfcode, guint32 frames_count)
+{
+#ifndef _WIN32
+  epan_dissect_t edt;
+  gboolean depends_on_order;
+  int num_workers;
+
+  if (frames_count < SHARKD_FILTER_PARALLEL_MIN_FRAMES)
+    return 1;
+
+  num_workers = MIN(g_get_num_processors(), SHARKD_FILTER_MAX_WORKERS);
+  if (num_workers < 2)
+    return 1;
+
+  /* A worker doesn't know which frames before its range passed. */
+  epan_dissect_init(&edt, cfile.epan, TRUE, FALSE);
+  epan_dissect_prime_with_dfilter(&edt, dfcode);
+  depends_on_order = proto_field_is_referenced(edt.tree,
+      proto_registrar_get_id_byname("frame.time_delta_displayed"));
+  epan_dissect_cleanup(&edt);
+
+  return depends_on_order ? 1 : num_workers;
+#else
+  (void) dfcode;
+  (void) frames_count;
+  return 1;
+#endif
+}
+
+/*
+ * Applies a filter to all frames. Returns -1 if the filter is invalid,
+ * -2 if the progress function asked to stop.
+ */
+int
+sharkd_filter(const char *dftext, guint8 **result)
+{
+  dfilter_t  *dfcode = NULL;
+
+  guint32 framenum;
+  guint32 frames_count;
+  char *err_info = NULL;
+  int num_workers;
+  gboolean filtered = FALSE;
+
+  guint8 *result_bits;
+  guint8 *cached_bits;
+  guint8 *candidates = NULL;
+  gboolean cache_result = FALSE;
+
+  if (!dfilter_compile(dftext, &dfcode, &err_info)) {
+    g_free(err_info);
+    return -1;
+  }
+
+  /* if dfilter_compile() success, but (dfcode == NULL) all frames are matching */
+  if (dfcode == NULL) {
+    *result = NULL;
+    return 0;
+  }
+
+  frames_count = cfile.count;
+
+  if (cfile.filter_cache == NULL)
+    cfile.filter_cache = dfilter_cache_new(SHARKD_FILTER_CACHE_MAX_ENTRIES);
+
+  /* The same filter, or the filters it is made of, might have been
+   * applied before. */
+  if (dfilter_cache_lookup(cfile.filter_cache, dfcode, frames_count, &cached_bits, NULL)) {
+    result_bits = (guint8 *) g_malloc0(2 + (frames_count / 8));
+    memcpy(result_bits, cached_bits, DFILTER_CACHE_BITMAP_SIZE(frames_count));
+    g_free(cached_bits);
+    dfilter_free(dfcode);
+
+    *result = result_bits;
+
+    framenum = frames_count + 1;
+    if ((framenum & 7) == 0)
+      framenum--;
+    return framenum;
+  }
+
+  /* The index of field values might know which frames match, or at
+   * least which frames can match. */
+  if (cfile.field_index != NULL &&
+      dfilter_index_num_frames(cfile.field_index) == frames_count) {
+    switch (dfilter_index_lookup(cfile.field_index, dfcode, &candidates)) {
+      case DFILTER_INDEX_EXACT:
+        result_bits = (guint8 *) g_malloc0(2 + (frames_count / 8));
+        memcpy(result_bits, candidates, DFILTER_CACHE_BITMAP_SIZE(frames_count));
+        g_free(candidates);
+        dfilter_cache_store(cfile.filter_cache, dfcode, frames_count, result_bits, NULL);
+        dfilter_free(dfcode);
+
+        *result = result_bits;
+
+        framenum = frames_count + 1;
+        if ((framenum & 7) == 0)
+          framenum--;
+        return framenum;
+
+      case DFILTER_INDEX_CANDIDATES:
+        break;
+
+      case DFILTER_INDEX_NONE:
+        candidates = NULL;
+        break;
+    }
+  }
+
+  result_bits = (guint8 *) g_malloc0(2 + (frames_count / 8));
+  progress_stopped = FALSE;
+
+  num_workers = sharkd_filter_num_workers(dfcode, frames_count);
+#ifndef _WIN32
+  if (num_workers > 1)
+    filtered = sharkd_filter_parallel(dfcode, frames_count, num_workers,
+                                      candidates, result_bits, &framenum);
+#endif
+  if (!filtered)
+    framenum = sharkd_filter_frames(dfcode, 1, frames_count, candidates,
+                                    result_bits, NULL, NULL);
+
+  g_free(candidates);
+
+  if (progress_stopped) {
+    g_free(result_bits);
+    dfilter_free(dfcode);
+    return -2;
+  }
+
+  if (framenum > frames_count)
+    cache_result = TRUE;
+
+  if ((framenum & 7) == 0)
+      framenum--;
+
+  if (cache_result)
+    dfilter_cache_store(cfile.filter_cache, dfcode, frames_count, result_bits, NULL);
+
   dfilter_free(dfcode);
 
   *result = result_bits;
@@ -709,6 +1439,327 @@ sharkd_filter(const char *dftext, guint8 **result)
   return framenum;
 }
 
+/*
+ * In daemon mode, the sessions that load the same capture file share the
+ * results of its first pass: the session that loaded the file forks a
+ * process that keeps them, and that forks a new session process for each
+ * client that later loads the same file. The frame table, the per-frame
+ * data of the dissectors and the packet offsets are then shared, copy on
+ * write, by all these processes, and the marks, comments and other
+ * changes of each client stay in its own session.
+ *
+ * The sessions find the process of a file through a UNIX socket in the
+ * directory of the daemon, named after the identity, size and
+ * modification time of the file, and hand their client over to it.
+ */
+#ifndef _WIN32
+typedef struct {
+  guint32 id;           /* of the load request */
+  guint32 background;   /* whether the load request is a background one */
+  guint32 pending_len;  /* bytes of input read, but not processed yet */
+} sharkd_share_join_msg;
+
+char *
+sharkd_share_path(const char *fname)
+{
+  const char *dir = sharkd_share_dir();
+  struct sockaddr_un s_un;
+  ws_statb64 st;
+  char *path;
+
+  if (dir == NULL || ws_stat64(fname, &st) != 0 || !S_ISREG(st.st_mode))
+    return NULL;
+
+  path = ws_strdup_printf("%s/%" G_GINT64_MODIFIER "x-%" G_GINT64_MODIFIER "x-%"
+                          G_GINT64_MODIFIER "x-%" G_GINT64_MODIFIER "x.sock", dir,
+                          (guint64) st.st_dev, (guint64) st.st_ino,
+                          (guint64) st.st_size, (guint64) st.st_mtime);
+  if (strlen(path) + 1 > sizeof(s_un.sun_path)) {
+    g_free(path);
+    return NULL;
+  }
+  return path;
+}
+
+static gboolean
+sharkd_share_addr(const char *path, struct sockaddr_un *s_un)
+{
+  memset(s_un, 0, sizeof(*s_un));
+  s_un->sun_family = AF_UNIX;
+  return g_strlcpy(s_un->sun_path, path, sizeof(s_un->sun_path)) < sizeof(s_un->sun_path);
+}
+
+gboolean
+sharkd_join_capture(const char *path, guint32 id, gboolean background, const char *pending, guint32 pending_len)
+{
+  sharkd_share_join_msg msg = { id, background ? 1 : 0, pending_len };
+  struct sockaddr_un s_un;
+  struct msghdr mh;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  union {
+    char buf[CMSG_SPACE(2 * sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  int fds[2] = { 0, 1 };
+  char ack;
+  int fd;
+
+  if (!sharkd_share_addr(path, &s_un))
+    return FALSE;
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return FALSE;
+
+  if (connect(fd, (struct sockaddr *) &s_un, sizeof(s_un)) < 0) {
+    /* Left over by a process that didn't exit cleanly */
+    if (errno == ECONNREFUSED)
+      ws_unlink(path);
+    close(fd);
+    return FALSE;
+  }
+
+  iov.iov_base = &msg;
+  iov.iov_len = sizeof(msg);
+  memset(&mh, 0, sizeof(mh));
+  mh.msg_iov = &iov;
+  mh.msg_iovlen = 1;
+  mh.msg_control = control.buf;
+  mh.msg_controllen = sizeof(control.buf);
+  cmsg = CMSG_FIRSTHDR(&mh);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+  /* Our client is served by the new session once it acknowledges. */
+  if (sendmsg(fd, &mh, 0) != (ssize_t) sizeof(msg) ||
+      !sharkd_filter_write(fd, pending, pending_len) ||
+      !sharkd_filter_read(fd, &ack, 1)) {
+    close(fd);
+    return FALSE;
+  }
+
+  close(fd);
+  return TRUE;
+}
+
+/*
+ * Receives a client from a session that joins the capture, and forks a
+ * session process for it. Returns TRUE in the new session process.
+ */
+static gboolean
+sharkd_share_accept(int conn, guint32 *id, gboolean *background, GString *pending)
+{
+  sharkd_share_join_msg msg;
+  struct msghdr mh;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  union {
+    char buf[CMSG_SPACE(2 * sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  int fds[2] = { -1, -1 };
+  char *data = NULL;
+  ssize_t got;
+  pid_t pid;
+
+  iov.iov_base = &msg;
+  iov.iov_len = sizeof(msg);
+  memset(&mh, 0, sizeof(mh));
+  mh.msg_iov = &iov;
+  mh.msg_iovlen = 1;
+  mh.msg_control = control.buf;
+  mh.msg_controllen = sizeof(control.buf);
+
+  do
+    got = recvmsg(conn, &mh, 0);
+  while (got < 0 && errno == EINTR);
+
+  for (cmsg = CMSG_FIRSTHDR(&mh); cmsg != NULL; cmsg = CMSG_NXTHDR(&mh, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+        cmsg->cmsg_len == CMSG_LEN(sizeof(fds)))
+      memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+  }
+
+  if (got != (ssize_t) sizeof(msg) || fds[0] == -1 || fds[1] == -1)
+    goto fail;
+
+  data = (char *) g_malloc(msg.pending_len + 1);
+  if (!sharkd_filter_read(conn, data, msg.pending_len))
+    goto fail;
+
+  pid = fork();
+  if (pid < 0)
+    goto fail;
+
+  if (pid == 0) {
+    int err;
+
+    /* Serve the client, with a file offset of our own. */
+    close(conn);
+    dup2(fds[0], 0);
+    dup2(fds[1], 1);
+    close(fds[0]);
+    close(fds[1]);
+    if (!wtap_fdreopen(cfile.provider.wth, cfile.filename, &err))
+      _exit(1);
+
+    g_string_truncate(pending, 0);
+    g_string_append_len(pending, data, msg.pending_len);
+    g_free(data);
+    *id = msg.id;
+    *background = msg.background != 0;
+    return TRUE;
+  }
+
+  /* The other end leaves it to the new session from now on. */
+  sharkd_filter_write(conn, "", 1);
+
+fail:
+  g_free(data);
+  if (fds[0] != -1)
+    close(fds[0]);
+  if (fds[1] != -1)
+    close(fds[1]);
+  return FALSE;
+}
+
+/*
+ * Keeps the capture for the sessions that join it, until the session
+ * that loaded it and all those have ended. Returns only in a new
+ * session process.
+ */
+static void
+sharkd_share_serve(int listen_fd, int alive_fd, const char *path,
+                   guint32 *id, gboolean *background, GString *pending)
+{
+  GArray *alive;
+  int null_fd;
+
+  alive = g_array_new(FALSE, FALSE, sizeof(int));
+  g_array_append_val(alive, alive_fd);
+
+  /* Don't hold the connection of the client of the session. */
+  null_fd = ws_open("/dev/null", O_RDWR, 0);
+  if (null_fd != -1) {
+    dup2(null_fd, 0);
+    dup2(null_fd, 1);
+    close(null_fd);
+  }
+
+  while (alive->len > 0) {
+    struct pollfd *fds;
+    guint i;
+
+    fds = g_new(struct pollfd, alive->len + 1);
+    fds[0].fd = listen_fd;
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    for (i = 0; i < alive->len; i++) {
+      fds[i + 1].fd = g_array_index(alive, int, i);
+      fds[i + 1].events = POLLIN;
+      fds[i + 1].revents = 0;
+    }
+
+    if (poll(fds, alive->len + 1, -1) < 0) {
+      g_free(fds);
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+
+    /* Nothing is written to these pipes; they only get closed. */
+    for (i = alive->len; i > 0; i--) {
+      if (fds[i].revents != 0) {
+        close(fds[i].fd);
+        g_array_remove_index(alive, i - 1);
+      }
+    }
+
+    if (fds[0].revents & POLLIN) {
+      int pipe_fds[2];
+      int conn;
+
+      conn = accept(listen_fd, NULL, NULL);
+      if (conn != -1 && pipe(pipe_fds) == 0) {
+        if (sharkd_share_accept(conn, id, background, pending)) {
+          /* New session */
+          close(listen_fd);
+          close(pipe_fds[0]);
+          for (i = 0; i < alive->len; i++)
+            close(g_array_index(alive, int, i));
+          g_array_free(alive, TRUE);
+          g_free(fds);
+          share_alive_fd = pipe_fds[1];
+          return;
+        }
+        /* Hangs up at once if the new session didn't start. */
+        close(pipe_fds[1]);
+        g_array_append_val(alive, pipe_fds[0]);
+      }
+      if (conn != -1)
+        close(conn);
+    }
+    g_free(fds);
+  }
+
+  ws_unlink(path);
+  _exit(0);
+}
+
+gboolean
+sharkd_share_capture(const char *path, guint32 *id, gboolean *background, GString *pending)
+{
+  struct sockaddr_un s_un;
+  int listen_fd;
+  int alive_fds[2];
+  pid_t pid;
+
+  if (!sharkd_share_addr(path, &s_un))
+    return FALSE;
+
+  listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd < 0)
+    return FALSE;
+
+  /* Fails if another session shares the file already. */
+  if (bind(listen_fd, (struct sockaddr *) &s_un, sizeof(s_un)) < 0 ||
+      listen(listen_fd, 16) < 0) {
+    close(listen_fd);
+    return FALSE;
+  }
+
+  if (pipe(alive_fds) < 0) {
+    ws_unlink(path);
+    close(listen_fd);
+    return FALSE;
+  }
+
+  fflush(stdout);
+  fflush(stderr);
+
+  pid = fork();
+  if (pid == 0) {
+    close(alive_fds[1]);
+    sharkd_share_serve(listen_fd, alive_fds[0], path, id, background, pending);
+    return TRUE;
+  }
+
+  close(listen_fd);
+  close(alive_fds[0]);
+  if (pid < 0) {
+    ws_unlink(path);
+    close(alive_fds[1]);
+    return FALSE;
+  }
+
+  share_alive_fd = alive_fds[1];
+  return FALSE;
+}
+#endif
+
 /*
  * Get the modified block if available, nothing otherwise.
  * Must be cloned if changes desired.
@@ -756,9 +1807,231 @@ int
 sharkd_set_modified_block(frame_data *fd, wtap_block_t new_block)
 {
   cap_file_provider_set_modified_block(&cfile.provider, fd, new_block);
+  dfilter_cache_clear(cfile.filter_cache);
+  sharkd_column_cache_clear();
   return 0;
 }
 
+/*
+ * Column values of frames that were dissected for a "frames" request,
+ * so that paging back and forth through the packet list doesn't dissect
+ * the same frames again.
+ *
+ * There is a set of rows for every column configuration that was asked
+ * for. Most column values repeat (protocol names, addresses, ports), so
+ * the rows point to reference counted copies that are shared by all the
+ * rows. When the cache uses more than SHARKD_COLUMN_CACHE_MAX_BYTES, the
+ * rows that were used least recently are dropped.
+ */
+struct sharkd_column_set {
+  char       *key;
+  int         num_cols;
+  GHashTable *rows;               /* frame number -> sharkd_column_row */
+};
+
+typedef struct {
+  guint refs;
+  char  str[];
+} sharkd_column_string;
+
+typedef struct {
+  GList                     link; /* in column_cache.lru, data is the row */
+  struct sharkd_column_set *set;
+  guint32                   framenum;
+  guint32                   flags;
+  const char               *values[];
+} sharkd_column_row;
+
+static struct {
+  GHashTable *sets;               /* key -> sharkd_column_set */
+  GHashTable *strings;            /* string -> sharkd_column_string */
+  GQueue      lru;                /* most recently used first */
+  gsize       size;
+} column_cache;
+
+/* What a hash table entry costs, roughly. */
+#define SHARKD_COLUMN_CACHE_ENTRY_SIZE (4 * sizeof(gpointer))
+
+static const char *
+column_cache_intern(const char *str)
+{
+  sharkd_column_string *interned;
+  size_t len;
+
+  if (str == NULL)
+    return NULL;
+
+  interned = (sharkd_column_string *) g_hash_table_lookup(column_cache.strings, str);
+  if (interned == NULL) {
+    len = strlen(str);
+    interned = (sharkd_column_string *) g_malloc(sizeof(sharkd_column_string) + len + 1);
+    interned->refs = 0;
+    memcpy(interned->str, str, len + 1);
+    g_hash_table_insert(column_cache.strings, interned->str, interned);
+    column_cache.size += sizeof(sharkd_column_string) + len + 1 + SHARKD_COLUMN_CACHE_ENTRY_SIZE;
+  }
+  interned->refs++;
+  return interned->str;
+}
+
+static void
+column_cache_release(const char *str)
+{
+  sharkd_column_string *interned;
+
+  if (str == NULL)
+    return;
+
+  interned = (sharkd_column_string *) g_hash_table_lookup(column_cache.strings, str);
+  if (--interned->refs == 0) {
+    column_cache.size -= sizeof(sharkd_column_string) + strlen(str) + 1 + SHARKD_COLUMN_CACHE_ENTRY_SIZE;
+    g_hash_table_remove(column_cache.strings, str);
+  }
+}
+
+static gsize
+column_cache_row_size(int num_cols)
+{
+  return sizeof(sharkd_column_row) + num_cols * sizeof(const char *) + SHARKD_COLUMN_CACHE_ENTRY_SIZE;
+}
+
+static void
+column_cache_remove_row(sharkd_column_row *row)
+{
+  struct sharkd_column_set *set = row->set;
+  int col;
+
+  g_queue_unlink(&column_cache.lru, &row->link);
+  g_hash_table_remove(set->rows, GUINT_TO_POINTER(row->framenum));
+  for (col = 0; col < set->num_cols; col++)
+    column_cache_release(row->values[col]);
+  column_cache.size -= column_cache_row_size(set->num_cols);
+  g_free(row);
+}
+
+static void
+column_cache_free_set(gpointer data)
+{
+  struct sharkd_column_set *set = (struct sharkd_column_set *) data;
+
+  g_hash_table_destroy(set->rows);
+  g_free(set->key);
+  g_free(set);
+}
+
+/*
+ * Returns the rows for a column configuration, which stay valid until
+ * the cache is cleared.
+ */
+struct sharkd_column_set *
+sharkd_column_cache_get_set(const column_info *cinfo)
+{
+  struct sharkd_column_set *set;
+  GString *key;
+  int col;
+
+  if (column_cache.sets == NULL) {
+    column_cache.sets = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, column_cache_free_set);
+    column_cache.strings = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+    g_queue_init(&column_cache.lru);
+  }
+
+  key = g_string_new(NULL);
+  for (col = 0; col < cinfo->num_cols; col++) {
+    const col_item_t *col_item = &cinfo->columns[col];
+
+    g_string_append_printf(key, "%d:%d:%s\n", col_item->col_fmt,
+                           col_item->col_custom_occurrence,
+                           (col_item->col_fmt == COL_CUSTOM) ? col_item->col_custom_fields : "");
+  }
+
+  set = (struct sharkd_column_set *) g_hash_table_lookup(column_cache.sets, key->str);
+  if (set == NULL) {
+    set = g_new(struct sharkd_column_set, 1);
+    set->key = g_string_free(key, FALSE);
+    set->num_cols = cinfo->num_cols;
+    set->rows = g_hash_table_new(g_direct_hash, g_direct_equal);
+    g_hash_table_insert(column_cache.sets, set->key, set);
+  } else {
+    g_string_free(key, TRUE);
+  }
+
+  return set;
+}
+
+/*
+ * Returns the column values of a frame, if they are cached, along with
+ * the SHARKD_COLUMN_ROW_ flags they were stored with. The values stay
+ * valid until the next call that stores values.
+ */
+const char * const *
+sharkd_column_cache_lookup(struct sharkd_column_set *set, guint32 framenum, guint32 *flags)
+{
+  sharkd_column_row *row;
+
+  row = (sharkd_column_row *) g_hash_table_lookup(set->rows, GUINT_TO_POINTER(framenum));
+  if (row == NULL)
+    return NULL;
+
+  g_queue_unlink(&column_cache.lru, &row->link);
+  g_queue_push_head_link(&column_cache.lru, &row->link);
+
+  *flags = row->flags;
+  return row->values;
+}
+
+void
+sharkd_column_cache_store(struct sharkd_column_set *set, guint32 framenum,
+                          const column_info *cinfo, guint32 flags)
+{
+  sharkd_column_row *row;
+  int col;
+
+  ws_assert(cinfo->num_cols == set->num_cols);
+
+  row = (sharkd_column_row *) g_hash_table_lookup(set->rows, GUINT_TO_POINTER(framenum));
+  if (row != NULL)
+    column_cache_remove_row(row);
+
+  row = (sharkd_column_row *) g_malloc(sizeof(sharkd_column_row) + set->num_cols * sizeof(const char *));
+  row->link.data = row;
+  row->link.prev = row->link.next = NULL;
+  row->set = set;
+  row->framenum = framenum;
+  row->flags = flags;
+  for (col = 0; col < set->num_cols; col++)
+    row->values[col] = column_cache_intern(cinfo->columns[col].col_data);
+
+  g_hash_table_insert(set->rows, GUINT_TO_POINTER(framenum), row);
+  g_queue_push_head_link(&column_cache.lru, &row->link);
+  column_cache.size += column_cache_row_size(set->num_cols);
+
+  /* Keep the row just stored, even if it alone is over budget. */
+  while (column_cache.size > SHARKD_COLUMN_CACHE_MAX_BYTES &&
+         column_cache.lru.tail != &row->link)
+    column_cache_remove_row((sharkd_column_row *) column_cache.lru.tail->data);
+}
+
+/*
+ * Forgets all column values, because a change (of preferences or of
+ * packet comments) might change them.
+ */
+void
+sharkd_column_cache_clear(void)
+{
+  if (column_cache.sets == NULL)
+    return;
+
+  while (column_cache.lru.tail != NULL)
+    column_cache_remove_row((sharkd_column_row *) column_cache.lru.tail->data);
+
+  g_hash_table_destroy(column_cache.sets);
+  g_hash_table_destroy(column_cache.strings);
+  column_cache.sets = NULL;
+  column_cache.strings = NULL;
+  column_cache.size = 0;
+}
+
 /*
  * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
  *
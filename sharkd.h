@@ -21,19 +21,28 @@
 #define SHARKD_DISSECT_FLAG_PROTO_TREE 0x04u
 #define SHARKD_DISSECT_FLAG_COLOR      0x08u
 
+/* Flags of the column values of a frame in the column cache */
+#define SHARKD_COLUMN_ROW_COMMENTED    0x01u
+
 #define SHARKD_MODE_CLASSIC_CONSOLE    1
 #define SHARKD_MODE_CLASSIC_DAEMON     2
 #define SHARKD_MODE_GOLD_CONSOLE       3
 #define SHARKD_MODE_GOLD_DAEMON        4
 
 typedef void (*sharkd_dissect_func_t)(epan_dissect_t *edt, proto_tree *tree, struct epan_column_info *cinfo, const GSList *data_src, void *data);
+/* Returns FALSE to stop the pass over the frames */
+typedef gboolean (*sharkd_progress_func_t)(guint32 done, guint32 total, void *data);
 
 /* sharkd.c */
 cf_status_t sharkd_cf_open(const char *fname, unsigned int type, gboolean is_tempfile, int *err);
 int sharkd_load_cap_file(void);
+gboolean sharkd_load_progress(gint64 *bytes_read, gint64 *elapsed);
 int sharkd_retap(void);
 int sharkd_filter(const char *dftext, guint8 **result);
+int sharkd_dissect_fields(const guint8 *filter_bits, GArray *hfids, sharkd_dissect_func_t cb, void *data);
+void sharkd_set_progress_func(sharkd_progress_func_t func, void *data);
 frame_data *sharkd_get_frame(guint32 framenum);
+void sharkd_release_frame(frame_data *fdata);
 enum dissect_request_status {
   DISSECT_REQUEST_SUCCESS,
   DISSECT_REQUEST_NO_SUCH_FRAME,
@@ -48,11 +57,21 @@ sharkd_dissect_request(guint32 framenum, guint32 frame_ref_num,
 wtap_block_t sharkd_get_modified_block(const frame_data *fd);
 wtap_block_t sharkd_get_packet_block(const frame_data *fd);
 int sharkd_set_modified_block(frame_data *fd, wtap_block_t new_block);
+struct sharkd_column_set *sharkd_column_cache_get_set(const column_info *cinfo);
+const char * const *sharkd_column_cache_lookup(struct sharkd_column_set *set, guint32 framenum, guint32 *flags);
+void sharkd_column_cache_store(struct sharkd_column_set *set, guint32 framenum, const column_info *cinfo, guint32 flags);
+void sharkd_column_cache_clear(void);
+#ifndef _WIN32
+char *sharkd_share_path(const char *fname);
+gboolean sharkd_join_capture(const char *path, guint32 id, gboolean background, const char *pending, guint32 pending_len);
+gboolean sharkd_share_capture(const char *path, guint32 *id, gboolean *background, GString *pending);
+#endif
 const char *sharkd_version(void);
 
 /* sharkd_daemon.c */
 int sharkd_init(int argc, char **argv);
 int sharkd_loop(int argc _U_, char* argv[] _U_);
+const char *sharkd_share_dir(void);
 
 /* sharkd_session.c */
 int sharkd_session_main(int mode_setting);
@@ -52,6 +52,8 @@
 
 static int mode = 0;
 static socket_handle_t _server_fd = INVALID_SOCKET;
+/* Sockets of the capture files shared by the sessions, see sharkd_share_capture() */
+static char *_share_dir = NULL;
 
 static socket_handle_t
 socket_init(char *path)
@@ -367,6 +369,10 @@ sharkd_loop(int argc _U_, char* argv[])
 		return sharkd_session_main(mode);
 	}
 
+#ifndef _WIN32
+	_share_dir = g_dir_make_tmp("sharkd-XXXXXX", NULL);
+#endif
+
 	while (1)
 	{
 #ifndef _WIN32
@@ -465,6 +471,12 @@ sharkd_loop(int argc _U_, char* argv[])
 	return 0;
 }
 
+const char *
+sharkd_share_dir(void)
+{
+	return _share_dir;
+}
+
 /*
  * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
  *
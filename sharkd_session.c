@@ -70,6 +70,11 @@
 
 #include <wsutil/pint.h>
 #include <wsutil/strtoi.h>
+#include <wsutil/file_util.h>
+
+#ifndef _WIN32
+#include <poll.h>
+#endif
 
 #include "globals.h"
 
@@ -85,8 +90,43 @@ static GHashTable *filter_table = NULL;
 static int mode;
 static guint32 rpcid;
 
+/* The request being processed, which a "cancel" request can stop. */
+static gboolean request_running;
+static guint32 running_rpcid;
+static gboolean cancel_requested;
+
+/* A preference was changed, so the dissection differs from the one of
+ * other sessions. */
+static gboolean prefs_changed;
+
+/* Requests read, but not processed yet */
+static GString *input_buf;
+static gboolean input_eof;
+
 static json_dumper dumper = {0};
 
+/* Bytes of downloaded data in each partial result */
+#define SHARKD_STREAM_DATA_BYTES (64 * 1024)
+
+/*
+ * Elements of the large arrays of a response that are sent in each
+ * "partial" notification when streaming, see sharkd_json_stream_begin(),
+ * or 0 to send the whole arrays in the response.
+ */
+static guint32 stream_rows;
+
+static struct
+{
+	gboolean active;
+	FILE *response_file;    /* holds the response while it's streamed */
+	json_dumper response;   /* state of the response, while a partial result is written */
+	json_dumper partial;    /* state of the partial result, while the response is written */
+	const char *key;        /* of the array of the partial result */
+	const char *tap;
+	guint32 seq;            /* of the next partial result */
+	guint32 rows;           /* in the partial result written */
+} stream;
+
 
 static const char *
 json_find_attr(const char *buf, const jsmntok_t *tokens, int count, const char *attr)
@@ -182,11 +222,16 @@ sharkd_json_response_open(guint32 id)
 	sharkd_json_value_anyf("id", "%d", id);
 }
 
+static void sharkd_json_stream_end(void);
+
 static void
 sharkd_json_response_close(void)
 {
 	json_dumper_finish(&dumper);
 
+	if (stream.active)
+		sharkd_json_stream_end();
+
 	/*
 	 * We do an explicit fflush after every line, because
 	 * we want output to be written to the socket as soon
@@ -216,6 +261,8 @@ static void
 sharkd_json_result_epilogue(void)
 {
 	json_dumper_end_object(&dumper);  // end the result object
+	if (stream.active)
+		sharkd_json_value_anyf("partials", "%u", stream.seq);
 	json_dumper_end_object(&dumper);  // end the message
 	sharkd_json_response_close();
 }
@@ -231,10 +278,170 @@ static void
 sharkd_json_result_array_epilogue(void)
 {
 	sharkd_json_array_close();        // end of result array
+	if (stream.active)
+		sharkd_json_value_anyf("partials", "%u", stream.seq);
 	json_dumper_end_object(&dumper);  // end the message
 	sharkd_json_response_close();
 }
 
+/*
+ * Streams the response being started: the elements of its large arrays,
+ * written between sharkd_json_stream_row_open() and _close(), are sent
+ * as soon as there are stream_rows of them, in notifications with
+ * attributes:
+ *   (m) id    - id of the request
+ *   (m) seq   - sequence number of the partial result, from 0
+ *   (o) tap   - name of the tap the elements are from
+ *   (m) <key> - array of elements
+ *
+ * The response follows the last partial result, with empty arrays, and
+ * "partials", the number of partial results, next to "result".
+ *
+ * As the partial results are written as soon as they are complete, a
+ * client that reads slowly blocks the session instead of letting the
+ * response pile up in memory.
+ */
+static void
+sharkd_json_stream_begin(void)
+{
+	if (stream_rows == 0)
+		return;
+
+	/* The response is written after the partial results. */
+	stream.response_file = tmpfile();
+	if (stream.response_file == NULL)
+		return;
+
+	memset(&stream.partial, 0, sizeof(stream.partial));
+	stream.partial.output_file = stdout;
+	dumper.output_file = stream.response_file;
+	stream.active = TRUE;
+	stream.key = NULL;
+	stream.tap = NULL;
+	stream.seq = 0;
+	stream.rows = 0;
+}
+
+static void
+sharkd_json_stream_partial_close(void)
+{
+	json_dumper_end_array(&stream.partial);
+	json_dumper_end_object(&stream.partial);  // end the params
+	json_dumper_end_object(&stream.partial);  // end the message
+	json_dumper_finish(&stream.partial);
+	fflush(stdout);
+
+	stream.key = NULL;
+	stream.rows = 0;
+}
+
+/*
+ * Starts an element of the array key, from the tap named tap if not NULL.
+ * Elements are written with the usual functions until the matching
+ * sharkd_json_stream_row_close().
+ */
+static void
+sharkd_json_stream_row_open(const char *key, const char *tap)
+{
+	if (!stream.active)
+		return;
+
+	if (stream.key && (strcmp(stream.key, key) || g_strcmp0(stream.tap, tap)))
+		sharkd_json_stream_partial_close();
+
+	stream.response = dumper;
+	dumper = stream.partial;
+
+	if (stream.key == NULL)
+	{
+		json_dumper_begin_object(&dumper);
+		sharkd_json_value_string("jsonrpc", "2.0");
+		sharkd_json_value_string("method", "partial");
+		sharkd_json_value_anyf("params", NULL);
+		json_dumper_begin_object(&dumper);
+		sharkd_json_value_anyf("id", "%u", rpcid);
+		sharkd_json_value_anyf("seq", "%u", stream.seq++);
+		if (tap)
+			sharkd_json_value_string("tap", tap);
+		sharkd_json_array_open(key);
+		stream.key = key;
+		stream.tap = tap;
+	}
+}
+
+static void
+sharkd_json_stream_row_close(void)
+{
+	if (!stream.active)
+		return;
+
+	stream.partial = dumper;
+	dumper = stream.response;
+
+	if (++stream.rows == stream_rows)
+		sharkd_json_stream_partial_close();
+}
+
+/*
+ * Writes binary data as the string key of the response, or in partial
+ * results of SHARKD_STREAM_DATA_BYTES when streaming.
+ */
+static void
+sharkd_json_stream_base64(const char *key, const guint8 *data, size_t len)
+{
+	size_t off;
+
+	if (!stream.active)
+	{
+		sharkd_json_value_base64(key, data, len);
+		return;
+	}
+
+	for (off = 0; off < len; off += SHARKD_STREAM_DATA_BYTES)
+	{
+		size_t chunk = MIN(len - off, SHARKD_STREAM_DATA_BYTES);
+
+		stream.response = dumper;
+		dumper = stream.partial;
+
+		json_dumper_begin_object(&dumper);
+		sharkd_json_value_string("jsonrpc", "2.0");
+		sharkd_json_value_string("method", "partial");
+		sharkd_json_value_anyf("params", NULL);
+		json_dumper_begin_object(&dumper);
+		sharkd_json_value_anyf("id", "%u", rpcid);
+		sharkd_json_value_anyf("seq", "%u", stream.seq++);
+		sharkd_json_value_base64(key, data + off, chunk);
+		json_dumper_end_object(&dumper);
+		json_dumper_end_object(&dumper);
+		json_dumper_finish(&dumper);
+		fflush(stdout);
+
+		stream.partial = dumper;
+		dumper = stream.response;
+	}
+}
+
+/* Sends the rest of the partial results, and the response after them. */
+static void
+sharkd_json_stream_end(void)
+{
+	char copy[8192];
+	size_t len;
+
+	if (stream.key)
+		sharkd_json_stream_partial_close();
+
+	rewind(stream.response_file);
+	while ((len = fread(copy, 1, sizeof(copy), stream.response_file)) > 0)
+		fwrite(copy, 1, len, stdout);
+	fclose(stream.response_file);
+	stream.response_file = NULL;
+
+	dumper.output_file = stdout;
+	stream.active = FALSE;
+}
+
 static void
 sharkd_json_simple_ok(guint32 id)
 {
@@ -283,6 +490,15 @@ sharkd_json_error(guint32 id, int code, char* data, char* format, ...)
 	sharkd_json_response_close();
 }
 
+static void
+sharkd_json_cancelled(guint32 id)
+{
+	sharkd_json_error(
+		id, -32800, NULL,
+		"Request cancelled"
+	);
+}
+
 static gboolean
 is_param_match(const char *param_in, const char *valid_param)
 {
@@ -363,11 +579,14 @@ json_prep(char* buf, const jsmntok_t* tokens, int count)
 
 		// Valid methods
 		{"method",     "analyse",    1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"method",     "bytes",      1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"method",     "bye",        1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"method",     "cancel",     1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"method",     "check",      1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"method",     "complete",   1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"method",     "download",   1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"method",     "dumpconf",   1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"method",     "extract",    1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"method",     "follow",     1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"method",     "frame",      1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"method",     "frames",     1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
@@ -377,16 +596,40 @@ json_prep(char* buf, const jsmntok_t* tokens, int count)
 		{"method",     "load",       1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"method",     "setcomment", 1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"method",     "setconf",    1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"method",     "stream",     1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"method",     "status",     1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"method",     "tap",        1, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 
 		// Parameters and their method context
+		{"bytes",      "frame",      2, JSMN_PRIMITIVE,    SHARKD_JSON_UINTEGER, MANDATORY},
+		{"bytes",      "ds",         2, JSMN_PRIMITIVE,    SHARKD_JSON_UINTEGER, OPTIONAL},
+		{"bytes",      "offset",     2, JSMN_PRIMITIVE,    SHARKD_JSON_UINTEGER, OPTIONAL},
+		{"bytes",      "length",     2, JSMN_PRIMITIVE,    SHARKD_JSON_UINTEGER, OPTIONAL},
+		{"cancel",     "request",    2, JSMN_PRIMITIVE,    SHARKD_JSON_UINTEGER, MANDATORY},
 		{"check",      "field",      2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"check",      "filter",     2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"complete",   "field",      2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"complete",   "pref",       2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"download",   "token",      2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"dumpconf",   "pref",       2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"extract",    "filter",     2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"extract",    "binary",     2, JSMN_PRIMITIVE,    SHARKD_JSON_BOOLEAN,  OPTIONAL},
+		{"extract",    "field0",     2, JSMN_STRING,       SHARKD_JSON_STRING,   MANDATORY},
+		{"extract",    "field1",     2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"extract",    "field2",     2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"extract",    "field3",     2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"extract",    "field4",     2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"extract",    "field5",     2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"extract",    "field6",     2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"extract",    "field7",     2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"extract",    "field8",     2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"extract",    "field9",     2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"extract",    "field10",    2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"extract",    "field11",    2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"extract",    "field12",    2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"extract",    "field13",    2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"extract",    "field14",    2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
+		{"extract",    "field15",    2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"follow",     "follow",     2, JSMN_STRING,       SHARKD_JSON_STRING,   MANDATORY},
 		{"follow",     "filter",     2, JSMN_STRING,       SHARKD_JSON_STRING,   MANDATORY},
 		{"frame",      "frame",      2, JSMN_PRIMITIVE,    SHARKD_JSON_UINTEGER, MANDATORY},
@@ -397,6 +640,7 @@ json_prep(char* buf, const jsmntok_t* tokens, int count)
 		{"frame",      "color",      2, JSMN_PRIMITIVE,    SHARKD_JSON_BOOLEAN,  OPTIONAL},
 		{"frame",      "bytes",      2, JSMN_PRIMITIVE,    SHARKD_JSON_BOOLEAN,  OPTIONAL},
 		{"frame",      "hidden",     2, JSMN_PRIMITIVE,    SHARKD_JSON_BOOLEAN,  OPTIONAL},
+		{"frame",      "lazy",       2, JSMN_PRIMITIVE,    SHARKD_JSON_BOOLEAN,  OPTIONAL},
 		{"frames",     "column*",    2, JSMN_UNDEFINED,    SHARKD_JSON_ANY,      OPTIONAL},
 		{"frames",     "filter",     2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"frames",     "skip",       2, JSMN_PRIMITIVE,    SHARKD_JSON_UINTEGER, OPTIONAL},
@@ -427,10 +671,12 @@ json_prep(char* buf, const jsmntok_t* tokens, int count)
 		{"iograph",    "filter8",    2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"iograph",    "filter9",    2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"load",       "file",       2, JSMN_STRING,       SHARKD_JSON_STRING,   MANDATORY},
+		{"load",       "background", 2, JSMN_PRIMITIVE,    SHARKD_JSON_BOOLEAN,  OPTIONAL},
 		{"setcomment", "frame",      2, JSMN_PRIMITIVE,    SHARKD_JSON_UINTEGER, MANDATORY},
 		{"setcomment", "comment",    2, JSMN_STRING,       SHARKD_JSON_STRING,   OPTIONAL},
 		{"setconf",    "name",       2, JSMN_STRING,       SHARKD_JSON_STRING,   MANDATORY},
 		{"setconf",    "value",      2, JSMN_UNDEFINED,    SHARKD_JSON_ANY,      MANDATORY},
+		{"stream",     "rows",       2, JSMN_PRIMITIVE,    SHARKD_JSON_UINTEGER, OPTIONAL},
 		{"tap",        "tap0",       2, JSMN_STRING,       SHARKD_JSON_STRING, MANDATORY},
 		{"tap",        "tap1",       2, JSMN_STRING,       SHARKD_JSON_STRING, OPTIONAL},
 		{"tap",        "tap2",       2, JSMN_STRING,       SHARKD_JSON_STRING, OPTIONAL},
@@ -721,7 +967,7 @@ sharkd_session_filter_data(const char *filter)
 
 		int ret = sharkd_filter(filter, &filtered);
 
-		if (ret == -1)
+		if (ret < 0)
 			return NULL;
 
 		l = g_new(struct sharkd_filter_item, 1);
@@ -1043,21 +1289,73 @@ sharkd_session_process_info(void)
 	sharkd_json_result_epilogue();
 }
 
+static void sharkd_iograph_store_clear(void);
+static void sharkd_frame_cache_clear(void);
+
 /**
  * sharkd_session_process_load()
  *
  * Process load request
  *
+ * In daemon mode, the sessions that load the same file share the results
+ * of its first pass, unless they have changed preferences.
+ *
+ * While the file is read, the request reports its progress, and the
+ * interactive requests ("status", "frames", "frame", "intervals"...) are
+ * answered with the frames read so far. Cancelling the request stops
+ * the reading, but keeps these frames.
+ *
  * Input:
  *   (m) file - file to be loaded
+ *   (o) background - set if respond before reading the file, and send
+ *                    a "loaded" notification once it's read
  *
  * Output object with attributes:
  *   (m) err - error code
+ *   (o) job - if background, id of the load, as in its notifications
+ *
+ * Notification "loaded", if background, with attributes:
+ *   (m) id        - id of the load request
+ *   (m) frames    - number of frames read
+ *   (o) cancelled - if the load was cancelled
+ *   (o) error     - if the file couldn't be read to the end, why
  */
+static void
+sharkd_session_loaded(guint32 id, int err)
+{
+	json_dumper_begin_object(&dumper);
+	sharkd_json_value_string("jsonrpc", "2.0");
+	sharkd_json_value_string("method", "loaded");
+	sharkd_json_value_anyf("params", NULL);
+	json_dumper_begin_object(&dumper);
+	sharkd_json_value_anyf("id", "%u", id);
+	sharkd_json_value_anyf("frames", "%u", cfile.count);
+	if (cancel_requested)
+		sharkd_json_value_anyf("cancelled", "true");
+	else if (err == ENOMEM)
+		sharkd_json_value_string("error", "Load failed, out of memory");
+	else if (err != 0)
+		sharkd_json_value_string("error", wtap_strerror(err));
+	json_dumper_end_object(&dumper);
+	json_dumper_end_object(&dumper);
+	sharkd_json_response_close();
+}
+
+static void
+sharkd_session_load_job(guint32 id)
+{
+	sharkd_json_result_prologue(id);
+	sharkd_json_value_string("status", "OK");
+	sharkd_json_value_anyf("job", "%u", id);
+	sharkd_json_result_epilogue();
+}
+
 static void
 sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
 {
 	const char *tok_file = json_find_attr(buf, tokens, count, "file");
+	gboolean background = (json_find_attr(buf, tokens, count, "background") != NULL);
+	char *share_path = NULL;
 	int err = 0;
 
 	if (!tok_file)
@@ -1065,34 +1363,97 @@ sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
 
 	fprintf(stderr, "load: filename=%s\n", tok_file);
 
+#ifndef _WIN32
+	/* If another session has loaded the file, use its first pass. */
+	if (!prefs_changed)
+		share_path = sharkd_share_path(tok_file);
+
+	if (share_path && sharkd_join_capture(share_path, rpcid, background, input_buf->str, (guint32) input_buf->len))
+	{
+		/* A new session of the process that has the file answers. */
+		fprintf(stderr, "load: joined the session of %s\n", share_path);
+		exit(0);
+	}
+#endif
+
+	sharkd_iograph_store_clear();
+	sharkd_frame_cache_clear();
+
 	if (sharkd_cf_open(tok_file, WTAP_TYPE_AUTO, FALSE, &err) != CF_OK)
 	{
 		sharkd_json_error(
 			rpcid, -2001, NULL,
 			"Unable to open the file"
 		);
+		g_free(share_path);
 		return;
 	}
 
+	if (background)
+		sharkd_session_load_job(rpcid);
+
 	TRY
 	{
 		err = sharkd_load_cap_file();
 	}
 	CATCH(OutOfMemoryError)
 	{
-		sharkd_json_error(
-			rpcid, -32603, NULL,
-			"Load failed, out of memory"
-		);
+		if (!background)
+			sharkd_json_error(
+				rpcid, -32603, NULL,
+				"Load failed, out of memory"
+			);
 		fprintf(stderr, "load: OutOfMemoryError\n");
 		err = ENOMEM;
 	}
 	ENDTRY;
 
-	if (err == 0)
+	/* The frames shown while reading might change with the frames read after them. */
+	sharkd_frame_cache_clear();
+
+#ifndef _WIN32
+	if (err == 0 && !cancel_requested && share_path)
+	{
+#ifdef HAVE_MAXMINDDB
+		/* As before the daemon forks, stop mmdbresolve so that the
+		 * processes don't share it. */
+		uat_clear(uat_get_table_by_name("MaxMind Database Paths"));
+#endif
+		if (sharkd_share_capture(share_path, &rpcid, &background, input_buf))
+		{
+			/* New session, for a client that loaded the same file
+			 * with a load request of its own */
+			running_rpcid = rpcid;
+			input_eof = FALSE;
+			stream_rows = 0;
+			if (background)
+				sharkd_session_load_job(rpcid);
+		}
+#ifdef HAVE_MAXMINDDB
+		uat_get_table_by_name("MaxMind Database Paths")->post_update_cb();
+#endif
+	}
+#endif
+	g_free(share_path);
+
+	if (background)
+		sharkd_session_loaded(rpcid, err);
+	else if (cancel_requested)
+		sharkd_json_cancelled(rpcid);
+	else if (err == 0)
 		sharkd_json_simple_ok(rpcid);
 }
 
+/* Estimates the seconds left to read a file of file_size bytes. */
+static double
+sharkd_load_eta(gint64 bytes_read, gint64 file_size, gint64 elapsed)
+{
+	if (bytes_read >= file_size)
+		return 0.0;
+
+	return (double) elapsed / G_USEC_PER_SEC * (double) (file_size - bytes_read) / (double) bytes_read;
+}
+
 /**
  * sharkd_session_process_status()
  *
@@ -1103,10 +1464,15 @@ sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
  *   (m) duration - time difference between time of first frame, and last loaded frame
  *   (o) filename - capture filename
  *   (o) filesize - capture filesize
+ *   (o) loading  - set while the capture is being loaded, with:
+ *   (o) bytes    - bytes of the capture read so far
+ *   (o) eta      - estimated seconds until the capture is loaded
  */
 static void
 sharkd_session_process_status(void)
 {
+	gint64 bytes_read, elapsed;
+
 	sharkd_json_result_prologue(rpcid);
 
 	sharkd_json_value_anyf("frames", "%u", cfile.count);
@@ -1126,6 +1492,14 @@ sharkd_session_process_status(void)
 
 		if (file_size > 0)
 			sharkd_json_value_anyf("filesize", "%" PRId64, file_size);
+
+		if (sharkd_load_progress(&bytes_read, &elapsed))
+		{
+			sharkd_json_value_anyf("loading", "true");
+			sharkd_json_value_anyf("bytes", "%" PRId64, bytes_read);
+			if (file_size > 0 && bytes_read > 0)
+				sharkd_json_value_anyf("eta", "%.1f", sharkd_load_eta(bytes_read, file_size, elapsed));
+		}
 	}
 
 	sharkd_json_result_epilogue();
@@ -1320,40 +1694,21 @@ sharkd_session_create_columns(column_info *cinfo, const char *buf, const jsmntok
 }
 
 static void
-sharkd_session_process_frames_cb(epan_dissect_t *edt, proto_tree *tree _U_,
-    struct epan_column_info *cinfo, const GSList *data_src _U_, void *data _U_)
+sharkd_session_process_frames_row(const frame_data *fdata, const char * const *values, int num_cols, gboolean commented)
 {
-	packet_info *pi = &edt->pi;
-	frame_data *fdata = pi->fd;
-	wtap_block_t pkt_block = NULL;
-	char *comment;
-
+	sharkd_json_stream_row_open("frames", NULL);
 	json_dumper_begin_object(&dumper);
 
 	sharkd_json_array_open("c");
-	for (int col = 0; col < cinfo->num_cols; ++col)
+	for (int col = 0; col < num_cols; ++col)
 	{
-		const col_item_t *col_item = &cinfo->columns[col];
-
-		sharkd_json_value_string(NULL, col_item->col_data);
+		sharkd_json_value_string(NULL, values[col]);
 	}
 	sharkd_json_array_close();
 
-	sharkd_json_value_anyf("num", "%u", pi->num);
-
-	/*
-	 * Get the block for this record, if it has one.
-	 */
-	if (fdata->has_modified_block)
-		pkt_block = sharkd_get_modified_block(fdata);
-	else
-		pkt_block = pi->rec->block;
+	sharkd_json_value_anyf("num", "%u", fdata->num);
 
-	/*
-	 * Does this record have any comments?
-	 */
-	if (pkt_block != NULL &&
-	    WTAP_OPTTYPE_SUCCESS == wtap_block_get_nth_string_option_value(pkt_block, OPT_COMMENT, 0, &comment))
+	if (commented)
 		sharkd_json_value_anyf("ct", "true");
 
 	if (fdata->ignored)
@@ -1369,6 +1724,43 @@ sharkd_session_process_frames_cb(epan_dissect_t *edt, proto_tree *tree _U_,
 	}
 
 	json_dumper_end_object(&dumper);
+	sharkd_json_stream_row_close();
+}
+
+static void
+sharkd_session_process_frames_cb(epan_dissect_t *edt, proto_tree *tree _U_,
+    struct epan_column_info *cinfo, const GSList *data_src _U_, void *data)
+{
+	struct sharkd_column_set *column_set = (struct sharkd_column_set *) data;
+	packet_info *pi = &edt->pi;
+	frame_data *fdata = pi->fd;
+	wtap_block_t pkt_block = NULL;
+	const char **values;
+	gboolean commented;
+	char *comment;
+
+	/*
+	 * Get the block for this record, if it has one.
+	 */
+	if (fdata->has_modified_block)
+		pkt_block = sharkd_get_modified_block(fdata);
+	else
+		pkt_block = pi->rec->block;
+
+	/*
+	 * Does this record have any comments?
+	 */
+	commented = (pkt_block != NULL &&
+	    WTAP_OPTTYPE_SUCCESS == wtap_block_get_nth_string_option_value(pkt_block, OPT_COMMENT, 0, &comment));
+
+	values = g_new(const char *, cinfo->num_cols);
+	for (int col = 0; col < cinfo->num_cols; ++col)
+		values[col] = cinfo->columns[col].col_data;
+	sharkd_session_process_frames_row(fdata, values, cinfo->num_cols, commented);
+	g_free(values);
+
+	sharkd_column_cache_store(column_set, fdata->num, cinfo,
+	    commented ? SHARKD_COLUMN_ROW_COMMENTED : 0);
 }
 
 /**
@@ -1384,6 +1776,9 @@ sharkd_session_process_frames_cb(epan_dissect_t *edt, proto_tree *tree _U_,
  *   (o) limit=N  - show only N frames
  *   (o) refs  - list (comma separated) with sorted time reference frame numbers.
  *
+ * The column values of the frames are remembered, so requesting frames
+ * again, e.g. when paging back, doesn't dissect them again.
+ *
  * Output array of frames with attributes:
  *   (m) c   - array of column data
  *   (m) num - frame number
@@ -1412,6 +1807,7 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
 	Buffer rec_buf;   /* Record data */
 	column_info *cinfo = &cfile.cinfo;
 	column_info user_cinfo;
+	struct sharkd_column_set *column_set;
 
 	if (tok_column)
 	{
@@ -1434,10 +1830,15 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
 		filter_item = sharkd_session_filter_data(tok_filter);
 		if (!filter_item)
 		{
-			sharkd_json_error(
-				rpcid, -13002, NULL,
-				"Filter expression invalid"
-			);
+			if (cancel_requested)
+				sharkd_json_cancelled(rpcid);
+			else
+				sharkd_json_error(
+					rpcid, -13002, NULL,
+					"Filter expression invalid"
+				);
+			if (cinfo != &cfile.cinfo)
+				col_cleanup(cinfo);
 			return;
 		}
 
@@ -1464,6 +1865,9 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
 			return;
 	}
 
+	column_set = sharkd_column_cache_get_set(cinfo);
+
+	sharkd_json_stream_begin();
 	sharkd_json_result_array_prologue(rpcid);
 
 	wtap_rec_init(&rec);
@@ -1473,6 +1877,9 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
 	{
 		frame_data *fdata;
 		enum dissect_request_status status;
+		const char * const *values;
+		guint32 row_flags;
+		guint32 dissect_flags;
 		int err;
 		gchar *err_info;
 
@@ -1509,11 +1916,26 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
 		}
 
 		fdata = sharkd_get_frame(framenum);
+
+		values = sharkd_column_cache_lookup(column_set, framenum, &row_flags);
+		if (values)
+		{
+			sharkd_session_process_frames_row(fdata, values, cinfo->num_cols,
+			    (row_flags & SHARKD_COLUMN_ROW_COMMENTED) != 0);
+			sharkd_release_frame(fdata);
+			if (limit && --limit == 0)
+				break;
+			continue;
+		}
+
+		dissect_flags = (fdata->color_filter == NULL) ? SHARKD_DISSECT_FLAG_COLOR : SHARKD_DISSECT_FLAG_NULL;
+		sharkd_release_frame(fdata);
+
 		status = sharkd_dissect_request(framenum,
 		    (framenum != 1) ? 1 : 0, framenum - 1,
 		    &rec, &rec_buf, cinfo,
-		    (fdata->color_filter == NULL) ? SHARKD_DISSECT_FLAG_COLOR : SHARKD_DISSECT_FLAG_NULL,
-		    &sharkd_session_process_frames_cb, NULL,
+		    dissect_flags,
+		    &sharkd_session_process_frames_cb, column_set,
 		    &err, &err_info);
 		switch (status) {
 
@@ -1821,6 +2243,7 @@ struct sharkd_conv_tap_data
 	conv_hash_t hash;
 	gboolean resolve_name;
 	gboolean resolve_port;
+	gboolean first_pass; /* hash is a table filled when the file was loaded */
 };
 
 static gboolean
@@ -2177,6 +2600,7 @@ sharkd_session_process_tap_conv_cb(void *arg)
 			char *src_port, *dst_port;
 			char *filter_str;
 
+			sharkd_json_stream_row_open("convs", iu->type);
 			json_dumper_begin_object(&dumper);
 
 			sharkd_json_value_string("saddr", (src_addr = get_conversation_address(NULL, &iui->src_address, iu->resolve_name)));
@@ -2216,6 +2640,7 @@ sharkd_session_process_tap_conv_cb(void *arg)
 				with_geoip = 1;
 
 			json_dumper_end_object(&dumper);
+			sharkd_json_stream_row_close();
 		}
 	}
 	else if (iu->hash.conv_array != NULL && !strncmp(iu->type, "endpt:", 6))
@@ -2226,6 +2651,7 @@ sharkd_session_process_tap_conv_cb(void *arg)
 			char *host_str, *port_str;
 			char *filter_str;
 
+			sharkd_json_stream_row_open("hosts", iu->type);
 			json_dumper_begin_object(&dumper);
 
 			sharkd_json_value_string("host", (host_str = get_conversation_address(NULL, &host->myaddress, iu->resolve_name)));
@@ -2255,6 +2681,7 @@ sharkd_session_process_tap_conv_cb(void *arg)
 			if (sharkd_session_geoip_addr(&(host->myaddress), ""))
 				with_geoip = 1;
 			json_dumper_end_object(&dumper);
+			sharkd_json_stream_row_close();
 		}
 	}
 	sharkd_json_array_close();
@@ -2271,7 +2698,11 @@ sharkd_session_free_tap_conv_cb(void *arg)
 	conv_hash_t *hash = (conv_hash_t *) arg;
 	struct sharkd_conv_tap_data *iu = (struct sharkd_conv_tap_data *) hash->user_data;
 
-	if (!strncmp(iu->type, "conv:", 5))
+	if (iu->first_pass)
+	{
+		/* not ours */
+	}
+	else if (!strncmp(iu->type, "conv:", 5))
 	{
 		reset_conversation_table_data(hash);
 	}
@@ -2788,6 +3219,7 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 	void *taps_data[16];
 	GFreeFunc taps_free[16];
 	int taps_count = 0;
+	int first_pass_count = 0; /* taps answered from the tables filled when loading */
 	int i;
 
 	rtpstream_tapinfo_t rtp_tapinfo =
@@ -2882,6 +3314,7 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 			const char *ct_tapname;
 			struct sharkd_conv_tap_data *ct_data;
 			tap_packet_cb tap_func = NULL;
+			const conv_hash_t *first_pass_hash;
 
 			if (!strncmp(tok_tap, "conv:", 5))
 			{
@@ -2922,6 +3355,17 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 
 			ct_data = g_new0(struct sharkd_conv_tap_data, 1);
 			ct_data->type = tok_tap;
+
+			/* If the table was filled when loading the file, the listener
+			 * only outputs it and there is nothing to tap. */
+			first_pass_hash = conversation_table_first_pass_lookup(cfile.conv_tables, ct, !strncmp(tok_tap, "endpt:", 6));
+			if (first_pass_hash && tap_filter[0] == '\0')
+			{
+				ct_data->hash = *first_pass_hash;
+				ct_data->first_pass = TRUE;
+				tap_func = NULL;
+				first_pass_count++;
+			}
 			ct_data->hash.user_data = ct_data;
 
 			/* XXX: make configurable */
@@ -3138,11 +3582,19 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
 		return;
 	}
 
-	sharkd_json_result_prologue(rpcid);
-	sharkd_json_array_open("taps");
-	sharkd_retap();
-	sharkd_json_array_close();
-	sharkd_json_result_epilogue();
+	if (first_pass_count < taps_count && sharkd_retap() < 0)
+	{
+		sharkd_json_cancelled(rpcid);
+	}
+	else
+	{
+		sharkd_json_stream_begin();
+		sharkd_json_result_prologue(rpcid);
+		sharkd_json_array_open("taps");
+		draw_tap_listeners(TRUE);
+		sharkd_json_array_close();
+		sharkd_json_result_epilogue();
+	}
 
 	for (i = 0; i < taps_count; i++)
 	{
@@ -3216,7 +3668,13 @@ sharkd_session_process_follow(char *buf, const jsmntok_t *tokens, int count)
 		return;
 	}
 
-	sharkd_retap();
+	if (sharkd_retap() < 0)
+	{
+		sharkd_json_cancelled(rpcid);
+		remove_tap_listener(follow_info);
+		follow_info_free(follow_info);
+		return;
+	}
 
 	sharkd_json_result_prologue(rpcid);
 
@@ -3409,35 +3867,276 @@ sharkd_follower_visit_layers_cb(const void *key _U_, void *value, void *user_dat
 	return FALSE;
 }
 
-struct sharkd_frame_request_data
+#define SHARKD_FRAME_CACHE_MAX_BYTES   (16 * 1024 * 1024)
+#define SHARKD_FRAME_SOURCES_MAX_BYTES (64 * 1024 * 1024)
+
+/*
+ * Responses to "frame" requests, so that going back and forth through
+ * the packet list doesn't dissect and serialize the same frames again,
+ * and the data sources of the frames shown last, so that "bytes" requests
+ * can send parts of large reassembled buffers without dissecting the
+ * frame again. When they use more than their limit, the entries that
+ * were used least recently are dropped. Both are cleared whenever the
+ * dissection might change.
+ */
+struct sharkd_frame_response
 {
-	gboolean display_hidden;
+	GList link;             /* in frame_cache.lru, data is the response */
+	char *key;
+	size_t len;
+	char text[];
 };
 
-static void
-sharkd_session_process_frame_cb(epan_dissect_t *edt, proto_tree *tree, struct epan_column_info *cinfo, const GSList *data_src, void *data)
+struct sharkd_frame_source
 {
-	packet_info *pi = &edt->pi;
-	frame_data *fdata = pi->fd;
-	wtap_block_t pkt_block = NULL;
+	char *name;
+	guint len;
+	guint8 *data;
+};
 
-	const struct sharkd_frame_request_data * const req_data = (const struct sharkd_frame_request_data * const) data;
-	const gboolean display_hidden = (req_data) ? req_data->display_hidden : FALSE;
+struct sharkd_frame_sources
+{
+	GList link;             /* in frame_cache.sources_lru, data is the sources */
+	guint32 framenum;
+	size_t size;
+	guint num_sources;
+	struct sharkd_frame_source sources[];
+};
 
-	sharkd_json_result_prologue(rpcid);
+static struct
+{
+	FILE *file;             /* where responses are serialized before being stored */
+	GHashTable *responses;  /* key -> sharkd_frame_response */
+	GQueue lru;             /* most recently used first */
+	size_t size;
+	GHashTable *sources;    /* frame number -> sharkd_frame_sources */
+	GQueue sources_lru;     /* most recently used first */
+	size_t sources_size;
+} frame_cache;
 
-	if (fdata->has_modified_block)
-		pkt_block = sharkd_get_modified_block(fdata);
-	else
-		pkt_block = pi->rec->block;
+static void
+sharkd_frame_response_free(gpointer data)
+{
+	struct sharkd_frame_response *resp = (struct sharkd_frame_response *) data;
 
-	if (pkt_block)
+	g_free(resp->key);
+	g_free(resp);
+}
+
+static void
+sharkd_frame_sources_free(gpointer data)
+{
+	struct sharkd_frame_sources *srcs = (struct sharkd_frame_sources *) data;
+	guint i;
+
+	for (i = 0; i < srcs->num_sources; i++)
 	{
-		guint i;
-		guint n;
-		gchar *comment;
+		g_free(srcs->sources[i].name);
+		wmem_free(NULL, srcs->sources[i].data);
+	}
+	g_free(srcs);
+}
 
-		n = wtap_block_count_option(pkt_block, OPT_COMMENT);
+static void
+sharkd_frame_cache_init(void)
+{
+	if (frame_cache.responses)
+		return;
+
+	frame_cache.responses = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, sharkd_frame_response_free);
+	frame_cache.sources = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, sharkd_frame_sources_free);
+	g_queue_init(&frame_cache.lru);
+	g_queue_init(&frame_cache.sources_lru);
+}
+
+static void
+sharkd_frame_cache_clear(void)
+{
+	if (!frame_cache.responses)
+		return;
+
+	g_queue_init(&frame_cache.lru);
+	g_queue_init(&frame_cache.sources_lru);
+	g_hash_table_remove_all(frame_cache.responses);
+	g_hash_table_remove_all(frame_cache.sources);
+	frame_cache.size = 0;
+	frame_cache.sources_size = 0;
+}
+
+static const struct sharkd_frame_response *
+sharkd_frame_cache_lookup(const char *key)
+{
+	struct sharkd_frame_response *resp;
+
+	sharkd_frame_cache_init();
+
+	resp = (struct sharkd_frame_response *) g_hash_table_lookup(frame_cache.responses, key);
+	if (resp)
+	{
+		g_queue_unlink(&frame_cache.lru, &resp->link);
+		g_queue_push_head_link(&frame_cache.lru, &resp->link);
+	}
+	return resp;
+}
+
+/* Stores the response text of len bytes read from file, takes key. */
+static const struct sharkd_frame_response *
+sharkd_frame_cache_store(char *key, FILE *file, size_t len)
+{
+	struct sharkd_frame_response *resp;
+
+	sharkd_frame_cache_init();
+
+	resp = (struct sharkd_frame_response *) g_malloc(sizeof(*resp) + len + 1);
+	resp->key = key;
+	resp->len = len;
+	resp->link.data = resp;
+	resp->link.prev = resp->link.next = NULL;
+	if (fread(resp->text, 1, len, file) != len)
+	{
+		sharkd_frame_response_free(resp);
+		return NULL;
+	}
+	resp->text[len] = '\0';
+
+	/* Responses larger than a quarter of the cache are sent, but not kept. */
+	if (len > SHARKD_FRAME_CACHE_MAX_BYTES / 4)
+		return resp;
+
+	while (frame_cache.size + len > SHARKD_FRAME_CACHE_MAX_BYTES)
+	{
+		struct sharkd_frame_response *old = (struct sharkd_frame_response *) frame_cache.lru.tail->data;
+
+		g_queue_unlink(&frame_cache.lru, &old->link);
+		frame_cache.size -= old->len;
+		g_hash_table_remove(frame_cache.responses, old->key);
+	}
+
+	g_hash_table_replace(frame_cache.responses, resp->key, resp);
+	g_queue_push_head_link(&frame_cache.lru, &resp->link);
+	frame_cache.size += len;
+	return resp;
+}
+
+static gboolean
+sharkd_frame_response_cached(const struct sharkd_frame_response *resp)
+{
+	return g_hash_table_lookup(frame_cache.responses, resp->key) == resp;
+}
+
+static struct sharkd_frame_sources *
+sharkd_frame_sources_lookup(guint32 framenum)
+{
+	struct sharkd_frame_sources *srcs;
+
+	sharkd_frame_cache_init();
+
+	srcs = (struct sharkd_frame_sources *) g_hash_table_lookup(frame_cache.sources, GUINT_TO_POINTER(framenum));
+	if (srcs)
+	{
+		g_queue_unlink(&frame_cache.sources_lru, &srcs->link);
+		g_queue_push_head_link(&frame_cache.sources_lru, &srcs->link);
+	}
+	return srcs;
+}
+
+static void
+sharkd_frame_sources_store(guint32 framenum, const GSList *data_src)
+{
+	struct sharkd_frame_sources *srcs;
+	guint num_sources = g_slist_length((GSList *) data_src);
+	guint i;
+
+	sharkd_frame_cache_init();
+
+	if (g_hash_table_lookup(frame_cache.sources, GUINT_TO_POINTER(framenum)))
+		return;
+
+	srcs = (struct sharkd_frame_sources *) g_malloc(sizeof(*srcs) + num_sources * sizeof(srcs->sources[0]));
+	srcs->link.data = srcs;
+	srcs->link.prev = srcs->link.next = NULL;
+	srcs->framenum = framenum;
+	srcs->num_sources = num_sources;
+	srcs->size = sizeof(*srcs) + num_sources * sizeof(srcs->sources[0]);
+
+	for (i = 0; i < num_sources; i++, data_src = data_src->next)
+	{
+		struct data_source *src = (struct data_source *) data_src->data;
+		tvbuff_t *tvb = get_data_source_tvb(src);
+		char *src_name = get_data_source_name(src);
+
+		srcs->sources[i].name = g_strdup(src_name);
+		wmem_free(NULL, src_name);
+		srcs->sources[i].len = tvb_captured_length(tvb);
+		srcs->sources[i].data = (guint8 *) tvb_memdup(NULL, tvb, 0, srcs->sources[i].len);
+		srcs->size += srcs->sources[i].len;
+	}
+
+	if (srcs->size > SHARKD_FRAME_SOURCES_MAX_BYTES)
+	{
+		sharkd_frame_sources_free(srcs);
+		return;
+	}
+
+	while (frame_cache.sources_size + srcs->size > SHARKD_FRAME_SOURCES_MAX_BYTES)
+	{
+		struct sharkd_frame_sources *old = (struct sharkd_frame_sources *) frame_cache.sources_lru.tail->data;
+
+		g_queue_unlink(&frame_cache.sources_lru, &old->link);
+		frame_cache.sources_size -= old->size;
+		g_hash_table_remove(frame_cache.sources, GUINT_TO_POINTER(old->framenum));
+	}
+
+	g_hash_table_insert(frame_cache.sources, GUINT_TO_POINTER(framenum), srcs);
+	g_queue_push_head_link(&frame_cache.sources_lru, &srcs->link);
+	frame_cache.sources_size += srcs->size;
+}
+
+/* Sends a response of the cache as the result of the current request. */
+static void
+sharkd_session_frame_response(const struct sharkd_frame_response *resp)
+{
+	sharkd_json_response_open(rpcid);
+	sharkd_json_value_anyf("result", "%s", resp->text);
+	json_dumper_end_object(&dumper);
+	sharkd_json_response_close();
+}
+
+struct sharkd_frame_request_data
+{
+	gboolean display_hidden;
+	gboolean lazy_sources;
+	gboolean capture;       /* write only the result object, to be cached */
+};
+
+static void
+sharkd_session_process_frame_cb(epan_dissect_t *edt, proto_tree *tree, struct epan_column_info *cinfo, const GSList *data_src, void *data)
+{
+	packet_info *pi = &edt->pi;
+	frame_data *fdata = pi->fd;
+	wtap_block_t pkt_block = NULL;
+
+	const struct sharkd_frame_request_data * const req_data = (const struct sharkd_frame_request_data * const) data;
+	const gboolean display_hidden = (req_data) ? req_data->display_hidden : FALSE;
+	const gboolean lazy_sources = (req_data) ? req_data->lazy_sources : FALSE;
+
+	if (req_data && req_data->capture)
+		json_dumper_begin_object(&dumper);
+	else
+		sharkd_json_result_prologue(rpcid);
+
+	if (fdata->has_modified_block)
+		pkt_block = sharkd_get_modified_block(fdata);
+	else
+		pkt_block = pi->rec->block;
+
+	if (pkt_block)
+	{
+		guint i;
+		guint n;
+		gchar *comment;
+
+		n = wtap_block_count_option(pkt_block, OPT_COMMENT);
 
 		sharkd_json_array_open("comment");
 		for (i = 0; i < n; i++) {
@@ -3525,6 +4224,10 @@ sharkd_session_process_frame_cb(epan_dissect_t *edt, proto_tree *tree, struct ep
 			sharkd_json_value_base64("bytes", "", 0);
 		}
 
+		/* Reassembled data can be large, keep it for "bytes" requests. */
+		if (data_src->next)
+			sharkd_frame_sources_store(fdata->num, data_src);
+
 		data_src = data_src->next;
 		if (data_src)
 		{
@@ -3548,7 +4251,11 @@ sharkd_session_process_frame_cb(epan_dissect_t *edt, proto_tree *tree, struct ep
 			tvb = get_data_source_tvb(src);
 			length = tvb_captured_length(tvb);
 
-			if (length != 0)
+			if (lazy_sources)
+			{
+				sharkd_json_value_anyf("len", "%u", length);
+			}
+			else if (length != 0)
 			{
 				const guchar *cp = tvb_get_ptr(tvb, 0, length);
 
@@ -3574,11 +4281,40 @@ sharkd_session_process_frame_cb(epan_dissect_t *edt, proto_tree *tree, struct ep
 	follow_iterate_followers(sharkd_follower_visit_layers_cb, pi);
 	sharkd_json_array_close();
 
-	sharkd_json_result_epilogue();
+	if (req_data && req_data->capture)
+	{
+		json_dumper_end_object(&dumper);
+		json_dumper_finish(&dumper);
+	}
+	else
+		sharkd_json_result_epilogue();
 }
 
 #define SHARKD_IOGRAPH_MAX_ITEMS 250000 /* 250k limit of items is taken from wireshark-qt, on x86_64 sizeof(io_graph_item_t) is 152, so single graph can take max 36 MB */
 
+#define SHARKD_IOGRAPH_STORE_MAX_GRAPHS 8
+#define SHARKD_IOGRAPH_STORE_MAX_ITEMS 100000 /* items of the finest interval of a store */
+#define SHARKD_IOGRAPH_STORE_MAX_LEVELS 10
+
+/*
+ * Items of a graph for the intervals base_interval, 10 * base_interval,
+ * 100 * base_interval... (one level per interval, up to a single item),
+ * so that the graph can be computed again for another interval, e.g. when
+ * zooming, by merging the items of the coarsest level that divides it
+ * instead of tapping all the frames again.
+ */
+struct sharkd_iograph_store
+{
+	guint32 base_interval;
+	int num_levels;
+	int num_items[SHARKD_IOGRAPH_STORE_MAX_LEVELS];
+	io_graph_item_t *items[SHARKD_IOGRAPH_STORE_MAX_LEVELS];
+};
+
+/* Stores of the graphs computed so far, by filter and field */
+static GHashTable *iograph_store_table = NULL;
+static GQueue iograph_store_keys = G_QUEUE_INIT; /* least recently used first */
+
 struct sharkd_iograph
 {
 	/* config */
@@ -3591,8 +4327,136 @@ struct sharkd_iograph
 	int num_items;
 	io_graph_item_t *items;
 	GString *error;
+
+	/* the retap fills the store of the graph when store_key is set */
+	const struct sharkd_iograph_store *store;
+	char *store_key;
 };
 
+static void
+sharkd_iograph_store_free(void *data)
+{
+	struct sharkd_iograph_store *store = (struct sharkd_iograph_store *) data;
+	int i;
+
+	for (i = 0; i < store->num_levels; i++)
+		g_free(store->items[i]);
+	g_free(store);
+}
+
+static void
+sharkd_iograph_store_clear(void)
+{
+	char *key;
+
+	if (iograph_store_table)
+		g_hash_table_remove_all(iograph_store_table);
+	while ((key = (char *) g_queue_pop_head(&iograph_store_keys)) != NULL)
+		g_free(key);
+}
+
+/* Interval of the finest level of the stores of the current file */
+static guint32
+sharkd_iograph_store_base_interval(void)
+{
+	double duration_ms = nstime_to_msec(&cfile.elapsed_time);
+	guint32 base_interval = 1;
+
+	while (duration_ms / base_interval >= SHARKD_IOGRAPH_STORE_MAX_ITEMS)
+		base_interval *= 10;
+
+	return base_interval;
+}
+
+/* Merges every factor items into the items of a coarser interval */
+static io_graph_item_t *
+sharkd_iograph_merge_items(const io_graph_item_t *items, int num_items, guint32 factor, io_graph_item_unit_t calc_type, int *merged_num_items)
+{
+	io_graph_item_t *merged;
+	int merged_num;
+	int i;
+
+	merged_num = (int) ((num_items + factor - 1) / factor);
+	merged = g_new(io_graph_item_t, merged_num > 0 ? merged_num : 1);
+	reset_io_graph_items(merged, merged_num);
+
+	for (i = 0; i < num_items; i++)
+		merge_io_graph_item(&merged[i / factor], &items[i], calc_type);
+
+	*merged_num_items = merged_num;
+	return merged;
+}
+
+/* Takes the items tapped at the base interval as the first level of a new store */
+static const struct sharkd_iograph_store *
+sharkd_iograph_store_add(char *key, io_graph_item_t *items, int num_items, io_graph_item_unit_t calc_type)
+{
+	struct sharkd_iograph_store *store;
+
+	if (!iograph_store_table)
+		iograph_store_table = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, sharkd_iograph_store_free);
+
+	if (g_queue_get_length(&iograph_store_keys) >= SHARKD_IOGRAPH_STORE_MAX_GRAPHS)
+	{
+		char *oldest_key = (char *) g_queue_pop_head(&iograph_store_keys);
+
+		g_hash_table_remove(iograph_store_table, oldest_key);
+		g_free(oldest_key);
+	}
+
+	store = g_new0(struct sharkd_iograph_store, 1);
+	store->base_interval = sharkd_iograph_store_base_interval();
+	store->items[0] = items;
+	store->num_items[0] = num_items;
+	store->num_levels = 1;
+
+	while (store->num_levels < SHARKD_IOGRAPH_STORE_MAX_LEVELS && store->num_items[store->num_levels - 1] > 1)
+	{
+		int level = store->num_levels++;
+
+		store->items[level] = sharkd_iograph_merge_items(store->items[level - 1], store->num_items[level - 1], 10, calc_type, &store->num_items[level]);
+	}
+
+	g_hash_table_insert(iograph_store_table, key, store);
+	g_queue_push_tail(&iograph_store_keys, key);
+	return store;
+}
+
+/* Looks up a store and makes it the most recently used one */
+static const struct sharkd_iograph_store *
+sharkd_iograph_store_lookup(const char *key)
+{
+	gpointer stored_key;
+	gpointer store;
+
+	if (!iograph_store_table)
+		return NULL;
+
+	if (!g_hash_table_lookup_extended(iograph_store_table, key, &stored_key, &store))
+		return NULL;
+
+	g_queue_remove(&iograph_store_keys, stored_key);
+	g_queue_push_tail(&iograph_store_keys, stored_key);
+	return (const struct sharkd_iograph_store *) store;
+}
+
+/* Computes the items of a graph from the coarsest level of its store that divides the interval */
+static void
+sharkd_iograph_from_store(struct sharkd_iograph *graph)
+{
+	const struct sharkd_iograph_store *store = graph->store;
+	guint32 level_interval = store->base_interval;
+	int level = 0;
+
+	while (level + 1 < store->num_levels && graph->interval % (level_interval * 10) == 0)
+	{
+		level_interval *= 10;
+		level++;
+	}
+
+	graph->items = sharkd_iograph_merge_items(store->items[level], store->num_items[level], graph->interval / level_interval, graph->calc_type, &graph->num_items);
+}
+
 static tap_packet_status
 sharkd_iograph_packet(void *g, packet_info *pinfo, epan_dissect_t *edt, const void *dummy _U_)
 {
@@ -3644,6 +4508,9 @@ sharkd_iograph_packet(void *g, packet_info *pinfo, epan_dissect_t *edt, const vo
  * Graph requests can be one of: "packets", "bytes", "bits", "sum:<field>", "frames:<field>", "max:<field>", "min:<field>", "avg:<field>", "load:<field>",
  * if you use variant with <field>, you need to pass field name in filter request.
  *
+ * The items of a graph are kept for a finer interval, see sharkd_iograph_store, so that
+ * asking for the same graph with another interval doesn't tap the frames again.
+ *
  * Output object with attributes:
  *   (m) iograph - array of graph results with attributes:
  *                  errmsg - graph cannot be constructed
@@ -3715,9 +4582,38 @@ sharkd_session_process_iograph(char *buf, const jsmntok_t *tokens, int count)
 		graph->space_items = 0; /* TODO, can avoid realloc()s in sharkd_iograph_packet() by calculating: capture_time / interval */
 		graph->num_items = 0;
 		graph->items = NULL;
+		graph->store = NULL;
+		graph->store_key = NULL;
 
 		if (!graph->error)
+		{
+			/* LOAD items are updated differently, other graphs of a field share the values. */
+			char *store_key = g_strdup_printf("%s\n%s%s",
+					tok_filter ? tok_filter : "",
+					(graph->calc_type == IOG_ITEM_UNIT_CALC_LOAD) ? "load:" : "",
+					field_name ? field_name : "");
+			guint32 base_interval = sharkd_iograph_store_base_interval();
+
+			graph->store = sharkd_iograph_store_lookup(store_key);
+			if (graph->store && graph->interval % graph->store->base_interval == 0)
+			{
+				/* no need to tap */
+				g_free(store_key);
+				graph_count++;
+				continue;
+			}
+			graph->store = NULL;
+
+			if (graph->interval % base_interval == 0)
+			{
+				graph->interval = base_interval;
+				graph->store_key = store_key;
+			}
+			else
+				g_free(store_key);
+
 			graph->error = register_tap_listener("frame", graph, tok_filter, TL_REQUIRES_PROTO_TREE, NULL, sharkd_iograph_packet, NULL, NULL);
+		}
 
 		graph_count++;
 
@@ -3728,6 +4624,7 @@ sharkd_session_process_iograph(char *buf, const jsmntok_t *tokens, int count)
 				"%s", graph->error->str
 			);
 			g_string_free(graph->error, TRUE);
+			g_free(graph->store_key);
 			return;
 		}
 
@@ -3736,8 +4633,56 @@ sharkd_session_process_iograph(char *buf, const jsmntok_t *tokens, int count)
 	}
 
 	/* retap only if we have at least one ok */
-	if (is_any_ok)
-		sharkd_retap();
+	if (is_any_ok && sharkd_retap() < 0)
+	{
+		sharkd_json_cancelled(rpcid);
+		for (i = 0; i < graph_count; i++)
+		{
+			if (!graphs[i].store)
+				remove_tap_listener(&graphs[i]);
+			g_free(graphs[i].items);
+			g_free(graphs[i].store_key);
+		}
+		return;
+	}
+
+	/* Adding a store can evict another one, so the graphs that were found
+	 * in a store are computed before any of the new stores is added. */
+	for (i = 0; i < graph_count; i++)
+	{
+		struct sharkd_iograph *graph = &graphs[i];
+
+		if (graph->store)
+			sharkd_iograph_from_store(graph);
+		else
+			remove_tap_listener(graph);
+		graph->store = NULL;
+	}
+
+	for (i = 0; i < graph_count; i++)
+	{
+		struct sharkd_iograph *graph = &graphs[i];
+
+		if (!graph->store_key)
+			continue;
+
+		/* Several graphs of the request can have filled the same store. */
+		graph->store = sharkd_iograph_store_lookup(graph->store_key);
+		if (graph->store)
+		{
+			g_free(graph->items);
+			g_free(graph->store_key);
+		}
+		else
+			graph->store = sharkd_iograph_store_add(graph->store_key, graph->items, graph->num_items, graph->calc_type);
+		graph->items = NULL;
+		graph->store_key = NULL;
+		graph->interval = interval_ms;
+
+		/* before the next graph can evict the store */
+		sharkd_iograph_from_store(graph);
+		graph->store = NULL;
+	}
 
 	sharkd_json_result_prologue(rpcid);
 
@@ -3781,7 +4726,6 @@ sharkd_session_process_iograph(char *buf, const jsmntok_t *tokens, int count)
 		}
 		json_dumper_end_object(&dumper);
 
-		remove_tap_listener(graph);
 		g_free(graph->items);
 	}
 	sharkd_json_array_close();
@@ -3824,7 +4768,7 @@ sharkd_session_process_intervals(char *buf, const jsmntok_t *tokens, int count)
 		guint64 bytes;
 	} st, st_total;
 
-	nstime_t *start_ts;
+	nstime_t start_ts;
 
 	guint32 interval_ms = 1000; /* default: one per second */
 
@@ -3841,10 +4785,13 @@ sharkd_session_process_intervals(char *buf, const jsmntok_t *tokens, int count)
 		filter_item = sharkd_session_filter_data(tok_filter);
 		if (!filter_item)
 		{
-			sharkd_json_error(
-				rpcid, -7001, NULL,
-				"Invalid filter parameter: %s", tok_filter
-			);
+			if (cancel_requested)
+				sharkd_json_cancelled(rpcid);
+			else
+				sharkd_json_error(
+					rpcid, -7001, NULL,
+					"Invalid filter parameter: %s", tok_filter
+				);
 			return;
 		}
 		filter_data = filter_item->filtered;
@@ -3861,7 +4808,14 @@ sharkd_session_process_intervals(char *buf, const jsmntok_t *tokens, int count)
 	sharkd_json_result_prologue(rpcid);
 	sharkd_json_array_open("intervals");
 
-	start_ts = (cfile.count >= 1) ? &(sharkd_get_frame(1)->abs_ts) : NULL;
+	nstime_set_zero(&start_ts);
+	if (cfile.count >= 1)
+	{
+		frame_data *first = sharkd_get_frame(1);
+
+		start_ts = first->abs_ts;
+		sharkd_release_frame(first);
+	}
 
 	for (guint32 framenum = 1; framenum <= cfile.count; framenum++)
 	{
@@ -3874,7 +4828,7 @@ sharkd_session_process_intervals(char *buf, const jsmntok_t *tokens, int count)
 
 		fdata = sharkd_get_frame(framenum);
 
-		msec_rel = (fdata->abs_ts.secs - start_ts->secs) * (gint64) 1000 + (fdata->abs_ts.nsecs - start_ts->nsecs) / 1000000;
+		msec_rel = (fdata->abs_ts.secs - start_ts.secs) * (gint64) 1000 + (fdata->abs_ts.nsecs - start_ts.nsecs) / 1000000;
 		new_idx  = msec_rel / interval_ms;
 
 		if (idx != new_idx)
@@ -3897,6 +4851,8 @@ sharkd_session_process_intervals(char *buf, const jsmntok_t *tokens, int count)
 
 		st_total.frames += 1;
 		st_total.bytes  += fdata->pkt_len;
+
+		sharkd_release_frame(fdata);
 	}
 
 	if (st.frames != 0)
@@ -3912,6 +4868,423 @@ sharkd_session_process_intervals(char *buf, const jsmntok_t *tokens, int count)
 	sharkd_json_result_epilogue();
 }
 
+#define SHARKD_EXTRACT_MAX_FIELDS 16
+
+enum sharkd_extract_type
+{
+	SHARKD_EXTRACT_INT,
+	SHARKD_EXTRACT_UINT,
+	SHARKD_EXTRACT_BOOL,
+	SHARKD_EXTRACT_DOUBLE,
+	SHARKD_EXTRACT_TIME,
+	SHARKD_EXTRACT_RELTIME,
+	SHARKD_EXTRACT_STRING
+};
+
+static const char * const sharkd_extract_type_names[] =
+{
+	"int", "uint", "bool", "double", "time", "reltime", "string"
+};
+
+struct sharkd_extract_column
+{
+	const char *field;
+	header_field_info *hfinfo;  /* first field with that name */
+	enum sharkd_extract_type type;
+
+	GArray *offsets;            /* guint32, index of the first value of each frame, and the end */
+	GArray *values;             /* gint64, guint64, double or, for strings, guint32 index in dict */
+	GHashTable *dict_index;     /* string -> index in dict + 1 */
+	GPtrArray *dict;
+};
+
+struct sharkd_extract
+{
+	GArray *frames;             /* guint32 */
+	int num_columns;
+	struct sharkd_extract_column columns[SHARKD_EXTRACT_MAX_FIELDS];
+};
+
+static enum sharkd_extract_type
+sharkd_extract_type_of(ftenum_t ftype)
+{
+	if (IS_FT_INT(ftype))
+		return SHARKD_EXTRACT_INT;
+	if (IS_FT_UINT(ftype))
+		return SHARKD_EXTRACT_UINT;
+
+	switch (ftype)
+	{
+		case FT_BOOLEAN:
+			return SHARKD_EXTRACT_BOOL;
+		case FT_FLOAT:
+		case FT_DOUBLE:
+			return SHARKD_EXTRACT_DOUBLE;
+		case FT_ABSOLUTE_TIME:
+			return SHARKD_EXTRACT_TIME;
+		case FT_RELATIVE_TIME:
+			return SHARKD_EXTRACT_RELTIME;
+		default:
+			return SHARKD_EXTRACT_STRING;
+	}
+}
+
+static void
+sharkd_extract_add_value(struct sharkd_extract_column *col, field_info *finfo)
+{
+	ftenum_t ftype = finfo->hfinfo->type;
+
+	switch (col->type)
+	{
+		case SHARKD_EXTRACT_INT:
+		{
+			gint64 value = IS_FT_INT64(ftype) ? fvalue_get_sinteger64(&finfo->value) : fvalue_get_sinteger(&finfo->value);
+
+			g_array_append_val(col->values, value);
+			break;
+		}
+
+		case SHARKD_EXTRACT_UINT:
+		case SHARKD_EXTRACT_BOOL:
+		{
+			guint64 value = (IS_FT_UINT32(ftype)) ? fvalue_get_uinteger(&finfo->value) : fvalue_get_uinteger64(&finfo->value);
+
+			g_array_append_val(col->values, value);
+			break;
+		}
+
+		case SHARKD_EXTRACT_DOUBLE:
+		{
+			double value = fvalue_get_floating(&finfo->value);
+
+			g_array_append_val(col->values, value);
+			break;
+		}
+
+		case SHARKD_EXTRACT_TIME:
+		case SHARKD_EXTRACT_RELTIME:
+		{
+			const nstime_t *ts = (const nstime_t *) fvalue_get(&finfo->value);
+			gint64 value = (gint64) ts->secs * 1000000000 + ts->nsecs;
+
+			g_array_append_val(col->values, value);
+			break;
+		}
+
+		case SHARKD_EXTRACT_STRING:
+		{
+			char *str = fvalue_to_string_repr(NULL, &finfo->value, FTREPR_DISPLAY, finfo->hfinfo->display);
+			guint32 idx;
+
+			if (str == NULL)
+				str = wmem_strdup(NULL, "");
+
+			idx = GPOINTER_TO_UINT(g_hash_table_lookup(col->dict_index, str));
+			if (idx == 0)
+			{
+				char *dict_str = g_strdup(str);
+
+				g_ptr_array_add(col->dict, dict_str);
+				idx = col->dict->len;
+				g_hash_table_insert(col->dict_index, dict_str, GUINT_TO_POINTER(idx));
+			}
+			idx--;
+			g_array_append_val(col->values, idx);
+			wmem_free(NULL, str);
+			break;
+		}
+	}
+}
+
+static void
+sharkd_session_process_extract_cb(epan_dissect_t *edt, proto_tree *tree, struct epan_column_info *cinfo _U_, const GSList *data_src _U_, void *data)
+{
+	struct sharkd_extract *extract = (struct sharkd_extract *) data;
+	int i;
+
+	g_array_append_val(extract->frames, edt->pi.fd->num);
+
+	for (i = 0; i < extract->num_columns; i++)
+	{
+		struct sharkd_extract_column *col = &extract->columns[i];
+		header_field_info *hfinfo;
+		guint32 end;
+
+		for (hfinfo = col->hfinfo; hfinfo; hfinfo = hfinfo->same_name_next)
+		{
+			GPtrArray *finfos = proto_get_finfo_ptr_array(tree, hfinfo->id);
+			guint j;
+
+			for (j = 0; finfos && j < finfos->len; j++)
+				sharkd_extract_add_value(col, (field_info *) g_ptr_array_index(finfos, j));
+		}
+
+		end = col->values->len;
+		g_array_append_val(col->offsets, end);
+	}
+}
+
+/* Writes guint32 numbers, as base64 of the little-endian numbers if binary. */
+static void
+sharkd_extract_write_indexes(const char *key, GArray *array, gboolean binary)
+{
+	guint i;
+
+	if (binary)
+	{
+		json_dumper_set_member_name(&dumper, key);
+		json_dumper_begin_base64(&dumper);
+		for (i = 0; i < array->len; i++)
+		{
+			guint8 le[4];
+
+			phtole32(le, g_array_index(array, guint32, i));
+			json_dumper_write_base64(&dumper, le, sizeof(le));
+		}
+		json_dumper_end_base64(&dumper);
+		return;
+	}
+
+	sharkd_json_array_open(key);
+	for (i = 0; i < array->len; i++)
+		sharkd_json_value_anyf(NULL, "%u", g_array_index(array, guint32, i));
+	sharkd_json_array_close();
+}
+
+/* Writes the values of a column, as base64 of the little-endian numbers if binary. */
+static void
+sharkd_extract_write_values(const struct sharkd_extract_column *col, gboolean binary)
+{
+	guint i;
+
+	if (col->type == SHARKD_EXTRACT_STRING)
+	{
+		sharkd_extract_write_indexes("values", col->values, binary);
+		return;
+	}
+
+	if (binary)
+	{
+		json_dumper_set_member_name(&dumper, "values");
+		json_dumper_begin_base64(&dumper);
+		for (i = 0; i < col->values->len; i++)
+		{
+			guint64 bits;
+			guint8 le[8];
+
+			/* 64-bit integers and doubles alike */
+			memcpy(&bits, &g_array_index(col->values, guint64, i), sizeof(bits));
+			phtole64(le, bits);
+			json_dumper_write_base64(&dumper, le, sizeof(le));
+		}
+		json_dumper_end_base64(&dumper);
+		return;
+	}
+
+	sharkd_json_array_open("values");
+	for (i = 0; i < col->values->len; i++)
+	{
+		switch (col->type)
+		{
+			case SHARKD_EXTRACT_INT:
+			case SHARKD_EXTRACT_TIME:
+			case SHARKD_EXTRACT_RELTIME:
+				sharkd_json_value_anyf(NULL, "%" PRId64, g_array_index(col->values, gint64, i));
+				break;
+			case SHARKD_EXTRACT_UINT:
+				sharkd_json_value_anyf(NULL, "%" PRIu64, g_array_index(col->values, guint64, i));
+				break;
+			case SHARKD_EXTRACT_BOOL:
+				sharkd_json_value_anyf(NULL, "%s", g_array_index(col->values, guint64, i) ? "true" : "false");
+				break;
+			case SHARKD_EXTRACT_DOUBLE:
+				/* null for NaN and infinities, which JSON doesn't have */
+				json_dumper_value_double(&dumper, g_array_index(col->values, double, i));
+				break;
+			case SHARKD_EXTRACT_STRING:
+				break;
+		}
+	}
+	sharkd_json_array_close();
+}
+
+/**
+ * sharkd_session_process_extract()
+ *
+ * Process extract request: the values of some fields in all the frames
+ * that pass a filter, one array per field, to export them for analysis.
+ * Only the fields asked for are kept when dissecting the frames.
+ *
+ * Input:
+ *   (m) field0 - name of a field
+ *   (o) field1...field15 - names of more fields
+ *   (o) filter - only the frames that pass this filter
+ *   (o) binary - set if output the arrays of numbers as base64 of the
+ *                little-endian numbers: 64-bit integers or doubles for
+ *                the values, 32-bit unsigned integers for the rest
+ *
+ * Output object with attributes:
+ *   (m) frames  - array of the frame numbers
+ *   (m) fields  - array of the fields, with attributes:
+ *                  field   - name of the field
+ *                  type    - type of the values: 'int', 'uint', 'bool', 'double',
+ *                            'time' (nanoseconds since the epoch), 'reltime'
+ *                            (nanoseconds), or 'string'
+ *                  offsets - array of the index of the first value of each frame,
+ *                            and the number of values, so that the values of
+ *                            frame i are values[offsets[i]] to values[offsets[i+1]-1]
+ *                  values  - array of the values, indexes in dict for strings,
+ *                            null for doubles that are NaN or infinite unless binary
+ *                  dict    - only for type 'string', array of the distinct values
+ */
+static void
+sharkd_session_process_extract(char *buf, const jsmntok_t *tokens, int count)
+{
+	const char *tok_filter = json_find_attr(buf, tokens, count, "filter");
+	gboolean binary = (json_find_attr(buf, tokens, count, "binary") != NULL);
+	const guint8 *filter_data = NULL;
+	struct sharkd_extract extract;
+	GArray *hfids;
+	gboolean fields_ok = TRUE;
+	guint32 zero = 0;
+	int i;
+
+	if (tok_filter)
+	{
+		const struct sharkd_filter_item *filter_item;
+
+		filter_item = sharkd_session_filter_data(tok_filter);
+		if (!filter_item)
+		{
+			if (cancel_requested)
+				sharkd_json_cancelled(rpcid);
+			else
+				sharkd_json_error(
+					rpcid, -16001, NULL,
+					"Invalid filter parameter: %s", tok_filter
+				);
+			return;
+		}
+		filter_data = filter_item->filtered;
+	}
+
+	memset(&extract, 0, sizeof(extract));
+	hfids = g_array_new(FALSE, FALSE, sizeof(int));
+
+	for (i = 0; i < SHARKD_EXTRACT_MAX_FIELDS; i++)
+	{
+		struct sharkd_extract_column *col = &extract.columns[extract.num_columns];
+		header_field_info *hfinfo;
+		char tok_name[32];
+		const char *tok_field;
+
+		snprintf(tok_name, sizeof(tok_name), "field%d", i);
+		tok_field = json_find_attr(buf, tokens, count, tok_name);
+		if (!tok_field)
+			break;
+
+		hfinfo = proto_registrar_get_byname(tok_field);
+		if (!hfinfo)
+		{
+			sharkd_json_error(
+				rpcid, -16002, NULL,
+				"Invalid field parameter: %s", tok_field
+			);
+			fields_ok = FALSE;
+			break;
+		}
+
+		/* Rewind to find the first field of this name. */
+		while (hfinfo->same_name_prev_id != -1)
+			hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+
+		col->field = tok_field;
+		col->hfinfo = hfinfo;
+		col->type = sharkd_extract_type_of(hfinfo->type);
+		for (; hfinfo; hfinfo = hfinfo->same_name_next)
+		{
+			/* Fields with the same name but another type of value are written as strings. */
+			if (sharkd_extract_type_of(hfinfo->type) != col->type)
+				col->type = SHARKD_EXTRACT_STRING;
+			g_array_append_val(hfids, hfinfo->id);
+		}
+
+		col->offsets = g_array_new(FALSE, FALSE, sizeof(guint32));
+		col->values = g_array_new(FALSE, FALSE, (col->type == SHARKD_EXTRACT_STRING) ? sizeof(guint32) : sizeof(guint64));
+		if (col->type == SHARKD_EXTRACT_STRING)
+		{
+			col->dict_index = g_hash_table_new(g_str_hash, g_str_equal);
+			col->dict = g_ptr_array_new_with_free_func(g_free);
+		}
+		g_array_append_val(col->offsets, zero);
+		extract.num_columns++;
+	}
+
+	if (fields_ok)
+	{
+		extract.frames = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+		int ret = sharkd_dissect_fields(filter_data, hfids, sharkd_session_process_extract_cb, &extract);
+
+		if (ret == -1)
+		{
+			sharkd_json_cancelled(rpcid);
+		}
+		else if (ret == -2)
+		{
+			sharkd_json_error(
+				rpcid, -16003, NULL,
+				"Read error - The frame could not be read from the file"
+			);
+		}
+		else
+		{
+			sharkd_json_result_prologue(rpcid);
+			sharkd_extract_write_indexes("frames", extract.frames, binary);
+
+			sharkd_json_array_open("fields");
+			for (i = 0; i < extract.num_columns; i++)
+			{
+				struct sharkd_extract_column *col = &extract.columns[i];
+				guint j;
+
+				json_dumper_begin_object(&dumper);
+				sharkd_json_value_string("field", col->field);
+				sharkd_json_value_string("type", sharkd_extract_type_names[col->type]);
+				sharkd_extract_write_indexes("offsets", col->offsets, binary);
+				sharkd_extract_write_values(col, binary);
+				if (col->type == SHARKD_EXTRACT_STRING)
+				{
+					sharkd_json_array_open("dict");
+					for (j = 0; j < col->dict->len; j++)
+						sharkd_json_value_string(NULL, (const char *) g_ptr_array_index(col->dict, j));
+					sharkd_json_array_close();
+				}
+				json_dumper_end_object(&dumper);
+			}
+			sharkd_json_array_close();
+
+			sharkd_json_result_epilogue();
+		}
+
+		g_array_free(extract.frames, TRUE);
+	}
+
+	for (i = 0; i < extract.num_columns; i++)
+	{
+		struct sharkd_extract_column *col = &extract.columns[i];
+
+		g_array_free(col->offsets, TRUE);
+		g_array_free(col->values, TRUE);
+		if (col->dict)
+		{
+			g_hash_table_destroy(col->dict_index);
+			g_ptr_array_free(col->dict, TRUE);
+		}
+	}
+	g_array_free(hfids, TRUE);
+}
+
 /**
  * sharkd_session_process_frame()
  *
@@ -3926,6 +5299,11 @@ sharkd_session_process_intervals(char *buf, const jsmntok_t *tokens, int count)
  *   (o) color - set if output color-filter bg/fg
  *   (o) bytes - set if output frame bytes
  *   (o) hidden - set if output hidden tree fields
+ *   (o) lazy - set if output the length of the other data srcs instead
+ *              of their bytes, to be fetched with "bytes" requests
+ *
+ * Responses are cached, so asking for the same frame with the same
+ * attributes again doesn't dissect it again.
  *
  * Output object with attributes:
  *   (m) err   - 0 if succeed
@@ -3947,7 +5325,10 @@ sharkd_session_process_intervals(char *buf, const jsmntok_t *tokens, int count)
  *
  *   (o) col   - array of column data
  *   (o) bytes - base64 of frame bytes
- *   (o) ds    - array of other data srcs
+ *   (o) ds    - array of other data srcs with attributes:
+ *                  name  - name of the data src
+ *                  bytes - base64 of data src bytes, unless lazy
+ *                  len   - length of data src bytes, if lazy
  *   (o) comment - frame comment
  *   (o) fol   - array of follow filters:
  *                  [0] - protocol
@@ -3973,6 +5354,10 @@ sharkd_session_process_frame(char *buf, const jsmntok_t *tokens, int count)
 	enum dissect_request_status status;
 	int err;
 	gchar *err_info;
+	char *cache_key;
+	const struct sharkd_frame_response *resp;
+	json_dumper saved_dumper;
+	long text_len = 0;
 
 	ws_strtou32(tok_frame, NULL, &framenum);  // we have already validated this
 
@@ -4015,31 +5400,241 @@ sharkd_session_process_frame(char *buf, const jsmntok_t *tokens, int count)
 	if (json_find_attr(buf, tokens, count, "color") != NULL)
 		dissect_flags |= SHARKD_DISSECT_FLAG_COLOR;
 
-	req_data.display_hidden = (json_find_attr(buf, tokens, count, "v") != NULL);
+	req_data.display_hidden = (json_find_attr(buf, tokens, count, "v") != NULL);
+	req_data.lazy_sources = (json_find_attr(buf, tokens, count, "lazy") != NULL);
+
+	cache_key = g_strdup_printf("%u:%u:%u:%x:%d:%d", framenum, ref_frame_num, prev_dis_num,
+	    dissect_flags, req_data.display_hidden, req_data.lazy_sources);
+	resp = sharkd_frame_cache_lookup(cache_key);
+	if (resp)
+	{
+		g_free(cache_key);
+		sharkd_session_frame_response(resp);
+		return;
+	}
+
+	/* Serialize the result object on its own, to keep it. */
+	if (frame_cache.file == NULL)
+		frame_cache.file = tmpfile();
+	req_data.capture = (frame_cache.file != NULL);
+	if (req_data.capture)
+	{
+		saved_dumper = dumper;
+		memset(&dumper, 0, sizeof(dumper));
+		dumper.output_file = frame_cache.file;
+		rewind(frame_cache.file);
+	}
+
+	wtap_rec_init(&rec);
+	ws_buffer_init(&rec_buf, 1514);
+
+	status = sharkd_dissect_request(framenum, ref_frame_num, prev_dis_num,
+	    &rec, &rec_buf, cinfo, dissect_flags,
+	    &sharkd_session_process_frame_cb, &req_data, &err, &err_info);
+
+	if (req_data.capture)
+	{
+		fflush(frame_cache.file);
+		text_len = ftell(frame_cache.file);
+		dumper = saved_dumper;
+	}
+
+	switch (status) {
+
+	case DISSECT_REQUEST_SUCCESS:
+		if (!req_data.capture)
+			break;
+
+		/* without the newline json_dumper_finish() wrote */
+		rewind(frame_cache.file);
+		resp = (text_len > 0) ? sharkd_frame_cache_store(cache_key, frame_cache.file, (size_t) text_len - 1) : NULL;
+		cache_key = NULL;
+		if (resp == NULL)
+		{
+			sharkd_json_error(
+				rpcid, -8003, NULL,
+				"Read error - The frame could not be serialized"
+			);
+			break;
+		}
+
+		sharkd_session_frame_response(resp);
+		if (!sharkd_frame_response_cached(resp))
+			sharkd_frame_response_free((gpointer) resp);
+		break;
+
+	case DISSECT_REQUEST_NO_SUCH_FRAME:
+		sharkd_json_error(
+			rpcid, -8003, NULL,
+			"Invalid frame - The frame number requested is out of range"
+		);
+		break;
+
+	case DISSECT_REQUEST_READ_ERROR:
+		sharkd_json_error(
+			rpcid, -8003, NULL,
+			/* XXX - show the error details */
+			"Read error - The frame could not be read from the file"
+		);
+		g_free(err_info);
+		break;
+	}
+
+	g_free(cache_key);
+	wtap_rec_cleanup(&rec);
+	ws_buffer_free(&rec_buf);
+}
+
+struct sharkd_bytes_request_data
+{
+	guint32 ds;
+	guint32 offset;
+	guint32 length;
+};
+
+static void
+sharkd_session_bytes_response(const struct sharkd_bytes_request_data *req_data, const char *name, const guint8 *data, guint len)
+{
+	guint32 length;
+
+	if (req_data->offset > len)
+	{
+		sharkd_json_error(
+			rpcid, -15003, NULL,
+			"Invalid offset - The offset is after the end of the data source"
+		);
+		return;
+	}
+
+	length = MIN(req_data->length, len - req_data->offset);
+
+	sharkd_json_result_prologue(rpcid);
+	sharkd_json_value_string("name", name);
+	sharkd_json_value_anyf("len", "%u", len);
+	sharkd_json_value_anyf("offset", "%u", req_data->offset);
+	sharkd_json_value_base64("bytes", data + req_data->offset, length);
+	sharkd_json_result_epilogue();
+}
+
+static void
+sharkd_session_process_bytes_cb(epan_dissect_t *edt, proto_tree *tree _U_, struct epan_column_info *cinfo _U_, const GSList *data_src, void *data)
+{
+	const struct sharkd_bytes_request_data *req_data = (const struct sharkd_bytes_request_data *) data;
+	struct data_source *src;
+	tvbuff_t *tvb;
+	char *src_name;
+	guint length;
+
+	if (data_src && data_src->next)
+		sharkd_frame_sources_store(edt->pi.fd->num, data_src);
+
+	data_src = g_slist_nth((GSList *) data_src, req_data->ds);
+	if (data_src == NULL)
+	{
+		sharkd_json_error(
+			rpcid, -15002, NULL,
+			"Invalid ds - The frame has no such data source"
+		);
+		return;
+	}
+
+	src = (struct data_source *) data_src->data;
+	tvb = get_data_source_tvb(src);
+	length = tvb_captured_length(tvb);
+	src_name = get_data_source_name(src);
+
+	sharkd_session_bytes_response(req_data, src_name, (length != 0) ? tvb_get_ptr(tvb, 0, length) : NULL, length);
+
+	wmem_free(NULL, src_name);
+}
+
+/**
+ * sharkd_session_process_bytes()
+ *
+ * Process bytes request: part of a data source of a frame, so that large
+ * reassembled data, of which a "lazy" frame response gives only the length,
+ * can be fetched when shown and a piece at a time. The data sources of the
+ * frames shown last are kept, so that this doesn't dissect them again.
+ *
+ * Input:
+ *   (m) frame  - frame number
+ *   (o) ds     - index of the data source: 0 for the frame bytes, i for
+ *                the i-th element of "ds" of the frame response, default 0
+ *   (o) offset - offset of the first byte, default 0
+ *   (o) length - maximum number of bytes, default up to the end
+ *
+ * Output object with attributes:
+ *   (m) name   - name of the data source
+ *   (m) len    - length of the whole data source
+ *   (m) offset - offset of the first byte
+ *   (m) bytes  - base64 of the bytes
+ */
+static void
+sharkd_session_process_bytes(char *buf, const jsmntok_t *tokens, int count)
+{
+	const char *tok_frame = json_find_attr(buf, tokens, count, "frame");
+	const char *tok_ds = json_find_attr(buf, tokens, count, "ds");
+	const char *tok_offset = json_find_attr(buf, tokens, count, "offset");
+	const char *tok_length = json_find_attr(buf, tokens, count, "length");
+	struct sharkd_bytes_request_data req_data;
+	struct sharkd_frame_sources *srcs;
+	guint32 framenum;
+	wtap_rec rec; /* Record metadata */
+	Buffer rec_buf;   /* Record data */
+	enum dissect_request_status status;
+	int err;
+	gchar *err_info;
+
+	ws_strtou32(tok_frame, NULL, &framenum);  // we have already validated this
+
+	req_data.ds = 0;
+	req_data.offset = 0;
+	req_data.length = G_MAXUINT32;
+	if (tok_ds)
+		ws_strtou32(tok_ds, NULL, &req_data.ds);
+	if (tok_offset)
+		ws_strtou32(tok_offset, NULL, &req_data.offset);
+	if (tok_length)
+		ws_strtou32(tok_length, NULL, &req_data.length);
+
+	srcs = sharkd_frame_sources_lookup(framenum);
+	if (srcs)
+	{
+		if (req_data.ds >= srcs->num_sources)
+		{
+			sharkd_json_error(
+				rpcid, -15002, NULL,
+				"Invalid ds - The frame has no such data source"
+			);
+			return;
+		}
+
+		sharkd_session_bytes_response(&req_data, srcs->sources[req_data.ds].name,
+		    srcs->sources[req_data.ds].data, srcs->sources[req_data.ds].len);
+		return;
+	}
 
 	wtap_rec_init(&rec);
 	ws_buffer_init(&rec_buf, 1514);
 
-	status = sharkd_dissect_request(framenum, ref_frame_num, prev_dis_num,
-	    &rec, &rec_buf, cinfo, dissect_flags,
-	    &sharkd_session_process_frame_cb, &req_data, &err, &err_info);
+	status = sharkd_dissect_request(framenum, (framenum != 1) ? 1 : 0, framenum - 1,
+	    &rec, &rec_buf, NULL, SHARKD_DISSECT_FLAG_BYTES,
+	    &sharkd_session_process_bytes_cb, &req_data, &err, &err_info);
 	switch (status) {
 
 	case DISSECT_REQUEST_SUCCESS:
-		/* success */
 		break;
 
 	case DISSECT_REQUEST_NO_SUCH_FRAME:
 		sharkd_json_error(
-			rpcid, -8003, NULL,
+			rpcid, -15001, NULL,
 			"Invalid frame - The frame number requested is out of range"
 		);
 		break;
 
 	case DISSECT_REQUEST_READ_ERROR:
 		sharkd_json_error(
-			rpcid, -8003, NULL,
-			/* XXX - show the error details */
+			rpcid, -15004, NULL,
 			"Read error - The frame could not be read from the file"
 		);
 		g_free(err_info);
@@ -4319,7 +5914,7 @@ sharkd_session_process_setcomment(char *buf, const jsmntok_t *tokens, int count)
 		return;
 	}
 
-	fdata = sharkd_get_frame(framenum);  // BUG HERE - If no file loaded you get a crash
+	fdata = sharkd_get_frame(framenum);
 	if (!fdata)
 	{
 		sharkd_json_error(
@@ -4343,8 +5938,13 @@ sharkd_session_process_setcomment(char *buf, const jsmntok_t *tokens, int count)
 	else
 	{
 		sharkd_set_modified_block(fdata, pkt_block);
+		/* Graphs can be filtered by frame.comment. */
+		sharkd_iograph_store_clear();
+		sharkd_frame_cache_clear();
 		sharkd_json_simple_ok(rpcid);
 	}
+
+	sharkd_release_frame(fdata);
 }
 
 /**
@@ -4394,6 +5994,21 @@ sharkd_session_process_setconf(char *buf, const jsmntok_t *tokens, int count)
 	switch (ret)
 	{
 	case PREFS_SET_OK:
+		/* The preference might change the dissection, and so the
+		 * results of the filters applied so far and the column
+		 * values shown. */
+		g_hash_table_remove_all(filter_table);
+		dfilter_cache_clear(cfile.filter_cache);
+		sharkd_column_cache_clear();
+		sharkd_iograph_store_clear();
+		sharkd_frame_cache_clear();
+		/* So might the conversations counted and the field values
+		 * indexed when loading. */
+		conversation_table_first_pass_free(cfile.conv_tables);
+		cfile.conv_tables = NULL;
+		dfilter_index_free(cfile.field_index);
+		cfile.field_index = NULL;
+		prefs_changed = TRUE;
 		sharkd_json_simple_ok(rpcid);
 		break;
 
@@ -4875,10 +6490,11 @@ sharkd_session_process_download(char *buf, const jsmntok_t *tokens, int count)
 			const char *mime     = (eo_entry->content_type) ? eo_entry->content_type : "application/octet-stream";
 			const char *filename = (eo_entry->filename) ? eo_entry->filename : tok_token;
 
+			sharkd_json_stream_begin();
 			sharkd_json_result_prologue(rpcid);
 			sharkd_json_value_string("file", filename);
 			sharkd_json_value_string("mime", mime);
-			sharkd_json_value_base64("data", eo_entry->payload_data, eo_entry->payload_len);
+			sharkd_json_stream_base64("data", eo_entry->payload_data, eo_entry->payload_len);
 			sharkd_json_result_epilogue();
 		}
 		else
@@ -4897,10 +6513,11 @@ sharkd_session_process_download(char *buf, const jsmntok_t *tokens, int count)
 			const char *mime     = "text/plain";
 			const char *filename = "keylog.txt";
 
+			sharkd_json_stream_begin();
 			sharkd_json_result_prologue(rpcid);
 			sharkd_json_value_string("file", filename);
 			sharkd_json_value_string("mime", mime);
-			sharkd_json_value_base64("data", str, str_len);
+			sharkd_json_stream_base64("data", str, str_len);
 			sharkd_json_result_epilogue();
 		}
 		g_free(str);
@@ -4931,7 +6548,13 @@ sharkd_session_process_download(char *buf, const jsmntok_t *tokens, int count)
 			return;
 		}
 
-		sharkd_retap();
+		if (sharkd_retap() < 0)
+		{
+			remove_tap_listener(&rtp_req);
+			g_slist_free_full(rtp_req.packets, sharkd_rtp_download_free_items);
+			sharkd_json_cancelled(rpcid);
+			return;
+		}
 		remove_tap_listener(&rtp_req);
 
 		if (rtp_req.packets)
@@ -4955,6 +6578,445 @@ sharkd_session_process_download(char *buf, const jsmntok_t *tokens, int count)
 	}
 }
 
+/**
+ * sharkd_session_process_stream()
+ *
+ * Process stream request, which sets how the responses of this session
+ * to "frames", "tap" with conversation or endpoint tables, and "download"
+ * of export objects or TLS secrets are sent: see sharkd_json_stream_begin().
+ *
+ * Input:
+ *   (o) rows - number of frames, conversations or endpoints in each
+ *              partial result; the whole response is sent at once if
+ *              missing
+ *
+ * Output object with attributes:
+ *   (m) status - "OK"
+ */
+static void
+sharkd_session_process_stream(char *buf, const jsmntok_t *tokens, int count)
+{
+	const char *tok_rows = json_find_attr(buf, tokens, count, "rows");
+
+	stream_rows = 0;
+	if (tok_rows)
+		ws_strtou32(tok_rows, NULL, &stream_rows);  // already validated
+
+	sharkd_json_simple_ok(rpcid);
+}
+
+/**
+ * sharkd_session_process_cancel()
+ *
+ * Process cancel request, which is also read while another request is
+ * being processed: see sharkd_session_check_input().
+ *
+ * Input:
+ *   (m) request - id of the request to stop, or of a queued request
+ *
+ * Output object with attributes:
+ *   (m) status - "OK"; the stopped request fails with error -32800.
+ */
+static gboolean sharkd_session_cancel_queued(guint32 request);
+
+static void
+sharkd_session_process_cancel(char *buf, const jsmntok_t *tokens, int count)
+{
+	const char *tok_request = json_find_attr(buf, tokens, count, "request");
+	guint32 request = 0;
+
+	ws_strtou32(tok_request, NULL, &request);  // already validated
+
+	if (request_running && request == running_rpcid)
+		cancel_requested = TRUE;
+	else if (!sharkd_session_cancel_queued(request))
+	{
+		sharkd_json_error(
+			rpcid, -14001, NULL,
+			"No request with id %u is being processed", request
+		);
+		return;
+	}
+
+	sharkd_json_simple_ok(rpcid);
+}
+
+/*
+ * Reads what is available of the input, blocking if nothing is.
+ * Returns FALSE at the end of the input.
+ */
+static gboolean
+sharkd_session_read_input(void)
+{
+	char chunk[4096];
+	int len;
+
+	if (input_eof)
+		return FALSE;
+
+	do
+		len = (int) ws_read(0, chunk, sizeof(chunk));
+	while (len < 0 && errno == EINTR);
+
+	if (len <= 0)
+	{
+		input_eof = TRUE;
+		return FALSE;
+	}
+
+	g_string_append_len(input_buf, chunk, len);
+	return TRUE;
+}
+
+/*
+ * Requests are queued in input_buf in the order they arrive, and taken
+ * from it by kind:
+ *
+ * - "cancel" requests are processed as soon as they are read, even while
+ *   another request is processed;
+ * - interactive requests, that are quick and don't change the state of
+ *   the session, go ahead of the analyses, that go through all the
+ *   frames, and can be processed while an analysis reports progress;
+ * - other requests change the state of the session, and no request goes
+ *   ahead of them.
+ */
+typedef enum {
+	SHARKD_REQUEST_CANCEL,
+	SHARKD_REQUEST_INTERACTIVE,
+	SHARKD_REQUEST_ANALYSIS,
+	SHARKD_REQUEST_ORDERED
+} sharkd_request_kind_t;
+
+static const struct
+{
+	const char *method;
+	sharkd_request_kind_t kind;
+} sharkd_request_kinds[] =
+{
+	{ "cancel",   SHARKD_REQUEST_CANCEL },
+	{ "bytes",    SHARKD_REQUEST_INTERACTIVE },
+	{ "check",    SHARKD_REQUEST_INTERACTIVE },
+	{ "complete", SHARKD_REQUEST_INTERACTIVE },
+	{ "dumpconf", SHARKD_REQUEST_INTERACTIVE },
+	{ "frame",    SHARKD_REQUEST_INTERACTIVE },
+	{ "frames",   SHARKD_REQUEST_INTERACTIVE },  /* unless filtered */
+	{ "info",     SHARKD_REQUEST_INTERACTIVE },
+	{ "intervals", SHARKD_REQUEST_INTERACTIVE }, /* unless filtered */
+	{ "status",   SHARKD_REQUEST_INTERACTIVE },
+	{ "analyse",  SHARKD_REQUEST_ANALYSIS },
+	{ "download", SHARKD_REQUEST_ANALYSIS },
+	{ "extract",  SHARKD_REQUEST_ANALYSIS },
+	{ "follow",   SHARKD_REQUEST_ANALYSIS },
+	{ "iograph",  SHARKD_REQUEST_ANALYSIS },
+	{ "tap",      SHARKD_REQUEST_ANALYSIS },
+};
+
+/* A request is processed while another one reports progress. */
+static gboolean request_nested;
+
+/* Returns the index of the token after token i and its children. */
+static int
+json_token_end(const jsmntok_t *tokens, int i)
+{
+	int j = i + 1;
+	int n;
+
+	for (n = 0; n < tokens[i].size; n++)
+		j = json_token_end(tokens, j);
+
+	return j;
+}
+
+static gboolean
+json_token_equal(const char *buf, const jsmntok_t *tok, const char *str)
+{
+	size_t len = strlen(str);
+
+	return tok->end - tok->start == (int) len && !strncmp(&buf[tok->start], str, len);
+}
+
+/*
+ * Returns the kind of the request on line, and sets *id to its id, or 0,
+ * without modifying line or reporting errors.
+ */
+static sharkd_request_kind_t
+sharkd_session_request_kind(const char *line, guint32 *id)
+{
+	sharkd_request_kind_t kind = SHARKD_REQUEST_ORDERED;
+	const char *method = NULL;
+	gboolean filtered = FALSE;
+	jsmntok_t *tokens;
+	char *copy;
+	int count, i, j, k, n;
+
+	*id = 0;
+
+	/* json_parse() wants to be able to modify its input. */
+	copy = g_strdup(line);
+	count = json_parse(copy, NULL, 0);
+	if (count <= 0)
+	{
+		g_free(copy);
+		return kind;
+	}
+
+	tokens = g_new0(jsmntok_t, count);
+	if (json_parse(copy, tokens, count) > 0 && tokens[0].type == JSMN_OBJECT)
+	{
+		i = 1;
+		for (k = 0; k < tokens[0].size && i + 1 < count; k++)
+		{
+			const jsmntok_t *key = &tokens[i];
+			const jsmntok_t *value = &tokens[i + 1];
+
+			if (json_token_equal(copy, key, "method") && value->type == JSMN_STRING)
+			{
+				for (n = 0; n < (int) G_N_ELEMENTS(sharkd_request_kinds); n++)
+				{
+					if (json_token_equal(copy, value, sharkd_request_kinds[n].method))
+					{
+						method = sharkd_request_kinds[n].method;
+						kind = sharkd_request_kinds[n].kind;
+					}
+				}
+			}
+			else if (json_token_equal(copy, key, "id") && value->type == JSMN_PRIMITIVE)
+			{
+				copy[value->end] = '\0';
+				ws_strtou32(&copy[value->start], NULL, id);
+			}
+			else if (json_token_equal(copy, key, "params") && value->type == JSMN_OBJECT)
+			{
+				j = i + 2;
+				for (n = 0; n < value->size && j + 1 < count; n++)
+				{
+					if (json_token_equal(copy, &tokens[j], "filter"))
+						filtered = TRUE;
+					j = json_token_end(tokens, j);
+				}
+			}
+			i = json_token_end(tokens, i);
+		}
+	}
+
+	/* Filtering goes through all the frames. */
+	if (filtered && method && (!strcmp(method, "frames") || !strcmp(method, "intervals")))
+		kind = SHARKD_REQUEST_ANALYSIS;
+
+	g_free(tokens);
+	g_free(copy);
+	return kind;
+}
+
+/* Reads what is available of the input, without blocking. */
+static void
+sharkd_session_poll_input(void)
+{
+#ifndef _WIN32
+	struct pollfd pfd;
+
+	pfd.fd = 0;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	if (poll(&pfd, 1, 0) > 0)
+		sharkd_session_read_input();
+#endif
+}
+
+/* Removes the request at start of input_buf, len bytes long, and returns it. */
+static char *
+sharkd_session_take_line(gsize start, gsize len)
+{
+	char *line = g_strndup(input_buf->str + start, len);
+
+	g_string_erase(input_buf, start, MIN(len + 1, input_buf->len - start));
+	return line;
+}
+
+/*
+ * Returns the next request to process, without the newline, or NULL at
+ * the end of the input. Free it with g_free().
+ */
+static char *
+sharkd_session_next_line(void)
+{
+	const char *nl;
+	gsize start;
+	guint32 id;
+
+	while ((nl = (const char *) memchr(input_buf->str, '\n', input_buf->len)) == NULL)
+	{
+		if (!sharkd_session_read_input())
+		{
+			if (input_buf->len == 0)
+				return NULL;
+
+			return sharkd_session_take_line(0, input_buf->len);
+		}
+	}
+
+	/* Take an interactive request queued behind analyses first. */
+	sharkd_session_poll_input();
+	nl = (const char *) memchr(input_buf->str, '\n', input_buf->len);
+	start = 0;
+	while (nl != NULL)
+	{
+		gsize len = nl - (input_buf->str + start);
+		char *line = g_strndup(input_buf->str + start, len);
+		sharkd_request_kind_t kind = sharkd_session_request_kind(line, &id);
+
+		g_free(line);
+		if (kind == SHARKD_REQUEST_INTERACTIVE || kind == SHARKD_REQUEST_CANCEL)
+			return sharkd_session_take_line(start, len);
+		if (kind != SHARKD_REQUEST_ANALYSIS)
+			break;
+
+		start += len + 1;
+		nl = (const char *) memchr(input_buf->str + start, '\n', input_buf->len - start);
+	}
+
+	nl = (const char *) memchr(input_buf->str, '\n', input_buf->len);
+	return sharkd_session_take_line(0, nl - input_buf->str);
+}
+
+/*
+ * Removes the queued request with the given id, and answers it with
+ * an error. Returns FALSE if there is none.
+ */
+static gboolean
+sharkd_session_cancel_queued(guint32 request)
+{
+	const char *nl;
+	gsize start = 0;
+	guint32 id;
+
+	while ((nl = (const char *) memchr(input_buf->str + start, '\n', input_buf->len - start)) != NULL)
+	{
+		gsize len = nl - (input_buf->str + start);
+		char *line = g_strndup(input_buf->str + start, len);
+
+		sharkd_session_request_kind(line, &id);
+		g_free(line);
+		if (id == request)
+		{
+			g_free(sharkd_session_take_line(start, len));
+			sharkd_json_cancelled(request);
+			return TRUE;
+		}
+		start += len + 1;
+	}
+	return FALSE;
+}
+
+static void sharkd_session_process_line(char *line);
+
+/*
+ * Processes the requests that arrived while another request is being
+ * processed, and that can't wait: "cancel" requests, and interactive
+ * requests, unless a request that changes the state of the session
+ * was queued before them.
+ */
+static void
+sharkd_session_check_input(void)
+{
+	const char *nl;
+	gsize start = 0;
+	gboolean ordered = FALSE;
+	guint32 id;
+
+	sharkd_session_poll_input();
+
+	/* Nothing must be written in the middle of a response. */
+	if (request_nested || dumper.current_depth != 0)
+		return;
+
+	while ((nl = (const char *) memchr(input_buf->str + start, '\n', input_buf->len - start)) != NULL)
+	{
+		gsize len = nl - (input_buf->str + start);
+		char *line = g_strndup(input_buf->str + start, len);
+		sharkd_request_kind_t kind = sharkd_session_request_kind(line, &id);
+
+		g_free(line);
+		if (kind == SHARKD_REQUEST_CANCEL ||
+		    (kind == SHARKD_REQUEST_INTERACTIVE && !ordered))
+		{
+			guint32 saved_rpcid = rpcid;
+			guint32 saved_running_rpcid = running_rpcid;
+			gboolean saved_cancel_requested = cancel_requested;
+
+			line = sharkd_session_take_line(start, len);
+			request_nested = TRUE;
+			sharkd_session_process_line(line);
+			request_nested = FALSE;
+			g_free(line);
+
+			rpcid = saved_rpcid;
+			running_rpcid = saved_running_rpcid;
+			request_running = TRUE;
+			/* The request being processed may have been cancelled. */
+			if (kind != SHARKD_REQUEST_CANCEL)
+				cancel_requested = saved_cancel_requested;
+		}
+		else
+		{
+			if (kind == SHARKD_REQUEST_ORDERED)
+				ordered = TRUE;
+			start += len + 1;
+		}
+	}
+}
+
+/*
+ * Reports the progress of the pass over the frames a request does with
+ * a notification, and checks whether the request was cancelled.
+ *
+ * Notification with attributes:
+ *   (m) id    - id of the request
+ *   (m) done  - number of frames done
+ *   (o) total - number of frames, unless loading
+ *   (o) bytes - if loading, bytes of the file read so far
+ *   (o) filesize - if loading, size of the file
+ *   (o) eta   - if loading, estimated seconds until the file is read
+ */
+static gboolean
+sharkd_session_progress(guint32 done, guint32 total, void *data _U_)
+{
+	gint64 bytes_read, elapsed;
+
+	/* Notifications can't be sent in the middle of a streamed response. */
+	if (!request_running || stream.active)
+		return TRUE;
+
+	json_dumper_begin_object(&dumper);
+	sharkd_json_value_string("jsonrpc", "2.0");
+	sharkd_json_value_string("method", "progress");
+	sharkd_json_value_anyf("params", NULL);
+	json_dumper_begin_object(&dumper);
+	sharkd_json_value_anyf("id", "%u", running_rpcid);
+	sharkd_json_value_anyf("done", "%u", done);
+	if (sharkd_load_progress(&bytes_read, &elapsed))
+	{
+		gint64 file_size = wtap_file_size(cfile.provider.wth, NULL);
+
+		sharkd_json_value_anyf("bytes", "%" PRId64, bytes_read);
+		if (file_size > 0)
+		{
+			sharkd_json_value_anyf("filesize", "%" PRId64, file_size);
+			if (bytes_read > 0)
+				sharkd_json_value_anyf("eta", "%.1f", sharkd_load_eta(bytes_read, file_size, elapsed));
+		}
+	}
+	else
+		sharkd_json_value_anyf("total", "%u", total);
+	json_dumper_end_object(&dumper);
+	json_dumper_end_object(&dumper);
+	sharkd_json_response_close();
+
+	sharkd_session_check_input();
+
+	return !cancel_requested;
+}
+
 static void
 sharkd_session_process(char *buf, const jsmntok_t *tokens, int count)
 {
@@ -4972,6 +7034,16 @@ sharkd_session_process(char *buf, const jsmntok_t *tokens, int count)
 				"No method found");
 			return;
 		}
+		if (!strcmp(tok_method, "cancel"))
+		{
+			sharkd_session_process_cancel(buf, tokens, count);
+			return;
+		}
+
+		running_rpcid = rpcid;
+		request_running = TRUE;
+		cancel_requested = FALSE;
+
 		if (!strcmp(tok_method, "load"))
 			sharkd_session_process_load(buf, tokens, count);
 		else if (!strcmp(tok_method, "status"))
@@ -4994,12 +7066,18 @@ sharkd_session_process(char *buf, const jsmntok_t *tokens, int count)
 			sharkd_session_process_iograph(buf, tokens, count);
 		else if (!strcmp(tok_method, "intervals"))
 			sharkd_session_process_intervals(buf, tokens, count);
+		else if (!strcmp(tok_method, "extract"))
+			sharkd_session_process_extract(buf, tokens, count);
 		else if (!strcmp(tok_method, "frame"))
 			sharkd_session_process_frame(buf, tokens, count);
+		else if (!strcmp(tok_method, "bytes"))
+			sharkd_session_process_bytes(buf, tokens, count);
 		else if (!strcmp(tok_method, "setcomment"))
 			sharkd_session_process_setcomment(buf, tokens, count);
 		else if (!strcmp(tok_method, "setconf"))
 			sharkd_session_process_setconf(buf, tokens, count);
+		else if (!strcmp(tok_method, "stream"))
+			sharkd_session_process_stream(buf, tokens, count);
 		else if (!strcmp(tok_method, "dumpconf"))
 			sharkd_session_process_dumpconf(buf, tokens, count);
 		else if (!strcmp(tok_method, "download"))
@@ -5016,15 +7094,54 @@ sharkd_session_process(char *buf, const jsmntok_t *tokens, int count)
 				"The method \"%s\" is unknown", tok_method
 			);
 		}
+
+		request_running = FALSE;
+	}
+}
+
+/* Processes a request, which is line seperated JSON. */
+static void
+sharkd_session_process_line(char *line)
+{
+	jsmntok_t *tokens;
+	int ret;
+
+	ret = json_parse(line, NULL, 0);
+	if (ret <= 0)
+	{
+		sharkd_json_error(
+			rpcid, -32600, NULL,
+			"Invalid JSON(1)"
+		);
+		return;
+	}
+
+	/* fprintf(stderr, "JSON: %d tokens\n", ret); */
+	ret += 1;
+
+	tokens = g_new0(jsmntok_t, ret);
+
+	ret = json_parse(line, tokens, ret);
+	if (ret <= 0)
+	{
+		sharkd_json_error(
+			rpcid, -32600, NULL,
+			"Invalid JSON(2)"
+		);
+		g_free(tokens);
+		return;
 	}
+
+	host_name_lookup_process();
+
+	sharkd_session_process(line, tokens, ret);
+	g_free(tokens);
 }
 
 int
 sharkd_session_main(int mode_setting)
 {
-	char buf[2 * 1024];
-	jsmntok_t *tokens = NULL;
-	int tokens_max = -1;
+	char *buf;
 
 	mode = mode_setting;
 
@@ -5034,54 +7151,23 @@ sharkd_session_main(int mode_setting)
 
 	filter_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, sharkd_session_filter_free);
 
+	input_buf = g_string_new(NULL);
+	sharkd_set_progress_func(sharkd_session_progress, NULL);
+
 #ifdef HAVE_MAXMINDDB
 	/* mmdbresolve was stopped before fork(), force starting it */
 	uat_get_table_by_name("MaxMind Database Paths")->post_update_cb();
 #endif
 
-	while (fgets(buf, sizeof(buf), stdin))
+	while ((buf = sharkd_session_next_line()) != NULL)
 	{
-		/* every command is line seperated JSON */
-		int ret;
-
-		ret = json_parse(buf, NULL, 0);
-		if (ret <= 0)
-		{
-			sharkd_json_error(
-				rpcid, -32600, NULL,
-				"Invalid JSON(1)"
-			);
-			continue;
-		}
-
-		/* fprintf(stderr, "JSON: %d tokens\n", ret); */
-		ret += 1;
-
-		if (tokens == NULL || tokens_max < ret)
-		{
-			tokens_max = ret;
-			tokens = (jsmntok_t *) g_realloc(tokens, sizeof(jsmntok_t) * tokens_max);
-		}
-
-		memset(tokens, 0, ret * sizeof(jsmntok_t));
-
-		ret = json_parse(buf, tokens, ret);
-		if (ret <= 0)
-		{
-			sharkd_json_error(
-				rpcid, -32600, NULL,
-				"Invalid JSON(2)"
-			);
-			continue;
-		}
-
-		host_name_lookup_process();
-
-		sharkd_session_process(buf, tokens, ret);
+		sharkd_session_process_line(buf);
+		g_free(buf);
 	}
 
+	sharkd_set_progress_func(NULL, NULL);
+	g_string_free(input_buf, TRUE);
 	g_hash_table_destroy(filter_table);
-	g_free(tokens);
 
 	return 0;
 }
@@ -288,6 +288,34 @@ class case_tshark_z_expert(subprocesstest.SubprocessTestCase):
         self.assertFalse(self.grepOutput('Chats'))
 
 
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_tshark_z_dfilter_stats(subprocesstest.SubprocessTestCase):
+    def test_tshark_z_dfilter_stats(self, cmd_tshark, capture_file):
+        self.assertRun((cmd_tshark, '-q', '-z', 'dfilter,stats',
+            '-Y', 'dhcp.option.dhcp == 5',
+            '-r', capture_file('dhcp.pcap')))
+        self.assertTrue(self.grepOutput('Display Filter Statistics:'))
+        self.assertTrue(self.grepOutput(r'^Filter: dhcp\.option\.dhcp == 5$'))
+        self.assertTrue(self.grepOutput(r'^Applied: 4, passed: 1 \(25\.00%\), time: '))
+        self.assertTrue(self.grepOutput('READ_TREE'))
+
+    def test_tshark_z_dfilter_stats_tap_filter(self, cmd_tshark, capture_file):
+        # The filters of other statistics are counted too, as the
+        # program they are combined into.
+        self.assertRun((cmd_tshark, '-q', '-z', 'dfilter,stats',
+            '-z', 'io,stat,0,udp.srcport == 67',
+            '-r', capture_file('dhcp.pcap')))
+        self.assertTrue(self.grepOutput(r'^Filter: \(combined rules\)$'))
+        self.assertTrue(self.grepOutput(r'^Applied: 4, passed: '))
+
+    def test_tshark_z_dfilter_stats_no_filter(self, cmd_tshark, capture_file):
+        self.assertRun((cmd_tshark, '-q', '-z', 'dfilter,stats',
+            '-r', capture_file('dhcp.pcap')))
+        self.assertTrue(self.grepOutput('Display Filter Statistics:'))
+        self.assertFalse(self.grepOutput('^Filter: '))
+
+
 @fixtures.mark_usefixtures('test_env')
 @fixtures.uses_fixtures
 class case_tshark_extcap(subprocesstest.SubprocessTestCase):
@@ -19,6 +19,15 @@ class case_bytes_ipv6(unittest.TestCase):
         dfilter = "ipv6.dst == ff05::9990"
         checkDFilterCount(dfilter, 0)
 
+    def test_in_prefix_1(self, checkDFilterCount):
+        # ff05::9998 is "equal" to ff05::/16, but isn't a duplicate of it.
+        dfilter = "ipv6.dst in {ff05::9998 ff05::/16}"
+        checkDFilterCount(dfilter, 1)
+
+    def test_in_prefix_2(self, checkDFilterCount):
+        dfilter = "ipv6.dst == ff05::9998 || ipv6.dst == ff05::/16"
+        checkDFilterCount(dfilter, 1)
+
     def test_ne_1(self, checkDFilterCount):
         dfilter = "ipv6.dst != ff05::9990"
         checkDFilterCount(dfilter, 1)
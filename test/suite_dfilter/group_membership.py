@@ -90,3 +90,28 @@ class case_membership(unittest.TestCase):
     def test_membership_12_value_string(self, checkDFilterCount):
         dfilter = 'tcp.checksum.status in {"Unverified", "Good"}'
         checkDFilterCount(dfilter, 1)
+
+    def test_membership_13_ip_cidr(self, checkDFilterCount):
+        dfilter = 'ip.dst in {192.168.0.0/16, 207.46.0.0/16}'
+        checkDFilterCount(dfilter, 1)
+
+    def test_membership_14_ip_cidr_no_match(self, checkDFilterCount):
+        dfilter = 'ip.src in {192.168.0.0/16, 207.46.0.0/16, 10.0.0.6}'
+        checkDFilterCount(dfilter, 0)
+
+    def test_membership_15_large_set(self, checkDFilterCount):
+        # Large sets of constants are tested with a single lookup.
+        dfilter = 'tcp.srcport in {%s}' % ', '.join(str(p) for p in range(1002, 5000, 3))
+        checkDFilterCount(dfilter, 1)
+
+    def test_membership_16_large_set_no_match(self, checkDFilterCount):
+        dfilter = 'tcp.dstport in {%s}' % ', '.join(str(p) for p in range(1000, 5000))
+        checkDFilterCount(dfilter, 0)
+
+    def test_membership_17_large_set_and_ranges(self, checkDFilterCount):
+        dfilter = 'tcp.dstport in {%s, 60 .. 90}' % ', '.join(str(p) for p in range(1000, 5000))
+        checkDFilterCount(dfilter, 1)
+
+    def test_membership_18_bytes(self, checkDFilterCount):
+        dfilter = 'eth.src in {ff:ff:ff:ff:ff:ff, 00:09:6b:88:f5:c9}'
+        checkDFilterCount(dfilter, 1)
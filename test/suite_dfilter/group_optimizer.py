@@ -0,0 +1,106 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+import unittest
+import fixtures
+from suite_dfilter.dfiltertest import *
+
+
+@fixtures.uses_fixtures
+class case_optimizer(unittest.TestCase):
+    trace_file = "http.pcap"
+
+    def test_or_chain_to_set_1(self, checkDFilterCount):
+        dfilter = 'tcp.port == 80 || tcp.port == 443 || tcp.port == 8080'
+        checkDFilterCount(dfilter, 1)
+
+    def test_or_chain_to_set_2(self, checkDFilterCount):
+        dfilter = 'tcp.port == 443 || tcp.port == 8080'
+        checkDFilterCount(dfilter, 0)
+
+    def test_or_chain_to_set_3(self, checkDFilterCount):
+        dfilter = '80 == tcp.port || tcp.port in {443 8080}'
+        checkDFilterCount(dfilter, 1)
+
+    def test_or_chain_to_set_4(self, checkDFilterCount):
+        dfilter = 'tcp.port == 443 || ip.proto == 6 || tcp.port == 8080'
+        checkDFilterCount(dfilter, 1)
+
+    def test_or_chain_to_set_5(self, checkDFilterCount):
+        # Only tests of the same field are merged.
+        dfilter = 'tcp.srcport == 80 || tcp.dstport == 80'
+        checkDFilterCount(dfilter, 1)
+
+    def test_set_empty_range(self, checkDFilterCount):
+        dfilter = 'tcp.port in {90..85, 80, 80}'
+        checkDFilterCount(dfilter, 1)
+
+    def test_set_ipv4_netmask_1(self, checkDFilterCount):
+        # 10.0.0.4 is "equal" to 10.0.0.0/8, but isn't a duplicate of it.
+        dfilter = 'ip.src in {10.0.0.4 10.0.0.0/8}'
+        checkDFilterCount(dfilter, 1)
+
+    def test_set_ipv4_netmask_2(self, checkDFilterCount):
+        dfilter = 'ip.src in {10.0.0.0/8 10.0.0.4}'
+        checkDFilterCount(dfilter, 1)
+
+    def test_set_ipv4_netmask_3(self, checkDFilterCount):
+        dfilter = 'ip.src in {10.0.0.4 10.0.0.6/31 10.0.0.4}'
+        checkDFilterCount(dfilter, 0)
+
+    def test_or_chain_to_set_ipv4_netmask(self, checkDFilterCount):
+        dfilter = 'ip.dst == 207.46.134.93 || ip.dst == 207.46.0.0/16'
+        checkDFilterCount(dfilter, 1)
+
+    def test_set_only_empty_range(self, checkDFilterCount):
+        dfilter = 'tcp.port in {90..85}'
+        checkDFilterCount(dfilter, 0)
+
+    def test_double_not(self, checkDFilterCount):
+        dfilter = '!!tcp'
+        checkDFilterCount(dfilter, 1)
+
+    def test_and_reorder(self, checkDFilterCount):
+        dfilter = 'frame contains "GET" && tcp.port == 80 && http'
+        checkDFilterCount(dfilter, 1)
+
+    def test_and_reorder_no_match(self, checkDFilterCount):
+        dfilter = 'frame contains "GET" && tcp.port == 443 && http'
+        checkDFilterCount(dfilter, 0)
+
+    def test_repeated_slice(self, checkDFilterCount):
+        dfilter = 'eth.src[0:3] == eth.src[0:3] && !(eth.src[0:3] != eth.src[0:3])'
+        checkDFilterCount(dfilter, 1)
+
+    # Filters that only compare integer and address fields with constants
+    # are run by the specialized evaluator.
+    def test_specialized_all_ne(self, checkDFilterCount):
+        dfilter = 'tcp.port != 80'
+        checkDFilterCount(dfilter, 0)
+
+    def test_specialized_any_ne(self, checkDFilterCount):
+        dfilter = 'tcp.port ~= 80'
+        checkDFilterCount(dfilter, 1)
+
+    def test_specialized_missing_field(self, checkDFilterCount):
+        dfilter = 'udp.port != 53 || !(udp.port == 53)'
+        checkDFilterCount(dfilter, 1)
+
+    def test_specialized_swapped(self, checkDFilterCount):
+        dfilter = '3000 < tcp.srcport && 80 >= tcp.dstport'
+        checkDFilterCount(dfilter, 1)
+
+    def test_specialized_ipv4_netmask(self, checkDFilterCount):
+        dfilter = 'ip.dst == 207.46.0.0/16 && ip.src > 10.0.0.4 && ip.src <= 10.0.0.5'
+        checkDFilterCount(dfilter, 1)
+
+    def test_specialized_bitwise_and(self, checkDFilterCount):
+        dfilter = 'tcp.flags & 0x08 && !(tcp.flags & 0x01)'
+        checkDFilterCount(dfilter, 1)
+
+    def test_specialized_boolean(self, checkDFilterCount):
+        dfilter = 'tcp.flags.push == 1 && tcp.flags.syn == 0'
+        checkDFilterCount(dfilter, 1)
+
+    def test_specialized_set(self, checkDFilterCount):
+        dfilter = 'tcp.port in {443, 8000 .. 8080} || ip.ttl in {128, 1 .. 10}'
+        checkDFilterCount(dfilter, 1)
@@ -0,0 +1,90 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+import os.path
+import subprocess
+import unittest
+import fixtures
+from suite_dfilter.dfiltertest import *
+
+
+@fixtures.fixture
+def checkDFilterRules(cmd_tshark, capture_file, conf_path, base_env, request):
+    def checkDFilterRules_real(rules, expected_names):
+        """Compile the rules into one program (as the coloring rules are) and
+        expect the name of the first matching rule for each packet."""
+        with open(os.path.join(conf_path, 'colorfilters'), 'w') as f:
+            for name, dfilter in rules:
+                f.write('@%s@%s@[0,0,0][65535,65535,65535]\n' % (name, dfilter))
+        proc = subprocess.run((cmd_tshark,
+                               '-n',
+                               '-r', capture_file(request.instance.trace_file),
+                               '--color',
+                               '-T', 'fields',
+                               '-e', 'frame.coloring_rule.name'),
+                              stdout=subprocess.PIPE,
+                              stderr=subprocess.PIPE,
+                              universal_newlines=True,
+                              env=base_env)
+        assert proc.returncode == 0, \
+            'Unexpected tshark exit code: %d. stderr:\n%s\n' % \
+            (proc.returncode, proc.stderr)
+        # The rules are only applied one by one if they can't be combined.
+        assert 'Could not combine' not in proc.stderr, proc.stderr
+        names = proc.stdout.splitlines()
+        assert names == expected_names, \
+            'Expected %r, got %r' % (expected_names, names)
+    return checkDFilterRules_real
+
+
+@fixtures.uses_fixtures
+class case_rules(unittest.TestCase):
+    # Discover, Offer, Request and ACK, from the client on port 68 and
+    # the server on port 67.
+    trace_file = "dhcp.pcap"
+
+    def test_first_match(self, checkDFilterRules):
+        rules = (
+            ('Offer', 'dhcp.option.dhcp == 2'),
+            ('Ack', 'dhcp.option.dhcp == 5'),
+            ('DHCP', 'dhcp'),
+            ('Frame', 'frame'),
+        )
+        checkDFilterRules(rules, ['DHCP', 'Offer', 'DHCP', 'Ack'])
+
+    def test_no_match(self, checkDFilterRules):
+        rules = (
+            ('DNS', 'dns'),
+            ('Request', 'dhcp.option.dhcp == 3'),
+        )
+        checkDFilterRules(rules, ['', '', 'Request', ''])
+
+    def test_common_subexpression(self, checkDFilterRules):
+        # The port test is shared: it is false for the client packets when
+        # the first rule fails and true for the ACK when the second fails.
+        rules = (
+            ('Offer', 'udp.srcport == 67 && dhcp.option.dhcp == 2'),
+            ('Client', 'udp.srcport == 68 && dhcp.option.dhcp == 2'),
+            ('Server', 'udp.srcport == 67'),
+            ('Not server', '!(udp.srcport == 67)'),
+        )
+        checkDFilterRules(rules, ['Not server', 'Offer', 'Not server', 'Server'])
+
+    def test_common_field(self, checkDFilterRules):
+        rules = (
+            ('Discover', 'dhcp.option.dhcp == 1 || dhcp.option.dhcp == 3 && udp.srcport == 67'),
+            ('Request', 'dhcp.option.dhcp == 3 && udp.srcport == 68'),
+            ('Server', 'dhcp.option.dhcp in {2 5}'),
+        )
+        checkDFilterRules(rules, ['Discover', 'Server', 'Request', 'Server'])
+
+    def test_invalid_rule(self, checkDFilterRules):
+        # A rule that doesn't compile is disabled; the others keep their
+        # positions in the program.
+        rules = (
+            ('Offer', 'dhcp.option.dhcp == 2'),
+            ('Invalid', 'dhcp.option.dhcp == '),
+            ('Unknown field', 'dhcp.no.such.field == 1'),
+            ('Server', 'udp.srcport == 67'),
+            ('DHCP', 'dhcp'),
+        )
+        checkDFilterRules(rules, ['DHCP', 'Offer', 'DHCP', 'Server'])
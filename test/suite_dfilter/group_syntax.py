@@ -51,6 +51,24 @@ class case_syntax(unittest.TestCase):
         dfilter = '"a" matches "b"'
         checkDFilterFail(dfilter, "requires a field-like value")
 
+    def test_matches_literal_1(self, checkDFilterCount):
+        # Optional characters aren't part of the required literal
+        dfilter = r'http.host matches "x?upd?ate\.mic"'
+        checkDFilterCount(dfilter, 1)
+
+    def test_matches_literal_2(self, checkDFilterCount):
+        dfilter = r'http.host matches "upx*date" && http.host matches "up{1}date"'
+        checkDFilterCount(dfilter, 1)
+
+    def test_matches_literal_3(self, checkDFilterCount):
+        # No literal is required with alternatives or options
+        dfilter = r'http.host matches "nomatch|microsoft" && http.host matches "(?i)UPDATE"'
+        checkDFilterCount(dfilter, 1)
+
+    def test_matches_literal_4(self, checkDFilterCount):
+        dfilter = r'http.host matches "update\.microsoft\.net"'
+        checkDFilterCount(dfilter, 0)
+
     def test_equal_1(self, checkDFilterCount):
         dfilter = 'ip.addr == 10.0.0.5'
         checkDFilterCount(dfilter, 1)
@@ -663,3 +663,49 @@ class case_communityid(subprocesstest.SubprocessTestCase):
              ))
 
         self.assertBaseline(dirs, proc.stdout_str, 'communityid-filtered.txt')
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_dissect_heuristics(subprocesstest.SubprocessTestCase):
+    def heur_stat_order(self, cmd_tshark, capture_file, table, pinned):
+        '''Returns the (heuristic, tried, accepted) rows of -z heur,stat for a table.'''
+        proc = self.assertRun((cmd_tshark,
+                '-r', capture_file('snakeoil-dtls.pcap'),
+                '-o', 'protocols.pin_heuristic_order:' + ('TRUE' if pinned else 'FALSE'),
+                '-z', 'heur,stat',
+                '-q',
+            ))
+        rows = []
+        for line in proc.stdout_str.splitlines():
+            fields = line.split()
+            if len(fields) == 5 and fields[0] == table:
+                rows.append((fields[1], int(fields[2]), int(fields[3])))
+        return rows
+
+    def test_heuristic_pinned_order(self, cmd_tshark, capture_file):
+        '''With pin_heuristic_order, the DTLS heuristic stays behind the ones that were tried before it'''
+        rows = self.heur_stat_order(cmd_tshark, capture_file, 'udp', True)
+        names = [row[0] for row in rows]
+        self.assertIn('dtls_udp', names)
+        dtls = names.index('dtls_udp')
+        self.assertGreater(rows[dtls][2], 0)
+        # Every packet that reached the DTLS heuristic went through the
+        # ones before it first, and none of those accepted it.
+        self.assertGreater(dtls, 0)
+        for name, tried, accepted in rows[:dtls]:
+            self.assertGreaterEqual(tried, rows[dtls][1])
+            self.assertEqual(accepted, 0)
+
+    def test_heuristic_learned_order(self, cmd_tshark, capture_file):
+        '''Without pin_heuristic_order, the DTLS heuristic moves ahead of the ones that rejected the packets'''
+        pinned = [row[0] for row in self.heur_stat_order(cmd_tshark, capture_file, 'udp', True)]
+        rows = self.heur_stat_order(cmd_tshark, capture_file, 'udp', False)
+        names = [row[0] for row in rows]
+        # The same heuristics are tried, as the conversation remembers DTLS
+        # once the heuristic accepted it, but not in the same order.
+        self.assertEqual(sorted(names), sorted(pinned))
+        self.assertLess(names.index('dtls_udp'), pinned.index('dtls_udp'))
+        # Only the one that accepted packets moved: the others keep their
+        # registration order.
+        self.assertEqual([name for name in names if name != 'dtls_udp'],
+                         [name for name in pinned if name != 'dtls_udp'])
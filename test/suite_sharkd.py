@@ -9,7 +9,14 @@
 '''sharkd tests'''
 
 import json
+import os
+import shutil
+import signal
+import socket
 import subprocess
+import sys
+import threading
+import time
 import unittest
 import subprocesstest
 import fixtures
@@ -42,6 +49,9 @@ def run_sharkd_session(cmd_sharkd, request):
                 jdata = json.loads(line)
             except json.JSONDecodeError:
                 self.fail('Invalid JSON: %r' % line)
+            # Progress notifications depend on timing.
+            if jdata.get('method') == 'progress':
+                continue
             outputs.append(jdata)
         return tuple(outputs)
     return run_sharkd_session_real
@@ -58,6 +68,87 @@ def check_sharkd_session(run_sharkd_session, request):
     return check_sharkd_session_real
 
 
+@fixtures.fixture
+def slow_capture(capture_file, home_path):
+    '''A FIFO from which dhcp.pcap is read a frame at a time, with pauses
+    longer than the interval of the progress notifications in between.
+    The requests sent with a load of it are answered after its second frame.'''
+    if not hasattr(os, 'mkfifo'):
+        fixtures.skip('Test requires FIFOs.')
+    path = os.path.join(home_path, 'slow.pcap')
+    os.mkfifo(path)
+    with open(capture_file('dhcp.pcap'), 'rb') as f:
+        data = f.read()
+    # The file header with the first frame, and the other frames
+    chunks = (data[:354], data[354:712], data[712:1042], data[1042:])
+
+    def write_chunks():
+        try:
+            with open(path, 'wb', buffering=0) as fifo:
+                for i, chunk in enumerate(chunks):
+                    if i > 0:
+                        time.sleep(0.5)
+                    fifo.write(chunk)
+        except OSError:
+            # A cancelled load stops reading.
+            pass
+
+    writer = threading.Thread(target=write_chunks, daemon=True)
+    writer.start()
+    yield path
+    writer.join(timeout=5)
+
+
+@fixtures.fixture
+def sharkd_daemon(cmd_sharkd, home_path, base_env):
+    '''Connects clients to a sharkd daemon, which is stopped when finished.'''
+    if sys.platform.startswith('win32'):
+        fixtures.skip('Shared captures are not supported on Windows.')
+    path = os.path.join(home_path, 'sharkd.sock')
+    # The daemon and its sessions are in the process group of sharkd,
+    # which exits once the daemon has started.
+    proc = subprocess.Popen((cmd_sharkd, 'unix:' + path), env=base_env,
+                            stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL,
+                            start_new_session=True)
+    proc.wait()
+
+    def connect():
+        for _ in range(50):
+            sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            try:
+                sock.connect(path)
+                return sock.makefile('rw')
+            except OSError:
+                sock.close()
+                time.sleep(0.1)
+        raise AssertionError('Cannot connect to the sharkd daemon')
+
+    try:
+        yield connect
+    finally:
+        try:
+            os.killpg(proc.pid, signal.SIGTERM)
+        except ProcessLookupError:
+            pass
+
+
+def sharkd_client_session(client, sharkd_commands, num_outputs):
+    '''Sends the requests to a client of a daemon, and returns its first
+    outputs other than progress notifications.'''
+    for command in sharkd_commands:
+        client.write(json.dumps(command) + '\n')
+    client.flush()
+    outputs = []
+    while len(outputs) < num_outputs:
+        line = client.readline()
+        if not line:
+            break
+        jdata = json.loads(line)
+        if jdata.get('method') != 'progress':
+            outputs.append(jdata)
+    return tuple(outputs)
+
+
 @fixtures.mark_usefixtures('base_env')
 @fixtures.uses_fixtures
 class case_sharkd(subprocesstest.SubprocessTestCase):
@@ -89,6 +180,19 @@ class case_sharkd(subprocesstest.SubprocessTestCase):
                 "filename": "dhcp.pcap", "filesize": 1400}},
         ))
 
+    def test_sharkd_req_load_background(self, check_sharkd_session, capture_file):
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap'), "background": True}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"status"},
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK","job":1}},
+            {"jsonrpc":"2.0","method":"loaded","params":{"id":1,"frames":4}},
+            {"jsonrpc":"2.0","id":2,"result":{"frames": 4, "duration": 0.070345000,
+                "filename": "dhcp.pcap", "filesize": 1400}},
+        ))
+
     def test_sharkd_req_analyse(self, check_sharkd_session, capture_file):
         check_sharkd_session((
             {"jsonrpc":"2.0", "id":1, "method":"load",
@@ -183,6 +287,119 @@ class case_sharkd(subprocesstest.SubprocessTestCase):
             },
         ))
 
+    def test_sharkd_req_frames_filter_cached(self, check_sharkd_session, capture_file):
+        # The second and third filters are answered from the result of the
+        # first one without dissecting the frames again.
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap')}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"frames",
+            "params":{"filter": "dhcp.option.dhcp == 1"}
+            },
+            {"jsonrpc":"2.0", "id":3, "method":"frames",
+            "params":{"filter": "dhcp.option.dhcp eq 1"}
+            },
+            {"jsonrpc":"2.0", "id":4, "method":"frames",
+            "params":{"filter": "!(dhcp.option.dhcp == 1)"}
+            },
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":2,"result":[MatchObject({"num": 1})]},
+            {"jsonrpc":"2.0","id":3,"result":[MatchObject({"num": 1})]},
+            {"jsonrpc":"2.0","id":4,"result":[
+                MatchObject({"num": 2}),
+                MatchObject({"num": 3}),
+                MatchObject({"num": 4}),
+            ]},
+        ))
+
+    def test_sharkd_req_frames_filter_indexed(self, check_sharkd_session, capture_file):
+        # The first filter is answered from the index, the second one only
+        # dissects the frames the index can't rule out.
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"setconf",
+            "params":{"name": "protocols.filter_index_fields", "value": "dhcp.option.dhcp"}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap')}
+            },
+            {"jsonrpc":"2.0", "id":3, "method":"frames",
+            "params":{"filter": "dhcp.option.dhcp == 3"}
+            },
+            {"jsonrpc":"2.0", "id":4, "method":"frames",
+            "params":{"filter": "dhcp.option.dhcp >= 2 && udp.srcport == 67"}
+            },
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":2,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":3,"result":[MatchObject({"num": 3})]},
+            {"jsonrpc":"2.0","id":4,"result":[
+                MatchObject({"num": 2}),
+                MatchObject({"num": 4}),
+            ]},
+        ))
+
+    def test_sharkd_req_frames_filter_not_indexed(self, check_sharkd_session, capture_file):
+        # The queries only get dns.response_in once their response was
+        # dissected, so it isn't indexed on the first pass.
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"setconf",
+            "params":{"name": "protocols.filter_index_fields", "value": "dns.response_in"}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"load",
+            "params":{"file": capture_file('dns+icmp.pcapng.gz')}
+            },
+            {"jsonrpc":"2.0", "id":3, "method":"frames",
+            "params":{"filter": "dns.response_in && frame.number >= 10"}
+            },
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":2,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":3,"result":[
+                MatchObject({"num": 10}),
+                MatchObject({"num": 16}),
+                MatchObject({"num": 24}),
+                MatchObject({"num": 26}),
+            ]},
+        ))
+
+    def test_sharkd_req_frames_columns_cached(self, check_sharkd_session, capture_file):
+        # The second request is answered from the column cache, the
+        # comment makes the third one dissect frame 2 again.
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap')}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"frames",
+            "params":{"column0": "frame.comment:0", "skip": 1, "limit": 2}
+            },
+            {"jsonrpc":"2.0", "id":3, "method":"frames",
+            "params":{"column0": "frame.comment:0", "skip": 1, "limit": 2}
+            },
+            {"jsonrpc":"2.0", "id":4, "method":"setcomment",
+            "params":{"frame": 2, "comment": "foo"}
+            },
+            {"jsonrpc":"2.0", "id":5, "method":"frames",
+            "params":{"column0": "frame.comment:0", "skip": 1, "limit": 2}
+            },
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":2,"result":[
+                MatchObject({"c": [""], "num": 2}),
+                MatchObject({"c": [""], "num": 3}),
+            ]},
+            {"jsonrpc":"2.0","id":3,"result":[
+                MatchObject({"c": [""], "num": 2}),
+                MatchObject({"c": [""], "num": 3}),
+            ]},
+            {"jsonrpc":"2.0","id":4,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":5,"result":[
+                MatchObject({"c": ["foo"], "num": 2, "ct": True}),
+                MatchObject({"c": [""], "num": 3}),
+            ]},
+        ))
+
     def test_sharkd_req_tap_invalid(self, check_sharkd_session, capture_file):
         # XXX Unrecognized taps result in an empty line, modify
         #     run_sharkd_session such that checking for it is possible.
@@ -251,6 +468,62 @@ class case_sharkd(subprocesstest.SubprocessTestCase):
             }},
         ))
 
+    def test_sharkd_req_tap_first_pass(self, check_sharkd_session, capture_file):
+        # The tables are filled when loading the file, without a retap.
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"setconf",
+            "params":{"name": "protocols.first_pass_conversation_tables", "value": "Ethernet,TCP"}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap')}
+            },
+            {"jsonrpc":"2.0", "id":3, "method":"tap", "params":{"tap0": "conv:Ethernet", "tap1": "endpt:TCP"}},
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":2,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":3,"result":{
+                "taps": [
+                    {
+                        "tap": "endpt:TCP",
+                        "type": "host",
+                        "proto": "TCP",
+                        "geoip": MatchAny(bool),
+                        "hosts": [],
+                    },
+                    {
+                        "tap": "conv:Ethernet",
+                        "type": "conv",
+                        "proto": "Ethernet",
+                        "geoip": MatchAny(bool),
+                        "convs": [
+                            {
+                                "saddr": MatchAny(str),
+                                "daddr": "Broadcast",
+                                "txf": 2,
+                                "txb": 628,
+                                "rxf": 0,
+                                "rxb": 0,
+                                "start": 0,
+                                "stop": 0.070031,
+                                "filter": "eth.addr==00:0b:82:01:fc:42 && eth.addr==ff:ff:ff:ff:ff:ff",
+                            },
+                            {
+                                "saddr": MatchAny(str),
+                                "daddr": MatchAny(str),
+                                "rxf": 0,
+                                "rxb": 0,
+                                "txf": 2,
+                                "txb": 684,
+                                "start": 0.000295,
+                                "stop": 0.070345,
+                                "filter": "eth.addr==00:08:74:ad:f1:9b && eth.addr==00:0b:82:01:fc:42",
+                            }
+                        ],
+                    },
+                ]
+            }},
+        ))
+
     def test_sharkd_req_follow_bad(self, check_sharkd_session, capture_file):
         # Unrecognized taps currently produce no output (not even err).
         check_sharkd_session((
@@ -344,6 +617,71 @@ class case_sharkd(subprocesstest.SubprocessTestCase):
             {"jsonrpc":"2.0","id":3,"error":{"code":-6001,"message":"Filter \"garbage filter\" is invalid - \"filter\" was unexpected in this context."}},
         ))
 
+    def test_sharkd_req_iograph_intervals(self, check_sharkd_session, capture_file):
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap')}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"iograph",
+            "params":{"graph0": "packets", "graph1": "bytes"}
+            },
+            {"jsonrpc":"2.0", "id":3, "method":"iograph",
+            "params":{"interval": 10, "graph0": "packets", "graph1": "bytes"}
+            },
+            {"jsonrpc":"2.0", "id":4, "method":"iograph",
+            "params":{"interval": 35, "graph0": "bytes"}
+            },
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":2,"result":{"iograph": [{"items": [4.000000]}, {"items": [1312.000000]}]}},
+            {"jsonrpc":"2.0","id":3,"result":{"iograph": [{"items": [2.000000, "7", 2.000000]}, {"items": [656.000000, "7", 656.000000]}]}},
+            {"jsonrpc":"2.0","id":4,"result":{"iograph": [{"items": [656.000000, "2", 656.000000]}]}},
+        ))
+
+    def test_sharkd_req_iograph_many_stores(self, check_sharkd_session, capture_file):
+        # More graphs than the stores that are kept: the first store is
+        # evicted by the graphs that follow it in the same request.
+        filters = (
+            "frame.number >= 1", "frame.number >= 2", "frame.number >= 3",
+            "frame.number >= 4", "frame.number <= 1", "frame.number <= 2",
+            "frame.number <= 3", "udp.srcport == 67", "udp.srcport == 68",
+            "frame.number >= 1",
+        )
+        graphs = {}
+        for i, dfilter in enumerate(filters):
+            graphs["graph%d" % i] = "packets"
+            graphs["filter%d" % i] = dfilter
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap')}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"iograph",
+            "params":graphs
+            },
+            {"jsonrpc":"2.0", "id":3, "method":"iograph",
+            "params":dict(graphs, interval=10)
+            },
+            {"jsonrpc":"2.0", "id":4, "method":"iograph",
+            "params":{"interval": 10, "graph0": "packets", "filter0": "frame.number >= 2"}
+            },
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":2,"result":{"iograph": [
+                {"items": [4.000000]}, {"items": [3.000000]}, {"items": [2.000000]},
+                {"items": [1.000000]}, {"items": [1.000000]}, {"items": [2.000000]},
+                {"items": [3.000000]}, {"items": [2.000000]}, {"items": [2.000000]},
+                {"items": [4.000000]},
+            ]}},
+            {"jsonrpc":"2.0","id":3,"result":{"iograph": [
+                {"items": [2.000000, "7", 2.000000]}, {"items": [1.000000, "7", 2.000000]},
+                {"items": ["7", 2.000000]}, {"items": ["7", 1.000000]},
+                {"items": [1.000000]}, {"items": [2.000000]},
+                {"items": [2.000000, "7", 1.000000]}, {"items": [1.000000, "7", 1.000000]},
+                {"items": [1.000000, "7", 1.000000]}, {"items": [2.000000, "7", 2.000000]},
+            ]}},
+            {"jsonrpc":"2.0","id":4,"result":{"iograph": [{"items": [1.000000, "7", 2.000000]}]}},
+        ))
+
     def test_sharkd_req_intervals_bad(self, check_sharkd_session, capture_file):
         check_sharkd_session((
             {"jsonrpc":"2.0", "id":1, "method":"load",
@@ -376,6 +714,76 @@ class case_sharkd(subprocesstest.SubprocessTestCase):
             {"jsonrpc":"2.0","id":4,"result":{"intervals":[[0,2,656]],"last":0,"frames":2,"bytes":656}},
         ))
 
+    def test_sharkd_req_extract(self, check_sharkd_session, capture_file):
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap')}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"extract",
+            "params":{"field0": "frame.number", "field1": "ip.src", "filter": "udp.srcport == 67"}
+            },
+            {"jsonrpc":"2.0", "id":3, "method":"extract",
+            "params":{"field0": "frame.number", "filter": "udp.srcport == 67", "binary": True}
+            },
+            {"jsonrpc":"2.0", "id":4, "method":"extract",
+            "params":{"field0": "garbage.field"}
+            },
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":2,"result":{"frames": [2, 4], "fields": [
+                {"field": "frame.number", "type": "uint", "offsets": [0, 1, 2], "values": [2, 4]},
+                {"field": "ip.src", "type": "string", "offsets": [0, 1, 2], "values": [0, 0],
+                 "dict": ["192.168.0.1"]},
+            ]}},
+            {"jsonrpc":"2.0","id":3,"result":{"frames": "AgAAAAQAAAA=", "fields": [
+                {"field": "frame.number", "type": "uint", "offsets": "AAAAAAEAAAACAAAA",
+                 "values": "AgAAAAAAAAAEAAAAAAAAAA=="},
+            ]}},
+            {"jsonrpc":"2.0","id":4,"error":{"code":-16002,"message":"Invalid field parameter: garbage.field"}},
+        ))
+
+    def test_sharkd_req_extract_priority(self, check_sharkd_session, capture_file):
+        # An extract goes through all the frames, so the interactive
+        # requests queued after it go ahead of it.
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap')}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"extract",
+            "params":{"field0": "frame.number"}
+            },
+            {"jsonrpc":"2.0", "id":3, "method":"status"},
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":3,"result":{"frames": 4, "duration": 0.070345000,
+                "filename": "dhcp.pcap", "filesize": 1400}},
+            {"jsonrpc":"2.0","id":2,"result":{"frames": [1, 2, 3, 4], "fields": [
+                {"field": "frame.number", "type": "uint", "offsets": [0, 1, 2, 3, 4], "values": [1, 2, 3, 4]},
+            ]}},
+        ))
+
+    def test_sharkd_req_extract_read_error(self, sharkd_daemon, capture_file, home_path):
+        # The file loses its last frames after it was loaded.
+        path = os.path.join(home_path, 'truncated.pcap')
+        shutil.copyfile(capture_file('dhcp.pcap'), path)
+        client = sharkd_daemon()
+        self.assertEqual(sharkd_client_session(client, (
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": path}
+            },
+        ), 1), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+        ))
+        os.truncate(path, 354)
+        self.assertEqual(sharkd_client_session(client, (
+            {"jsonrpc":"2.0", "id":2, "method":"extract",
+            "params":{"field0": "frame.number"}
+            },
+        ), 1), (
+            {"jsonrpc":"2.0","id":2,"error":{"code":-16003,"message":"Read error - The frame could not be read from the file"}},
+        ))
+        client.close()
+
     def test_sharkd_req_frame_basic(self, check_sharkd_session, capture_file):
         # XXX add more tests for other options (ref_frame, prev_frame, columns, color, bytes, hidden)
         check_sharkd_session((
@@ -419,6 +827,74 @@ class case_sharkd(subprocesstest.SubprocessTestCase):
             },
         ))
 
+    def test_sharkd_req_frame_cached(self, check_sharkd_session, capture_file):
+        # The second request is answered from the frame cache, the
+        # comment makes the fourth one dissect the frame again.
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap')}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"frame",
+            "params":{"frame": 2}
+            },
+            {"jsonrpc":"2.0", "id":3, "method":"frame",
+            "params":{"frame": 2}
+            },
+            {"jsonrpc":"2.0", "id":4, "method":"setcomment",
+            "params":{"frame": 2, "comment": "foo"}
+            },
+            {"jsonrpc":"2.0", "id":5, "method":"frame",
+            "params":{"frame": 2}
+            },
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":2,"result":{"fol": [["UDP", "udp.stream eq 1"]]}},
+            {"jsonrpc":"2.0","id":3,"result":{"fol": [["UDP", "udp.stream eq 1"]]}},
+            {"jsonrpc":"2.0","id":4,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":5,"result":{"comment": ["foo"], "fol": [["UDP", "udp.stream eq 1"]]}},
+        ))
+
+    def test_sharkd_req_bytes(self, check_sharkd_session, capture_file):
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap')}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"bytes",
+            "params":{"frame": 2, "offset": 12, "length": 2}
+            },
+            {"jsonrpc":"2.0", "id":3, "method":"bytes",
+            "params":{"frame": 2, "ds": 1}
+            },
+            {"jsonrpc":"2.0", "id":4, "method":"bytes",
+            "params":{"frame": 2, "offset": 400}
+            },
+            {"jsonrpc":"2.0", "id":5, "method":"bytes",
+            "params":{"frame": 99999}
+            },
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":2,"result":{"name": MatchAny(str), "len": 342, "offset": 12, "bytes": "CAA="}},
+            {"jsonrpc":"2.0","id":3,"error":{"code":-15002,"message":"Invalid ds - The frame has no such data source"}},
+            {"jsonrpc":"2.0","id":4,"error":{"code":-15003,"message":"Invalid offset - The offset is after the end of the data source"}},
+            {"jsonrpc":"2.0","id":5,"error":{"code":-15001,"message":"Invalid frame - The frame number requested is out of range"}},
+        ))
+
+    def test_sharkd_req_bytes_priority(self, check_sharkd_session, capture_file):
+        # Like "frame", "bytes" goes ahead of the analyses queued before it.
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap')}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"tap", "params":{"tap0": "endpt:UDP"}},
+            {"jsonrpc":"2.0", "id":3, "method":"bytes",
+            "params":{"frame": 2, "offset": 12, "length": 2}
+            },
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":3,"result":{"name": MatchAny(str), "len": 342, "offset": 12, "bytes": "CAA="}},
+            {"jsonrpc":"2.0","id":2,"result":MatchAny(dict)},
+        ))
+
     def test_sharkd_req_setcomment(self, check_sharkd_session, capture_file):
         check_sharkd_session((
             {"jsonrpc":"2.0", "id":1, "method":"load",
@@ -499,6 +975,153 @@ class case_sharkd(subprocesstest.SubprocessTestCase):
             {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
         ))
 
+    def test_sharkd_req_frames_stream(self, check_sharkd_session, capture_file):
+        matchFrames = MatchList({
+            "c": MatchList(MatchAny(str)),
+            "num": MatchAny(int),
+            "bg": MatchAny(str),
+            "fg": MatchAny(str),
+        })
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap')}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"stream", "params":{"rows": 3}},
+            {"jsonrpc":"2.0", "id":3, "method":"frames"},
+            {"jsonrpc":"2.0", "id":4, "method":"stream"},
+            {"jsonrpc":"2.0", "id":5, "method":"frames", "params":{"limit": 1}},
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":2,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","method":"partial","params":{"id":3,"seq":0,"frames":matchFrames}},
+            {"jsonrpc":"2.0","method":"partial","params":{"id":3,"seq":1,"frames":matchFrames}},
+            {"jsonrpc":"2.0","id":3,"result":[],"partials":2},
+            {"jsonrpc":"2.0","id":4,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":5,"result":matchFrames},
+        ))
+
+    def test_sharkd_req_cancel_not_running(self, check_sharkd_session):
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"status"},
+            {"jsonrpc":"2.0", "id":2, "method":"cancel", "params":{"request": 1}},
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"frames":0,"duration":0.000000000}},
+            {"jsonrpc":"2.0","id":2,"error":{"code":-14001,"message":"No request with id 1 is being processed"}},
+        ))
+
+    def test_sharkd_req_priority(self, check_sharkd_session, capture_file):
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap')}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"tap", "params":{"tap0": "endpt:TCP"}},
+            {"jsonrpc":"2.0", "id":3, "method":"tap", "params":{"tap0": "endpt:UDP"}},
+            {"jsonrpc":"2.0", "id":4, "method":"status"},
+            {"jsonrpc":"2.0", "id":5, "method":"cancel", "params":{"request": 3}},
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":4,"result":{"frames": 4, "duration": 0.070345000,
+                "filename": "dhcp.pcap", "filesize": 1400}},
+            {"jsonrpc":"2.0","id":3,"error":{"code":-32800,"message":"Request cancelled"}},
+            {"jsonrpc":"2.0","id":5,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":2,"result":{"taps": [{
+                "tap": "endpt:TCP",
+                "type": "host",
+                "proto": "TCP",
+                "geoip": MatchAny(bool),
+                "hosts": [],
+            }]}},
+        ))
+
+    def test_sharkd_req_during_load(self, check_sharkd_session, slow_capture):
+        # The status is answered while the capture is read. The size of a
+        # FIFO isn't known, so there is no estimate of the time left.
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": slow_capture}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"status"},
+            {"jsonrpc":"2.0", "id":3, "method":"check", "params":{"filter": "udp"}},
+            # Without a newline, this one is only read after the load.
+            {"jsonrpc":"2.0", "id":4, "method":"check"},
+        ), (
+            {"jsonrpc":"2.0","id":2,"result":{"frames": 2, "duration": 0.000295000,
+                "filename": "slow.pcap", "loading": True, "bytes": 712}},
+            {"jsonrpc":"2.0","id":3,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":4,"result":{"status":"OK"}},
+        ))
+
+    def test_sharkd_req_load_cancel(self, check_sharkd_session, slow_capture):
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": slow_capture, "background": True}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"cancel", "params":{"request": 1}},
+            {"jsonrpc":"2.0", "id":3, "method":"check"},
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK","job":1}},
+            {"jsonrpc":"2.0","id":2,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","method":"loaded","params":{"id":1,"frames":2,"cancelled":True}},
+            {"jsonrpc":"2.0","id":3,"result":{"status":"OK"}},
+        ))
+
+    def test_sharkd_req_status_eta(self, run_sharkd_session, capture_file, home_path):
+        # A file that takes longer to load than the interval of the
+        # progress notifications, made of copies of the frames of dhcp.pcap
+        with open(capture_file('dhcp.pcap'), 'rb') as f:
+            data = f.read()
+        path = os.path.join(home_path, 'large.pcap')
+        with open(path, 'wb') as f:
+            f.write(data[:24] + data[24:] * 25000)
+        file_size = os.path.getsize(path)
+        outputs = run_sharkd_session((
+            json.dumps({"jsonrpc":"2.0", "id":1, "method":"load",
+                "params":{"file": path, "background": True}}),
+            json.dumps({"jsonrpc":"2.0", "id":2, "method":"status"}),
+            json.dumps({"jsonrpc":"2.0", "id":3, "method":"check"}),
+        ))
+        self.assertEqual(outputs[0], {"jsonrpc":"2.0","id":1,"result":{"status":"OK","job":1}})
+        if outputs[1].get('id') != 2:
+            self.skipTest('The file was loaded before the status was requested.')
+        status = outputs[1]['result']
+        self.assertEqual(status, {"frames": MatchAny(int), "duration": MatchAny(float),
+            "filename": "large.pcap", "filesize": file_size,
+            "loading": True, "bytes": MatchAny(int), "eta": MatchAny(float)})
+        self.assertGreater(status['bytes'], 0)
+        self.assertLessEqual(status['bytes'], file_size)
+        self.assertGreaterEqual(status['eta'], 0)
+        self.assertEqual(outputs[2:], (
+            {"jsonrpc":"2.0","method":"loaded","params":{"id":1,"frames":100000}},
+            {"jsonrpc":"2.0","id":3,"result":{"status":"OK"}},
+        ))
+
+    def test_sharkd_req_load_joined(self, sharkd_daemon, capture_file):
+        # A client that loads a capture already loaded by another one joins
+        # its session, and gets the same answers as for a load of its own.
+        first = sharkd_daemon()
+        self.assertEqual(sharkd_client_session(first, (
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap')}
+            },
+        ), 1), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+        ))
+        second = sharkd_daemon()
+        self.assertEqual(sharkd_client_session(second, (
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap'), "background": True}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"status"},
+        ), 3), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK","job":1}},
+            {"jsonrpc":"2.0","method":"loaded","params":{"id":1,"frames":4}},
+            {"jsonrpc":"2.0","id":2,"result":{"frames": 4, "duration": 0.070345000,
+                "filename": "dhcp.pcap", "filesize": 1400}},
+        ))
+        second.close()
+        first.close()
+
     def test_sharkd_bad_request(self, check_sharkd_session):
         check_sharkd_session((
             {"jsonrpc":"2.0", "id":1, "method":"dud"},
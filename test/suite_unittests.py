@@ -19,10 +19,22 @@ import fixtures
 
 @fixtures.uses_fixtures
 class case_unittests(subprocesstest.SubprocessTestCase):
+    def test_unit_dfilter_profile_test(self, program, base_env):
+        '''dfilter_profile_test'''
+        self.assertRun(program('dfilter_profile_test'), env=base_env)
+
+    def test_unit_epan_thread_test(self, program, base_env):
+        '''epan_thread_test'''
+        self.assertRun(program('epan_thread_test'), env=base_env)
+
     def test_unit_exntest(self, program, base_env):
         '''exntest'''
         self.assertRun(program('exntest'), env=base_env)
 
+    def test_unit_frame_data_table_test(self, program, base_env):
+        '''frame_data_table_test'''
+        self.assertRun(program('frame_data_table_test'), env=base_env)
+
     def test_unit_oids_test(self, program, base_env):
         '''oids_test'''
         self.assertRun(program('oids_test'), env=base_env)
@@ -31,10 +43,18 @@ class case_unittests(subprocesstest.SubprocessTestCase):
         '''reassemble_test'''
         self.assertRun(program('reassemble_test'), env=base_env)
 
+    def test_unit_tap_test(self, program, base_env):
+        '''tap_test'''
+        self.assertRun(program('tap_test'), env=base_env)
+
     def test_unit_tvbtest(self, program, base_env):
         '''tvbtest'''
         self.assertRun(program('tvbtest'), env=base_env)
 
+    def test_unit_value_string_test(self, program, base_env):
+        '''value_string_test'''
+        self.assertRun(program('value_string_test'), env=base_env)
+
     def test_unit_wmem_test(self, program, base_env):
         '''wmem_test'''
         self.assertRun((program('wmem_test'),
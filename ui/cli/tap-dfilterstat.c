@@ -0,0 +1,92 @@
+/* tap-dfilterstat.c
+ * Display filter execution statistics for tshark
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <glib.h>
+
+#include <epan/packet.h>
+#include <epan/tap.h>
+#include <epan/stat_tap_ui.h>
+#include <epan/dfilter/dfilter.h>
+
+#include <ui/cmdarg_err.h>
+
+void register_tap_listener_dfilterstat(void);
+
+/*
+ * The counters are kept by the display filter engine itself, so, as
+ * with heur,stat, we only need a listener on the frame tap to get our
+ * draw routine called at the end.
+ */
+static tap_packet_status
+dfilterstat_packet(void *tapdata _U_, packet_info *pinfo _U_, epan_dissect_t *edt _U_, const void *data _U_)
+{
+	return TAP_PACKET_DONT_REDRAW;
+}
+
+static void
+dfilterstat_draw(void *tapdata _U_)
+{
+	printf("\n");
+	printf("===================================================================\n");
+	printf("Display Filter Statistics:\n");
+	printf("For every instruction: how many times it ran, how often its result\n");
+	printf("was TRUE and the time spent in it.\n");
+	dfilter_print_all_profiles(stdout);
+	printf("===================================================================\n");
+}
+
+static void
+dfilterstat_init(const char *opt_arg _U_, void *userdata _U_)
+{
+	GString *error_string;
+
+	error_string = register_tap_listener("frame", NULL, NULL, TL_REQUIRES_NOTHING, NULL, dfilterstat_packet, dfilterstat_draw, NULL);
+	if (error_string) {
+		cmdarg_err("Couldn't register dfilter,stats tap: %s",
+			error_string->str);
+		g_string_free(error_string, TRUE);
+		exit(1);
+	}
+
+	dfilter_set_profiling(TRUE);
+}
+
+static stat_tap_ui dfilterstat_ui = {
+	REGISTER_STAT_GROUP_GENERIC,
+	NULL,
+	"dfilter,stats",
+	dfilterstat_init,
+	0,
+	NULL
+};
+
+void
+register_tap_listener_dfilterstat(void)
+{
+	register_stat_tap_ui(&dfilterstat_ui, NULL);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
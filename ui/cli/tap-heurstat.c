@@ -0,0 +1,107 @@
+/* tap-heurstat.c
+ * Heuristic dissector statistics for tshark
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <glib.h>
+
+#include <epan/packet.h>
+#include <epan/tap.h>
+#include <epan/stat_tap_ui.h>
+
+#include <ui/cmdarg_err.h>
+
+void register_tap_listener_heurstat(void);
+
+/*
+ * The counters are kept by dissector_try_heuristic() itself, so we only
+ * need a listener to get our draw routine called at the end; use the
+ * frame tap, which is always there.
+ */
+static tap_packet_status
+heurstat_packet(void *tapdata _U_, packet_info *pinfo _U_, epan_dissect_t *edt _U_, const void *data _U_)
+{
+	return TAP_PACKET_DONT_REDRAW;
+}
+
+static void
+heurstat_print_entry(const gchar *table_name, struct heur_dtbl_entry *entry, gpointer user_data _U_)
+{
+	if (entry->tried == 0)
+		return;
+
+	printf("%-16s %-32s %12" G_GUINT64_FORMAT " %12" G_GUINT64_FORMAT " %6.2f%%\n",
+	       table_name, entry->short_name, entry->tried, entry->accepted,
+	       100.0 * (double)entry->accepted / (double)entry->tried);
+}
+
+static void
+heurstat_print_table(const char *table_name, struct heur_dissector_list *table _U_, gpointer user_data _U_)
+{
+	heur_dissector_table_foreach(table_name, heurstat_print_entry, NULL);
+}
+
+static void
+heurstat_draw(void *tapdata _U_)
+{
+	printf("\n");
+	printf("===================================================================\n");
+	printf("Heuristic Dissector Statistics:\n");
+	printf("Only heuristic dissectors that were tried are listed; within a table\n");
+	printf("they are listed in the order in which they are currently tried.\n");
+	printf("%-16s %-32s %12s %12s %7s\n", "Table", "Heuristic", "Tried", "Accepted", "Rate");
+	dissector_all_heur_tables_foreach_table(heurstat_print_table, NULL, NULL);
+	printf("===================================================================\n");
+}
+
+static void
+heurstat_init(const char *opt_arg _U_, void *userdata _U_)
+{
+	GString *error_string;
+
+	error_string = register_tap_listener("frame", NULL, NULL, TL_REQUIRES_NOTHING, NULL, heurstat_packet, heurstat_draw, NULL);
+	if (error_string) {
+		cmdarg_err("Couldn't register heur,stat tap: %s",
+			error_string->str);
+		g_string_free(error_string, TRUE);
+		exit(1);
+	}
+}
+
+static stat_tap_ui heurstat_ui = {
+	REGISTER_STAT_GROUP_GENERIC,
+	NULL,
+	"heur,stat",
+	heurstat_init,
+	0,
+	NULL
+};
+
+void
+register_tap_listener_heurstat(void)
+{
+	register_stat_tap_ui(&heurstat_ui, NULL);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
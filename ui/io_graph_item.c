@@ -263,3 +263,76 @@ double get_io_graph_item(const io_graph_item_t *items_, io_graph_item_unit_t val
     }
     return value;
 }
+
+void merge_io_graph_item(io_graph_item_t *item, const io_graph_item_t *src, int item_unit)
+{
+    gboolean extreme = FALSE;
+
+    if (item->first_frame_in_invl == 0) {
+        item->first_frame_in_invl = src->first_frame_in_invl;
+    }
+    /* LOAD items can have a time without any frame. */
+    if (src->last_frame_in_invl != 0) {
+        item->last_frame_in_invl = src->last_frame_in_invl;
+    }
+
+    if (src->fields > 0) {
+        if (item->fields == 0) {
+            item->int_max    = src->int_max;
+            item->int_min    = src->int_min;
+            item->float_max  = src->float_max;
+            item->float_min  = src->float_min;
+            item->double_max = src->double_max;
+            item->double_min = src->double_min;
+            item->time_max   = src->time_max;
+            item->time_min   = src->time_min;
+            item->extreme_frame_in_invl = src->extreme_frame_in_invl;
+        } else {
+            /*
+             * Only the values of the field type were updated, the others
+             * are zero on both sides and never replace anything.
+             */
+            if (src->int_max > item->int_max) {
+                item->int_max = src->int_max;
+            }
+            if (src->int_min < item->int_min) {
+                item->int_min = src->int_min;
+            }
+            if (src->float_max > item->float_max) {
+                item->float_max = src->float_max;
+                extreme |= (item_unit == IOG_ITEM_UNIT_CALC_MAX);
+            }
+            if (src->float_min < item->float_min) {
+                item->float_min = src->float_min;
+                extreme |= (item_unit == IOG_ITEM_UNIT_CALC_MIN);
+            }
+            if (src->double_max > item->double_max) {
+                item->double_max = src->double_max;
+                extreme |= (item_unit == IOG_ITEM_UNIT_CALC_MAX);
+            }
+            if (src->double_min < item->double_min) {
+                item->double_min = src->double_min;
+                extreme |= (item_unit == IOG_ITEM_UNIT_CALC_MIN);
+            }
+            if (nstime_cmp(&src->time_max, &item->time_max) > 0) {
+                item->time_max = src->time_max;
+                extreme |= (item_unit == IOG_ITEM_UNIT_CALC_MAX);
+            }
+            if (nstime_cmp(&src->time_min, &item->time_min) < 0) {
+                item->time_min = src->time_min;
+                extreme |= (item_unit == IOG_ITEM_UNIT_CALC_MIN);
+            }
+            if (extreme) {
+                item->extreme_frame_in_invl = src->extreme_frame_in_invl;
+            }
+        }
+    }
+
+    item->frames     += src->frames;
+    item->bytes      += src->bytes;
+    item->fields     += src->fields;
+    item->int_tot    += src->int_tot;
+    item->float_tot  += src->float_tot;
+    item->double_tot += src->double_tot;
+    nstime_add(&item->time_tot, &src->time_tot);
+}
@@ -128,6 +128,20 @@ GString *check_field_unit(const char *field_name, int *hf_index, io_graph_item_u
  */
 double get_io_graph_item(const io_graph_item_t *items, io_graph_item_unit_t val_units, int idx, int hf_index, const capture_file *cap_file, int interval, int cur_idx);
 
+/** Merge the values of an io_graph_item_t into another one.
+ *
+ * Used to compute the items of an interval from the items of a finer
+ * interval that divides it, instead of tapping the packets again.
+ * LOAD values can be merged as well since the time spent in each finer
+ * interval is accounted to it.
+ *
+ * @param item [in,out] Item to update.
+ * @param src [in] Item of an interval included in the one of item,
+ *                 following the ones already merged into it.
+ * @param item_unit [in] The type of unit calculated. From IOG_ITEM_UNITS.
+ */
+void merge_io_graph_item(io_graph_item_t *item, const io_graph_item_t *src, int item_unit);
+
 /** Update the values of an io_graph_item_t.
  *
  * Frame and byte counts are always calculated. If edt is non-NULL advanced
@@ -90,8 +90,11 @@ ConversationDialog::ConversationDialog(QWidget &parent, CaptureFile &cf, int cli
     }
 
     // QTabWidget selects the first item by default.
+    bool need_retap = false;
     foreach (int conv_proto, conv_protos) {
-        addTrafficTable(get_conversation_by_proto_id(conv_proto));
+        if (addTrafficTable(get_conversation_by_proto_id(conv_proto))) {
+            need_retap = true;
+        }
     }
 
     fillTypeMenu(conv_protos);
@@ -104,7 +107,9 @@ ConversationDialog::ConversationDialog(QWidget &parent, CaptureFile &cf, int cli
     updateWidgets();
 //    currentTabChanged();
 
-    cap_file_.delayedRetapPackets();
+    if (need_retap) {
+        cap_file_.delayedRetapPackets();
+    }
 }
 
 ConversationDialog::~ConversationDialog()
@@ -194,6 +199,11 @@ bool ConversationDialog::addTrafficTable(register_ct_t* table)
                         get_conversation_packet_func(table),
                         ConversationTreeWidget::tapDraw);
 
+    if (fillFromFirstPass(conv_tree->trafficTreeHash(), table, false, filter)) {
+        ConversationTreeWidget::tapDraw(conv_tree->trafficTreeHash());
+        return false;
+    }
+
     return true;
 }
 
@@ -72,8 +72,11 @@ EndpointDialog::EndpointDialog(QWidget &parent, CaptureFile &cf, int cli_proto_i
     }
 
     // QTabWidget selects the first item by default.
+    bool need_retap = false;
     foreach (int endp_proto, endp_protos) {
-        addTrafficTable(get_conversation_by_proto_id(endp_proto));
+        if (addTrafficTable(get_conversation_by_proto_id(endp_proto))) {
+            need_retap = true;
+        }
     }
 
     fillTypeMenu(endp_protos);
@@ -86,7 +89,9 @@ EndpointDialog::EndpointDialog(QWidget &parent, CaptureFile &cf, int cli_proto_i
     updateWidgets();
 //    currentTabChanged();
 
-    cap_file_.delayedRetapPackets();
+    if (need_retap) {
+        cap_file_.delayedRetapPackets();
+    }
 }
 
 EndpointDialog::~EndpointDialog()
@@ -169,6 +174,12 @@ bool EndpointDialog::addTrafficTable(register_ct_t *table)
                         EndpointTreeWidget::tapReset,
                         get_hostlist_packet_func(table),
                         EndpointTreeWidget::tapDraw);
+
+    if (fillFromFirstPass(endp_tree->trafficTreeHash(), table, true, filter)) {
+        EndpointTreeWidget::tapDraw(endp_tree->trafficTreeHash());
+        return false;
+    }
+
     return true;
 }
 
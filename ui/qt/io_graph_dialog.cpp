@@ -1233,14 +1233,19 @@ void IOGraphDialog::on_intervalComboBox_currentIndexChanged(int)
 {
     int interval = ui->intervalComboBox->itemData(ui->intervalComboBox->currentIndex()).toInt();
     bool need_retap = false;
+    bool need_recalc = false;
 
     if (uat_model_ != NULL) {
         for (int row = 0; row < uat_model_->rowCount(); row++) {
             IOGraph *iog = ioGraphs_.value(row, NULL);
             if (iog) {
-                iog->setInterval(interval);
+                bool retap = iog->setInterval(interval);
                 if (iog->visible()) {
-                    need_retap = true;
+                    if (retap) {
+                        need_retap = true;
+                    } else {
+                        need_recalc = true;
+                    }
                 }
             }
         }
@@ -1248,6 +1253,8 @@ void IOGraphDialog::on_intervalComboBox_currentIndexChanged(int)
 
     if (need_retap) {
         scheduleRetap(true);
+    } else if (need_recalc) {
+        scheduleRecalc(true);
     }
 
     updateLegend();
@@ -2154,9 +2161,36 @@ bool IOGraph::hasItemToShow(int idx, double value) const
     return result;
 }
 
-void IOGraph::setInterval(int interval)
+bool IOGraph::setInterval(int interval)
 {
+    if (interval == interval_) {
+        return false;
+    }
+
+    // The items of an interval that divides the new one can be merged
+    // into the new items, unless packets were dropped past the last one.
+    if (cur_idx_ < 0 || cur_idx_ >= max_io_items_ - 1 ||
+            interval_ <= 0 || interval % interval_ != 0) {
+        interval_ = interval;
+        return true;
+    }
+
+    int factor = interval / interval_;
+    int num_items = cur_idx_ / factor + 1;
+
+    for (int idx = 0; idx < num_items; idx++) {
+        io_graph_item_t item;
+
+        reset_io_graph_items(&item, 1);
+        for (int src_idx = idx * factor; src_idx < (idx + 1) * factor && src_idx <= cur_idx_; src_idx++) {
+            merge_io_graph_item(&item, &items_[src_idx], val_units_);
+        }
+        items_[idx] = item;
+    }
+    reset_io_graph_items(&items_[num_items], cur_idx_ + 1 - num_items);
+    cur_idx_ = num_items - 1;
     interval_ = interval;
+    return false;
 }
 
 // Get the value at the given interval (idx) for the current value unit.
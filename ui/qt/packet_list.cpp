@@ -232,6 +232,7 @@ PacketList::PacketList(QWidget *parent) :
     rows_inserted_(false),
     columns_changed_(false),
     set_column_visibility_(false),
+    color_filters_hash_(color_filters_get_hash()),
     frozen_rows_(QModelIndexList()),
     cur_history_(-1),
     in_history_(false)
@@ -1180,7 +1181,16 @@ void PacketList::preferencesChanged()
 
 void PacketList::recolorPackets()
 {
-    packet_list_model_->resetColorized();
+    // Rows keep their colors until reset, so skip the reset if the
+    // coloring rules are the same as before.
+    guint hash = color_filters_get_hash();
+    if (hash != color_filters_hash_) {
+        color_filters_hash_ = hash;
+        packet_list_model_->resetColorized();
+        // Filters of frame.coloring_rule.* have other results now.
+        if (cap_file_)
+            dfilter_cache_clear(cap_file_->filter_cache);
+    }
     redrawVisiblePackets();
 }
 
@@ -136,6 +136,7 @@ private:
     bool rows_inserted_;
     bool columns_changed_;
     bool set_column_visibility_;
+    guint color_filters_hash_;
     QModelIndexList frozen_rows_;
     QVector<int> selection_history_;
     int cur_history_;
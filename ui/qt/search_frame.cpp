@@ -63,7 +63,7 @@ SearchFrame::SearchFrame(QWidget *parent) :
 SearchFrame::~SearchFrame()
 {
     if (regex_) {
-        g_regex_unref(regex_);
+        ws_regex_free(regex_);
     }
     delete sf_ui_;
 }
@@ -140,13 +140,18 @@ void SearchFrame::keyPressEvent(QKeyEvent *event)
 
 bool SearchFrame::regexCompile()
 {
-    int flags = (G_REGEX_OPTIMIZE);
+    unsigned flags = 0;
     if (!sf_ui_->caseCheckBox->isChecked()) {
-        flags |= G_REGEX_CASELESS;
+        flags |= WS_REGEX_CASELESS;
+    }
+    // The packet list and details are text, but the packet bytes
+    // are matched byte by byte so that binary data doesn't fail.
+    if (sf_ui_->searchInComboBox->currentIndex() != in_bytes_) {
+        flags |= WS_REGEX_UTF8;
     }
 
     if (regex_) {
-        g_regex_unref(regex_);
+        ws_regex_free(regex_);
     }
 
     if (sf_ui_->searchLineEdit->text().isEmpty()) {
@@ -154,12 +159,12 @@ bool SearchFrame::regexCompile()
         return false;
     }
 
-    GError *error = nullptr;
-    regex_ = g_regex_new(sf_ui_->searchLineEdit->text().toUtf8().constData(),
-                         (GRegexCompileFlags)flags, (GRegexMatchFlags) 0, &error);
-    if (error) {
-        regex_error_ = error->message;
-        g_error_free(error);
+    char *errmsg = nullptr;
+    regex_ = ws_regex_compile_ex(sf_ui_->searchLineEdit->text().toUtf8().constData(),
+                                 &errmsg, flags);
+    if (errmsg) {
+        regex_error_ = errmsg;
+        g_free(errmsg);
     }
 
     return regex_ ? true : false;
@@ -296,6 +301,7 @@ void SearchFrame::on_searchInComboBox_currentIndexChanged(int idx)
     default:
         break;
     }
+    regexCompile();
 }
 
 void SearchFrame::on_charEncodingComboBox_currentIndexChanged(int idx)
@@ -216,6 +216,15 @@ void TrafficTableDialog::on_displayFilterCheckBox_toggled(bool checked)
     cap_file_.retapPackets();
 }
 
+bool TrafficTableDialog::fillFromFirstPass(conv_hash_t *hash, register_ct_t *table, bool hostlist, const char *filter)
+{
+    if (!cap_file_.isValid() || (filter && filter[0] != '\0')) {
+        return false;
+    }
+
+    return conversation_table_first_pass_copy(cap_file_.capFile()->conv_tables, table, hostlist, hash);
+}
+
 void TrafficTableDialog::captureEvent(CaptureEvent e)
 {
     if (e.captureContext() == CaptureEvent::Retap)
@@ -132,8 +132,12 @@ protected:
     const QList<int> defaultProtos() const;
     static gboolean fillTypeMenuFunc(const void *key, void *value, void *userdata);
     void fillTypeMenu(QList<int> &enabled_protos);
-    // Adds a conversation tree. Returns true if the tree was freshly created, false if it was cached.
+    // Adds a conversation tree. Returns true if the tree was freshly created and
+    // needs a retap, false if it was cached or filled from the capture file's tables.
     virtual bool addTrafficTable(register_ct_t*) { return false; }
+    // Fills the table of a new tree from the one counted while the capture file
+    // was read, if any and if the tree isn't filtered. Returns true if it was filled.
+    bool fillFromFirstPass(conv_hash_t *hash, register_ct_t *table, bool hostlist, const char *filter);
     void addProgressFrame(QObject *parent);
 
     // UI getters
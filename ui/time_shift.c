@@ -290,6 +290,8 @@ time_shift_all(capture_file *cf, const gchar *offset_text)
         modify_time_perform(fd, neg ? SHIFT_NEG : SHIFT_POS, &offset, SHIFT_KEEPOFFSET);
     }
     cf->unsaved_changes = TRUE;
+    /* Filters of the times of the frames have other results now. */
+    dfilter_cache_clear(cf->filter_cache);
     packet_list_queue_draw();
 
     return NULL;
@@ -336,6 +338,7 @@ time_shift_settime(capture_file *cf, guint packet_num, const gchar *time_text)
     }
 
     cf->unsaved_changes = TRUE;
+    dfilter_cache_clear(cf->filter_cache);
     packet_list_queue_draw();
     return NULL;
 }
@@ -420,6 +423,7 @@ time_shift_adjtime(capture_file *cf, guint packet1_num, const gchar *time1_text,
     }
 
     cf->unsaved_changes = TRUE;
+    dfilter_cache_clear(cf->filter_cache);
     packet_list_queue_draw();
     return NULL;
 }
@@ -444,6 +448,7 @@ time_shift_undo(capture_file *cf)
             continue;   /* Shouldn't happen */
         modify_time_perform(fd, SHIFT_NEG, &nulltime, SHIFT_SETTOZERO);
     }
+    dfilter_cache_clear(cf->filter_cache);
     packet_list_queue_draw();
     return NULL;
 }
@@ -11,14 +11,46 @@
 #include "regex.h"
 
 #include <wsutil/ws_return.h>
+#include <wsutil/str_util.h>
 #include <pcre2.h>
 
 
 struct _ws_regex {
     pcre2_code *code;
     char *pattern;
+    /* A substring every match must contain, or NULL. */
+    char *literal;
+    size_t literal_len;
 };
 
+/* The literals shorter than this aren't worth a separate search. */
+#define LITERAL_MIN_LEN 2
+
+/*
+ * We don't use the matched substrings, only the offsets of the whole
+ * match, so each thread reuses a single match data block for every
+ * regex instead of allocating one for each match.
+ */
+static void
+free_match_data(gpointer data)
+{
+    pcre2_match_data_free((pcre2_match_data *)data);
+}
+
+static GPrivate thread_match_data = G_PRIVATE_INIT(free_match_data);
+
+static pcre2_match_data *
+get_match_data(void)
+{
+    pcre2_match_data *match_data = g_private_get(&thread_match_data);
+
+    if (match_data == NULL) {
+        match_data = pcre2_match_data_create(1, NULL);
+        g_private_set(&thread_match_data, match_data);
+    }
+    return match_data;
+}
+
 #define ERROR_MAXLEN_IN_CODE_UNITS   128
 
 static char *
@@ -43,16 +75,29 @@ get_error_msg(int errorcode)
 
 
 static pcre2_code *
-compile_pcre2(const char *patt, char **errmsg)
+compile_pcre2(const char *patt, unsigned flags, char **errmsg)
 {
     pcre2_code *code;
     int errorcode;
     PCRE2_SIZE erroroffset;
+    uint32_t options;
 
     /* By default UTF-8 is off. */
+    if (flags & WS_REGEX_UTF8) {
+        options = PCRE2_UTF;
+#ifdef PCRE2_MATCH_INVALID_UTF
+        options |= PCRE2_MATCH_INVALID_UTF;
+#endif
+    }
+    else {
+        options = PCRE2_NEVER_UTF;
+    }
+    if (flags & WS_REGEX_CASELESS)
+        options |= PCRE2_CASELESS;
+
     code = pcre2_compile_8((PCRE2_SPTR)patt,
                 PCRE2_ZERO_TERMINATED,
-                PCRE2_NEVER_UTF,
+                options,
                 &errorcode,
                 &erroroffset,
                 NULL);
@@ -62,37 +107,234 @@ compile_pcre2(const char *patt, char **errmsg)
         return NULL;
     }
 
+    /* Use the JIT compiler if it is available.  If it isn't, or fails,
+     * pcre2_match() uses the interpreter. */
+    pcre2_jit_compile(code, PCRE2_JIT_COMPLETE);
+
     return code;
 }
 
 
+/* Returns the "]" that ends the character class starting at p, or NULL. */
+static const char *
+skip_class(const char *p)
+{
+    p++;
+    /* A "]" right after "[" or "[^" is part of the class. */
+    if (*p == '^')
+        p++;
+    if (*p == ']')
+        p++;
+    for (; *p != '\0' && *p != ']'; p++) {
+        if (*p == '\\' && p[1] != '\0') {
+            p++;
+        }
+        else if (*p == '[' && p[1] == ':') {
+            /* POSIX class, e.g. "[:alpha:]" */
+            p = strstr(p, ":]");
+            if (p == NULL)
+                return NULL;
+            p++;
+        }
+    }
+    return *p == ']' ? p : NULL;
+}
+
+/*
+ * Returns the "}" of the repeat count "{n}", "{n,}" or "{n,m}" that
+ * starts at p, or NULL if p doesn't start one.
+ */
+static const char *
+skip_repeat_count(const char *p)
+{
+    p++;
+    if (!g_ascii_isdigit(*p))
+        return NULL;
+    while (g_ascii_isdigit(*p))
+        p++;
+    if (*p == ',') {
+        p++;
+        while (g_ascii_isdigit(*p))
+            p++;
+    }
+    return *p == '}' ? p : NULL;
+}
+
+/*
+ * Find the longest run of literal characters that every match of patt
+ * must contain.  This only looks at the top level of the pattern and
+ * gives up on anything it doesn't understand (alternatives, option
+ * settings, quoting, unusual escapes), so it can miss literals but
+ * never returns one that isn't required.
+ */
+static char *
+required_literal(const char *patt, size_t *literal_len)
+{
+    GString *run = g_string_new(NULL);
+    GString *best = g_string_new(NULL);
+    int depth = 0;
+    const char *p, *q;
+
+#define END_RUN() \
+    do { \
+        if (run->len > best->len) \
+            g_string_assign(best, run->str); \
+        g_string_truncate(run, 0); \
+    } while (0)
+
+    /* Options and lookarounds. */
+    if (strstr(patt, "(?") != NULL)
+        goto give_up;
+
+    for (p = patt; *p != '\0'; p++) {
+        if (depth > 0) {
+            /* Inside a group, which might be optional; skip it. */
+            if (*p == '\\' && p[1] != '\0')
+                p++;
+            else if (*p == '(')
+                depth++;
+            else if (*p == ')')
+                depth--;
+            else if (*p == '[' && (p = skip_class(p)) == NULL)
+                goto give_up;
+            continue;
+        }
+        switch (*p) {
+            case '|':
+                /* Alternatives; nothing is required. */
+                goto give_up;
+            case '{':
+                /* Anything but a repeat count is taken literally, and
+                 * might contain an alternative. */
+                if ((q = skip_repeat_count(p)) == NULL)
+                    goto give_up;
+                p = q;
+                /* FALLTHROUGH */
+            case '?':
+            case '*':
+                /* The previous character might be optional. */
+                if (run->len > 0)
+                    g_string_truncate(run, run->len - 1);
+                END_RUN();
+                break;
+            case '+':
+                /* The previous character is there at least once. */
+                END_RUN();
+                break;
+            case '(':
+                END_RUN();
+                depth++;
+                break;
+            case '[':
+                END_RUN();
+                p = skip_class(p);
+                if (p == NULL)
+                    goto give_up;
+                break;
+            case '.':
+            case '^':
+            case '$':
+            case ')':
+                END_RUN();
+                break;
+            case '\\':
+                p++;
+                if (*p == '\0') {
+                    goto give_up;
+                }
+                else if (g_ascii_isdigit(*p)) {
+                    /* Back reference or octal character code. */
+                    END_RUN();
+                    while (g_ascii_isdigit(p[1]))
+                        p++;
+                }
+                else if (g_ascii_isalnum(*p)) {
+                    /* Character types and assertions.  Give up on the
+                     * escapes that take arguments and on quoting. */
+                    if (strchr("dDsSwWhHvVRXNbBAzZGKaefnrt", *p) == NULL)
+                        goto give_up;
+                    END_RUN();
+                }
+                else {
+                    g_string_append_c(run, *p);
+                }
+                break;
+            default:
+                g_string_append_c(run, *p);
+                break;
+        }
+    }
+    END_RUN();
+    goto done;
+
+give_up:
+    /* What was found so far might be part of an alternative. */
+    g_string_truncate(best, 0);
+done:
+#undef END_RUN
+    g_string_free(run, TRUE);
+    if (best->len < LITERAL_MIN_LEN) {
+        g_string_free(best, TRUE);
+        *literal_len = 0;
+        return NULL;
+    }
+    *literal_len = best->len;
+    return g_string_free(best, FALSE);
+}
+
+
 ws_regex_t *
 ws_regex_compile(const char *patt, char **errmsg)
+{
+    return ws_regex_compile_ex(patt, errmsg, 0);
+}
+
+
+ws_regex_t *
+ws_regex_compile_ex(const char *patt, char **errmsg, unsigned flags)
 {
     ws_return_val_if_null(patt, NULL);
 
-    pcre2_code *code = compile_pcre2(patt, errmsg);
+    pcre2_code *code = compile_pcre2(patt, flags, errmsg);
     if (code == NULL)
         return NULL;
 
     ws_regex_t *re = g_new(ws_regex_t, 1);
     re->code = code;
     re->pattern = g_strdup(patt);
+    if (flags & WS_REGEX_CASELESS) {
+        re->literal = NULL;
+        re->literal_len = 0;
+    }
+    else {
+        re->literal = required_literal(patt, &re->literal_len);
+    }
     return re;
 }
 
 
 static bool
-match_pcre2(pcre2_code *code, PCRE2_SPTR subject, PCRE2_SIZE length)
+match_pcre2(const ws_regex_t *re, PCRE2_SPTR subject, PCRE2_SIZE length,
+                size_t *pos_vect)
 {
     pcre2_match_data *match_data;
+    PCRE2_SIZE *ovector;
     int rc;
 
+    /* Rule out the subjects that don't contain the required literal
+     * with a (much faster) plain search. */
+    if (re->literal != NULL) {
+        if (length == PCRE2_ZERO_TERMINATED)
+            length = strlen((const char *)subject);
+        if (ws_memmem(subject, length, re->literal, re->literal_len) == NULL)
+            return FALSE;
+    }
+
     /* We don't use the matched substring but pcre2_match requires
      * at least one pair of offsets. */
-    match_data = pcre2_match_data_create(1, NULL);
+    match_data = get_match_data();
 
-    rc = pcre2_match(code,
+    rc = pcre2_match(re->code,
                     subject,
                     length,
                     0,          /* start at offset zero of the subject */
@@ -100,7 +342,18 @@ match_pcre2(pcre2_code *code, PCRE2_SPTR subject, PCRE2_SIZE length)
                     match_data,
                     NULL);
 
-    pcre2_match_data_free(match_data);
+    if (rc == PCRE2_ERROR_JIT_STACKLIMIT) {
+        /* Patterns that backtrack a lot over long subjects can run out
+         * of the (small) default JIT stack; the interpreter keeps its
+         * backtracking data on the heap, so it can still do those. */
+        rc = pcre2_match(re->code,
+                        subject,
+                        length,
+                        0,
+                        PCRE2_NO_JIT,
+                        match_data,
+                        NULL);
+    }
 
     if (rc < 0) {
         /* No match */
@@ -115,6 +368,11 @@ match_pcre2(pcre2_code *code, PCRE2_SPTR subject, PCRE2_SIZE length)
     }
 
     /* Matched */
+    if (pos_vect != NULL) {
+        ovector = pcre2_get_ovector_pointer(match_data);
+        pos_vect[0] = ovector[0];
+        pos_vect[1] = ovector[1];
+    }
     return TRUE;
 }
 
@@ -125,7 +383,7 @@ ws_regex_matches(const ws_regex_t *re, const char *subj)
     ws_return_val_if_null(re, FALSE);
     ws_return_val_if_null(subj, FALSE);
 
-    return match_pcre2(re->code, (PCRE2_SPTR)subj, PCRE2_ZERO_TERMINATED);
+    return match_pcre2(re, (PCRE2_SPTR)subj, PCRE2_ZERO_TERMINATED, NULL);
 }
 
 
@@ -136,7 +394,19 @@ ws_regex_matches_length(const ws_regex_t *re,
     ws_return_val_if_null(re, FALSE);
     ws_return_val_if_null(subj, FALSE);
 
-    return match_pcre2(re->code, (PCRE2_SPTR)subj, (PCRE2_SIZE)subj_length);
+    return match_pcre2(re, (PCRE2_SPTR)subj, (PCRE2_SIZE)subj_length, NULL);
+}
+
+
+bool
+ws_regex_matches_pos(const ws_regex_t *re,
+                        const char *subj, size_t subj_length,
+                        size_t pos_vect[2])
+{
+    ws_return_val_if_null(re, FALSE);
+    ws_return_val_if_null(subj, FALSE);
+
+    return match_pcre2(re, (PCRE2_SPTR)subj, (PCRE2_SIZE)subj_length, pos_vect);
 }
 
 
@@ -145,6 +415,7 @@ ws_regex_free(ws_regex_t *re)
 {
     pcre2_code_free(re->code);
     g_free(re->pattern);
+    g_free(re->literal);
     g_free(re);
 }
 
@@ -22,6 +22,16 @@ typedef struct _ws_regex ws_regex_t;
 WS_DLL_PUBLIC ws_regex_t *
 ws_regex_compile(const char *patt, char **errmsg);
 
+#define WS_REGEX_CASELESS   (1U << 0)
+/* Match UTF-8 characters rather than bytes, e.g. for "." or [^x].
+ * Subjects that aren't valid UTF-8 don't match unless the PCRE2 library
+ * supports PCRE2_MATCH_INVALID_UTF. */
+#define WS_REGEX_UTF8       (1U << 1)
+
+/** Compiles with the WS_REGEX_xxx flags. */
+WS_DLL_PUBLIC ws_regex_t *
+ws_regex_compile_ex(const char *patt, char **errmsg, unsigned flags);
+
 /** Matches a null-terminated subject string. */
 WS_DLL_PUBLIC bool
 ws_regex_matches(const ws_regex_t *re, const char *subj);
@@ -31,6 +41,14 @@ WS_DLL_PUBLIC bool
 ws_regex_matches_length(const ws_regex_t *re,
                         const char *subj, size_t subj_length);
 
+/** Matches a subject string length in 8 bit code units and, if it
+ * matches, sets pos_vect to the offsets of the start and the end
+ * of the match. */
+WS_DLL_PUBLIC bool
+ws_regex_matches_pos(const ws_regex_t *re,
+                        const char *subj, size_t subj_length,
+                        size_t pos_vect[2]);
+
 WS_DLL_PUBLIC void
 ws_regex_free(ws_regex_t *re);
 
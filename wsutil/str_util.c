@@ -16,6 +16,8 @@
 
 #include <wsutil/to_str.h>
 
+#include "ws_memmem_int.h"
+
 gchar *
 wmem_strconcat(wmem_allocator_t *allocator, const gchar *first, ...)
 {
@@ -315,6 +317,14 @@ const guint8 *
 ws_memmem(const void *_haystack, size_t haystack_len,
                 const void *_needle, size_t needle_len)
 {
+#ifdef HAVE_SSE2
+    /* Worth it once there are 16 candidate positions. */
+    if (needle_len != 0 && haystack_len >= needle_len + 15 &&
+            ws_memmem_sse2_supported())
+        return ws_memmem_sse2((const guint8 *)_haystack, haystack_len,
+                              (const guint8 *)_needle, needle_len);
+#endif
+
 #ifdef HAVE_MEMMEM
     return memmem(_haystack, haystack_len, _needle, needle_len);
 #else
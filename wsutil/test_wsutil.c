@@ -9,6 +9,7 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <glib.h>
 #include <wsutil/utf8_entities.h>
 
@@ -124,6 +125,29 @@ static void test_str_ascii(void)
 
 #include "to_str.h"
 
+static void test_memmem(void)
+{
+    /* Long enough for the vectorized search, with partial matches
+     * (same first and last byte) before the match and in the tail. */
+    const char *haystack = "passwxpasswd-a-passwd-passxd-passwd";
+    const guint8 *p;
+
+    p = ws_memmem(haystack, strlen(haystack), "passwd", 6);
+    g_assert_true(p == (const guint8 *)haystack + 6);
+
+    p = ws_memmem(haystack, strlen(haystack), "xd-passwd", 9);
+    g_assert_true(p == (const guint8 *)haystack + 26);
+
+    p = ws_memmem(haystack, strlen(haystack), "d", 1);
+    g_assert_true(p == (const guint8 *)haystack + 11);
+
+    p = ws_memmem(haystack, strlen(haystack), "passwd!", 7);
+    g_assert_null(p);
+
+    p = ws_memmem(haystack, 10, "passwd", 6);
+    g_assert_null(p);
+}
+
 static void test_word_to_hex(void)
 {
     static char buf[32];
@@ -438,6 +462,81 @@ static void test_int64_to_str_back(void)
     g_assert_cmpstr(str, ==, "9223372036854775807");
 }
 
+#include "regex.h"
+
+static void test_regex_utf8(void)
+{
+    ws_regex_t *re;
+    char *errmsg = NULL;
+
+    /* Without WS_REGEX_UTF8, "." matches a byte... */
+    re = ws_regex_compile("^.$", &errmsg);
+    g_assert_nonnull(re);
+    g_assert_false(ws_regex_matches(re, "\xc3\xa9"));
+    g_assert_true(ws_regex_matches_length(re, "\xff", 1));
+    ws_regex_free(re);
+
+    /* ...with it, a character. */
+    re = ws_regex_compile_ex("^.$", &errmsg, WS_REGEX_UTF8);
+    g_assert_nonnull(re);
+    g_assert_true(ws_regex_matches(re, "\xc3\xa9"));
+    g_assert_false(ws_regex_matches(re, "ab"));
+    ws_regex_free(re);
+
+    re = ws_regex_compile_ex("\xc3\x89t\xc3\xa9", &errmsg, WS_REGEX_UTF8 | WS_REGEX_CASELESS);
+    g_assert_nonnull(re);
+    g_assert_true(ws_regex_matches(re, "un \xc3\xa9t\xc3\xa9 chaud"));
+    ws_regex_free(re);
+}
+
+static void test_regex_jit_stack(void)
+{
+    ws_regex_t *re;
+    char *errmsg = NULL;
+    char *subj;
+
+    /* Each repetition of the group needs some backtracking space, more
+     * than the default JIT stack has for a subject that long. */
+    re = ws_regex_compile("^(a|b)*c$", &errmsg);
+    g_assert_nonnull(re);
+    subj = g_strnfill(20000, 'a');
+    subj[19999] = 'c';
+    g_assert_true(ws_regex_matches(re, subj));
+    subj[19999] = 'a';
+    g_assert_false(ws_regex_matches(re, subj));
+    g_free(subj);
+    ws_regex_free(re);
+}
+
+static void test_regex_alternatives(void)
+{
+    ws_regex_t *re;
+    char *errmsg = NULL;
+
+    /* The literal before an escape that isn't understood is not
+     * required if an alternative follows. */
+    re = ws_regex_compile("abc\\x41|zzz", &errmsg);
+    g_assert_nonnull(re);
+    g_assert_true(ws_regex_matches(re, "abcA"));
+    g_assert_true(ws_regex_matches(re, "only zzz"));
+    g_assert_false(ws_regex_matches(re, "abc"));
+    ws_regex_free(re);
+
+    /* "{" that doesn't start a repeat count is a literal character. */
+    re = ws_regex_compile("xyz{b|q}", &errmsg);
+    g_assert_nonnull(re);
+    g_assert_true(ws_regex_matches(re, "xyz{b"));
+    g_assert_true(ws_regex_matches(re, "q}"));
+    g_assert_false(ws_regex_matches(re, "xyz"));
+    ws_regex_free(re);
+
+    re = ws_regex_compile("abcd{2}e", &errmsg);
+    g_assert_nonnull(re);
+    g_assert_true(ws_regex_matches(re, "abcdde"));
+    g_assert_false(ws_regex_matches(re, "abcde"));
+    ws_regex_free(re);
+}
+
 #include "ws_getopt.h"
 
 #define ARGV_MAX 31
@@ -622,6 +721,7 @@ int main(int argc, char **argv)
     g_test_add_func("/str_util/strconcat", test_strconcat);
     g_test_add_func("/str_util/strsplit", test_strsplit);
     g_test_add_func("/str_util/str_ascii", test_str_ascii);
+    g_test_add_func("/str_util/memmem", test_memmem);
 
     g_test_add_func("/to_str/word_to_hex", test_word_to_hex);
     g_test_add_func("/to_str/bytes_to_str", test_bytes_to_str);
@@ -641,6 +741,10 @@ int main(int argc, char **argv)
     g_test_add_func("/to_str/int_to_str_back", test_int_to_str_back);
     g_test_add_func("/to_str/int64_to_str_back", test_int64_to_str_back);
 
+    g_test_add_func("/regex/utf8", test_regex_utf8);
+    g_test_add_func("/regex/jit_stack", test_regex_jit_stack);
+    g_test_add_func("/regex/alternatives", test_regex_alternatives);
+
     g_test_add_func("/ws_getopt/basic1", test_getopt_long_basic1);
     g_test_add_func("/ws_getopt/basic2", test_getopt_long_basic2);
     g_test_add_func("/ws_getopt/optional1", test_getopt_optional_argument1);
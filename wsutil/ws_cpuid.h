@@ -89,7 +89,7 @@ ws_cpuid(guint32 *CPUInfo _U_, int selector _U_)
 }
 #endif
 
-static int
+static inline int
 ws_cpuid_sse42(void)
 {
 	guint32 CPUInfo[4];
@@ -100,3 +100,15 @@ ws_cpuid_sse42(void)
 	/* in ECX bit 20 toggled on */
 	return (CPUInfo[2] & (1 << 20));
 }
+
+static inline int
+ws_cpuid_sse2(void)
+{
+	guint32 CPUInfo[4];
+
+	if (!ws_cpuid(CPUInfo, 1))
+		return 0;
+
+	/* in EDX bit 26 toggled on */
+	return (CPUInfo[3] & (1 << 26));
+}
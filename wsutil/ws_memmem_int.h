@@ -0,0 +1,19 @@
+/** @file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WS_MEMMEM_INT_H__
+#define __WS_MEMMEM_INT_H__
+
+#ifdef HAVE_SSE2
+gboolean ws_memmem_sse2_supported(void);
+/* needle_len must be at least 1 and haystack_len at least needle_len. */
+const guint8 *ws_memmem_sse2(const guint8 *haystack, size_t haystack_len, const guint8 *needle, size_t needle_len);
+#endif
+
+#endif /* __WS_MEMMEM_INT_H__ */
@@ -0,0 +1,126 @@
+/* ws_memmem_sse2.c
+ * Substring search with SSE2 intrinsics
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/*
+ * This compares 16 candidate positions at a time: a position can only
+ * start a match if the haystack has the first byte of the needle there
+ * and the last byte of the needle needle_len - 1 bytes further.  Only the
+ * positions that pass both tests are checked with memcmp(), so for
+ * typical data this runs close to memory bandwidth.
+ *
+ * See "SIMD-friendly algorithms for substring searching" by Wojciech Mula,
+ * http://0x80.pl/articles/simd-strfind.html
+ */
+
+#include "config.h"
+
+#ifdef HAVE_SSE2
+
+#include <glib.h>
+#include "ws_cpuid.h"
+
+#include <emmintrin.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "ws_memmem_int.h"
+
+#define cast_128aligned__m128i(p) ((const __m128i *) (const void *) (p))
+
+static inline unsigned
+lowest_bit(unsigned mask)
+{
+#if defined(__GNUC__)
+	return (unsigned) __builtin_ctz(mask);
+#elif defined(_MSC_VER)
+	unsigned long bit;
+
+	_BitScanForward(&bit, mask);
+	return (unsigned) bit;
+#else
+	unsigned bit = 0;
+
+	while (!(mask & 1)) {
+		mask >>= 1;
+		bit++;
+	}
+	return bit;
+#endif
+}
+
+gboolean
+ws_memmem_sse2_supported(void)
+{
+	static int supported = -1;
+
+	if (supported == -1)
+		supported = ws_cpuid_sse2() ? 1 : 0;
+
+	return supported;
+}
+
+const guint8 *
+ws_memmem_sse2(const guint8 *haystack, size_t haystack_len,
+		const guint8 *needle, size_t needle_len)
+{
+	const __m128i first = _mm_set1_epi8((char) needle[0]);
+	const __m128i last = _mm_set1_epi8((char) needle[needle_len - 1]);
+	size_t i;
+
+	/* Both loads of a block must stay inside the haystack. */
+	for (i = 0; i + needle_len + 15 <= haystack_len; i += 16) {
+		/* _mm_loadu_si128() works with unaligned data, cast safe */
+		const __m128i block_first = _mm_loadu_si128(cast_128aligned__m128i(haystack + i));
+		const __m128i block_last = _mm_loadu_si128(cast_128aligned__m128i(haystack + i + needle_len - 1));
+		unsigned mask;
+
+		mask = (unsigned) _mm_movemask_epi8(_mm_and_si128(
+					_mm_cmpeq_epi8(first, block_first),
+					_mm_cmpeq_epi8(last, block_last)));
+
+		while (mask != 0) {
+			const guint8 *candidate = haystack + i + lowest_bit(mask);
+
+			/* The first and last bytes are known to match. */
+			if (needle_len <= 2 ||
+			    memcmp(candidate + 1, needle + 1, needle_len - 2) == 0)
+				return candidate;
+
+			mask &= mask - 1;
+		}
+	}
+
+	/* Fewer than 16 candidate positions are left. */
+	for (; i + needle_len <= haystack_len; i++) {
+		if (haystack[i] == needle[0] &&
+		    memcmp(haystack + i + 1, needle + 1, needle_len - 1) == 0)
+			return haystack + i;
+	}
+
+	return NULL;
+}
+
+#endif /* HAVE_SSE2 */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */